@@ -28,6 +28,19 @@
 
 #include <freerdp/freerdp.h>
 #include <freerdp/channels/drdynvc.h>
+#include <freerdp/channels/ainput.h>
+#include <freerdp/channels/audin.h>
+#include <freerdp/channels/disp.h>
+#include <freerdp/channels/geometry.h>
+#include <freerdp/channels/gfxredir.h>
+#include <freerdp/channels/rdpecam.h>
+#include <freerdp/channels/rdpei.h>
+#include <freerdp/channels/rdpemsc.h>
+#include <freerdp/channels/rdpgfx.h>
+#include <freerdp/channels/rdpsnd.h>
+#include <freerdp/channels/tsmf.h>
+#include <freerdp/channels/urbdrc.h>
+#include <freerdp/channels/video.h>
 #include <freerdp/utils/drdynvc.h>
 
 #include "drdynvc_main.h"
@@ -35,11 +48,13 @@
 #define TAG CHANNELS_TAG("drdynvc.client")
 
 static void dvcman_channel_free(DVCMAN_CHANNEL* channel);
+static void dvcman_channel_unref(DVCMAN_CHANNEL* channel);
 static UINT dvcman_channel_close(DVCMAN_CHANNEL* channel, BOOL perRequest, BOOL fromHashTableFn);
 static void dvcman_free(drdynvcPlugin* drdynvc, IWTSVirtualChannelManager* pChannelMgr);
 static UINT drdynvc_write_data(drdynvcPlugin* drdynvc, UINT32 ChannelId, const BYTE* data,
                                UINT32 dataSize, BOOL* close);
 static UINT drdynvc_send(drdynvcPlugin* drdynvc, wStream* s);
+static void drdynvc_lanes_stop(drdynvcPlugin* drdynvc);
 
 static void dvcman_wtslistener_free(DVCMAN_LISTENER* listener)
 {
@@ -280,7 +295,7 @@ static void channelByIdCleanerFn(void* value)
 	if (channel)
 	{
 		dvcman_channel_close(channel, FALSE, TRUE);
-		dvcman_channel_free(channel);
+		dvcman_channel_unref(channel);
 	}
 }
 
@@ -390,6 +405,7 @@ static void dvcman_channel_free(DVCMAN_CHANNEL* channel)
 	if (channel->dvc_data)
 		Stream_Release(channel->dvc_data);
 
+	DeleteCriticalSection(&(channel->dispatch_lock));
 	DeleteCriticalSection(&(channel->lock));
 	free(channel->channel_name);
 	free(channel);
@@ -401,9 +417,47 @@ static void dvcman_channel_unref(DVCMAN_CHANNEL* channel)
 	if (InterlockedDecrement(&channel->refCounter))
 		return;
 
+	dvcman_channel_free(channel);
+}
+
+/**
+ * Drops the reference held by channelsById. Queued lane messages may keep the channel alive
+ * after that, so the entry is only removed if it still refers to this channel: the server is
+ * free to reuse the ChannelId once the channel was closed.
+ */
+static void dvcman_channel_remove(DVCMAN_CHANNEL* channel)
+{
+	WINPR_ASSERT(channel);
 	DVCMAN* dvcman = channel->dvcman;
-	if (dvcman)
+	WINPR_ASSERT(dvcman);
+
+	HashTable_Lock(dvcman->channelsById);
+	if (HashTable_GetItemValue(dvcman->channelsById, &channel->channel_id) == channel)
 		HashTable_Remove(dvcman->channelsById, &channel->channel_id);
+	HashTable_Unlock(dvcman->channelsById);
+}
+
+/* Every message queued on a bounded lane holds a lane slot, returned either when the lane
+ * picks the message up or when the channel is closed, whichever comes first. */
+static void dvcman_channel_release_slot(DVCMAN_CHANNEL* channel, DRDYNVC_LANE* lane)
+{
+	WINPR_ASSERT(channel);
+	WINPR_ASSERT(lane);
+
+	if (!lane->slots)
+		return;
+
+	LONG queued = channel->queued;
+	while (queued > 0)
+	{
+		const LONG prev = InterlockedCompareExchange(&channel->queued, queued - 1, queued);
+		if (prev == queued)
+		{
+			(void)ReleaseSemaphore(lane->slots, 1, NULL);
+			return;
+		}
+		queued = prev;
+	}
 }
 
 static UINT dvcchannel_send_close(DVCMAN_CHANNEL* channel)
@@ -457,9 +511,14 @@ static UINT dvcman_call_on_receive(DVCMAN_CHANNEL* channel, wStream* data)
 static UINT dvcman_channel_close(DVCMAN_CHANNEL* channel, BOOL perRequest, BOOL fromHashTableFn)
 {
 	UINT error = CHANNEL_RC_OK;
+	BOOL remove = FALSE;
 	DrdynvcClientContext* context = NULL;
 
 	WINPR_ASSERT(channel);
+
+	/* A dispatch lane might be delivering data to this channel right now,
+	 * wait for it to finish before tearing down the callback. */
+	EnterCriticalSection(&channel->dispatch_lock);
 	switch (channel->state)
 	{
 		case DVC_CHANNEL_INIT:
@@ -483,6 +542,17 @@ static UINT dvcman_channel_close(DVCMAN_CHANNEL* channel, BOOL perRequest, BOOL
 
 					WLog_Print(drdynvc->log, WLOG_DEBUG, msg, channel->channel_name);
 				}
+
+				/* the lane discards messages of closed channels, do not let them block it */
+				DRDYNVC_LANE* lane = &drdynvc->lanes[channel->lane];
+				const LONG dropped = InterlockedExchange(&channel->queued, 0);
+				if (dropped > 0)
+				{
+					WLog_Print(drdynvc->log, WLOG_DEBUG,
+					           "[%s] dropping %" PRId32 " queued messages for '%s'", lane->name,
+					           dropped, channel->channel_name);
+					(void)ReleaseSemaphore(lane->slots, dropped, NULL);
+				}
 			}
 
 			channel->state = DVC_CHANNEL_CLOSED;
@@ -505,18 +575,52 @@ static UINT dvcman_channel_close(DVCMAN_CHANNEL* channel, BOOL perRequest, BOOL
 				}
 			}
 
-			if (!fromHashTableFn)
-				dvcman_channel_unref(channel);
+			remove = !fromHashTableFn;
 			break;
 		case DVC_CHANNEL_CLOSED:
 			break;
 		default:
 			break;
 	}
+	LeaveCriticalSection(&channel->dispatch_lock);
+
+	/* might free the channel, so do this after the lock was released */
+	if (remove)
+		dvcman_channel_remove(channel);
 
 	return error;
 }
 
+static size_t drdynvc_lane_for_channel(const char* name)
+{
+	static const char* realtime[] = { RDPEI_DVC_CHANNEL_NAME,  AINPUT_DVC_CHANNEL_NAME,
+		                              RDPSND_DVC_CHANNEL_NAME, RDPSND_LOSSY_DVC_CHANNEL_NAME,
+		                              AUDIN_DVC_CHANNEL_NAME,  DISP_DVC_CHANNEL_NAME,
+		                              RDPEMSC_DVC_CHANNEL_NAME };
+	/* geometry and video must stay on the same lane, video data refers to geometry mappings */
+	static const char* bulk[] = { RDPGFX_DVC_CHANNEL_NAME,     VIDEO_CONTROL_DVC_CHANNEL_NAME,
+		                          VIDEO_DATA_DVC_CHANNEL_NAME, GEOMETRY_DVC_CHANNEL_NAME,
+		                          GFXREDIR_DVC_CHANNEL_NAME,   TSMF_DVC_CHANNEL_NAME,
+		                          URBDRC_DVC_CHANNEL_NAME,     RDPECAM_DVC_CHANNEL_NAME };
+
+	if (!name)
+		return DRDYNVC_LANE_DEFAULT;
+
+	for (size_t x = 0; x < ARRAYSIZE(realtime); x++)
+	{
+		if (strcmp(name, realtime[x]) == 0)
+			return DRDYNVC_LANE_REALTIME;
+	}
+
+	for (size_t x = 0; x < ARRAYSIZE(bulk); x++)
+	{
+		if (strcmp(name, bulk[x]) == 0)
+			return DRDYNVC_LANE_BULK;
+	}
+
+	return DRDYNVC_LANE_DEFAULT;
+}
+
 static DVCMAN_CHANNEL* dvcman_channel_new(WINPR_ATTR_UNUSED drdynvcPlugin* drdynvc,
                                           IWTSVirtualChannelManager* pChannelMgr, UINT32 ChannelId,
                                           const char* ChannelName)
@@ -539,9 +643,14 @@ static DVCMAN_CHANNEL* dvcman_channel_new(WINPR_ATTR_UNUSED drdynvcPlugin* drdyn
 	if (!channel->channel_name)
 		goto fail;
 
+	channel->lane = drdynvc_lane_for_channel(ChannelName);
+
 	if (!InitializeCriticalSectionEx(&(channel->lock), 0, 0))
 		goto fail;
 
+	if (!InitializeCriticalSectionEx(&(channel->dispatch_lock), 0, 0))
+		goto fail;
+
 	return channel;
 fail:
 	dvcman_channel_free(channel);
@@ -728,7 +837,8 @@ static DVCMAN_CHANNEL* dvcman_create_channel(drdynvcPlugin* drdynvc,
 		WLog_Print(drdynvc->log, WLOG_ERROR,
 		           "OnNewChannelConnection failed with error %" PRIu32 "!", *res);
 		*res = ERROR_INTERNAL_ERROR;
-		dvcman_channel_unref(channel);
+		dvcman_channel_remove(channel);
+		channel = NULL;
 		goto out;
 	}
 
@@ -736,7 +846,7 @@ static DVCMAN_CHANNEL* dvcman_create_channel(drdynvcPlugin* drdynvc,
 	{
 		WLog_Print(drdynvc->log, WLOG_ERROR, "OnNewChannelConnection returned with bAccept FALSE!");
 		*res = ERROR_INTERNAL_ERROR;
-		dvcman_channel_unref(channel);
+		dvcman_channel_remove(channel);
 		channel = NULL;
 		goto out;
 	}
@@ -822,6 +932,74 @@ static UINT dvcman_receive_channel_data_first(DVCMAN_CHANNEL* channel, UINT32 le
 	return CHANNEL_RC_OK;
 }
 
+static UINT dvcman_deliver_channel_data(DVCMAN_CHANNEL* channel, wStream* data)
+{
+	UINT status = CHANNEL_RC_OK;
+
+	WINPR_ASSERT(channel);
+
+	EnterCriticalSection(&channel->dispatch_lock);
+	if ((channel->state == DVC_CHANNEL_RUNNING) && channel->channel_callback)
+		status = dvcman_call_on_receive(channel, data);
+	LeaveCriticalSection(&channel->dispatch_lock);
+	return status;
+}
+
+/**
+ * Function description
+ *
+ * Hands a complete channel message to the dispatch lane of the channel.
+ * Ownership of \b data is transferred.
+ *
+ * @return 0 on success, otherwise a Win32 error code
+ */
+static UINT dvcman_dispatch_channel_data(DVCMAN_CHANNEL* channel, wStream* data)
+{
+	WINPR_ASSERT(channel);
+	WINPR_ASSERT(channel->dvcman);
+
+	drdynvcPlugin* drdynvc = channel->dvcman->drdynvc;
+	WINPR_ASSERT(drdynvc);
+	WINPR_ASSERT(channel->lane < DRDYNVC_LANE_COUNT);
+
+	DRDYNVC_LANE* lane = &drdynvc->lanes[channel->lane];
+	if (!lane->thread)
+	{
+		const UINT status = dvcman_deliver_channel_data(channel, data);
+		Stream_Release(data);
+		return status;
+	}
+
+	/* Only the bulk lane is bounded: waiting for it stalls every other lane behind it, which is
+	 * acceptable for graphics data but never for input, audio or control messages. */
+	if (lane->slots)
+	{
+		HANDLE handles[] = { lane->slots, lane->thread };
+		const DWORD rc = WaitForMultipleObjects(ARRAYSIZE(handles), handles, FALSE, INFINITE);
+		if (rc != WAIT_OBJECT_0)
+		{
+			WLog_Print(drdynvc->log, WLOG_ERROR, "[%s] lane not available for '%s'", lane->name,
+			           channel->channel_name);
+			Stream_Release(data);
+			return ERROR_INTERNAL_ERROR;
+		}
+
+		InterlockedIncrement(&channel->queued);
+	}
+
+	InterlockedIncrement(&channel->refCounter);
+	if (!MessageQueue_Post(lane->queue, NULL, 0, channel, data))
+	{
+		WLog_Print(drdynvc->log, WLOG_ERROR, "[%s] MessageQueue_Post failed!", lane->name);
+		dvcman_channel_release_slot(channel, lane);
+		dvcman_channel_unref(channel);
+		Stream_Release(data);
+		return ERROR_INTERNAL_ERROR;
+	}
+
+	return CHANNEL_RC_OK;
+}
+
 /**
  * Function description
  *
@@ -853,16 +1031,33 @@ static UINT dvcman_receive_channel_data(DVCMAN_CHANNEL* channel, wStream* data,
 
 		if (Stream_GetPosition(channel->dvc_data) >= channel->dvc_data_length)
 		{
-			Stream_SealLength(channel->dvc_data);
-			Stream_SetPosition(channel->dvc_data, 0);
-
-			status = dvcman_call_on_receive(channel, channel->dvc_data);
-			Stream_Release(channel->dvc_data);
+			wStream* complete = channel->dvc_data;
 			channel->dvc_data = NULL;
+
+			Stream_SealLength(complete);
+			Stream_SetPosition(complete, 0);
+			status = dvcman_dispatch_channel_data(channel, complete);
 		}
 	}
+	else if (!channel->dvcman->drdynvc->lanes[channel->lane].thread)
+		status = dvcman_deliver_channel_data(channel, data);
 	else
-		status = dvcman_call_on_receive(channel, data);
+	{
+		/* data points into the shared drdynvc receive buffer, detach it */
+		wStream* copy = StreamPool_Take(channel->dvcman->pool, dataSize);
+		if (!copy)
+		{
+			drdynvcPlugin* drdynvc = channel->dvcman->drdynvc;
+			WLog_Print(drdynvc->log, WLOG_ERROR, "StreamPool_Take failed!");
+			status = CHANNEL_RC_NO_MEMORY;
+			goto out;
+		}
+
+		Stream_Copy(data, copy, dataSize);
+		Stream_SealLength(copy);
+		Stream_SetPosition(copy, 0);
+		status = dvcman_dispatch_channel_data(channel, copy);
+	}
 
 out:
 	return status;
@@ -1252,7 +1447,8 @@ static UINT drdynvc_process_create_request(drdynvcPlugin* drdynvc, UINT8 Sp, UIN
 	{
 		WLog_Print(drdynvc->log, WLOG_ERROR, "VirtualChannelWriteEx failed with %s [%08" PRIX32 "]",
 		           WTSErrorToString(status), status);
-		dvcman_channel_unref(channel);
+		if (channel && (channel_status == CHANNEL_RC_OK))
+			dvcman_channel_remove(channel);
 		return status;
 	}
 
@@ -1613,6 +1809,8 @@ static DWORD WINAPI drdynvc_virtual_channel_client_thread(LPVOID arg)
 		}
 	}
 
+	drdynvc_lanes_stop(drdynvc);
+
 	{
 		/* Disconnect remaining dynamic channels that the server did not.
 		 * This is required to properly shut down channels by calling the appropriate
@@ -1630,6 +1828,199 @@ static DWORD WINAPI drdynvc_virtual_channel_client_thread(LPVOID arg)
 	return error;
 }
 
+static DWORD WINAPI drdynvc_lane_thread(LPVOID arg)
+{
+	wMessage message = { 0 };
+	UINT error = CHANNEL_RC_OK;
+	DRDYNVC_LANE* lane = (DRDYNVC_LANE*)arg;
+
+	WINPR_ASSERT(lane);
+	drdynvcPlugin* drdynvc = lane->drdynvc;
+	WINPR_ASSERT(drdynvc);
+
+	while (1)
+	{
+		if (!MessageQueue_Wait(lane->queue))
+		{
+			WLog_Print(drdynvc->log, WLOG_ERROR, "[%s] MessageQueue_Wait failed!", lane->name);
+			error = ERROR_INTERNAL_ERROR;
+			break;
+		}
+
+		if (!MessageQueue_Peek(lane->queue, &message, TRUE))
+		{
+			WLog_Print(drdynvc->log, WLOG_ERROR, "[%s] MessageQueue_Peek failed!", lane->name);
+			error = ERROR_INTERNAL_ERROR;
+			break;
+		}
+
+		if (message.id == WMQ_QUIT)
+			break;
+
+		if (message.id == 0)
+		{
+			DVCMAN_CHANNEL* channel = (DVCMAN_CHANNEL*)message.wParam;
+			wStream* data = (wStream*)message.lParam;
+
+			dvcman_channel_release_slot(channel, lane);
+
+			const UINT status = dvcman_deliver_channel_data(channel, data);
+			Stream_Release(data);
+
+			if (status != CHANNEL_RC_OK)
+			{
+				WLog_Print(drdynvc->log, WLOG_WARN,
+				           "[%s] OnDataReceived for '%s' failed with error %" PRIu32 "!",
+				           lane->name, channel->channel_name, status);
+				dvcman_channel_close(channel, FALSE, FALSE);
+			}
+			dvcman_channel_unref(channel);
+		}
+	}
+
+	if (error && drdynvc->rdpcontext)
+		setChannelError(drdynvc->rdpcontext, error, "drdynvc_lane_thread reported an error");
+
+	ExitThread((DWORD)error);
+	return error;
+}
+
+static void drdynvc_lane_object_free(void* obj)
+{
+	wMessage* msg = (wMessage*)obj;
+
+	if (!msg || (msg->id != 0))
+		return;
+
+	DVCMAN_CHANNEL* channel = (DVCMAN_CHANNEL*)msg->wParam;
+	wStream* s = (wStream*)msg->lParam;
+
+	if (s)
+		Stream_Release(s);
+	if (channel)
+		dvcman_channel_unref(channel);
+}
+
+static BOOL drdynvc_lanes_new(drdynvcPlugin* drdynvc)
+{
+	const char* names[] = { "realtime", "default", "bulk" };
+	/* bulk messages (graphics frames) are large, bound them. The other lanes never make the
+	 * receive thread wait, a slow consumer there must not hold up the rest. */
+	const LONG limits[] = { 0, 0, 32 };
+
+	WINPR_ASSERT(drdynvc);
+	WINPR_STATIC_ASSERT(ARRAYSIZE(names) == DRDYNVC_LANE_COUNT);
+	WINPR_STATIC_ASSERT(ARRAYSIZE(limits) == DRDYNVC_LANE_COUNT);
+
+	for (size_t x = 0; x < DRDYNVC_LANE_COUNT; x++)
+	{
+		DRDYNVC_LANE* lane = &drdynvc->lanes[x];
+
+		lane->drdynvc = drdynvc;
+		lane->name = names[x];
+		lane->maxPending = limits[x];
+		lane->queue = MessageQueue_New(NULL);
+		if (!lane->queue)
+		{
+			WLog_Print(drdynvc->log, WLOG_ERROR, "[%s] MessageQueue_New failed!", lane->name);
+			return FALSE;
+		}
+
+		wObject* obj = MessageQueue_Object(lane->queue);
+		obj->fnObjectFree = drdynvc_lane_object_free;
+	}
+
+	return TRUE;
+}
+
+static void drdynvc_lanes_free(drdynvcPlugin* drdynvc)
+{
+	WINPR_ASSERT(drdynvc);
+
+	for (size_t x = 0; x < DRDYNVC_LANE_COUNT; x++)
+	{
+		DRDYNVC_LANE* lane = &drdynvc->lanes[x];
+		MessageQueue_Free(lane->queue);
+		lane->queue = NULL;
+	}
+}
+
+static UINT drdynvc_lanes_start(drdynvcPlugin* drdynvc)
+{
+	WINPR_ASSERT(drdynvc);
+
+	for (size_t x = 0; x < DRDYNVC_LANE_COUNT; x++)
+	{
+		DRDYNVC_LANE* lane = &drdynvc->lanes[x];
+
+		WINPR_ASSERT(lane->queue);
+		WINPR_ASSERT(!lane->thread);
+
+		if (lane->maxPending > 0)
+		{
+			lane->slots = CreateSemaphore(NULL, lane->maxPending, lane->maxPending, NULL);
+			if (!lane->slots)
+			{
+				WLog_Print(drdynvc->log, WLOG_ERROR, "[%s] CreateSemaphore failed!", lane->name);
+				return ERROR_INTERNAL_ERROR;
+			}
+		}
+
+		lane->thread = CreateThread(NULL, 0, drdynvc_lane_thread, lane, 0, NULL);
+		if (!lane->thread)
+		{
+			WLog_Print(drdynvc->log, WLOG_ERROR, "[%s] CreateThread failed!", lane->name);
+			return ERROR_INTERNAL_ERROR;
+		}
+
+		if (x == DRDYNVC_LANE_REALTIME)
+		{
+			if (!SetThreadPriority(lane->thread, THREAD_PRIORITY_HIGHEST))
+				WLog_Print(drdynvc->log, WLOG_WARN, "SetThreadPriority failed, ignoring.");
+		}
+	}
+
+	return CHANNEL_RC_OK;
+}
+
+/**
+ * Function description
+ *
+ * Delivers all pending messages and stops the lane threads.
+ * Must be called before the channels are cleared.
+ */
+static void drdynvc_lanes_stop(drdynvcPlugin* drdynvc)
+{
+	WINPR_ASSERT(drdynvc);
+
+	for (size_t x = 0; x < DRDYNVC_LANE_COUNT; x++)
+	{
+		DRDYNVC_LANE* lane = &drdynvc->lanes[x];
+
+		if (lane->thread)
+		{
+			if (!MessageQueue_PostQuit(lane->queue, 0))
+				WLog_Print(drdynvc->log, WLOG_ERROR, "[%s] MessageQueue_PostQuit failed!",
+				           lane->name);
+			else if (WaitForSingleObject(lane->thread, INFINITE) != WAIT_OBJECT_0)
+				WLog_Print(drdynvc->log, WLOG_ERROR, "[%s] WaitForSingleObject failed!",
+				           lane->name);
+
+			(void)CloseHandle(lane->thread);
+			lane->thread = NULL;
+		}
+
+		if (lane->queue)
+			MessageQueue_Clear(lane->queue);
+
+		if (lane->slots)
+		{
+			(void)CloseHandle(lane->slots);
+			lane->slots = NULL;
+		}
+	}
+}
+
 static void drdynvc_queue_object_free(void* obj)
 {
 	wStream* s = NULL;
@@ -1664,6 +2055,10 @@ static UINT drdynvc_virtual_channel_event_initialized(drdynvcPlugin* drdynvc, LP
 
 	obj = MessageQueue_Object(drdynvc->queue);
 	obj->fnObjectFree = drdynvc_queue_object_free;
+
+	if (!drdynvc_lanes_new(drdynvc))
+		goto error;
+
 	drdynvc->channel_mgr = dvcman_new(drdynvc);
 
 	if (!drdynvc->channel_mgr)
@@ -1733,11 +2128,18 @@ static UINT drdynvc_virtual_channel_event_connected(drdynvcPlugin* drdynvc, LPVO
 
 	if (drdynvc->async)
 	{
+		if ((error = drdynvc_lanes_start(drdynvc)))
+		{
+			drdynvc_lanes_stop(drdynvc);
+			goto error;
+		}
+
 		if (!(drdynvc->thread = CreateThread(NULL, 0, drdynvc_virtual_channel_client_thread,
 		                                     (void*)drdynvc, 0, NULL)))
 		{
 			error = ERROR_INTERNAL_ERROR;
 			WLog_Print(drdynvc->log, WLOG_ERROR, "CreateThread failed!");
+			drdynvc_lanes_stop(drdynvc);
 			goto error;
 		}
 
@@ -1836,6 +2238,7 @@ static UINT drdynvc_virtual_channel_event_terminated(drdynvcPlugin* drdynvc)
 
 	MessageQueue_Free(drdynvc->queue);
 	drdynvc->queue = NULL;
+	drdynvc_lanes_free(drdynvc);
 
 	if (drdynvc->channel_mgr)
 	{
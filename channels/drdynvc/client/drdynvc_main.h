@@ -92,8 +92,33 @@ typedef struct
 	wStream* dvc_data;
 	UINT32 dvc_data_length;
 	CRITICAL_SECTION lock;
+
+	size_t lane;
+	volatile LONG queued; /** messages on the lane still holding a slot */
+	CRITICAL_SECTION dispatch_lock;
 } DVCMAN_CHANNEL;
 
+/** Dispatch lanes for reassembled channel messages.
+ *  Every channel is bound to a single lane, so per channel ordering is kept while
+ *  latency sensitive channels are not queued behind bulk graphics data. */
+typedef enum
+{
+	DRDYNVC_LANE_REALTIME,
+	DRDYNVC_LANE_DEFAULT,
+	DRDYNVC_LANE_BULK,
+	DRDYNVC_LANE_COUNT
+} DRDYNVC_LANE_ID;
+
+typedef struct
+{
+	drdynvcPlugin* drdynvc;
+	const char* name;
+	LONG maxPending; /** 0 for an unbounded lane */
+	HANDLE thread;
+	HANDLE slots;
+	wMessageQueue* queue;
+} DRDYNVC_LANE;
+
 typedef enum
 {
 	DRDYNVC_STATE_INITIAL,
@@ -116,6 +141,7 @@ struct drdynvc_plugin
 	void* InitHandle;
 	DWORD OpenHandle;
 	wMessageQueue* queue;
+	DRDYNVC_LANE lanes[DRDYNVC_LANE_COUNT];
 
 	DRDYNVC_STATE state;
 	DrdynvcClientContext* context;
@@ -0,0 +1,453 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * File System Virtual Channel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <winpr/assert.h>
+#include <winpr/crt.h>
+#include <winpr/string.h>
+#include <winpr/sysinfo.h>
+#include <winpr/interlocked.h>
+#include <winpr/collections.h>
+
+#include "drive_cache.h"
+
+typedef struct
+{
+	DWORD dwFileAttributes;
+	FILETIME ftCreationTime;
+	FILETIME ftLastAccessTime;
+	FILETIME ftLastWriteTime;
+	DWORD nFileSizeHigh;
+	DWORD nFileSizeLow;
+	size_t nameOffset;
+	size_t nameLength;
+} DRIVE_DIR_ENTRY;
+
+struct s_drive_dir_listing
+{
+	volatile LONG refs;
+	DRIVE_DIR_ENTRY* entries;
+	size_t count;
+	size_t capacity;
+	WCHAR* names;
+	size_t namesLength;
+	size_t namesCapacity;
+};
+
+typedef struct
+{
+	UINT64 expires;
+	DWORD error;
+	WIN32_FILE_ATTRIBUTE_DATA data;
+} DRIVE_CACHE_ATTRIBUTES;
+
+typedef struct
+{
+	UINT64 expires;
+	DRIVE_DIR_LISTING* listing;
+} DRIVE_CACHE_LISTING;
+
+struct s_drive_cache
+{
+	wHashTable* attributes;
+	wHashTable* listings;
+	/* bumped by every invalidation, guarded by both table locks */
+	UINT64 generation;
+};
+
+typedef struct
+{
+	wHashTable* table;
+	BOOL pattern;
+	const WCHAR* path;
+	size_t pathLength;
+	const WCHAR* parent;
+	size_t parentLength;
+} DRIVE_CACHE_INVALIDATE;
+
+static UINT32 drive_cache_key_hash(const void* key)
+{
+	const WCHAR* str = key;
+	UINT32 hash = 2166136261u;
+
+	WINPR_ASSERT(str);
+	while (*str)
+	{
+		hash ^= (UINT32)*str++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static BOOL drive_cache_key_equals(const void* key1, const void* key2)
+{
+	if (!key1 || !key2)
+		return key1 == key2;
+	return _wcscmp(key1, key2) == 0;
+}
+
+static void* drive_cache_key_clone(const void* key)
+{
+	return _wcsdup(key);
+}
+
+static void drive_cache_listing_free(void* obj)
+{
+	DRIVE_CACHE_LISTING* entry = obj;
+	if (!entry)
+		return;
+	drive_dir_listing_release(entry->listing);
+	free(entry);
+}
+
+static wHashTable* drive_cache_table_new(OBJECT_FREE_FN valueFree)
+{
+	wHashTable* table = HashTable_New(TRUE);
+	if (!table)
+		return NULL;
+
+	if (!HashTable_SetHashFunction(table, drive_cache_key_hash))
+		goto fail;
+
+	wObject* obj = HashTable_KeyObject(table);
+	obj->fnObjectEquals = drive_cache_key_equals;
+	obj->fnObjectNew = drive_cache_key_clone;
+	obj->fnObjectFree = free;
+
+	obj = HashTable_ValueObject(table);
+	obj->fnObjectFree = valueFree;
+	return table;
+
+fail:
+	HashTable_Free(table);
+	return NULL;
+}
+
+DRIVE_CACHE* drive_cache_new(void)
+{
+	DRIVE_CACHE* cache = calloc(1, sizeof(DRIVE_CACHE));
+	if (!cache)
+		return NULL;
+
+	cache->attributes = drive_cache_table_new(free);
+	cache->listings = drive_cache_table_new(drive_cache_listing_free);
+	if (!cache->attributes || !cache->listings)
+		goto fail;
+
+	return cache;
+
+fail:
+	drive_cache_free(cache);
+	return NULL;
+}
+
+void drive_cache_free(DRIVE_CACHE* cache)
+{
+	if (!cache)
+		return;
+
+	HashTable_Free(cache->attributes);
+	HashTable_Free(cache->listings);
+	free(cache);
+}
+
+BOOL drive_cache_get_attributes(DRIVE_CACHE* cache, const WCHAR* path,
+                                WIN32_FILE_ATTRIBUTE_DATA* data)
+{
+	WINPR_ASSERT(path);
+	WINPR_ASSERT(data);
+
+	if (!cache)
+		return GetFileAttributesExW(path, GetFileExInfoStandard, data);
+
+	const UINT64 now = GetTickCount64();
+
+	HashTable_Lock(cache->attributes);
+	const DRIVE_CACHE_ATTRIBUTES* cached = HashTable_GetItemValue(cache->attributes, path);
+	if (cached && (cached->expires > now))
+	{
+		const DWORD error = cached->error;
+		*data = cached->data;
+		HashTable_Unlock(cache->attributes);
+
+		if (error != ERROR_SUCCESS)
+		{
+			SetLastError(error);
+			return FALSE;
+		}
+		return TRUE;
+	}
+	const UINT64 generation = cache->generation;
+	HashTable_Unlock(cache->attributes);
+
+	DRIVE_CACHE_ATTRIBUTES* entry = calloc(1, sizeof(DRIVE_CACHE_ATTRIBUTES));
+	const BOOL rc = GetFileAttributesExW(path, GetFileExInfoStandard, data);
+	const DWORD error = rc ? ERROR_SUCCESS : GetLastError();
+
+	if (entry)
+	{
+		entry->expires = now + DRIVE_CACHE_TTL_MS;
+		entry->error = error;
+		if (rc)
+			entry->data = *data;
+
+		/* Do not store the result if the path was modified while we looked it up */
+		HashTable_Lock(cache->attributes);
+		if (generation != cache->generation)
+			free(entry);
+		else
+		{
+			if (HashTable_Count(cache->attributes) >= DRIVE_CACHE_MAX_ENTRIES)
+				HashTable_Clear(cache->attributes);
+			if (!HashTable_Insert(cache->attributes, path, entry))
+				free(entry);
+		}
+		HashTable_Unlock(cache->attributes);
+	}
+
+	if (!rc)
+		SetLastError(error);
+	return rc;
+}
+
+static BOOL drive_cache_matches(const DRIVE_CACHE_INVALIDATE* inv, const WCHAR* key,
+                                size_t keyLength)
+{
+	WINPR_ASSERT(inv);
+	WINPR_ASSERT(key);
+
+	/* The path itself, the parent directory and every descendant of path */
+	if ((keyLength == inv->parentLength) && (_wcsncmp(key, inv->parent, keyLength) == 0))
+		return TRUE;
+
+	if ((keyLength >= inv->pathLength) && (_wcsncmp(key, inv->path, inv->pathLength) == 0))
+		return (keyLength == inv->pathLength) || (key[inv->pathLength] == L'/');
+
+	return FALSE;
+}
+
+static BOOL drive_cache_invalidate_entry(const void* key, void* value, void* arg)
+{
+	const DRIVE_CACHE_INVALIDATE* inv = arg;
+	const WCHAR* str = key;
+
+	WINPR_UNUSED(value);
+	WINPR_ASSERT(inv);
+	WINPR_ASSERT(str);
+
+	/* Listings are keyed by search pattern, compare the directory part */
+	size_t length = _wcslen(str);
+	if (inv->pattern)
+	{
+		while ((length > 0) && (str[length - 1] != L'/'))
+			length--;
+		if (length > 1)
+			length--;
+	}
+
+	if (drive_cache_matches(inv, str, length))
+		HashTable_Remove(inv->table, key);
+	return TRUE;
+}
+
+void drive_cache_invalidate(DRIVE_CACHE* cache, const WCHAR* path)
+{
+	if (!cache || !path)
+		return;
+
+	DRIVE_CACHE_INVALIDATE inv = { 0 };
+	inv.path = path;
+	inv.pathLength = _wcslen(path);
+	inv.parent = path;
+	inv.parentLength = inv.pathLength;
+	while ((inv.parentLength > 0) && (path[inv.parentLength - 1] != L'/'))
+		inv.parentLength--;
+	if (inv.parentLength > 1)
+		inv.parentLength--;
+
+	HashTable_Lock(cache->attributes);
+	HashTable_Lock(cache->listings);
+	cache->generation++;
+
+	inv.table = cache->attributes;
+	inv.pattern = FALSE;
+	HashTable_Foreach(cache->attributes, drive_cache_invalidate_entry, &inv);
+
+	inv.table = cache->listings;
+	inv.pattern = TRUE;
+	HashTable_Foreach(cache->listings, drive_cache_invalidate_entry, &inv);
+
+	HashTable_Unlock(cache->listings);
+	HashTable_Unlock(cache->attributes);
+}
+
+UINT64 drive_cache_generation(DRIVE_CACHE* cache)
+{
+	if (!cache)
+		return 0;
+
+	HashTable_Lock(cache->attributes);
+	const UINT64 generation = cache->generation;
+	HashTable_Unlock(cache->attributes);
+	return generation;
+}
+
+DRIVE_DIR_LISTING* drive_cache_get_listing(DRIVE_CACHE* cache, const WCHAR* pattern)
+{
+	DRIVE_DIR_LISTING* listing = NULL;
+
+	if (!cache || !pattern)
+		return NULL;
+
+	const UINT64 now = GetTickCount64();
+
+	HashTable_Lock(cache->listings);
+	const DRIVE_CACHE_LISTING* cached = HashTable_GetItemValue(cache->listings, pattern);
+	if (cached && (cached->expires > now))
+	{
+		listing = cached->listing;
+		InterlockedIncrement(&listing->refs);
+	}
+	HashTable_Unlock(cache->listings);
+	return listing;
+}
+
+void drive_cache_put_listing(DRIVE_CACHE* cache, const WCHAR* pattern, DRIVE_DIR_LISTING* listing,
+                             UINT64 generation)
+{
+	if (!cache || !pattern || !listing)
+		return;
+
+	DRIVE_CACHE_LISTING* entry = calloc(1, sizeof(DRIVE_CACHE_LISTING));
+	if (!entry)
+		return;
+
+	entry->expires = GetTickCount64() + DRIVE_CACHE_TTL_MS;
+	entry->listing = listing;
+	InterlockedIncrement(&listing->refs);
+
+	HashTable_Lock(cache->listings);
+	if (generation != cache->generation)
+		drive_cache_listing_free(entry);
+	else
+	{
+		if (HashTable_Count(cache->listings) >= DRIVE_CACHE_MAX_LISTINGS)
+			HashTable_Clear(cache->listings);
+		if (!HashTable_Insert(cache->listings, pattern, entry))
+			drive_cache_listing_free(entry);
+	}
+	HashTable_Unlock(cache->listings);
+}
+
+DRIVE_DIR_LISTING* drive_dir_listing_new(void)
+{
+	DRIVE_DIR_LISTING* listing = calloc(1, sizeof(DRIVE_DIR_LISTING));
+	if (!listing)
+		return NULL;
+
+	listing->refs = 1;
+	return listing;
+}
+
+void drive_dir_listing_release(DRIVE_DIR_LISTING* listing)
+{
+	if (!listing)
+		return;
+
+	if (InterlockedDecrement(&listing->refs) != 0)
+		return;
+
+	free(listing->entries);
+	free(listing->names);
+	free(listing);
+}
+
+BOOL drive_dir_listing_append(DRIVE_DIR_LISTING* listing, const WIN32_FIND_DATAW* data)
+{
+	WINPR_ASSERT(listing);
+	WINPR_ASSERT(data);
+
+	const size_t nameLength = _wcsnlen(data->cFileName, ARRAYSIZE(data->cFileName));
+
+	if (listing->count == listing->capacity)
+	{
+		const size_t capacity = listing->capacity ? listing->capacity * 2 : 32;
+		DRIVE_DIR_ENTRY* tmp = realloc(listing->entries, capacity * sizeof(DRIVE_DIR_ENTRY));
+		if (!tmp)
+			return FALSE;
+		listing->entries = tmp;
+		listing->capacity = capacity;
+	}
+
+	if (listing->namesCapacity - listing->namesLength < nameLength)
+	{
+		size_t capacity = listing->namesCapacity ? listing->namesCapacity * 2 : 1024;
+		while (capacity - listing->namesLength < nameLength)
+			capacity *= 2;
+		WCHAR* tmp = realloc(listing->names, capacity * sizeof(WCHAR));
+		if (!tmp)
+			return FALSE;
+		listing->names = tmp;
+		listing->namesCapacity = capacity;
+	}
+
+	DRIVE_DIR_ENTRY* entry = &listing->entries[listing->count++];
+	entry->dwFileAttributes = data->dwFileAttributes;
+	entry->ftCreationTime = data->ftCreationTime;
+	entry->ftLastAccessTime = data->ftLastAccessTime;
+	entry->ftLastWriteTime = data->ftLastWriteTime;
+	entry->nFileSizeHigh = data->nFileSizeHigh;
+	entry->nFileSizeLow = data->nFileSizeLow;
+	entry->nameOffset = listing->namesLength;
+	entry->nameLength = nameLength;
+	memcpy(&listing->names[listing->namesLength], data->cFileName, nameLength * sizeof(WCHAR));
+	listing->namesLength += nameLength;
+	return TRUE;
+}
+
+size_t drive_dir_listing_count(const DRIVE_DIR_LISTING* listing)
+{
+	if (!listing)
+		return 0;
+	return listing->count;
+}
+
+BOOL drive_dir_listing_get(const DRIVE_DIR_LISTING* listing, size_t index, WIN32_FIND_DATAW* data)
+{
+	WINPR_ASSERT(data);
+
+	if (!listing || (index >= listing->count))
+		return FALSE;
+
+	const DRIVE_DIR_ENTRY* entry = &listing->entries[index];
+
+	/* The short name is not used by the channel and therefore not cached */
+	ZeroMemory(data, sizeof(WIN32_FIND_DATAW));
+	data->dwFileAttributes = entry->dwFileAttributes;
+	data->ftCreationTime = entry->ftCreationTime;
+	data->ftLastAccessTime = entry->ftLastAccessTime;
+	data->ftLastWriteTime = entry->ftLastWriteTime;
+	data->nFileSizeHigh = entry->nFileSizeHigh;
+	data->nFileSizeLow = entry->nFileSizeLow;
+	memcpy(data->cFileName, &listing->names[entry->nameOffset],
+	       entry->nameLength * sizeof(WCHAR));
+	return TRUE;
+}
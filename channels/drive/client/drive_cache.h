@@ -0,0 +1,81 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * File System Virtual Channel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_CHANNEL_DRIVE_CLIENT_CACHE_H
+#define FREERDP_CHANNEL_DRIVE_CLIENT_CACHE_H
+
+#include <winpr/wtypes.h>
+#include <winpr/file.h>
+
+/* How long attributes and directory listings are served without asking the file system */
+#define DRIVE_CACHE_TTL_MS 2000
+/* Upper bound of cached paths/listings, the cache is reset when exceeded */
+#define DRIVE_CACHE_MAX_ENTRIES 4096
+#define DRIVE_CACHE_MAX_LISTINGS 64
+/* Directories with more entries are enumerated but not cached */
+#define DRIVE_CACHE_MAX_LISTING_ENTRIES 8192
+
+typedef struct s_drive_cache DRIVE_CACHE;
+typedef struct s_drive_dir_listing DRIVE_DIR_LISTING;
+
+/**
+ * Short lived cache of file attributes and directory listings of a redirected drive, keyed by
+ * full path.
+ *
+ * Every modification done through the channel must call drive_cache_invalidate, changes done
+ * by other local processes become visible after at most DRIVE_CACHE_TTL_MS.
+ */
+DRIVE_CACHE* drive_cache_new(void);
+void drive_cache_free(DRIVE_CACHE* cache);
+
+/**
+ * Equivalent of GetFileAttributesExW(path, GetFileExInfoStandard, data), negative results are
+ * cached as well.
+ */
+BOOL drive_cache_get_attributes(DRIVE_CACHE* cache, const WCHAR* path,
+                                WIN32_FILE_ATTRIBUTE_DATA* data);
+
+/**
+ * Drop everything cached about path, its parent directory and, if path is a directory, all
+ * its descendants.
+ */
+void drive_cache_invalidate(DRIVE_CACHE* cache, const WCHAR* path);
+
+/**
+ * Look up a complete listing for the search pattern, returns a new reference or NULL.
+ */
+DRIVE_DIR_LISTING* drive_cache_get_listing(DRIVE_CACHE* cache, const WCHAR* pattern);
+
+/**
+ * Current invalidation generation, to be sampled before enumerating a directory.
+ */
+UINT64 drive_cache_generation(DRIVE_CACHE* cache);
+
+/**
+ * Store a complete listing for the search pattern, the cache takes its own reference.
+ * The listing is dropped if an invalidation happened since generation was sampled.
+ */
+void drive_cache_put_listing(DRIVE_CACHE* cache, const WCHAR* pattern, DRIVE_DIR_LISTING* listing,
+                             UINT64 generation);
+
+DRIVE_DIR_LISTING* drive_dir_listing_new(void);
+void drive_dir_listing_release(DRIVE_DIR_LISTING* listing);
+BOOL drive_dir_listing_append(DRIVE_DIR_LISTING* listing, const WIN32_FIND_DATAW* data);
+size_t drive_dir_listing_count(const DRIVE_DIR_LISTING* listing);
+BOOL drive_dir_listing_get(const DRIVE_DIR_LISTING* listing, size_t index, WIN32_FIND_DATAW* data);
+
+#endif /* FREERDP_CHANNEL_DRIVE_CLIENT_CACHE_H */
@@ -43,6 +43,7 @@
 #include <freerdp/channels/rdpdr.h>
 
 #include "drive_file.h"
+#include "drive_cache.h"
 
 #ifdef WITH_DEBUG_RDPDR
 #define DEBUG_WSTR(msg, wstr)                                    \
@@ -59,6 +60,9 @@
 	} while (0)
 #endif
 
+static BOOL drive_file_sync(DRIVE_FILE* file, BOOL invalidate);
+static void drive_file_find_close(DRIVE_FILE* file);
+
 static BOOL drive_file_fix_path(WCHAR* path, size_t length)
 {
 	if ((length == 0) || (length > UINT32_MAX))
@@ -120,8 +124,8 @@ static BOOL contains_dotdot(const WCHAR* path, size_t base_length, size_t path_l
 	return FALSE;
 }
 
-static WCHAR* drive_file_combine_fullpath(const WCHAR* base_path, const WCHAR* path,
-                                          size_t PathWCharLength)
+WCHAR* drive_file_combine_fullpath(const WCHAR* base_path, const WCHAR* path,
+                                   size_t PathWCharLength)
 {
 	BOOL ok = FALSE;
 	WCHAR* fullpath = NULL;
@@ -191,7 +195,10 @@ static BOOL drive_file_set_fullpath(DRIVE_FILE* file, const WCHAR* fullpath)
 static BOOL drive_file_init(DRIVE_FILE* file)
 {
 	UINT CreateDisposition = 0;
-	DWORD dwAttr = GetFileAttributesW(file->fullpath);
+	WIN32_FILE_ATTRIBUTE_DATA data = { 0 };
+	const DWORD dwAttr = drive_cache_get_attributes(file->cache, file->fullpath, &data)
+	                         ? data.dwFileAttributes
+	                         : INVALID_FILE_ATTRIBUTES;
 
 	if (dwAttr != INVALID_FILE_ATTRIBUTES)
 	{
@@ -315,9 +322,25 @@ static BOOL drive_file_init(DRIVE_FILE* file)
 	return file->file_handle != INVALID_HANDLE_VALUE;
 }
 
+/**
+ * Read-ahead is only safe if no other handle may modify the file behind our back, write-behind
+ * only if no other handle may observe the file before we flush. The share mode covers other
+ * processes, the handles of this client on the same file are tracked with the shared flag.
+ * Once a write back failed, writes go through so that no further errors are delayed.
+ */
+static void drive_file_update_buffering(DRIVE_FILE* file)
+{
+	WINPR_ASSERT(file);
+
+	file->readAhead = !file->shared && ((file->SharedAccess & FILE_SHARE_WRITE) == 0);
+	file->writeBehind = !file->shared && !file->writeFailed &&
+	                    ((file->SharedAccess & (FILE_SHARE_READ | FILE_SHARE_WRITE)) == 0);
+}
+
 DRIVE_FILE* drive_file_new(const WCHAR* base_path, const WCHAR* path, UINT32 PathWCharLength,
                            UINT32 id, UINT32 DesiredAccess, UINT32 CreateDisposition,
-                           UINT32 CreateOptions, UINT32 FileAttributes, UINT32 SharedAccess)
+                           UINT32 CreateOptions, UINT32 FileAttributes, UINT32 SharedAccess,
+                           DRIVE_CACHE* cache)
 {
 	if (!base_path || (!path && (PathWCharLength > 0)))
 		return NULL;
@@ -330,21 +353,32 @@ DRIVE_FILE* drive_file_new(const WCHAR* base_path, const WCHAR* path, UINT32 Pat
 		return NULL;
 	}
 
+	InitializeCriticalSection(&file->lock);
 	file->file_handle = INVALID_HANDLE_VALUE;
 	file->find_handle = INVALID_HANDLE_VALUE;
 	file->id = id;
 	file->basepath = base_path;
+	file->cache = cache;
 	file->FileAttributes = FileAttributes;
 	file->DesiredAccess = DesiredAccess;
 	file->CreateDisposition = CreateDisposition;
 	file->CreateOptions = CreateOptions;
 	file->SharedAccess = SharedAccess;
 
+	/* Decided here as drive_file_init drops the share mode on POSIX */
+	drive_file_update_buffering(file);
+
 	WCHAR* p = drive_file_combine_fullpath(base_path, path, PathWCharLength);
 	(void)drive_file_set_fullpath(file, p);
 	free(p);
 
-	if (!drive_file_init(file))
+	const BOOL rc = drive_file_init(file);
+
+	/* Anything but a plain open may have created or truncated the file */
+	if (CreateDisposition != FILE_OPEN)
+		drive_cache_invalidate(cache, file->fullpath);
+
+	if (!rc)
 	{
 		DWORD lastError = GetLastError();
 		drive_file_free(file);
@@ -362,17 +396,16 @@ BOOL drive_file_free(DRIVE_FILE* file)
 	if (!file)
 		return FALSE;
 
+	/* Report a failed write-behind on close, the file is released regardless */
+	const BOOL flushed = drive_file_sync(file, TRUE);
+
 	if (file->file_handle != INVALID_HANDLE_VALUE)
 	{
 		(void)CloseHandle(file->file_handle);
 		file->file_handle = INVALID_HANDLE_VALUE;
 	}
 
-	if (file->find_handle != INVALID_HANDLE_VALUE)
-	{
-		FindClose(file->find_handle);
-		file->find_handle = INVALID_HANDLE_VALUE;
-	}
+	drive_file_find_close(file);
 
 	if (file->delete_pending)
 	{
@@ -385,9 +418,14 @@ BOOL drive_file_free(DRIVE_FILE* file)
 			goto fail;
 	}
 
-	rc = TRUE;
+	rc = flushed;
 fail:
+	if (file->delete_pending || file->written)
+		drive_cache_invalidate(file->cache, file->fullpath);
 	DEBUG_WSTR("Free %s", file->fullpath);
+	DeleteCriticalSection(&file->lock);
+	free(file->readBuffer);
+	free(file->writeBuffer);
 	free(file->fullpath);
 	free(file);
 	return rc;
@@ -446,6 +484,294 @@ BOOL drive_file_write(DRIVE_FILE* file, const BYTE* buffer, UINT32 Length)
 	return TRUE;
 }
 
+static void drive_file_set_offset(OVERLAPPED* ov, UINT64 Offset)
+{
+	WINPR_ASSERT(ov);
+	ov->DUMMYUNIONNAME.DUMMYSTRUCTNAME.Offset = (DWORD)(Offset & UINT32_MAX);
+	ov->DUMMYUNIONNAME.DUMMYSTRUCTNAME.OffsetHigh = (DWORD)(Offset >> 32);
+}
+
+static BOOL drive_file_pread(DRIVE_FILE* file, UINT64 Offset, BYTE* buffer, UINT32* Length)
+{
+	OVERLAPPED ov = { 0 };
+	DWORD read = 0;
+
+	WINPR_ASSERT(file);
+	WINPR_ASSERT(buffer);
+	WINPR_ASSERT(Length);
+
+	if (Offset > INT64_MAX)
+		return FALSE;
+
+	drive_file_set_offset(&ov, Offset);
+	if (!ReadFile(file->file_handle, buffer, *Length, &read, &ov))
+		return FALSE;
+
+	*Length = read;
+	return TRUE;
+}
+
+static BOOL drive_file_pwrite(DRIVE_FILE* file, UINT64 Offset, const BYTE* buffer, UINT32 Length)
+{
+	WINPR_ASSERT(file);
+	WINPR_ASSERT(buffer || (Length == 0));
+
+	while (Length > 0)
+	{
+		OVERLAPPED ov = { 0 };
+		DWORD written = 0;
+
+		if (Offset > INT64_MAX)
+			return FALSE;
+
+		drive_file_set_offset(&ov, Offset);
+		if (!WriteFile(file->file_handle, buffer, Length, &written, &ov))
+			return FALSE;
+
+		if (written == 0)
+			return FALSE;
+
+		Length -= written;
+		buffer += written;
+		Offset += written;
+	}
+
+	return TRUE;
+}
+
+/* Must be called with file->lock held, a failure is kept in writeError */
+static void drive_file_write_back(DRIVE_FILE* file)
+{
+	WINPR_ASSERT(file);
+
+	if (file->writeLength == 0)
+		return;
+
+	/* The data is dropped even on failure, the error goes to the next request */
+	if (!drive_file_pwrite(file, file->writeOffset, file->writeBuffer, file->writeLength))
+	{
+		const DWORD error = GetLastError();
+		file->writeError = error ? error : ERROR_WRITE_FAULT;
+		file->writeFailed = TRUE;
+		drive_file_update_buffering(file);
+	}
+
+	file->writeLength = 0;
+}
+
+/**
+ * Must be called with file->lock held. Fails if the pending data could not be written or an
+ * earlier write back, one not done for a request on this file, has failed.
+ */
+static BOOL drive_file_flush_int(DRIVE_FILE* file)
+{
+	WINPR_ASSERT(file);
+
+	drive_file_write_back(file);
+
+	if (file->writeError == 0)
+		return TRUE;
+
+	SetLastError(file->writeError);
+	file->writeError = 0;
+	return FALSE;
+}
+
+/**
+ * Write back pending data and optionally drop read-ahead data.
+ *
+ * Called before anything that relies on the on-disk state of the file (size queries, truncation,
+ * rename, close).
+ */
+static BOOL drive_file_sync(DRIVE_FILE* file, BOOL invalidate)
+{
+	WINPR_ASSERT(file);
+
+	EnterCriticalSection(&file->lock);
+	const BOOL rc = drive_file_flush_int(file);
+	if (invalidate)
+	{
+		file->readLength = 0;
+		file->readWindow = 0;
+	}
+	LeaveCriticalSection(&file->lock);
+	return rc;
+}
+
+void drive_file_set_shared(DRIVE_FILE* file, BOOL shared)
+{
+	WINPR_ASSERT(file);
+
+	EnterCriticalSection(&file->lock);
+	file->shared = shared;
+
+	if (shared)
+	{
+		drive_file_write_back(file);
+		file->readLength = 0;
+		file->readWindow = 0;
+	}
+
+	drive_file_update_buffering(file);
+	LeaveCriticalSection(&file->lock);
+}
+
+BOOL drive_file_read_at(DRIVE_FILE* file, UINT64 Offset, BYTE* buffer, UINT32* Length)
+{
+	if (!file || !buffer || !Length)
+		return FALSE;
+
+	if (Offset > INT64_MAX)
+		return FALSE;
+
+	DEBUG_WSTR("Read file %s", file->fullpath);
+
+	const UINT32 requested = *Length;
+
+	EnterCriticalSection(&file->lock);
+
+	if (!drive_file_flush_int(file))
+		goto fail;
+
+	/* Serve from the read-ahead buffer if it covers the request (or ends at EOF) */
+	if ((file->readLength > 0) && (Offset >= file->readOffset) &&
+	    (Offset - file->readOffset < file->readLength))
+	{
+		const size_t pos = (size_t)(Offset - file->readOffset);
+		const size_t available = file->readLength - pos;
+
+		if ((available >= requested) || file->readEof)
+		{
+			const UINT32 served = (available < requested) ? (UINT32)available : requested;
+			memcpy(buffer, &file->readBuffer[pos], served);
+			file->nextReadOffset = Offset + served;
+			*Length = served;
+			LeaveCriticalSection(&file->lock);
+			return TRUE;
+		}
+	}
+
+	/* Adapt the read-ahead window: grow on sequential access, reset on random access */
+	if (file->readAhead && (Offset == file->nextReadOffset))
+	{
+		UINT32 window = file->readWindow ? file->readWindow * 2 : DRIVE_FILE_READAHEAD_MIN;
+		if ((requested <= DRIVE_FILE_READAHEAD_MAX / 2) && (window < requested * 2))
+			window = requested * 2;
+		if (window > DRIVE_FILE_READAHEAD_MAX)
+			window = DRIVE_FILE_READAHEAD_MAX;
+		file->readWindow = window;
+	}
+	else
+		file->readWindow = 0;
+
+	file->nextReadOffset = Offset + requested;
+
+	if (file->readWindow <= requested)
+	{
+		/* Not worth buffering, read directly without holding the lock */
+		LeaveCriticalSection(&file->lock);
+		return drive_file_pread(file, Offset, buffer, Length);
+	}
+
+	if (file->readCapacity < file->readWindow)
+	{
+		BYTE* tmp = realloc(file->readBuffer, file->readWindow);
+		if (!tmp)
+		{
+			SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+			goto fail;
+		}
+		file->readBuffer = tmp;
+		file->readCapacity = file->readWindow;
+	}
+
+	UINT32 filled = file->readWindow;
+	file->readLength = 0;
+	if (!drive_file_pread(file, Offset, file->readBuffer, &filled))
+		goto fail;
+
+	file->readOffset = Offset;
+	file->readLength = filled;
+	file->readEof = filled < file->readWindow;
+
+	*Length = (filled < requested) ? filled : requested;
+	memcpy(buffer, file->readBuffer, *Length);
+	file->nextReadOffset = Offset + *Length;
+	LeaveCriticalSection(&file->lock);
+	return TRUE;
+
+fail:
+	LeaveCriticalSection(&file->lock);
+	return FALSE;
+}
+
+BOOL drive_file_write_at(DRIVE_FILE* file, UINT64 Offset, const BYTE* buffer, UINT32 Length)
+{
+	BOOL rc = FALSE;
+
+	if (!file || !buffer)
+		return FALSE;
+
+	if (Offset > INT64_MAX)
+		return FALSE;
+
+	DEBUG_WSTR("Write file %s", file->fullpath);
+
+	EnterCriticalSection(&file->lock);
+
+	/* Cached size and time stamps are stale from the first write on */
+	if (!file->written)
+	{
+		file->written = TRUE;
+		drive_cache_invalidate(file->cache, file->fullpath);
+	}
+
+	/* Any write invalidates read-ahead data */
+	file->readLength = 0;
+
+	/* Append to the pending write if it continues it */
+	if ((file->writeLength > 0) && (Offset == file->writeOffset + file->writeLength) &&
+	    (Length <= DRIVE_FILE_WRITEBEHIND_SIZE - file->writeLength))
+	{
+		memcpy(&file->writeBuffer[file->writeLength], buffer, Length);
+		file->writeLength += Length;
+	}
+	else
+	{
+		if (!drive_file_flush_int(file))
+			goto out;
+
+		if (!file->writeBehind || (Length >= DRIVE_FILE_WRITEBEHIND_SIZE))
+		{
+			rc = drive_file_pwrite(file, Offset, buffer, Length);
+			goto out;
+		}
+
+		if (!file->writeBuffer)
+		{
+			file->writeBuffer = malloc(DRIVE_FILE_WRITEBEHIND_SIZE);
+			if (!file->writeBuffer)
+			{
+				SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+				goto out;
+			}
+		}
+
+		memcpy(file->writeBuffer, buffer, Length);
+		file->writeOffset = Offset;
+		file->writeLength = Length;
+	}
+
+	if (file->writeLength == DRIVE_FILE_WRITEBEHIND_SIZE)
+		rc = drive_file_flush_int(file);
+	else
+		rc = TRUE;
+
+out:
+	LeaveCriticalSection(&file->lock);
+	return rc;
+}
+
 static BOOL drive_file_query_from_handle_information(const DRIVE_FILE* file,
                                                      const BY_HANDLE_FILE_INFORMATION* info,
                                                      UINT32 FsInformationClass, wStream* output)
@@ -581,37 +907,22 @@ static BOOL drive_file_query_from_attributes(const DRIVE_FILE* file,
 BOOL drive_file_query_information(DRIVE_FILE* file, UINT32 FsInformationClass, wStream* output)
 {
 	BY_HANDLE_FILE_INFORMATION fileInformation = { 0 };
-	BOOL status = 0;
-	HANDLE hFile = NULL;
 
 	if (!file || !output)
 		return FALSE;
 
+	if (!drive_file_sync(file, FALSE))
+		goto out_fail;
+
 	if ((file->file_handle != INVALID_HANDLE_VALUE) &&
 	    GetFileInformationByHandle(file->file_handle, &fileInformation))
 		return drive_file_query_from_handle_information(file, &fileInformation, FsInformationClass,
 		                                                output);
 
-	hFile = CreateFileW(file->fullpath, 0, FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
-	                    FILE_ATTRIBUTE_NORMAL, NULL);
-	if (hFile != INVALID_HANDLE_VALUE)
-	{
-		status = GetFileInformationByHandle(hFile, &fileInformation);
-		(void)CloseHandle(hFile);
-		if (!status)
-			goto out_fail;
-
-		if (!drive_file_query_from_handle_information(file, &fileInformation, FsInformationClass,
-		                                              output))
-			goto out_fail;
-
-		return TRUE;
-	}
-
-	/* If we failed before (i.e. if information for a drive is queried) fall back to
-	 * GetFileAttributesExW */
+	/* Directories (and the drive root) have no handle, answer those from the path. Explorer
+	 * queries them over and over, so go through the attribute cache. */
 	WIN32_FILE_ATTRIBUTE_DATA fileAttributes = { 0 };
-	if (!GetFileAttributesExW(file->fullpath, GetFileExInfoStandard, &fileAttributes))
+	if (!drive_cache_get_attributes(file->cache, file->fullpath, &fileAttributes))
 		goto out_fail;
 
 	if (!drive_file_query_from_attributes(file, &fileAttributes, FsInformationClass, output))
@@ -647,6 +958,9 @@ BOOL drive_file_set_information(DRIVE_FILE* file, UINT32 FsInformationClass, UIN
 	if (!file || !input)
 		return FALSE;
 
+	if (!drive_file_sync(file, TRUE))
+		return FALSE;
+
 	switch (FsInformationClass)
 	{
 		case FileBasicInformation:
@@ -813,6 +1127,7 @@ BOOL drive_file_set_information(DRIVE_FILE* file, UINT32 FsInformationClass, UIN
 			                MOVEFILE_COPY_ALLOWED |
 			                    (ReplaceIfExists ? MOVEFILE_REPLACE_EXISTING : 0)))
 			{
+				drive_cache_invalidate(file->cache, file->fullpath);
 				const BOOL rc = drive_file_set_fullpath(file, fullpath);
 				free(fullpath);
 				if (!rc)
@@ -836,6 +1151,7 @@ BOOL drive_file_set_information(DRIVE_FILE* file, UINT32 FsInformationClass, UIN
 			return FALSE;
 	}
 
+	drive_cache_invalidate(file->cache, file->fullpath);
 	return TRUE;
 }
 
@@ -966,6 +1282,89 @@ static BOOL drive_file_query_names_info(DRIVE_FILE* file, wStream* output, size_
 	return TRUE;
 }
 
+static void drive_file_find_close(DRIVE_FILE* file)
+{
+	WINPR_ASSERT(file);
+
+	if (file->find_handle != INVALID_HANDLE_VALUE)
+		FindClose(file->find_handle);
+	file->find_handle = INVALID_HANDLE_VALUE;
+
+	drive_dir_listing_release(file->listing);
+	file->listing = NULL;
+	file->listingIndex = 0;
+}
+
+/**
+ * Start a directory enumeration.
+ *
+ * Complete listings are served from the drive cache. On a miss the directory is read in one go
+ * and the result cached, unless it is too large: Then the first DRIVE_CACHE_MAX_LISTING_ENTRIES
+ * entries are buffered and the rest is enumerated from the still open search handle.
+ */
+static BOOL drive_file_find_first(DRIVE_FILE* file, const WCHAR* pattern)
+{
+	WIN32_FIND_DATAW data = { 0 };
+
+	WINPR_ASSERT(file);
+
+	drive_file_find_close(file);
+
+	if (!pattern)
+		return FALSE;
+
+	file->listing = drive_cache_get_listing(file->cache, pattern);
+	if (file->listing)
+		return TRUE;
+
+	const UINT64 generation = drive_cache_generation(file->cache);
+	file->find_handle = FindFirstFileW(pattern, &data);
+	if (file->find_handle == INVALID_HANDLE_VALUE)
+		return FALSE;
+
+	file->listing = drive_dir_listing_new();
+	if (!file->listing)
+		goto fail;
+
+	do
+	{
+		if (!drive_dir_listing_append(file->listing, &data))
+			goto fail;
+
+		if (drive_dir_listing_count(file->listing) >= DRIVE_CACHE_MAX_LISTING_ENTRIES)
+			return TRUE;
+	} while (FindNextFileW(file->find_handle, &data));
+
+	/* Serve what was read so far, but only cache listings that are known to be complete */
+	const DWORD error = GetLastError();
+	FindClose(file->find_handle);
+	file->find_handle = INVALID_HANDLE_VALUE;
+	if (error == ERROR_NO_MORE_FILES)
+		drive_cache_put_listing(file->cache, pattern, file->listing, generation);
+	return TRUE;
+
+fail:
+	drive_file_find_close(file);
+	return FALSE;
+}
+
+static BOOL drive_file_find_next(DRIVE_FILE* file)
+{
+	WINPR_ASSERT(file);
+
+	if (drive_dir_listing_get(file->listing, file->listingIndex, &file->find_data))
+	{
+		file->listingIndex++;
+		return TRUE;
+	}
+
+	if (file->find_handle != INVALID_HANDLE_VALUE)
+		return FindNextFileW(file->find_handle, &file->find_data);
+
+	SetLastError(ERROR_NO_MORE_FILES);
+	return FALSE;
+}
+
 BOOL drive_file_query_directory(DRIVE_FILE* file, UINT32 FsInformationClass, BYTE InitialQuery,
                                 const WCHAR* path, UINT32 PathWCharLength, wStream* output)
 {
@@ -978,19 +1377,15 @@ BOOL drive_file_query_directory(DRIVE_FILE* file, UINT32 FsInformationClass, BYT
 
 	if (InitialQuery != 0)
 	{
-		/* release search handle */
-		if (file->find_handle != INVALID_HANDLE_VALUE)
-			FindClose(file->find_handle);
-
 		ent_path = drive_file_combine_fullpath(file->basepath, path, PathWCharLength);
-		/* open new search handle and retrieve the first entry */
-		file->find_handle = FindFirstFileW(ent_path, &file->find_data);
+		const BOOL started = drive_file_find_first(file, ent_path);
 		free(ent_path);
 
-		if (file->find_handle == INVALID_HANDLE_VALUE)
+		if (!started)
 			goto out_fail;
 	}
-	else if (!FindNextFileW(file->find_handle, &file->find_data))
+
+	if (!drive_file_find_next(file))
 		goto out_fail;
 
 	length = _wcslen(file->find_data.cFileName) * 2;
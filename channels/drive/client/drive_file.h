@@ -28,10 +28,18 @@
 
 #include <winpr/stream.h>
 #include <winpr/file.h>
+#include <winpr/synch.h>
 #include <freerdp/channels/log.h>
 
+#include "drive_cache.h"
+
 #define TAG CHANNELS_TAG("drive.client")
 
+/* Sequential read-ahead window bounds and write-behind buffer size per open file */
+#define DRIVE_FILE_READAHEAD_MIN (64u * 1024u)
+#define DRIVE_FILE_READAHEAD_MAX (4u * 1024u * 1024u)
+#define DRIVE_FILE_WRITEBEHIND_SIZE (1u * 1024u * 1024u)
+
 typedef struct
 {
 	UINT32 id;
@@ -41,23 +49,58 @@ typedef struct
 	WIN32_FIND_DATAW find_data;
 	const WCHAR* basepath;
 	WCHAR* fullpath;
+	DRIVE_CACHE* cache;
+	DRIVE_DIR_LISTING* listing;
+	size_t listingIndex;
+	BOOL written;
 	BOOL delete_pending;
 	UINT32 FileAttributes;
 	UINT32 SharedAccess;
 	UINT32 DesiredAccess;
 	UINT32 CreateDisposition;
 	UINT32 CreateOptions;
+	UINT32 inflight; /* shared IRPs currently executing, guarded by the device */
+
+	/* read-ahead and write-behind state, guarded by lock */
+	CRITICAL_SECTION lock;
+	BOOL shared;      /* another FileId refers to the same path */
+	BOOL writeFailed; /* a write back failed, write through from then on */
+	DWORD writeError; /* failed write back not yet reported to a request */
+	BOOL readAhead;
+	BOOL writeBehind;
+	UINT64 nextReadOffset;
+	UINT32 readWindow;
+	BYTE* readBuffer;
+	size_t readCapacity;
+	UINT64 readOffset;
+	size_t readLength;
+	BOOL readEof;
+	BYTE* writeBuffer;
+	UINT64 writeOffset;
+	UINT32 writeLength;
 } DRIVE_FILE;
 
 DRIVE_FILE* drive_file_new(const WCHAR* base_path, const WCHAR* path, UINT32 PathWCharLength,
                            UINT32 id, UINT32 DesiredAccess, UINT32 CreateDisposition,
-                           UINT32 CreateOptions, UINT32 FileAttributes, UINT32 SharedAccess);
+                           UINT32 CreateOptions, UINT32 FileAttributes, UINT32 SharedAccess,
+                           DRIVE_CACHE* cache);
 BOOL drive_file_free(DRIVE_FILE* file);
 
+WCHAR* drive_file_combine_fullpath(const WCHAR* base_path, const WCHAR* path,
+                                   size_t PathWCharLength);
+
+/**
+ * Set while another open file refers to the same path. Buffered data is written back and
+ * dropped and the file is no longer buffered, so the handles see each other's changes.
+ */
+void drive_file_set_shared(DRIVE_FILE* file, BOOL shared);
+
 BOOL drive_file_open(DRIVE_FILE* file);
 BOOL drive_file_seek(DRIVE_FILE* file, UINT64 Offset);
 BOOL drive_file_read(DRIVE_FILE* file, BYTE* buffer, UINT32* Length);
 BOOL drive_file_write(DRIVE_FILE* file, const BYTE* buffer, UINT32 Length);
+BOOL drive_file_read_at(DRIVE_FILE* file, UINT64 Offset, BYTE* buffer, UINT32* Length);
+BOOL drive_file_write_at(DRIVE_FILE* file, UINT64 Offset, const BYTE* buffer, UINT32 Length);
 BOOL drive_file_query_information(DRIVE_FILE* file, UINT32 FsInformationClass, wStream* output);
 BOOL drive_file_set_information(DRIVE_FILE* file, UINT32 FsInformationClass, UINT32 Length,
                                 wStream* input);
@@ -46,6 +46,9 @@
 
 #include "drive_file.h"
 
+/* Number of worker threads executing shared IRPs (read, write, queries) concurrently */
+#define DRIVE_MAX_CONCURRENT_IRPS 8
+
 typedef struct
 {
 	DEVICE device;
@@ -59,7 +62,15 @@ typedef struct
 	BOOL async;
 	wMessageQueue* IrpQueue;
 
+	HANDLE workers[DRIVE_MAX_CONCURRENT_IRPS];
+	size_t workerCount;
+	wMessageQueue* WorkQueue;
+	HANDLE stopEvent;
+	HANDLE idleEvent;
+	CRITICAL_SECTION inflightLock;
+
 	DEVMAN* devman;
+	DRIVE_CACHE* cache;
 
 	rdpContext* rdpcontext;
 } DRIVE_DEVICE;
@@ -143,6 +154,47 @@ static DRIVE_FILE* drive_get_file_by_id(DRIVE_DEVICE* drive, UINT32 id)
 	return file;
 }
 
+/**
+ * The open files of fullpath are buffered only while a single FileId refers to the path.
+ * pending counts a file about to be opened.
+ *
+ * @return the number of open files of fullpath
+ */
+static size_t drive_update_shared(DRIVE_DEVICE* drive, const WCHAR* fullpath, size_t pending)
+{
+	ULONG_PTR* keys = NULL;
+	size_t found = 0;
+
+	WINPR_ASSERT(drive);
+
+	if (!fullpath)
+		return 0;
+
+	ListDictionary_Lock(drive->files);
+	const size_t count = ListDictionary_GetKeys(drive->files, &keys);
+
+	for (size_t pass = 0; pass < 2; pass++)
+	{
+		for (size_t x = 0; x < count; x++)
+		{
+			DRIVE_FILE* file =
+			    (DRIVE_FILE*)ListDictionary_GetItemValue(drive->files, (void*)keys[x]);
+
+			if (!file || !file->fullpath || (_wcscmp(file->fullpath, fullpath) != 0))
+				continue;
+
+			if (pass == 0)
+				found++;
+			else if (file->shared != (found + pending > 1))
+				drive_file_set_shared(file, found + pending > 1);
+		}
+	}
+
+	ListDictionary_Unlock(drive->files);
+	free(keys);
+	return found;
+}
+
 /**
  * Function description
  *
@@ -174,8 +226,19 @@ static UINT drive_process_irp_create(DRIVE_DEVICE* drive, IRP* irp)
 
 	path = Stream_ConstPointer(irp->input);
 	FileId = irp->devman->id_sequence++;
+
+	/* the buffers of other handles on the path are written back before the create can
+	 * truncate the file */
+	WCHAR* fullpath = drive_file_combine_fullpath(drive->path, path, PathLength / sizeof(WCHAR));
+	const size_t others = drive_update_shared(drive, fullpath, 1);
+	free(fullpath);
+
 	file = drive_file_new(drive->path, path, PathLength / sizeof(WCHAR), FileId, DesiredAccess,
-	                      CreateDisposition, CreateOptions, FileAttributes, SharedAccess);
+	                      CreateDisposition, CreateOptions, FileAttributes, SharedAccess,
+	                      drive->cache);
+
+	if (file && (others > 0))
+		drive_file_set_shared(file, TRUE);
 
 	if (!file)
 	{
@@ -218,9 +281,8 @@ static UINT drive_process_irp_create(DRIVE_DEVICE* drive, IRP* irp)
 		if (allocationSize > 0)
 		{
 			const BYTE buffer[] = { '\0' };
-			if (!drive_file_seek(file, allocationSize - sizeof(buffer)))
-				return ERROR_INTERNAL_ERROR;
-			if (!drive_file_write(file, buffer, sizeof(buffer)))
+			if (!drive_file_write_at(file, allocationSize - sizeof(buffer), buffer,
+			                         sizeof(buffer)))
 				return ERROR_INTERNAL_ERROR;
 		}
 	}
@@ -232,6 +294,24 @@ static UINT drive_process_irp_create(DRIVE_DEVICE* drive, IRP* irp)
 	return irp->Complete(irp);
 }
 
+/**
+ * Close a file taken from the list, a single remaining file of its path is buffered again.
+ */
+static BOOL drive_file_free_shared(DRIVE_DEVICE* drive, DRIVE_FILE* file)
+{
+	WINPR_ASSERT(drive);
+	WINPR_ASSERT(file);
+
+	WCHAR* fullpath = file->fullpath ? _wcsdup(file->fullpath) : NULL;
+	const BOOL rc = drive_file_free(file);
+	const DWORD error = GetLastError();
+
+	(void)drive_update_shared(drive, fullpath, 0);
+	free(fullpath);
+	SetLastError(error);
+	return rc;
+}
+
 /**
  * Function description
  *
@@ -254,7 +334,7 @@ static UINT drive_process_irp_close(DRIVE_DEVICE* drive, IRP* irp)
 	{
 		ListDictionary_Take(drive->files, key);
 
-		if (drive_file_free(file))
+		if (drive_file_free_shared(drive, file))
 			irp->IoStatus = STATUS_SUCCESS;
 		else
 			irp->IoStatus = drive_map_windows_err(GetLastError());
@@ -292,11 +372,6 @@ static UINT drive_process_irp_read(DRIVE_DEVICE* drive, IRP* irp)
 		irp->IoStatus = STATUS_UNSUCCESSFUL;
 		Length = 0;
 	}
-	else if (!drive_file_seek(file, Offset))
-	{
-		irp->IoStatus = drive_map_windows_err(GetLastError());
-		Length = 0;
-	}
 
 	if (!Stream_EnsureRemainingCapacity(irp->output, Length + 4))
 	{
@@ -309,7 +384,7 @@ static UINT drive_process_irp_read(DRIVE_DEVICE* drive, IRP* irp)
 	{
 		BYTE* buffer = Stream_PointerAs(irp->output, BYTE) + sizeof(UINT32);
 
-		if (!drive_file_read(file, buffer, &Length))
+		if (!drive_file_read_at(file, Offset, buffer, &Length))
 		{
 			irp->IoStatus = drive_map_windows_err(GetLastError());
 			Stream_Write_UINT32(irp->output, 0);
@@ -355,12 +430,7 @@ static UINT drive_process_irp_write(DRIVE_DEVICE* drive, IRP* irp)
 		irp->IoStatus = STATUS_UNSUCCESSFUL;
 		Length = 0;
 	}
-	else if (!drive_file_seek(file, Offset))
-	{
-		irp->IoStatus = drive_map_windows_err(GetLastError());
-		Length = 0;
-	}
-	else if (!drive_file_write(file, ptr, Length))
+	else if (!drive_file_write_at(file, Offset, ptr, Length))
 	{
 		irp->IoStatus = drive_map_windows_err(GetLastError());
 		Length = 0;
@@ -786,6 +856,159 @@ static BOOL drive_poll_run(DRIVE_DEVICE* drive, IRP* irp)
 	return TRUE;
 }
 
+/**
+ * IRPs that only read file state or use positional I/O may run concurrently with each other,
+ * everything else acts as a barrier for the file it targets.
+ */
+static BOOL drive_irp_is_shared(const IRP* irp)
+{
+	WINPR_ASSERT(irp);
+
+	switch (irp->MajorFunction)
+	{
+		case IRP_MJ_READ:
+		case IRP_MJ_WRITE:
+		case IRP_MJ_QUERY_INFORMATION:
+		case IRP_MJ_QUERY_VOLUME_INFORMATION:
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+static void drive_file_acquire(DRIVE_DEVICE* drive, DRIVE_FILE* file)
+{
+	WINPR_ASSERT(drive);
+
+	if (!file)
+		return;
+
+	EnterCriticalSection(&drive->inflightLock);
+	file->inflight++;
+	LeaveCriticalSection(&drive->inflightLock);
+}
+
+static void drive_file_release(DRIVE_DEVICE* drive, DRIVE_FILE* file)
+{
+	WINPR_ASSERT(drive);
+
+	if (!file)
+		return;
+
+	EnterCriticalSection(&drive->inflightLock);
+	WINPR_ASSERT(file->inflight > 0);
+	file->inflight--;
+	(void)SetEvent(drive->idleEvent);
+	LeaveCriticalSection(&drive->inflightLock);
+}
+
+/**
+ * Wait until all shared IRPs dispatched for a file have completed.
+ */
+static BOOL drive_file_wait_idle(DRIVE_DEVICE* drive, DRIVE_FILE* file)
+{
+	WINPR_ASSERT(drive);
+
+	if (!file)
+		return TRUE;
+
+	while (1)
+	{
+		EnterCriticalSection(&drive->inflightLock);
+		const UINT32 inflight = file->inflight;
+		if (inflight > 0)
+			(void)ResetEvent(drive->idleEvent);
+		LeaveCriticalSection(&drive->inflightLock);
+
+		if (inflight == 0)
+			return TRUE;
+
+		if (WaitForSingleObject(drive->idleEvent, INFINITE) == WAIT_FAILED)
+			return FALSE;
+	}
+}
+
+/**
+ * Hand shared IRPs to the worker pool, run all others in order on the calling thread once
+ * the file they target has no shared IRPs pending.
+ */
+static BOOL drive_dispatch_irp(DRIVE_DEVICE* drive, IRP* irp)
+{
+	WINPR_ASSERT(drive);
+
+	if (!irp)
+		return TRUE;
+
+	DRIVE_FILE* file = drive_get_file_by_id(drive, irp->FileId);
+
+	if ((drive->workerCount > 0) && drive_irp_is_shared(irp))
+	{
+		drive_file_acquire(drive, file);
+		if (!MessageQueue_Post(drive->WorkQueue, NULL, 0, (void*)irp, (void*)file))
+		{
+			WLog_ERR(TAG, "MessageQueue_Post failed!");
+			drive_file_release(drive, file);
+			return FALSE;
+		}
+		return TRUE;
+	}
+
+	if (!drive_file_wait_idle(drive, file))
+	{
+		WLog_ERR(TAG, "WaitForSingleObject failed!");
+		return FALSE;
+	}
+
+	return drive_poll_run(drive, irp);
+}
+
+static DWORD WINAPI drive_worker_func(LPVOID arg)
+{
+	DRIVE_DEVICE* drive = (DRIVE_DEVICE*)arg;
+	UINT error = CHANNEL_RC_OK;
+
+	WINPR_ASSERT(drive);
+
+	HANDLE events[] = { drive->stopEvent, MessageQueue_Event(drive->WorkQueue) };
+
+	while (1)
+	{
+		const DWORD status = WaitForMultipleObjects(ARRAYSIZE(events), events, FALSE, INFINITE);
+
+		if (status == WAIT_FAILED)
+		{
+			error = GetLastError();
+			WLog_ERR(TAG, "WaitForMultipleObjects failed with error %" PRIu32 "!", error);
+			break;
+		}
+
+		if (status == WAIT_OBJECT_0)
+			break;
+
+		/* Another worker may have taken the message already */
+		wMessage message = { 0 };
+		if (!MessageQueue_Peek(drive->WorkQueue, &message, TRUE))
+			continue;
+
+		IRP* irp = (IRP*)message.wParam;
+		DRIVE_FILE* file = (DRIVE_FILE*)message.lParam;
+		const BOOL rc = drive_poll_run(drive, irp);
+		drive_file_release(drive, file);
+
+		if (!rc)
+		{
+			error = ERROR_INTERNAL_ERROR;
+			break;
+		}
+	}
+
+	if (error && drive->rdpcontext)
+		setChannelError(drive->rdpcontext, error, "drive_worker_func reported an error");
+
+	ExitThread(error);
+	return error;
+}
+
 static DWORD WINAPI drive_thread_func(LPVOID arg)
 {
 	DRIVE_DEVICE* drive = (DRIVE_DEVICE*)arg;
@@ -820,7 +1043,7 @@ static DWORD WINAPI drive_thread_func(LPVOID arg)
 			break;
 
 		IRP* irp = (IRP*)message.wParam;
-		if (!drive_poll_run(drive, irp))
+		if (!drive_dispatch_irp(drive, irp))
 			break;
 	}
 
@@ -869,9 +1092,29 @@ static UINT drive_free_int(DRIVE_DEVICE* drive)
 	if (!drive)
 		return ERROR_INVALID_PARAMETER;
 
+	if (drive->stopEvent)
+		(void)SetEvent(drive->stopEvent);
+
+	for (size_t x = 0; x < drive->workerCount; x++)
+	{
+		if (WaitForSingleObject(drive->workers[x], INFINITE) == WAIT_FAILED)
+		{
+			error = GetLastError();
+			WLog_ERR(TAG, "WaitForSingleObject failed with error %" PRIu32 "", error);
+		}
+		(void)CloseHandle(drive->workers[x]);
+	}
+
 	(void)CloseHandle(drive->thread);
+	MessageQueue_Free(drive->WorkQueue);
 	ListDictionary_Free(drive->files);
+	drive_cache_free(drive->cache);
 	MessageQueue_Free(drive->IrpQueue);
+	if (drive->stopEvent)
+		(void)CloseHandle(drive->stopEvent);
+	if (drive->idleEvent)
+		(void)CloseHandle(drive->idleEvent);
+	DeleteCriticalSection(&drive->inflightLock);
 	Stream_Free(drive->device.data, TRUE);
 	free(drive->path);
 	free(drive);
@@ -955,6 +1198,7 @@ static UINT drive_register_drive_path(PDEVICE_SERVICE_ENTRY_POINTS pEntryPoints,
 			return CHANNEL_RC_NO_MEMORY;
 		}
 
+		InitializeCriticalSection(&drive->inflightLock);
 		drive->device.type = RDPDR_DTYP_FILESYSTEM;
 		drive->device.IRPRequest = drive_irp_request;
 		drive->device.Free = drive_free;
@@ -1016,6 +1260,15 @@ static UINT drive_register_drive_path(PDEVICE_SERVICE_ENTRY_POINTS pEntryPoints,
 		}
 
 		ListDictionary_ValueObject(drive->files)->fnObjectFree = drive_file_objfree;
+		drive->cache = drive_cache_new();
+
+		if (!drive->cache)
+		{
+			WLog_ERR(TAG, "drive_cache_new failed!");
+			error = CHANNEL_RC_NO_MEMORY;
+			goto out_error;
+		}
+
 		drive->IrpQueue = MessageQueue_New(NULL);
 
 		if (!drive->IrpQueue)
@@ -1029,25 +1282,64 @@ static UINT drive_register_drive_path(PDEVICE_SERVICE_ENTRY_POINTS pEntryPoints,
 		WINPR_ASSERT(obj);
 		obj->fnObjectFree = drive_message_free;
 
-		if ((error = pEntryPoints->RegisterDevice(pEntryPoints->devman, (DEVICE*)drive)))
-		{
-			WLog_ERR(TAG, "RegisterDevice failed with error %" PRIu32 "!", error);
-			goto out_error;
-		}
-
 		drive->async = !freerdp_settings_get_bool(drive->rdpcontext->settings,
 		                                          FreeRDP_SynchronousStaticChannels);
 		if (drive->async)
 		{
+			drive->WorkQueue = MessageQueue_New(NULL);
+			drive->stopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+			drive->idleEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+			if (!drive->WorkQueue || !drive->stopEvent || !drive->idleEvent)
+			{
+				WLog_ERR(TAG, "Failed to allocate the IRP worker pool!");
+				error = CHANNEL_RC_NO_MEMORY;
+				goto out_error;
+			}
+
+			obj = MessageQueue_Object(drive->WorkQueue);
+			WINPR_ASSERT(obj);
+			obj->fnObjectFree = drive_message_free;
+
+			/* drive_free_int stops and joins the workers started so far */
+			for (size_t x = 0; x < ARRAYSIZE(drive->workers); x++)
+			{
+				drive->workers[x] = CreateThread(NULL, 0, drive_worker_func, drive, 0, NULL);
+				if (!drive->workers[x])
+				{
+					WLog_ERR(TAG, "CreateThread failed!");
+					error = ERROR_INTERNAL_ERROR;
+					goto out_error;
+				}
+				drive->workerCount++;
+			}
+
 			if (!(drive->thread =
 			          CreateThread(NULL, 0, drive_thread_func, drive, CREATE_SUSPENDED, NULL)))
 			{
 				WLog_ERR(TAG, "CreateThread failed!");
+				error = ERROR_INTERNAL_ERROR;
 				goto out_error;
 			}
+		}
+
+		/* devman owns the drive once registered, so this comes last */
+		if ((error = pEntryPoints->RegisterDevice(pEntryPoints->devman, (DEVICE*)drive)))
+		{
+			WLog_ERR(TAG, "RegisterDevice failed with error %" PRIu32 "!", error);
+
+			if (drive->thread)
+			{
+				(void)MessageQueue_PostQuit(drive->IrpQueue, 0);
+				ResumeThread(drive->thread);
+				(void)WaitForSingleObject(drive->thread, INFINITE);
+			}
 
-			ResumeThread(drive->thread);
+			goto out_error;
 		}
+
+		if (drive->thread)
+			ResumeThread(drive->thread);
 	}
 
 	return CHANNEL_RC_OK;
@@ -315,10 +315,6 @@ static UINT rdpgfx_send_supported_caps(GENERIC_CHANNEL_CALLBACK* callback)
 			capsSet->flags = caps10Flags;
 		}
 
-		/* The following capabilities expect support for image scaling.
-		 * Disable these for builds that do not have support for that.
-		 */
-#if defined(WITH_CAIRO) || defined(WITH_SWSCALE)
 		if (!rdpgfx_is_capability_filtered(gfx, RDPGFX_CAPVERSION_105))
 		{
 			capsSet = &capsSets[pdu.capsSetCount++];
@@ -342,7 +338,6 @@ static UINT rdpgfx_send_supported_caps(GENERIC_CHANNEL_CALLBACK* callback)
 			capsSet->length = 0x4;
 			capsSet->flags = caps10Flags;
 		}
-#endif
 
 		if (!rdpgfx_is_capability_filtered(gfx, RDPGFX_CAPVERSION_107))
 		{
@@ -350,9 +345,6 @@ static UINT rdpgfx_send_supported_caps(GENERIC_CHANNEL_CALLBACK* callback)
 			capsSet->version = RDPGFX_CAPVERSION_107;
 			capsSet->length = 0x4;
 			capsSet->flags = caps10Flags;
-#if !defined(WITH_CAIRO) && !defined(WITH_SWSCALE)
-			capsSet->flags |= RDPGFX_CAPS_FLAG_SCALEDMAP_DISABLE;
-#endif
 		}
 	}
 
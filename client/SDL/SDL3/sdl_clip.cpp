@@ -789,6 +789,18 @@ UINT sdlClip::ReceiveFormatDataResponse(CliprdrClientContext* context,
 			WLog_Print(clipboard->_log, WLOG_ERROR, "error when setting clipboard data");
 			return ERROR_INTERNAL_ERROR;
 		}
+
+		/* applications usually ask for several image types in a row, start converting large
+		 * images now instead of on each request */
+		if ((srcFormatId == CF_DIB) || (srcFormatId == CF_DIBV5))
+		{
+			for (const auto& mime : s_mime_image())
+			{
+				const auto formatId = ClipboardGetFormatId(clipboard->_system, mime);
+				if ((formatId != 0) && (request.mime() != mime))
+					(void)ClipboardPrefetchData(clipboard->_system, formatId);
+			}
+		}
 	} while (false);
 
 	if (!SetEvent(clipboard->_event))
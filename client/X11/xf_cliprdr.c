@@ -2146,6 +2146,25 @@ xf_cliprdr_server_format_data_request(CliprdrClientContext* context,
 	return CHANNEL_RC_OK;
 }
 
+/* The other image targets offered for the same server format are usually requested right after
+ * the first one. Start converting large images now instead of on each request. */
+static void xf_cliprdr_prefetch_images(xfClipboard* clipboard, UINT32 srcFormatId,
+                                       UINT32 dstFormatId)
+{
+	WINPR_ASSERT(clipboard);
+
+	for (size_t x = 0; x < clipboard->numClientFormats; x++)
+	{
+		const xfCliprdrFormat* format = &clipboard->clientFormats[x];
+
+		if (!format->isImage || (format->formatToRequest != srcFormatId) ||
+		    (format->localFormat == dstFormatId))
+			continue;
+
+		(void)ClipboardPrefetchData(clipboard->system, format->localFormat);
+	}
+}
+
 /**
  * Function description
  *
@@ -2289,6 +2308,7 @@ xf_cliprdr_server_format_data_response(CliprdrClientContext* context,
 		}
 		else
 		{
+			xf_cliprdr_prefetch_images(clipboard, srcFormatId, dstFormatId);
 			pDstData = (BYTE*)ClipboardGetData(clipboard->system, dstFormatId, &DstSize);
 
 			if (!pDstData)
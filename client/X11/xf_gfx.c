@@ -245,7 +245,7 @@ UINT xf_OutputExpose(xfContext* xfc, UINT32 x, UINT32 y, UINT32 width, UINT32 he
 
 	free(pSurfaceIds);
 	LeaveCriticalSection(&context->mux);
-	IFCALLRET(context->UpdateSurfaces, status, context);
+	status = gdi_graphics_pipeline_update_surfaces(context);
 
 	if (status != CHANNEL_RC_OK)
 		goto fail;
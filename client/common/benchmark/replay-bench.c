@@ -0,0 +1,676 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Session replay benchmarking tool
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <winpr/assert.h>
+#include <winpr/interlocked.h>
+#include <winpr/path.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/freerdp.h>
+#include <freerdp/gdi/gdi.h>
+#include <freerdp/gdi/gfx.h>
+#include <freerdp/streamdump.h>
+#include <freerdp/transport_io.h>
+#include <freerdp/utils/gfx.h>
+#include <freerdp/client/cmdline.h>
+#include <freerdp/client/rdpgfx.h>
+#include <freerdp/channels/channels.h>
+#include <freerdp/log.h>
+
+#define TAG CLIENT_TAG("replay-bench")
+
+/* Count heap allocations by interposing the glibc allocator entry points.
+ * Every call to malloc, calloc, realloc, memalign, aligned_alloc or posix_memalign counts as one
+ * allocation of the requested size, realloc counts the new size even if the block is resized in
+ * place. Calls rejected for invalid arguments, free, valloc and pvalloc are not counted.
+ * Sanitizer builds bring their own allocator, so leave it alone there. */
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+#define REPLAY_BENCH_COUNT_ALLOCATIONS
+#define REPLAY_BENCH_EXPORT __attribute__((visibility("default")))
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void* __libc_memalign(size_t alignment, size_t size);
+
+static UINT64 replay_allocations = 0;
+static UINT64 replay_allocated_bytes = 0;
+
+static void replay_count_allocation(size_t size)
+{
+	__atomic_fetch_add(&replay_allocations, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&replay_allocated_bytes, size, __ATOMIC_RELAXED);
+}
+
+REPLAY_BENCH_EXPORT void* malloc(size_t size)
+{
+	replay_count_allocation(size);
+	return __libc_malloc(size);
+}
+
+REPLAY_BENCH_EXPORT void* calloc(size_t nmemb, size_t size)
+{
+	replay_count_allocation(nmemb * size);
+	return __libc_calloc(nmemb, size);
+}
+
+REPLAY_BENCH_EXPORT void* realloc(void* ptr, size_t size)
+{
+	replay_count_allocation(size);
+	return __libc_realloc(ptr, size);
+}
+
+REPLAY_BENCH_EXPORT void* memalign(size_t alignment, size_t size)
+{
+	replay_count_allocation(size);
+	return __libc_memalign(alignment, size);
+}
+
+/* glibc implements aligned_alloc as memalign */
+REPLAY_BENCH_EXPORT void* aligned_alloc(size_t alignment, size_t size)
+{
+	replay_count_allocation(size);
+	return __libc_memalign(alignment, size);
+}
+
+REPLAY_BENCH_EXPORT int posix_memalign(void** memptr, size_t alignment, size_t size)
+{
+	WINPR_ASSERT(memptr);
+
+	/* a power of two multiple of sizeof(void*) */
+	if ((alignment == 0) || ((alignment % sizeof(void*)) != 0) ||
+	    ((alignment & (alignment - 1)) != 0))
+		return EINVAL;
+
+	replay_count_allocation(size);
+	void* ptr = __libc_memalign(alignment, size);
+
+	if (!ptr)
+		return ENOMEM;
+
+	*memptr = ptr;
+	return 0;
+}
+#endif
+
+typedef enum
+{
+	REPLAY_STAGE_TRANSPORT,
+	REPLAY_STAGE_UPDATE,
+	REPLAY_STAGE_GFX_DECODE,
+	REPLAY_STAGE_GFX_PRESENT,
+	REPLAY_STAGE_COUNT
+} replay_stage_id;
+
+/* Stage names, also used as JSON keys */
+static const char* replay_stage_names[REPLAY_STAGE_COUNT] = { "transport", "update", "gfx_decode",
+	                                                          "gfx_present" };
+
+/* RDPGFX codec ids are all below 0x10 */
+#define REPLAY_CODEC_COUNT 0x10
+
+typedef struct
+{
+	volatile LONGLONG calls;
+	volatile LONGLONG ns;
+} replay_stage;
+
+typedef struct
+{
+	rdpClientContext common;
+
+	pTransportRWFkt ReadPdu;
+	pBeginPaint BeginPaint;
+	pEndPaint EndPaint;
+	pcRdpgfxSurfaceCommand SurfaceCommand;
+	pcRdpgfxEndFrame EndFrame;
+	UINT64 paintStart;
+
+	BOOL endOfDump;
+	volatile LONGLONG pdus;
+	volatile LONGLONG bytes;
+	volatile LONGLONG gfxFrames;
+	replay_stage stages[REPLAY_STAGE_COUNT];
+	replay_stage codecs[REPLAY_CODEC_COUNT];
+} replayContext;
+
+typedef struct
+{
+	UINT64 connectNs;
+	UINT64 totalNs;
+	UINT64 allocations;
+	UINT64 allocatedBytes;
+} replay_result;
+
+static void replay_add(volatile LONGLONG* value, LONGLONG diff)
+{
+	LONGLONG cur = *value;
+	for (;;)
+	{
+		const LONGLONG prev = InterlockedCompareExchange64(value, cur + diff, cur);
+		if (prev == cur)
+			break;
+		cur = prev;
+	}
+}
+
+static void replay_stage_add(replay_stage* stage, UINT64 start)
+{
+	WINPR_ASSERT(stage);
+	const UINT64 end = winpr_GetTickCount64NS();
+	replay_add(&stage->calls, 1);
+	replay_add(&stage->ns, (LONGLONG)(end - start));
+}
+
+static UINT64 replay_allocation_count(UINT64* bytes)
+{
+#if defined(REPLAY_BENCH_COUNT_ALLOCATIONS)
+	if (bytes)
+		*bytes = __atomic_load_n(&replay_allocated_bytes, __ATOMIC_RELAXED);
+	return __atomic_load_n(&replay_allocations, __ATOMIC_RELAXED);
+#else
+	if (bytes)
+		*bytes = 0;
+	return 0;
+#endif
+}
+
+static int replay_read_pdu(rdpTransport* transport, wStream* s)
+{
+	replayContext* replay = (replayContext*)transport_get_context(transport);
+	WINPR_ASSERT(replay);
+	WINPR_ASSERT(replay->ReadPdu);
+
+	const UINT64 start = winpr_GetTickCount64NS();
+	const int rc = replay->ReadPdu(transport, s);
+	replay_stage_add(&replay->stages[REPLAY_STAGE_TRANSPORT], start);
+
+	if (rc < 0)
+		replay->endOfDump = TRUE;
+	else if (rc > 0)
+	{
+		replay_add(&replay->pdus, 1);
+		replay_add(&replay->bytes, (LONGLONG)Stream_Length(s));
+	}
+	return rc;
+}
+
+static BOOL replay_begin_paint(rdpContext* context)
+{
+	replayContext* replay = (replayContext*)context;
+	WINPR_ASSERT(replay);
+
+	replay->paintStart = winpr_GetTickCount64NS();
+	return IFCALLRESULT(TRUE, replay->BeginPaint, context);
+}
+
+static BOOL replay_end_paint(rdpContext* context)
+{
+	replayContext* replay = (replayContext*)context;
+	WINPR_ASSERT(replay);
+
+	const BOOL rc = IFCALLRESULT(TRUE, replay->EndPaint, context);
+	replay_stage_add(&replay->stages[REPLAY_STAGE_UPDATE], replay->paintStart);
+	return rc;
+}
+
+static replayContext* replay_from_gfx(RdpgfxClientContext* gfx)
+{
+	WINPR_ASSERT(gfx);
+	rdpGdi* gdi = (rdpGdi*)gfx->custom;
+	WINPR_ASSERT(gdi);
+	return (replayContext*)gdi->context;
+}
+
+static UINT replay_gfx_surface_command(RdpgfxClientContext* gfx, const RDPGFX_SURFACE_COMMAND* cmd)
+{
+	replayContext* replay = replay_from_gfx(gfx);
+	WINPR_ASSERT(replay);
+	WINPR_ASSERT(replay->SurfaceCommand);
+	WINPR_ASSERT(cmd);
+
+	const UINT64 start = winpr_GetTickCount64NS();
+	const UINT rc = replay->SurfaceCommand(gfx, cmd);
+	replay_stage_add(&replay->stages[REPLAY_STAGE_GFX_DECODE], start);
+	if (cmd->codecId < REPLAY_CODEC_COUNT)
+		replay_stage_add(&replay->codecs[cmd->codecId], start);
+	return rc;
+}
+
+static UINT replay_gfx_end_frame(RdpgfxClientContext* gfx, const RDPGFX_END_FRAME_PDU* endFrame)
+{
+	replayContext* replay = replay_from_gfx(gfx);
+	WINPR_ASSERT(replay);
+	WINPR_ASSERT(replay->EndFrame);
+
+	const UINT64 start = winpr_GetTickCount64NS();
+	const UINT rc = replay->EndFrame(gfx, endFrame);
+	replay_stage_add(&replay->stages[REPLAY_STAGE_GFX_PRESENT], start);
+	replay_add(&replay->gfxFrames, 1);
+	return rc;
+}
+
+static void replay_OnChannelConnectedEventHandler(void* context,
+                                                  const ChannelConnectedEventArgs* e)
+{
+	replayContext* replay = (replayContext*)context;
+	WINPR_ASSERT(replay);
+	WINPR_ASSERT(e);
+
+	freerdp_client_OnChannelConnectedEventHandler(context, e);
+
+	if (strcmp(e->name, RDPGFX_DVC_CHANNEL_NAME) == 0)
+	{
+		RdpgfxClientContext* gfx = (RdpgfxClientContext*)e->pInterface;
+		WINPR_ASSERT(gfx);
+
+		replay->SurfaceCommand = gfx->SurfaceCommand;
+		replay->EndFrame = gfx->EndFrame;
+		if (replay->SurfaceCommand)
+			gfx->SurfaceCommand = replay_gfx_surface_command;
+		if (replay->EndFrame)
+			gfx->EndFrame = replay_gfx_end_frame;
+	}
+}
+
+static void replay_OnChannelDisconnectedEventHandler(void* context,
+                                                     const ChannelDisconnectedEventArgs* e)
+{
+	freerdp_client_OnChannelDisconnectedEventHandler(context, e);
+}
+
+static BOOL replay_pre_connect(freerdp* instance)
+{
+	WINPR_ASSERT(instance);
+	WINPR_ASSERT(instance->context);
+
+	PubSub_SubscribeChannelConnected(instance->context->pubSub,
+	                                 replay_OnChannelConnectedEventHandler);
+	PubSub_SubscribeChannelDisconnected(instance->context->pubSub,
+	                                    replay_OnChannelDisconnectedEventHandler);
+	return TRUE;
+}
+
+static BOOL replay_post_connect(freerdp* instance)
+{
+	WINPR_ASSERT(instance);
+
+	if (!gdi_init(instance, PIXEL_FORMAT_BGRX32))
+		return FALSE;
+
+	replayContext* replay = (replayContext*)instance->context;
+	WINPR_ASSERT(replay);
+
+	rdpUpdate* update = instance->context->update;
+	WINPR_ASSERT(update);
+
+	replay->BeginPaint = update->BeginPaint;
+	replay->EndPaint = update->EndPaint;
+	update->BeginPaint = replay_begin_paint;
+	update->EndPaint = replay_end_paint;
+	return TRUE;
+}
+
+static void replay_post_disconnect(freerdp* instance)
+{
+	if (!instance || !instance->context)
+		return;
+
+	PubSub_UnsubscribeChannelConnected(instance->context->pubSub,
+	                                   replay_OnChannelConnectedEventHandler);
+	PubSub_UnsubscribeChannelDisconnected(instance->context->pubSub,
+	                                      replay_OnChannelDisconnectedEventHandler);
+	gdi_free(instance);
+}
+
+static BOOL replay_client_new(freerdp* instance, rdpContext* context)
+{
+	if (!instance || !context)
+		return FALSE;
+
+	instance->PreConnect = replay_pre_connect;
+	instance->PostConnect = replay_post_connect;
+	instance->PostDisconnect = replay_post_disconnect;
+	return TRUE;
+}
+
+static int RdpClientEntry(RDP_CLIENT_ENTRY_POINTS* pEntryPoints)
+{
+	WINPR_ASSERT(pEntryPoints);
+
+	ZeroMemory(pEntryPoints, sizeof(RDP_CLIENT_ENTRY_POINTS));
+	pEntryPoints->Version = RDP_CLIENT_INTERFACE_VERSION;
+	pEntryPoints->Size = sizeof(RDP_CLIENT_ENTRY_POINTS_V1);
+	pEntryPoints->ContextSize = sizeof(replayContext);
+	pEntryPoints->ClientNew = replay_client_new;
+	return 0;
+}
+
+static BOOL replay_register_transport(rdpContext* context)
+{
+	replayContext* replay = (replayContext*)context;
+	WINPR_ASSERT(replay);
+
+	if (!stream_dump_register_handlers(context, CONNECTION_STATE_MCS_CREATE_REQUEST, FALSE))
+		return FALSE;
+
+	const rdpTransportIo* dfl = freerdp_get_io_callbacks(context);
+	if (!dfl)
+		return FALSE;
+
+	rdpTransportIo io = *dfl;
+	replay->ReadPdu = io.ReadPdu;
+	io.ReadPdu = replay_read_pdu;
+	return freerdp_set_io_callbacks(context, &io);
+}
+
+static BOOL replay_run(rdpContext* context, replay_result* result)
+{
+	HANDLE handles[MAXIMUM_WAIT_OBJECTS] = { 0 };
+	replayContext* replay = (replayContext*)context;
+
+	WINPR_ASSERT(replay);
+	WINPR_ASSERT(result);
+
+	const UINT64 allocStart = replay_allocation_count(&result->allocatedBytes);
+	const UINT64 allocBytesStart = result->allocatedBytes;
+	const UINT64 start = winpr_GetTickCount64NS();
+
+	if (!freerdp_connect(context->instance))
+	{
+		if (!replay->endOfDump)
+		{
+			WLog_ERR(TAG, "replay connection failure 0x%08" PRIx32,
+			         freerdp_get_last_error(context));
+			return FALSE;
+		}
+	}
+	result->connectNs = winpr_GetTickCount64NS() - start;
+
+	while (!replay->endOfDump && !freerdp_shall_disconnect_context(context))
+	{
+		const DWORD nCount = freerdp_get_event_handles(context, handles, ARRAYSIZE(handles));
+		if (nCount == 0)
+		{
+			WLog_ERR(TAG, "freerdp_get_event_handles failed");
+			break;
+		}
+
+		const DWORD status = WaitForMultipleObjects(nCount, handles, FALSE, 100);
+		if (status == WAIT_FAILED)
+		{
+			WLog_ERR(TAG, "WaitForMultipleObjects failed with %" PRIu32 "", status);
+			break;
+		}
+
+		if (!freerdp_check_event_handles(context))
+			break;
+	}
+
+	result->totalNs = winpr_GetTickCount64NS() - start;
+	result->allocations = replay_allocation_count(&result->allocatedBytes) - allocStart;
+	result->allocatedBytes -= allocBytesStart;
+
+	freerdp_disconnect(context->instance);
+
+	if (!replay->endOfDump)
+	{
+		WLog_ERR(TAG, "replay aborted before the end of the dump was reached");
+		return FALSE;
+	}
+	if (replay->pdus == 0)
+	{
+		WLog_ERR(TAG, "no PDU could be replayed from the dump");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static double replay_per_second(LONGLONG count, UINT64 ns)
+{
+	if (ns == 0)
+		return 0.0;
+	return (double)count * 1000000000.0 / (double)ns;
+}
+
+static void replay_print_json_string(FILE* fp, const char* str)
+{
+	(void)fputc('"', fp);
+	for (const char* cur = str; cur && *cur; cur++)
+	{
+		const unsigned char c = (unsigned char)*cur;
+		if ((c == '"') || (c == '\\'))
+			(void)fprintf(fp, "\\%c", c);
+		else if (c < 0x20)
+			(void)fprintf(fp, "\\u%04x", c);
+		else
+			(void)fputc(c, fp);
+	}
+	(void)fputc('"', fp);
+}
+
+static void replay_print_json(FILE* fp, const char* file, const replayContext* replay,
+                              const replay_result* result)
+{
+	(void)fprintf(fp, "{\n  \"file\": ");
+	replay_print_json_string(fp, file);
+	(void)fprintf(fp, ",\n  \"duration_ns\": %" PRIu64 ",\n", result->totalNs);
+	(void)fprintf(fp, "  \"connect_ns\": %" PRIu64 ",\n", result->connectNs);
+	(void)fprintf(fp, "  \"pdus\": %" PRId64 ",\n", replay->pdus);
+	(void)fprintf(fp, "  \"bytes\": %" PRId64 ",\n", replay->bytes);
+	(void)fprintf(fp, "  \"bytes_per_second\": %.1f,\n",
+	              replay_per_second(replay->bytes, result->totalNs));
+	(void)fprintf(fp, "  \"gfx_frames\": %" PRId64 ",\n", replay->gfxFrames);
+	(void)fprintf(fp, "  \"paints\": %" PRId64 ",\n",
+	              replay->stages[REPLAY_STAGE_UPDATE].calls);
+	(void)fprintf(fp, "  \"frames_per_second\": %.2f,\n",
+	              replay_per_second(replay->gfxFrames + replay->stages[REPLAY_STAGE_UPDATE].calls,
+	                                result->totalNs));
+#if defined(REPLAY_BENCH_COUNT_ALLOCATIONS)
+	(void)fprintf(fp, "  \"allocations\": %" PRIu64 ",\n", result->allocations);
+	(void)fprintf(fp, "  \"allocated_bytes\": %" PRIu64 ",\n", result->allocatedBytes);
+#endif
+
+	(void)fprintf(fp, "  \"stages\": {");
+	for (size_t x = 0; x < REPLAY_STAGE_COUNT; x++)
+	{
+		const replay_stage* stage = &replay->stages[x];
+		(void)fprintf(fp, "%s\n    \"%s\": { \"calls\": %" PRId64 ", \"ns\": %" PRId64 " }",
+		              (x > 0) ? "," : "", replay_stage_names[x], stage->calls, stage->ns);
+	}
+	(void)fprintf(fp, "\n  },\n  \"codecs\": {");
+
+	BOOL first = TRUE;
+	for (UINT16 x = 0; x < REPLAY_CODEC_COUNT; x++)
+	{
+		const replay_stage* stage = &replay->codecs[x];
+		if (stage->calls == 0)
+			continue;
+		(void)fprintf(fp, "%s\n    ", first ? "" : ",");
+		replay_print_json_string(fp, rdpgfx_get_codec_id_string(x));
+		(void)fprintf(fp, ": { \"calls\": %" PRId64 ", \"ns\": %" PRId64 " }", stage->calls,
+		              stage->ns);
+		first = FALSE;
+	}
+	(void)fprintf(fp, "%s}\n}\n", first ? "" : "\n  ");
+}
+
+static void replay_print_stage(FILE* fp, const char* name, const replay_stage* stage)
+{
+	const double ms = (double)stage->ns / 1000000.0;
+	const double avg = (stage->calls > 0) ? (double)stage->ns / 1000.0 / (double)stage->calls : 0.0;
+	(void)fprintf(fp, "  %-32s %10" PRId64 " %12.3f %10.3f\n", name, stage->calls, ms, avg);
+}
+
+static void replay_print_text(FILE* fp, const char* file, const replayContext* replay,
+                              const replay_result* result)
+{
+	const LONGLONG frames = replay->gfxFrames + replay->stages[REPLAY_STAGE_UPDATE].calls;
+
+	(void)fprintf(fp, "Replay of %s\n", file);
+	(void)fprintf(fp, "  duration    %.3f s (connect %.3f s)\n", (double)result->totalNs / 1e9,
+	              (double)result->connectNs / 1e9);
+	(void)fprintf(fp, "  pdus        %" PRId64 " (%" PRId64 " bytes, %.2f MiB/s)\n", replay->pdus,
+	              replay->bytes,
+	              replay_per_second(replay->bytes, result->totalNs) / (1024.0 * 1024.0));
+	(void)fprintf(fp,
+	              "  frames      %" PRId64 " (%" PRId64 " gfx, %" PRId64 " paint, %.2f fps)\n",
+	              frames, replay->gfxFrames, replay->stages[REPLAY_STAGE_UPDATE].calls,
+	              replay_per_second(frames, result->totalNs));
+#if defined(REPLAY_BENCH_COUNT_ALLOCATIONS)
+	(void)fprintf(fp, "  allocations %" PRIu64 " (%" PRIu64 " bytes)\n", result->allocations,
+	              result->allocatedBytes);
+#else
+	(void)fprintf(fp, "  allocations not available on this platform\n");
+#endif
+	(void)fprintf(fp, "\n  %-32s %10s %12s %10s\n", "stage", "calls", "total [ms]", "avg [us]");
+	for (size_t x = 0; x < REPLAY_STAGE_COUNT; x++)
+		replay_print_stage(fp, replay_stage_names[x], &replay->stages[x]);
+
+	for (UINT16 x = 0; x < REPLAY_CODEC_COUNT; x++)
+	{
+		char name[64] = { 0 };
+		if (replay->codecs[x].calls == 0)
+			continue;
+		(void)_snprintf(name, sizeof(name), "  %s", rdpgfx_get_codec_id_string(x));
+		replay_print_stage(fp, name, &replay->codecs[x]);
+	}
+}
+
+static void replay_log_to_stderr(void)
+{
+	/* Keep stdout reserved for the report. Other appender types reject the
+	 * setting, which leaves a user supplied WLOG_APPENDER configuration alone. */
+	wLogAppender* appender = WLog_GetLogAppender(WLog_GetRoot());
+	if (appender)
+		(void)WLog_ConfigureAppender(appender, "outputstream", (void*)"stderr");
+}
+
+static void replay_usage(const char* name)
+{
+	(void)fprintf(stderr,
+	              "Usage: %s [--json] <dump file> [client options]\n"
+	              "\n"
+	              "Replays a session recorded with /dump:record,file:<dump file> through the\n"
+	              "client stack without delays and reports per stage timings.\n"
+	              "Pass the client options used for the recording (e.g. /gfx, /rfx, /bpp) so\n"
+	              "the same channels and codecs are negotiated.\n"
+	              "\n"
+	              "  --json  print the report as JSON\n",
+	              name);
+}
+
+int main(int argc, char* argv[])
+{
+	int rc = -1;
+	BOOL json = FALSE;
+	int arg = 1;
+	replay_result result = { 0 };
+	RDP_CLIENT_ENTRY_POINTS clientEntryPoints = { 0 };
+
+	for (; arg < argc; arg++)
+	{
+		if (strcmp(argv[arg], "--json") == 0)
+			json = TRUE;
+		else if ((strcmp(argv[arg], "--help") == 0) || (strcmp(argv[arg], "-h") == 0))
+		{
+			replay_usage(argv[0]);
+			return 0;
+		}
+		else
+			break;
+	}
+
+	if (arg >= argc)
+	{
+		replay_usage(argv[0]);
+		return -1;
+	}
+
+	const char* file = argv[arg++];
+	if (!winpr_PathFileExists(file))
+	{
+		(void)fprintf(stderr, "dump file '%s' does not exist\n", file);
+		return -1;
+	}
+
+	replay_log_to_stderr();
+
+	RdpClientEntry(&clientEntryPoints);
+	rdpContext* context = freerdp_client_context_new(&clientEntryPoints);
+	if (!context)
+		goto fail;
+
+	/* Hand the remaining options to the regular client parser */
+	if (arg < argc)
+	{
+		argv[arg - 1] = argv[0];
+		const int status = freerdp_client_settings_parse_command_line(
+		    context->settings, argc - arg + 1, &argv[arg - 1], FALSE);
+		if (status)
+		{
+			rc = freerdp_client_settings_command_line_status_print(context->settings, status,
+			                                                       argc - arg + 1, &argv[arg - 1]);
+			goto fail;
+		}
+	}
+
+	rdpSettings* settings = context->settings;
+	if (!freerdp_settings_set_bool(settings, FreeRDP_TransportDump, FALSE) ||
+	    !freerdp_settings_set_bool(settings, FreeRDP_TransportDumpReplay, TRUE) ||
+	    !freerdp_settings_set_bool(settings, FreeRDP_TransportDumpReplayNodelay, TRUE) ||
+	    !freerdp_settings_set_bool(settings, FreeRDP_DeactivateClientDecoding, FALSE) ||
+	    !freerdp_settings_set_string(settings, FreeRDP_TransportDumpFile, file))
+		goto fail;
+
+	if (!freerdp_settings_get_string(settings, FreeRDP_ServerHostname))
+	{
+		if (!freerdp_settings_set_string(settings, FreeRDP_ServerHostname, "replay"))
+			goto fail;
+	}
+
+	if (!replay_register_transport(context))
+		goto fail;
+
+	if (freerdp_client_start(context) != 0)
+		goto fail;
+
+	const BOOL success = replay_run(context, &result);
+
+	if (freerdp_client_stop(context) != 0)
+		goto fail;
+
+	if (!success)
+		goto fail;
+
+	if (json)
+		replay_print_json(stdout, file, (replayContext*)context, &result);
+	else
+		replay_print_text(stdout, file, (replayContext*)context, &result);
+	rc = 0;
+
+fail:
+	freerdp_client_context_free(context);
+	return rc;
+}
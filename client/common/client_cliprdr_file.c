@@ -34,6 +34,7 @@
 #if defined(WITH_FUSE)
 #include <sys/mount.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <errno.h>
 #include <time.h>
 #endif
@@ -58,6 +59,14 @@
 #define NO_CLIP_DATA_ID (UINT64_C(1) << 32)
 #define WIN32_FILETIME_TO_UNIX_EPOCH INT64_C(11644473600)
 
+/* FUSE reads are served from aligned chunks, each fetched with a single FILECONTENTS_RANGE */
+#define CLIPRDR_FUSE_CHUNK_SIZE (1024ULL * 1024ULL)
+/* Chunks requested ahead of a sequential reader */
+#define CLIPRDR_FUSE_PREFETCH_CHUNKS 4
+/* Upper bound of cached chunks per file, in flight chunks are never evicted */
+#define CLIPRDR_FUSE_MAX_CHUNKS 16
+#define CLIPRDR_FUSE_MAX_READ_SIZE (8ULL * 1024ULL * 1024ULL)
+
 #ifdef WITH_DEBUG_CLIPRDR
 #define DEBUG_CLIPRDR(log, ...) WLog_Print(log, WLOG_DEBUG, __VA_ARGS__)
 #else
@@ -99,8 +108,29 @@ struct sCliprdrFuseFile
 
 	BOOL has_clip_data_id;
 	UINT32 clip_data_id;
+
+	/* Read cache, created on first read, guarded by the inode_table lock */
+	wArrayList* chunks;
+	wArrayList* waiters;
+	UINT64 next_read_offset;
 };
 
+typedef struct
+{
+	UINT64 index;
+	BOOL complete;
+	BYTE* data;
+	size_t length;
+	size_t capacity;
+} CliprdrFuseChunk;
+
+typedef struct
+{
+	fuse_req_t fuse_req;
+	UINT64 offset;
+	size_t size;
+} CliprdrFuseReadWaiter;
+
 typedef struct
 {
 	CliprdrFileContext* file_context;
@@ -128,6 +158,8 @@ typedef struct
 	CliprdrFuseFile* fuse_file;
 	fuse_req_t fuse_req;
 	UINT32 stream_id;
+	/* FUSE_LL_OPERATION_READ requests fetch a chunk and have no fuse_req attached */
+	UINT64 chunk_index;
 } CliprdrFuseRequest;
 
 typedef struct
@@ -142,6 +174,7 @@ typedef struct
 	char* name;
 	FILE* fp;
 	INT64 size;
+	UINT64 position;
 	CliprdrFileContext* context;
 } CliprdrLocalFile;
 
@@ -186,6 +219,11 @@ struct cliprdr_file_context
 	UINT32 local_lock_id;
 
 	wHashTable* local_streams;
+	/* The only local file kept open between range requests, guarded by local_streams */
+	CliprdrLocalFile* open_file;
+	/* Reused for every range response, guarded by local_streams */
+	BYTE* range_buffer;
+	size_t range_buffer_size;
 	wLog* log;
 	void* clipboard;
 	CliprdrClientContext* context;
@@ -196,6 +234,17 @@ struct cliprdr_file_context
 };
 
 #if defined(WITH_FUSE)
+static void fuse_chunk_free(void* data)
+{
+	CliprdrFuseChunk* chunk = data;
+
+	if (!chunk)
+		return;
+
+	free(chunk->data);
+	free(chunk);
+}
+
 static void fuse_file_free(void* data)
 {
 	CliprdrFuseFile* fuse_file = data;
@@ -203,6 +252,17 @@ static void fuse_file_free(void* data)
 	if (!fuse_file)
 		return;
 
+	if (fuse_file->waiters)
+	{
+		/* Reads still waiting for data must not be left unanswered */
+		for (size_t x = 0; x < ArrayList_Count(fuse_file->waiters); x++)
+		{
+			CliprdrFuseReadWaiter* waiter = ArrayList_GetItem(fuse_file->waiters, x);
+			fuse_reply_err(waiter->fuse_req, EIO);
+		}
+		ArrayList_Free(fuse_file->waiters);
+	}
+	ArrayList_Free(fuse_file->chunks);
 	ArrayList_Free(fuse_file->children);
 	free(fuse_file->filename_with_root);
 
@@ -352,7 +412,8 @@ static BOOL maybe_clear_fuse_request(const void* key, void* value, void* arg)
 	DEBUG_CLIPRDR(file_context->log, "Clearing FileContentsRequest for file \"%s\"",
 	              fuse_file->filename_with_root);
 
-	fuse_reply_err(fuse_request->fuse_req, EIO);
+	if (fuse_request->fuse_req)
+		fuse_reply_err(fuse_request->fuse_req, EIO);
 	HashTable_Remove(file_context->request_table, key);
 
 	return TRUE;
@@ -911,7 +972,7 @@ static void cliprdr_file_fuse_open(fuse_req_t fuse_req, fuse_ino_t fuse_ino,
 }
 
 static BOOL request_file_range_async(CliprdrFileContext* file_context, CliprdrFuseFile* fuse_file,
-                                     fuse_req_t fuse_req, off_t offset, size_t requested_size)
+                                     UINT64 chunk_index, UINT64 offset, size_t requested_size)
 {
 	CLIPRDR_FILE_CONTENTS_REQUEST file_contents_request = { 0 };
 
@@ -922,9 +983,10 @@ static BOOL request_file_range_async(CliprdrFileContext* file_context, CliprdrFu
 		return FALSE;
 
 	CliprdrFuseRequest* fuse_request =
-	    cliprdr_fuse_request_new(file_context, fuse_file, fuse_req, FUSE_LL_OPERATION_READ);
+	    cliprdr_fuse_request_new(file_context, fuse_file, NULL, FUSE_LL_OPERATION_READ);
 	if (!fuse_request)
 		return FALSE;
+	fuse_request->chunk_index = chunk_index;
 
 	file_contents_request.common.msgType = CB_FILECONTENTS_REQUEST;
 	file_contents_request.streamId = fuse_request->stream_id;
@@ -950,13 +1012,330 @@ static BOOL request_file_range_async(CliprdrFileContext* file_context, CliprdrFu
 	// NOLINTBEGIN(clang-analyzer-unix.Malloc)
 	DEBUG_CLIPRDR(
 	    file_context->log,
-	    "Requested file range (%zu Bytes at offset %lu) for file \"%s\" with stream id %u",
+	    "Requested file range (%zu Bytes at offset %" PRIu64 ") for file \"%s\" with stream id %u",
 	    requested_size, offset, fuse_file->filename, fuse_request->stream_id);
 
 	return TRUE;
 	// NOLINTEND(clang-analyzer-unix.Malloc)
 }
 
+static CliprdrFuseChunk* fuse_file_get_chunk(CliprdrFuseFile* fuse_file, UINT64 index)
+{
+	WINPR_ASSERT(fuse_file);
+
+	for (size_t x = 0; x < ArrayList_Count(fuse_file->chunks); x++)
+	{
+		CliprdrFuseChunk* chunk = ArrayList_GetItem(fuse_file->chunks, x);
+		if (chunk->index == index)
+			return chunk;
+	}
+	return NULL;
+}
+
+static BOOL fuse_file_chunk_is_waited_for(CliprdrFuseFile* fuse_file, UINT64 index)
+{
+	WINPR_ASSERT(fuse_file);
+
+	for (size_t x = 0; x < ArrayList_Count(fuse_file->waiters); x++)
+	{
+		const CliprdrFuseReadWaiter* waiter = ArrayList_GetItem(fuse_file->waiters, x);
+		const UINT64 first = waiter->offset / CLIPRDR_FUSE_CHUNK_SIZE;
+		const UINT64 last = (waiter->offset + waiter->size - 1) / CLIPRDR_FUSE_CHUNK_SIZE;
+
+		if ((index >= first) && (index <= last))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/**
+ * Returns a completed chunk that may be dropped to make room for a new one. Chunks behind the
+ * current read position are preferred, chunks in flight or needed by a pending read are kept.
+ */
+static CliprdrFuseChunk* fuse_file_chunk_to_evict(CliprdrFuseFile* fuse_file)
+{
+	CliprdrFuseChunk* candidate = NULL;
+
+	WINPR_ASSERT(fuse_file);
+
+	const UINT64 current = fuse_file->next_read_offset / CLIPRDR_FUSE_CHUNK_SIZE;
+
+	for (size_t x = 0; x < ArrayList_Count(fuse_file->chunks); x++)
+	{
+		CliprdrFuseChunk* chunk = ArrayList_GetItem(fuse_file->chunks, x);
+
+		if (!chunk->complete || fuse_file_chunk_is_waited_for(fuse_file, chunk->index))
+			continue;
+		if (chunk->index < current)
+			return chunk;
+		if (!candidate || (chunk->index > candidate->index))
+			candidate = chunk;
+	}
+	return candidate;
+}
+
+/**
+ * Makes sure chunk index is cached or in flight. Prefetches (demand == FALSE) give up instead of
+ * growing the cache beyond CLIPRDR_FUSE_MAX_CHUNKS.
+ */
+static BOOL fuse_file_request_chunk(CliprdrFileContext* file_context, CliprdrFuseFile* fuse_file,
+                                    UINT64 index, BOOL demand)
+{
+	CliprdrFuseChunk* chunk = NULL;
+
+	WINPR_ASSERT(file_context);
+	WINPR_ASSERT(fuse_file);
+
+	const UINT64 offset = index * CLIPRDR_FUSE_CHUNK_SIZE;
+	if (offset >= fuse_file->size)
+		return TRUE;
+	if (fuse_file_get_chunk(fuse_file, index))
+		return TRUE;
+
+	CliprdrFuseChunk* evict = NULL;
+	if (ArrayList_Count(fuse_file->chunks) >= CLIPRDR_FUSE_MAX_CHUNKS)
+	{
+		evict = fuse_file_chunk_to_evict(fuse_file);
+		if (!evict && !demand)
+			return FALSE;
+	}
+
+	chunk = calloc(1, sizeof(CliprdrFuseChunk));
+	if (!chunk)
+		return FALSE;
+	chunk->index = index;
+
+	if (evict)
+	{
+		/* Recycle the buffer of the evicted chunk */
+		chunk->data = evict->data;
+		chunk->capacity = evict->capacity;
+		evict->data = NULL;
+		ArrayList_Remove(fuse_file->chunks, evict);
+	}
+
+	if (!ArrayList_Append(fuse_file->chunks, chunk))
+	{
+		fuse_chunk_free(chunk);
+		return FALSE;
+	}
+
+	const size_t requested_size = (size_t)MIN(CLIPRDR_FUSE_CHUNK_SIZE, fuse_file->size - offset);
+	if (!request_file_range_async(file_context, fuse_file, index, offset, requested_size))
+	{
+		ArrayList_Remove(fuse_file->chunks, chunk);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Answers the read if all chunks covering it arrived, the data is handed to FUSE directly from
+ * the chunks without assembling a copy.
+ */
+static BOOL fuse_file_try_reply(CliprdrFuseFile* fuse_file, const CliprdrFuseReadWaiter* waiter)
+{
+	struct iovec iov[CLIPRDR_FUSE_MAX_READ_SIZE / CLIPRDR_FUSE_CHUNK_SIZE + 1] = { 0 };
+	int count = 0;
+	UINT64 offset = waiter->offset;
+	size_t left = waiter->size;
+
+	WINPR_ASSERT(fuse_file);
+	WINPR_ASSERT(waiter);
+
+	while (left > 0)
+	{
+		const UINT64 index = offset / CLIPRDR_FUSE_CHUNK_SIZE;
+		const size_t skip = (size_t)(offset - index * CLIPRDR_FUSE_CHUNK_SIZE);
+		const CliprdrFuseChunk* chunk = fuse_file_get_chunk(fuse_file, index);
+
+		if (!chunk || !chunk->complete)
+			return FALSE;
+
+		/* A short chunk means the file shrunk, reply with what is there */
+		if (chunk->length <= skip)
+			break;
+
+		const size_t len = MIN(left, chunk->length - skip);
+		WINPR_ASSERT(count < (int)ARRAYSIZE(iov));
+		iov[count].iov_base = &chunk->data[skip];
+		iov[count].iov_len = len;
+		count++;
+
+		offset += len;
+		left -= len;
+		if (skip + len < CLIPRDR_FUSE_CHUNK_SIZE)
+			break;
+	}
+
+	fuse_reply_iov(waiter->fuse_req, iov, count);
+	return TRUE;
+}
+
+static void fuse_file_process_waiters(CliprdrFuseFile* fuse_file)
+{
+	WINPR_ASSERT(fuse_file);
+
+	size_t x = 0;
+	while (x < ArrayList_Count(fuse_file->waiters))
+	{
+		CliprdrFuseReadWaiter* waiter = ArrayList_GetItem(fuse_file->waiters, x);
+		if (fuse_file_try_reply(fuse_file, waiter))
+			ArrayList_RemoveAt(fuse_file->waiters, x);
+		else
+			x++;
+	}
+}
+
+static void fuse_file_fail_chunk(CliprdrFuseFile* fuse_file, CliprdrFuseChunk* chunk)
+{
+	WINPR_ASSERT(fuse_file);
+	WINPR_ASSERT(chunk);
+
+	size_t x = 0;
+	while (x < ArrayList_Count(fuse_file->waiters))
+	{
+		CliprdrFuseReadWaiter* waiter = ArrayList_GetItem(fuse_file->waiters, x);
+		const UINT64 first = waiter->offset / CLIPRDR_FUSE_CHUNK_SIZE;
+		const UINT64 last = (waiter->offset + waiter->size - 1) / CLIPRDR_FUSE_CHUNK_SIZE;
+
+		if ((chunk->index >= first) && (chunk->index <= last))
+		{
+			fuse_reply_err(waiter->fuse_req, EIO);
+			ArrayList_RemoveAt(fuse_file->waiters, x);
+		}
+		else
+			x++;
+	}
+	ArrayList_Remove(fuse_file->chunks, chunk);
+}
+
+static BOOL fuse_file_init_read_cache(CliprdrFuseFile* fuse_file)
+{
+	WINPR_ASSERT(fuse_file);
+
+	if (!fuse_file->chunks)
+	{
+		fuse_file->chunks = ArrayList_New(FALSE);
+		if (!fuse_file->chunks)
+			return FALSE;
+		wObject* obj = ArrayList_Object(fuse_file->chunks);
+		obj->fnObjectFree = fuse_chunk_free;
+	}
+	if (!fuse_file->waiters)
+	{
+		fuse_file->waiters = ArrayList_New(FALSE);
+		if (!fuse_file->waiters)
+			return FALSE;
+		wObject* obj = ArrayList_Object(fuse_file->waiters);
+		obj->fnObjectFree = free;
+	}
+	return TRUE;
+}
+
+/**
+ * Queues a FUSE read, requesting the missing chunks and, if the file is read sequentially,
+ * the next CLIPRDR_FUSE_PREFETCH_CHUNKS chunks as well. Replies right away on a cache hit.
+ */
+static BOOL fuse_file_read(CliprdrFileContext* file_context, CliprdrFuseFile* fuse_file,
+                           fuse_req_t fuse_req, UINT64 offset, size_t size)
+{
+	WINPR_ASSERT(file_context);
+	WINPR_ASSERT(fuse_file);
+	WINPR_ASSERT(size > 0);
+
+	if (!fuse_file_init_read_cache(fuse_file))
+		return FALSE;
+
+	const BOOL sequential = (offset == fuse_file->next_read_offset);
+	const UINT64 first = offset / CLIPRDR_FUSE_CHUNK_SIZE;
+	const UINT64 last = (offset + size - 1) / CLIPRDR_FUSE_CHUNK_SIZE;
+
+	fuse_file->next_read_offset = offset + size;
+
+	CliprdrFuseReadWaiter* waiter = calloc(1, sizeof(CliprdrFuseReadWaiter));
+	if (!waiter)
+		return FALSE;
+	waiter->fuse_req = fuse_req;
+	waiter->offset = offset;
+	waiter->size = size;
+
+	/* Register first so that eviction does not drop the chunks this read needs */
+	if (!ArrayList_Append(fuse_file->waiters, waiter))
+	{
+		free(waiter);
+		return FALSE;
+	}
+
+	for (UINT64 index = first; index <= last; index++)
+	{
+		if (!fuse_file_request_chunk(file_context, fuse_file, index, TRUE))
+		{
+			/* Chunks already requested for this read are answered to nobody, they stay cached */
+			ArrayList_Remove(fuse_file->waiters, waiter);
+			return FALSE;
+		}
+	}
+
+	if (sequential)
+	{
+		for (UINT64 index = last + 1; index <= last + CLIPRDR_FUSE_PREFETCH_CHUNKS; index++)
+		{
+			if (!fuse_file_request_chunk(file_context, fuse_file, index, FALSE))
+				break;
+		}
+	}
+
+	if (fuse_file_try_reply(fuse_file, waiter))
+		ArrayList_Remove(fuse_file->waiters, waiter);
+	return TRUE;
+}
+
+static void fuse_file_chunk_received(CliprdrFileContext* file_context,
+                                     const CliprdrFuseRequest* fuse_request,
+                                     const CLIPRDR_FILE_CONTENTS_RESPONSE* file_contents_response)
+{
+	CliprdrFuseFile* fuse_file = fuse_request->fuse_file;
+
+	WINPR_ASSERT(file_context);
+	WINPR_ASSERT(fuse_file);
+
+	CliprdrFuseChunk* chunk = fuse_file_get_chunk(fuse_file, fuse_request->chunk_index);
+	if (!chunk || chunk->complete)
+		return;
+
+	if (!(file_contents_response->common.msgFlags & CB_RESPONSE_OK) ||
+	    (file_contents_response->cbRequested > CLIPRDR_FUSE_CHUNK_SIZE))
+	{
+		WLog_Print(file_context->log, WLOG_WARN,
+		           "FileContentsRequests for file \"%s\" was unsuccessful", fuse_file->filename);
+		fuse_file_fail_chunk(fuse_file, chunk);
+		return;
+	}
+
+	DEBUG_CLIPRDR(file_context->log, "Received file range for file \"%s\" with stream id %u",
+	              fuse_file->filename, file_contents_response->streamId);
+
+	if (chunk->capacity < file_contents_response->cbRequested)
+	{
+		BYTE* data = realloc(chunk->data, CLIPRDR_FUSE_CHUNK_SIZE);
+		if (!data)
+		{
+			fuse_file_fail_chunk(fuse_file, chunk);
+			return;
+		}
+		chunk->data = data;
+		chunk->capacity = CLIPRDR_FUSE_CHUNK_SIZE;
+	}
+	if (file_contents_response->cbRequested > 0)
+		memcpy(chunk->data, file_contents_response->requestedData,
+		       file_contents_response->cbRequested);
+	chunk->length = file_contents_response->cbRequested;
+	chunk->complete = TRUE;
+
+	fuse_file_process_waiters(fuse_file);
+}
+
 static void cliprdr_file_fuse_read(fuse_req_t fuse_req, fuse_ino_t fuse_ino, size_t size,
                                    off_t offset, WINPR_ATTR_UNUSED struct fuse_file_info* file_info)
 {
@@ -986,9 +1365,16 @@ static void cliprdr_file_fuse_read(fuse_req_t fuse_req, fuse_ino_t fuse_ino, siz
 		return;
 	}
 
-	size = MIN(size, 8ULL * 1024ULL * 1024ULL);
+	size = MIN(size, CLIPRDR_FUSE_MAX_READ_SIZE);
+	size = MIN(size, fuse_file->size - (UINT64)offset);
+	if (size == 0)
+	{
+		HashTable_Unlock(file_context->inode_table);
+		fuse_reply_buf(fuse_req, NULL, 0);
+		return;
+	}
 
-	result = request_file_range_async(file_context, fuse_file, fuse_req, offset, size);
+	result = fuse_file_read(file_context, fuse_file, fuse_req, (UINT64)offset, size);
 	HashTable_Unlock(file_context->inode_table);
 
 	if (!result)
@@ -1199,6 +1585,15 @@ static UINT cliprdr_file_context_server_file_contents_response(
 		return CHANNEL_RC_OK;
 	}
 
+	if (fuse_request->operation_type == FUSE_LL_OPERATION_READ)
+	{
+		fuse_file_chunk_received(file_context, fuse_request, file_contents_response);
+		HashTable_Remove(file_context->request_table,
+		                 (void*)(uintptr_t)file_contents_response->streamId);
+		HashTable_Unlock(file_context->inode_table);
+		return CHANNEL_RC_OK;
+	}
+
 	if (!(file_contents_response->common.msgFlags & CB_RESPONSE_OK))
 	{
 		WLog_Print(file_context->log, WLOG_WARN,
@@ -1240,11 +1635,6 @@ static UINT cliprdr_file_context_server_file_contents_response(
 		entry.attr_timeout = 1.0;
 		entry.entry_timeout = 1.0;
 	}
-	else if (fuse_request->operation_type == FUSE_LL_OPERATION_READ)
-	{
-		DEBUG_CLIPRDR(file_context->log, "Received file range for file \"%s\" with stream id %u",
-		              fuse_request->fuse_file->filename, file_contents_response->streamId);
-	}
 	HashTable_Unlock(file_context->inode_table);
 
 	switch (fuse_request->operation_type)
@@ -1257,11 +1647,6 @@ static UINT cliprdr_file_context_server_file_contents_response(
 		case FUSE_LL_OPERATION_GETATTR:
 			fuse_reply_attr(fuse_request->fuse_req, &entry.attr, entry.attr_timeout);
 			break;
-		case FUSE_LL_OPERATION_READ:
-			fuse_reply_buf(fuse_request->fuse_req,
-			               (const char*)file_contents_response->requestedData,
-			               file_contents_response->cbRequested);
-			break;
 		default:
 			break;
 	}
@@ -1368,15 +1753,36 @@ static CliprdrLocalFile* file_info_for_request(CliprdrFileContext* file, UINT32
 	return NULL;
 }
 
+static void cliprdr_local_file_close(CliprdrLocalFile* file)
+{
+	WINPR_ASSERT(file);
+	WINPR_ASSERT(file->context);
+
+	if (file->context->open_file == file)
+		file->context->open_file = NULL;
+	if (file->fp)
+		(void)fclose(file->fp);
+	file->fp = NULL;
+	file->position = 0;
+}
+
 static CliprdrLocalFile* file_for_request(CliprdrFileContext* file, UINT32 lockId, UINT32 listIndex)
 {
 	CliprdrLocalFile* f = file_info_for_request(file, lockId, listIndex);
 	if (f)
 	{
+		/* Sequential range requests hit the same file over and over again, keep exactly one
+		 * open so that neither the open nor the descriptor count scales with the requests. */
+		if (file->open_file && (file->open_file != f))
+			cliprdr_local_file_close(file->open_file);
+
 		if (!f->fp)
 		{
 			const char* name = f->name;
 			f->fp = winpr_fopen(name, "rb");
+			f->position = 0;
+			if (f->fp)
+				file->open_file = f;
 		}
 		if (!f->fp)
 		{
@@ -1411,12 +1817,10 @@ static void cliprdr_local_file_try_close(CliprdrLocalFile* file, UINT res, UINT6
 	}
 	else
 	{
-		// TODO: we need to keep track of open files to avoid running out of file descriptors
-		// TODO: for the time being just close again.
+		/* More data to come, keep the file open for the next range request */
+		return;
 	}
-	if (file->fp)
-		(void)fclose(file->fp);
-	file->fp = NULL;
+	cliprdr_local_file_close(file);
 }
 
 static UINT cliprdr_file_context_server_file_size_request(
@@ -1445,6 +1849,7 @@ static UINT cliprdr_file_context_server_file_size_request(
 		{
 			const INT64 size = _ftelli64(rfile->fp);
 			rfile->size = size;
+			rfile->position = (size > 0) ? (UINT64)size : 0;
 			cliprdr_local_file_try_close(rfile, res, 0, 0);
 
 			res = cliprdr_file_context_send_contents_response(file, fileContentsRequest, &size,
@@ -1456,11 +1861,24 @@ static UINT cliprdr_file_context_server_file_size_request(
 	return res;
 }
 
+static BYTE* cliprdr_file_context_range_buffer(CliprdrFileContext* file, size_t size)
+{
+	WINPR_ASSERT(file);
+
+	if (file->range_buffer_size < size)
+	{
+		BYTE* tmp = realloc(file->range_buffer, size);
+		if (!tmp)
+			return NULL;
+		file->range_buffer = tmp;
+		file->range_buffer_size = size;
+	}
+	return file->range_buffer;
+}
+
 static UINT cliprdr_file_context_server_file_range_request(
     CliprdrFileContext* file, const CLIPRDR_FILE_CONTENTS_REQUEST* fileContentsRequest)
 {
-	BYTE* data = NULL;
-
 	WINPR_ASSERT(fileContentsRequest);
 
 	HashTable_Lock(file->local_streams);
@@ -1472,16 +1890,26 @@ static UINT cliprdr_file_context_server_file_range_request(
 	if (!rfile)
 		goto fail;
 
-	if (_fseeki64(rfile->fp, WINPR_ASSERTING_INT_CAST(int64_t, offset), SEEK_SET) < 0)
-		goto fail;
+	/* Sequential requests continue where the last one stopped, skip the seek then */
+	if (rfile->position != offset)
+	{
+		if (_fseeki64(rfile->fp, WINPR_ASSERTING_INT_CAST(int64_t, offset), SEEK_SET) < 0)
+			goto fail;
+		rfile->position = offset;
+	}
 
-	data = malloc(fileContentsRequest->cbRequested);
-	if (!data)
+	/* The response is serialized before ClientFileContentsResponse returns, so the buffer
+	 * can be reused for the next request. */
+	BYTE* data = cliprdr_file_context_range_buffer(file, fileContentsRequest->cbRequested);
+	if (!data && (fileContentsRequest->cbRequested > 0))
 		goto fail;
 
 	const size_t r = fread(data, 1, fileContentsRequest->cbRequested, rfile->fp);
+	rfile->position += r;
+	if ((r < fileContentsRequest->cbRequested) && ferror(rfile->fp))
+		goto fail;
+
 	const UINT rc = cliprdr_file_context_send_contents_response(file, fileContentsRequest, data, r);
-	free(data);
 
 	cliprdr_local_file_try_close(rfile, rc, offset, fileContentsRequest->cbRequested);
 	HashTable_Unlock(file->local_streams);
@@ -1490,7 +1918,6 @@ fail:
 	if (rfile)
 		cliprdr_local_file_try_close(rfile, ERROR_INTERNAL_ERROR, offset,
 		                             fileContentsRequest->cbRequested);
-	free(data);
 	HashTable_Unlock(file->local_streams);
 	return cliprdr_file_context_send_file_contents_failure(file, fileContentsRequest);
 }
@@ -2091,6 +2518,7 @@ void cliprdr_file_context_free(CliprdrFileContext* file)
 	HashTable_Free(file->inode_table);
 #endif
 	HashTable_Free(file->local_streams);
+	free(file->range_buffer);
 	winpr_RemoveDirectory(file->path);
 	free(file->path);
 	free(file->exposed_path);
@@ -2125,7 +2553,7 @@ static void cliprdr_local_file_free(CliprdrLocalFile* file)
 	if (file->fp)
 	{
 		WLog_Print(file->context->log, WLOG_DEBUG, "closing file %s, discarding entry", file->name);
-		(void)fclose(file->fp);
+		cliprdr_local_file_close(file);
 	}
 	free(file->name);
 	*file = empty;
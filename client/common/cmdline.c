@@ -2194,6 +2194,13 @@ static int parse_tls_cipher_options(rdpSettings* settings, const COMMAND_LINE_AR
 			rc = fail_at(arg, parse_tls_secrets_file(settings, &arg->Value[13]));
 		else if (option_starts_with("enforce:", arg->Value))
 			rc = fail_at(arg, parse_tls_enforce(settings, &arg->Value[8]));
+		else if (option_equals("ktls", arg->Value))
+		{
+			if (!freerdp_settings_set_bool(settings, FreeRDP_KernelTlsOffload, TRUE))
+				rc = fail_at(arg, COMMAND_LINE_ERROR);
+			else
+				rc = 0;
+		}
 	}
 
 #if defined(WITH_FREERDP_DEPRECATED_COMMANDLINE)
@@ -468,8 +468,8 @@ static const COMMAND_LINE_ARGUMENT_A global_cmd_args[] = {
 	{ "timezone", COMMAND_LINE_VALUE_REQUIRED, "<windows timezone>", NULL, NULL, -1, NULL,
 	  "Use supplied windows timezone for connection (requires server support), see /list:timezones "
 	  "for allowed values" },
-	{ "tls", COMMAND_LINE_VALUE_REQUIRED, "[ciphers|seclevel|secrets-file|enforce]", NULL, NULL, -1,
-	  NULL,
+	{ "tls", COMMAND_LINE_VALUE_REQUIRED, "[ciphers|seclevel|secrets-file|enforce|ktls]", NULL,
+	  NULL, -1, NULL,
 	  "TLS configuration options:"
 	  " * ciphers:[netmon|ma|<cipher names>]\n"
 	  " * seclevel:<level>, default: 1, range: [0-5] Override the default TLS security level, "
@@ -478,7 +478,8 @@ static const COMMAND_LINE_ARGUMENT_A global_cmd_args[] = {
 	  " * enforce[:[ssl3|1.0|1.1|1.2|1.3]] Force use of SSL/TLS version for a connection. Some "
 	  "servers have a buggy TLS "
 	  "version negotiation and might fail without this. Defaults to TLS 1.2 if no argument is "
-	  "supplied. Use 1.0 for windows 7" },
+	  "supplied. Use 1.0 for windows 7\n"
+	  " * ktls Offload TLS record encryption to the kernel if supported (Linux only)" },
 #if defined(WITH_FREERDP_DEPRECATED_COMMANDLINE)
 	{ "tls-ciphers", COMMAND_LINE_VALUE_REQUIRED, "[netmon|ma|ciphers]", NULL, NULL, -1, NULL,
 	  "[DEPRECATED, use /tls:ciphers] Allowed TLS ciphers" },
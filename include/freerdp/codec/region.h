@@ -120,6 +120,18 @@ extern "C"
 	FREERDP_API BOOL region16_union_rect(REGION16* dst, const REGION16* src,
 	                                     const RECTANGLE_16* rect);
 
+	/** adds count rectangles in src and stores the resulting region in dst, in one sweep
+	 * rather than one pass over the region per rectangle. Empty rectangles are ignored.
+	 * @param dst destination region
+	 * @param src source region
+	 * @param rects the rectangles to add
+	 * @param count the number of rectangles
+	 * @return if the operation was successful (false meaning out-of-memory)
+	 * @since version 3.16.0
+	 */
+	FREERDP_API BOOL region16_union_rects(REGION16* dst, const REGION16* src,
+	                                      const RECTANGLE_16* rects, size_t count);
+
 	/** returns if a rectangle intersects the region
 	 * @param src the region
 	 * @param arg2 the rectangle
@@ -49,6 +49,7 @@ extern "C"
 		UINT32 outputTargetHeight;
 		BOOL windowMapped;
 		BOOL handleInUpdateSurfaceArea;
+		void* decodeJob; /** @since version 3.16.0 */
 	};
 	typedef struct gdi_gfx_surface gdiGfxSurface;
 
@@ -70,6 +71,15 @@ extern "C"
 	                                               pcRdpgfxUpdateSurfaceArea update);
 	FREERDP_API void gdi_graphics_pipeline_uninit(rdpGdi* gdi, RdpgfxClientContext* gfx);
 
+	/** @brief Completes pending asynchronous surface decodes and calls UpdateSurfaces.
+	 *
+	 *  Use this instead of calling \b UpdateSurfaces directly from outside the channel thread,
+	 *  surface data might still be written by a decode job otherwise.
+	 *
+	 *  @since version 3.16.0
+	 */
+	FREERDP_API UINT gdi_graphics_pipeline_update_surfaces(RdpgfxClientContext* gfx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -141,6 +141,34 @@ typedef pstatus_t (*fn_copy_no_overlap_t)(BYTE* WINPR_RESTRICT pDstData, DWORD D
 	                                      const gdiPalette* WINPR_RESTRICT palette, UINT32 flags);
 typedef pstatus_t (*fn_lShiftC_16s_inplace_t)(INT16* WINPR_RESTRICT pSrcDst, UINT32 val,
 	                                          UINT32 len);
+
+/**
+ * @brief Scale a (sub)image, shrinking uses an area (box) filter and enlarging a bilinear one.
+ * Source and destination may use different pixel formats, equal sizes are copied.
+ *
+ * @param pDstData The destination image buffer
+ * @param DstFormat The destination image format @ref PIXEL_FORMAT
+ * @param nDstStep The destination image line with in bytes (including padding)
+ * @param nXDst The X coordinate to start writing to
+ * @param nYDst The Y coordinate to start writing to
+ * @param nDstWidth The width in pixels of the scaled image
+ * @param nDstHeight The height in pixels of the scaled image
+ * @param pSrcData The source image buffer
+ * @param SrcFormat The source image format @ref PIXEL_FORMAT
+ * @param nSrcStep The source image line with in bytes (including padding)
+ * @param nXSrc The X coordinate to start reading from
+ * @param nYSrc The Y coordinate to start reading from
+ * @param nSrcWidth The width in pixels of the source image
+ * @param nSrcHeight The height in pixels of the source image
+ * @return \b <=0 for failure, success otherwise
+ *  @since version 3.16.0
+ */
+typedef pstatus_t (*fn_image_scale_t)(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat,
+	                                  UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
+	                                  UINT32 nDstWidth, UINT32 nDstHeight,
+	                                  const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+	                                  UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc,
+	                                  UINT32 nSrcWidth, UINT32 nSrcHeight);
 typedef pstatus_t (*fn_lShiftC_16s_t)(const INT16* WINPR_RESTRICT pSrc, UINT32 val,
 	                                  INT16* WINPR_RESTRICT pSrcDst, UINT32 len);
 typedef pstatus_t (*fn_lShiftC_16u_t)(const UINT16* WINPR_RESTRICT pSrc, UINT32 val,
@@ -302,6 +330,7 @@ typedef struct
 	fn_add_16s_inplace_t add_16s_inplace;         /** @since version 3.6.0 */
 	fn_lShiftC_16s_inplace_t lShiftC_16s_inplace; /** @since version 3.6.0 */
 	fn_copy_no_overlap_t copy_no_overlap;         /** @since version 3.6.0 */
+	fn_image_scale_t image_scale;                 /** @since version 3.16.0 */
 } primitives_t;
 
 typedef enum
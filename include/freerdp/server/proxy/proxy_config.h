@@ -119,6 +119,9 @@ extern "C"
 
 		/* target continued */
 		UINT32 TargetTlsSecLevel; /** @since version 3.2.0 */
+
+		/* security continued */
+		BOOL KernelTlsOffload; /** @since version 3.16.0 */
 	};
 
 	/**
@@ -325,6 +325,11 @@ extern "C"
 #define PACKET_COMPR_TYPE_RDP61 0x03
 #define PACKET_COMPR_TYPE_RDP8 0x04
 
+/* Bulk compression effort, @since version 3.16.0 */
+#define COMPRESSION_EFFORT_DEFAULT 0
+#define COMPRESSION_EFFORT_FAST 1
+#define COMPRESSION_EFFORT_BEST 2
+
 /* Desktop Rotation Flags */
 #define ORIENTATION_LANDSCAPE 0
 #define ORIENTATION_PORTRAIT 90
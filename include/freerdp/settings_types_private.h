@@ -207,7 +207,22 @@ struct rdp_settings
 	SETTINGS_DEPRECATED(ALIGN64 BOOL ForceEncryptedCsPdu);    /* 719 */
 	SETTINGS_DEPRECATED(ALIGN64 BOOL HiDefRemoteApp);         /* 720 */
 	SETTINGS_DEPRECATED(ALIGN64 UINT32 CompressionLevel);     /* 721 */
-	UINT64 padding0768[768 - 722];                            /* 722 */
+
+	/** CompressionMatchDepth limits the hash chain candidates the NCRUSH (RDP 6.0) compressor
+	 * examines per position. 0 selects the codec default of 32.
+	 */
+	SETTINGS_DEPRECATED(ALIGN64 UINT32 CompressionMatchDepth); /* 722 */
+
+	/** CompressionEffort selects one of the COMPRESSION_EFFORT_* levels of the bulk compressor,
+	 * trading CPU time against compression ratio.
+	 */
+	SETTINGS_DEPRECATED(ALIGN64 UINT32 CompressionEffort); /* 723 */
+
+	/** CompressionMatchWays sets the candidates per hash bucket of the MPPC (RDP 4.0/5.0)
+	 * compressor, at most 8. 0 selects the codec default of 1, the fastest.
+	 */
+	SETTINGS_DEPRECATED(ALIGN64 UINT32 CompressionMatchWays); /* 724 */
+	UINT64 padding0768[768 - 725];                            /* 725 */
 
 	/* Client Info (Extra) */
 	SETTINGS_DEPRECATED(ALIGN64 BOOL IPv6Enabled);       /* 768 */
@@ -290,7 +305,12 @@ struct rdp_settings
 	SETTINGS_DEPRECATED(ALIGN64 char* WinSCardModule);              /* 1113 */
 	SETTINGS_DEPRECATED(ALIGN64 BOOL RemoteCredentialGuard);        /* 1114 */
 	SETTINGS_DEPRECATED(ALIGN64 BOOL RestrictedAdminModeSupported); /* 1115 */
-	UINT64 padding1152[1152 - 1116];                                /* 1116 */
+
+	/** KernelTlsOffload hands TLS record encryption to the kernel after the handshake,
+	 * if the platform supports it. Falls back to user space TLS otherwise.
+	 */
+	SETTINGS_DEPRECATED(ALIGN64 BOOL KernelTlsOffload); /* 1116 */
+	UINT64 padding1152[1152 - 1117];                    /* 1117 */
 
 	/* Connection Cookie */
 	SETTINGS_DEPRECATED(ALIGN64 BOOL MstscCookieMode);      /* 1152 */
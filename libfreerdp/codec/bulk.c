@@ -268,14 +268,19 @@ int bulk_compress(rdpBulk* WINPR_RESTRICT bulk, const BYTE* WINPR_RESTRICT pSrcD
 		case PACKET_COMPR_TYPE_8K:
 		case PACKET_COMPR_TYPE_64K:
 			mppc_set_compression_level(bulk->mppcSend, bulk->CompressionLevel);
+			mppc_set_match_ways(bulk->mppcSend, bulk->context->settings->CompressionMatchWays);
 			status = mppc_compress(bulk->mppcSend, pSrcData, SrcSize, bulk->OutputBuffer, ppDstData,
 			                       pDstSize, pFlags);
 			break;
 		case PACKET_COMPR_TYPE_RDP6:
+			ncrush_set_chain_depth(bulk->ncrushSend,
+			                       bulk->context->settings->CompressionMatchDepth);
 			status = ncrush_compress(bulk->ncrushSend, pSrcData, SrcSize, bulk->OutputBuffer,
 			                         ppDstData, pDstSize, pFlags);
 			break;
 		case PACKET_COMPR_TYPE_RDP61:
+			xcrush_set_compression_effort(bulk->xcrushSend,
+			                              bulk->context->settings->CompressionEffort);
 			status = xcrush_compress(bulk->xcrushSend, pSrcData, SrcSize, bulk->OutputBuffer,
 			                         ppDstData, pDstSize, pFlags);
 			break;
@@ -1207,7 +1207,16 @@ BOOL freerdp_image_scale(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32
 		                                     nDstHeight, pSrcData, SrcFormat, nSrcStep, nXSrc,
 		                                     nYSrc, NULL, FREERDP_FLIP_NONE);
 	}
-	else
+
+	/* the built in scaler caches its filters and needs no context per call */
+	primitives_t* prims = primitives_get();
+	WINPR_ASSERT(prims);
+
+	if (prims->image_scale(pDstData, DstFormat, nDstStep, nXDst, nYDst, nDstWidth, nDstHeight,
+	                       pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc, nSrcWidth,
+	                       nSrcHeight) == PRIMITIVES_SUCCESS)
+		return TRUE;
+
 #if defined(WITH_SWSCALE)
 	{
 		int res = 0;
@@ -1270,9 +1279,9 @@ BOOL freerdp_image_scale(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32
 		cairo_surface_destroy(cdst);
 	}
 #else
-	{
-		WLog_WARN(TAG, "SmartScaling requested but compiled without libcairo support!");
-	}
+	WLog_WARN(TAG, "Scaling %" PRIu32 "x%" PRIu32 " %s to %" PRIu32 "x%" PRIu32 " %s failed",
+	          nSrcWidth, nSrcHeight, FreeRDPGetColorFormatName(SrcFormat), nDstWidth, nDstHeight,
+	          FreeRDPGetColorFormatName(DstFormat));
 #endif
 	return rc;
 }
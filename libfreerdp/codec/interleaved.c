@@ -23,6 +23,7 @@
 
 #include <winpr/assert.h>
 #include <winpr/cast.h>
+#include <winpr/endian.h>
 #include <freerdp/config.h>
 
 #include <freerdp/codec/interleaved.h>
@@ -523,8 +524,6 @@ struct S_BITMAP_INTERLEAVED_CONTEXT
 
 	UINT32 TempSize;
 	BYTE* TempBuffer;
-
-	wStream* bts;
 };
 
 BOOL interleaved_decompress(BITMAP_INTERLEAVED_CONTEXT* WINPR_RESTRICT interleaved,
@@ -635,18 +634,539 @@ BOOL interleaved_decompress(BITMAP_INTERLEAVED_CONTEXT* WINPR_RESTRICT interleav
 	return TRUE;
 }
 
+/*
+   The encoder works on the bitmap converted to the wire pixel format, bottom-up as it is sent.
+   A zeroed scanline precedes the first one so the pixel above is always addressable, the first
+   scanline orders of the decoder behave as if that line was black.
+*/
+
+#define INTERLEAVED_MAX_RUN UINT16_MAX
+
+/* runs shorter than this are only taken when no foreground/background image fits */
+#define INTERLEAVED_MIN_LONG_RUN 8
+
+/* a background or foreground stretch this long ends a foreground/background image */
+#define INTERLEAVED_FGBG_BREAK 32
+
+typedef struct
+{
+	const BYTE* pixels;
+	size_t stride;
+	size_t width;
+	size_t count;
+	size_t bpp;
+	UINT32 fgPel;
+	BOOL firstLine;
+	BOOL insertFgPel;
+	wStream* s;
+} INTERLEAVED_ENCODER;
+
+typedef enum
+{
+	INTERLEAVED_RUN_NONE,
+	INTERLEAVED_RUN_BG,
+	INTERLEAVED_RUN_FG,
+	INTERLEAVED_RUN_COLOR,
+	INTERLEAVED_RUN_DITHERED,
+	INTERLEAVED_RUN_SET_FG
+} INTERLEAVED_RUN;
+
+static INLINE UINT32 interleaved_read_pixel(const INTERLEAVED_ENCODER* WINPR_RESTRICT encoder,
+                                            size_t pos)
+{
+	const BYTE* src = &encoder->pixels[pos * encoder->bpp];
+
+	switch (encoder->bpp)
+	{
+		case 1:
+			return src[0];
+		case 2:
+			return winpr_Data_Get_UINT16(src);
+		default:
+			return src[0] | ((UINT32)src[1] << 8) | ((UINT32)src[2] << 16);
+	}
+}
+
+static INLINE UINT32 interleaved_read_above(const INTERLEAVED_ENCODER* WINPR_RESTRICT encoder,
+                                            size_t pos)
+{
+	const BYTE* src = &encoder->pixels[pos * encoder->bpp] - encoder->stride;
+
+	switch (encoder->bpp)
+	{
+		case 1:
+			return src[0];
+		case 2:
+			return winpr_Data_Get_UINT16(src);
+		default:
+			return src[0] | ((UINT32)src[1] << 8) | ((UINT32)src[2] << 16);
+	}
+}
+
+static INLINE size_t interleaved_count_trailing_zeros(UINT64 value)
+{
+	WINPR_ASSERT(value != 0);
+
+#if defined(__GNUC__) || defined(__clang__)
+	return (size_t)__builtin_ctzll(value);
+#else
+	size_t count = 0;
+
+	while ((value & 1) == 0)
+	{
+		value >>= 1;
+		count++;
+	}
+
+	return count;
+#endif
+}
+
+/**
+ * Number of leading bytes a and b have in common, compared 8 bytes at a time.
+ */
+static INLINE size_t interleaved_equal_bytes(const BYTE* WINPR_RESTRICT a,
+                                             const BYTE* WINPR_RESTRICT b, size_t size)
+{
+	size_t x = 0;
+
+	for (; x + 8 <= size; x += 8)
+	{
+		const UINT64 diff = winpr_Data_Get_UINT64(&a[x]) ^ winpr_Data_Get_UINT64(&b[x]);
+
+		if (diff != 0)
+			return x + interleaved_count_trailing_zeros(diff) / 8;
+	}
+
+	while ((x < size) && (a[x] == b[x]))
+		x++;
+
+	return x;
+}
+
+/**
+ * Number of pixels starting at pos that are equal to the pixel distance bytes before them.
+ */
+static INLINE size_t interleaved_equal_pixels(const INTERLEAVED_ENCODER* WINPR_RESTRICT encoder,
+                                              size_t pos, size_t distance, size_t limit)
+{
+	const BYTE* src = &encoder->pixels[pos * encoder->bpp];
+	const size_t length = MIN(limit - pos, INTERLEAVED_MAX_RUN);
+
+	return interleaved_equal_bytes(src, src - distance, length * encoder->bpp) / encoder->bpp;
+}
+
+static INLINE size_t interleaved_fg_run(const INTERLEAVED_ENCODER* WINPR_RESTRICT encoder,
+                                        size_t pos, size_t limit, UINT32 fgPel)
+{
+	const size_t end = pos + MIN(limit - pos, INTERLEAVED_MAX_RUN);
+	size_t x = pos;
+
+	while ((x < end) &&
+	       (interleaved_read_pixel(encoder, x) == (interleaved_read_above(encoder, x) ^ fgPel)))
+		x++;
+
+	return x - pos;
+}
+
+/**
+ * Length of the foreground/background image starting at pos, stopping in front of stretches
+ * that are cheaper to send as background or foreground run.
+ */
+static INLINE size_t interleaved_fgbg_length(const INTERLEAVED_ENCODER* WINPR_RESTRICT encoder,
+                                             size_t pos, size_t limit, UINT32 fgPel)
+{
+	const size_t end = pos + MIN(limit - pos, INTERLEAVED_MAX_RUN);
+	size_t streakStart = pos;
+	BOOL streakFg = FALSE;
+
+	for (size_t x = pos; x < end; x++)
+	{
+		const UINT32 pixel = interleaved_read_pixel(encoder, x);
+		const UINT32 above = interleaved_read_above(encoder, x);
+		BOOL fg = FALSE;
+
+		if (pixel == (above ^ fgPel))
+			fg = TRUE;
+		else if (pixel != above)
+			return x - pos;
+
+		if ((x == pos) || (fg != streakFg))
+		{
+			streakStart = x;
+			streakFg = fg;
+		}
+		else if (x - streakStart + 1 >= INTERLEAVED_FGBG_BREAK)
+			return streakStart - pos;
+	}
+
+	return end - pos;
+}
+
+static INLINE void interleaved_write_pixel(wStream* WINPR_RESTRICT s, UINT32 pixel, size_t bpp)
+{
+	switch (bpp)
+	{
+		case 1:
+			Stream_Write_UINT8(s, pixel & 0xFF);
+			break;
+		case 2:
+			Stream_Write_UINT16(s, pixel & 0xFFFF);
+			break;
+		default:
+			Stream_Write_UINT8(s, pixel & 0xFF);
+			Stream_Write_UINT8(s, (pixel >> 8) & 0xFF);
+			Stream_Write_UINT8(s, (pixel >> 16) & 0xFF);
+			break;
+	}
+}
+
+/**
+ * Writes an order header, mask is the length field of the short form, the one byte extended
+ * form stores the length minus (mask + 1).
+ */
+static INLINE BOOL interleaved_write_header(INTERLEAVED_ENCODER* WINPR_RESTRICT encoder,
+                                            size_t pos, BYTE code, BYTE mask, BYTE mega,
+                                            size_t length, size_t payload)
+{
+	wStream* s = encoder->s;
+
+	WINPR_ASSERT(length > 0);
+	WINPR_ASSERT(length <= INTERLEAVED_MAX_RUN);
+
+	if (!Stream_CheckAndLogRequiredCapacity(TAG, s, 3 + payload))
+		return FALSE;
+
+	if (length <= mask)
+		Stream_Write_UINT8(s, (BYTE)(code | length));
+	else if (length - mask - 1 <= UINT8_MAX)
+	{
+		Stream_Write_UINT8(s, code);
+		Stream_Write_UINT8(s, (BYTE)(length - mask - 1));
+	}
+	else
+	{
+		Stream_Write_UINT8(s, mega);
+		Stream_Write_UINT16(s, (UINT16)length);
+	}
+
+	/* the decoder leaves its first line state at the first order starting past it */
+	if (encoder->firstLine && (pos >= encoder->width))
+		encoder->firstLine = FALSE;
+
+	encoder->insertFgPel = FALSE;
+	return TRUE;
+}
+
+static BOOL interleaved_write_color_image(INTERLEAVED_ENCODER* WINPR_RESTRICT encoder, size_t pos,
+                                          size_t length)
+{
+	while (length > 0)
+	{
+		const size_t count = MIN(length, INTERLEAVED_MAX_RUN);
+		const size_t size = count * encoder->bpp;
+
+		if (!interleaved_write_header(encoder, pos, REGULAR_COLOR_IMAGE << 5, 0x1F,
+		                              MEGA_MEGA_COLOR_IMAGE, count, size))
+			return FALSE;
+
+		Stream_Write(encoder->s, &encoder->pixels[pos * encoder->bpp], size);
+		pos += count;
+		length -= count;
+	}
+
+	return TRUE;
+}
+
+static BOOL interleaved_write_run(INTERLEAVED_ENCODER* WINPR_RESTRICT encoder, size_t pos,
+                                  INTERLEAVED_RUN run, size_t length)
+{
+	const size_t bpp = encoder->bpp;
+	const UINT32 pixel = interleaved_read_pixel(encoder, pos);
+	wStream* s = encoder->s;
+
+	switch (run)
+	{
+		case INTERLEAVED_RUN_BG:
+			if (!interleaved_write_header(encoder, pos, REGULAR_BG_RUN, 0x1F, MEGA_MEGA_BG_RUN,
+			                              length, 0))
+				return FALSE;
+
+			encoder->insertFgPel = TRUE;
+			break;
+
+		case INTERLEAVED_RUN_FG:
+			if (!interleaved_write_header(encoder, pos, REGULAR_FG_RUN << 5, 0x1F,
+			                              MEGA_MEGA_FG_RUN, length, 0))
+				return FALSE;
+			break;
+
+		case INTERLEAVED_RUN_SET_FG:
+			if (!interleaved_write_header(encoder, pos, LITE_SET_FG_FG_RUN << 4, 0x0F,
+			                              MEGA_MEGA_SET_FG_RUN, length, bpp))
+				return FALSE;
+
+			encoder->fgPel = pixel ^ interleaved_read_above(encoder, pos);
+			interleaved_write_pixel(s, encoder->fgPel, bpp);
+			break;
+
+		case INTERLEAVED_RUN_COLOR:
+			if (!interleaved_write_header(encoder, pos, REGULAR_COLOR_RUN << 5, 0x1F,
+			                              MEGA_MEGA_COLOR_RUN, length, bpp))
+				return FALSE;
+
+			interleaved_write_pixel(s, pixel, bpp);
+			break;
+
+		case INTERLEAVED_RUN_DITHERED:
+			if (!interleaved_write_header(encoder, pos, LITE_DITHERED_RUN << 4, 0x0F,
+			                              MEGA_MEGA_DITHERED_RUN, length / 2, 2 * bpp))
+				return FALSE;
+
+			interleaved_write_pixel(s, pixel, bpp);
+			interleaved_write_pixel(s, interleaved_read_pixel(encoder, pos + 1), bpp);
+			break;
+
+		default:
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static INLINE BYTE interleaved_fgbg_mask(const INTERLEAVED_ENCODER* WINPR_RESTRICT encoder,
+                                        size_t pos, size_t count)
+{
+	BYTE bitmask = 0;
+
+	for (size_t x = 0; x < count; x++)
+	{
+		if (interleaved_read_pixel(encoder, pos + x) != interleaved_read_above(encoder, pos + x))
+			bitmask |= (BYTE)(1 << x);
+	}
+
+	return bitmask;
+}
+
+static BOOL interleaved_write_fgbg_image(INTERLEAVED_ENCODER* WINPR_RESTRICT encoder, size_t pos,
+                                         size_t length, UINT32 fgPel)
+{
+	const BOOL setFg = fgPel != encoder->fgPel;
+	const size_t bpp = encoder->bpp;
+	wStream* s = encoder->s;
+
+	WINPR_ASSERT(length > 0);
+	WINPR_ASSERT(length <= INTERLEAVED_MAX_RUN);
+
+	if (!Stream_CheckAndLogRequiredCapacity(TAG, s, 3 + bpp + (length + 7) / 8))
+		return FALSE;
+
+	if (encoder->firstLine && (pos >= encoder->width))
+		encoder->firstLine = FALSE;
+
+	encoder->insertFgPel = FALSE;
+
+	if ((length == 8) && !setFg)
+	{
+		const BYTE bitmask = interleaved_fgbg_mask(encoder, pos, 8);
+
+		if (bitmask == g_MaskSpecialFgBg1)
+		{
+			Stream_Write_UINT8(s, SPECIAL_FGBG_1);
+			return TRUE;
+		}
+
+		if (bitmask == g_MaskSpecialFgBg2)
+		{
+			Stream_Write_UINT8(s, SPECIAL_FGBG_2);
+			return TRUE;
+		}
+	}
+
+	if (setFg)
+	{
+		if ((length % 8 == 0) && (length / 8 <= g_MaskLiteRunLength))
+			Stream_Write_UINT8(s, (BYTE)((LITE_SET_FG_FGBG_IMAGE << 4) | (length / 8)));
+		else if (length <= 256)
+		{
+			Stream_Write_UINT8(s, LITE_SET_FG_FGBG_IMAGE << 4);
+			Stream_Write_UINT8(s, (BYTE)(length - 1));
+		}
+		else
+		{
+			Stream_Write_UINT8(s, MEGA_MEGA_SET_FGBG_IMAGE);
+			Stream_Write_UINT16(s, (UINT16)length);
+		}
+
+		interleaved_write_pixel(s, fgPel, bpp);
+		encoder->fgPel = fgPel;
+	}
+	else
+	{
+		if ((length % 8 == 0) && (length / 8 <= g_MaskRegularRunLength))
+			Stream_Write_UINT8(s, (BYTE)((REGULAR_FGBG_IMAGE << 5) | (length / 8)));
+		else if (length <= 256)
+		{
+			Stream_Write_UINT8(s, REGULAR_FGBG_IMAGE << 5);
+			Stream_Write_UINT8(s, (BYTE)(length - 1));
+		}
+		else
+		{
+			Stream_Write_UINT8(s, MEGA_MEGA_FGBG_IMAGE);
+			Stream_Write_UINT16(s, (UINT16)length);
+		}
+	}
+
+	for (size_t x = 0; x < length; x += 8)
+		Stream_Write_UINT8(s, interleaved_fgbg_mask(encoder, pos + x, MIN(8, length - x)));
+
+	return TRUE;
+}
+
+static BOOL interleaved_encode(INTERLEAVED_ENCODER* WINPR_RESTRICT encoder)
+{
+	const size_t bpp = encoder->bpp;
+	size_t literalStart = 0;
+	size_t literals = 0;
+	size_t pos = 0;
+
+	while (pos < encoder->count)
+	{
+		/* orders depending on the line above must not cross the end of the first line */
+		const size_t limit = (pos < encoder->width) ? encoder->width : encoder->count;
+		const UINT32 pixel = interleaved_read_pixel(encoder, pos);
+		const UINT32 above = interleaved_read_above(encoder, pos);
+		const BOOL insertFgPel = (literals == 0) && encoder->insertFgPel &&
+		                         !(encoder->firstLine && (pos >= encoder->width));
+		INTERLEAVED_RUN run = INTERLEAVED_RUN_NONE;
+		size_t length = 0;
+		size_t bg = 0;
+
+		/* a background run directly following another one starts with a foreground pixel */
+		if (insertFgPel)
+		{
+			if (pixel == (above ^ encoder->fgPel))
+				bg = MIN(1 + interleaved_equal_pixels(encoder, pos + 1, encoder->stride, limit),
+				         INTERLEAVED_MAX_RUN);
+		}
+		else if (pixel == above)
+			bg = interleaved_equal_pixels(encoder, pos, encoder->stride, limit);
+
+		const size_t fg = interleaved_fg_run(encoder, pos, limit, encoder->fgPel);
+		const size_t color =
+		    MIN(1 + interleaved_equal_pixels(encoder, pos + 1, bpp, encoder->count),
+		        INTERLEAVED_MAX_RUN);
+		size_t dithered = 0;
+		size_t setFg = 0;
+
+		if ((pos + 1 < encoder->count) && (interleaved_read_pixel(encoder, pos + 1) != pixel))
+		{
+			const size_t pairs =
+			    (2 + interleaved_equal_pixels(encoder, pos + 2, 2 * bpp, encoder->count)) / 2;
+			dithered = 2 * MIN(pairs, INTERLEAVED_MAX_RUN);
+		}
+
+		if ((fg == 0) && (pixel != above))
+			setFg = interleaved_fg_run(encoder, pos, limit, pixel ^ above);
+
+		if (bg > length)
+		{
+			run = INTERLEAVED_RUN_BG;
+			length = bg;
+		}
+
+		if (fg > length)
+		{
+			run = INTERLEAVED_RUN_FG;
+			length = fg;
+		}
+
+		if (color > length)
+		{
+			run = INTERLEAVED_RUN_COLOR;
+			length = color;
+		}
+
+		if (dithered > length)
+		{
+			run = INTERLEAVED_RUN_DITHERED;
+			length = dithered;
+		}
+
+		if (setFg > length)
+		{
+			run = INTERLEAVED_RUN_SET_FG;
+			length = setFg;
+		}
+
+		if (length < INTERLEAVED_MIN_LONG_RUN)
+		{
+			UINT32 fgPel = encoder->fgPel;
+
+			if ((pixel != above) && (pixel != (above ^ fgPel)))
+				fgPel = pixel ^ above;
+
+			const size_t fgbg = interleaved_fgbg_length(encoder, pos, limit, fgPel);
+
+			if (fgbg >= 8)
+			{
+				if (!interleaved_write_color_image(encoder, literalStart, literals))
+					return FALSE;
+
+				literals = 0;
+
+				if (!interleaved_write_fgbg_image(encoder, pos, fgbg, fgPel))
+					return FALSE;
+
+				pos += fgbg;
+				continue;
+			}
+
+			/* a background run is a single byte, all others need at least a pixel */
+			if ((bg >= 2) || ((bg == 1) && insertFgPel))
+			{
+				run = INTERLEAVED_RUN_BG;
+				length = bg;
+			}
+			else if (length < 3)
+				run = INTERLEAVED_RUN_NONE;
+		}
+
+		if (run == INTERLEAVED_RUN_NONE)
+		{
+			if (literals == 0)
+				literalStart = pos;
+
+			literals++;
+			pos++;
+			continue;
+		}
+
+		if (!interleaved_write_color_image(encoder, literalStart, literals))
+			return FALSE;
+
+		literals = 0;
+
+		if (!interleaved_write_run(encoder, pos, run, length))
+			return FALSE;
+
+		pos += length;
+	}
+
+	return interleaved_write_color_image(encoder, literalStart, literals);
+}
+
 BOOL interleaved_compress(BITMAP_INTERLEAVED_CONTEXT* WINPR_RESTRICT interleaved,
                           BYTE* WINPR_RESTRICT pDstData, UINT32* WINPR_RESTRICT pDstSize,
                           UINT32 nWidth, UINT32 nHeight, const BYTE* WINPR_RESTRICT pSrcData,
                           UINT32 SrcFormat, UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc,
                           const gdiPalette* WINPR_RESTRICT palette, UINT32 bpp)
 {
-	BOOL status = 0;
-	wStream* s = NULL;
 	UINT32 DstFormat = 0;
-	const UINT32 maxSize = 64 * 64 * 4;
+	wStream sbuffer = { 0 };
+	INTERLEAVED_ENCODER encoder = { 0 };
 
-	if (!interleaved || !pDstData || !pSrcData)
+	if (!interleaved || !pDstData || !pDstSize || !pSrcData)
 		return FALSE;
 
 	if ((nWidth == 0) || (nHeight == 0))
@@ -658,19 +1178,19 @@ BOOL interleaved_compress(BITMAP_INTERLEAVED_CONTEXT* WINPR_RESTRICT interleaved
 		return FALSE;
 	}
 
-	if ((nWidth > 64) || (nHeight > 64))
+	if ((nWidth > UINT16_MAX) || (nHeight > UINT16_MAX))
 	{
 		WLog_ERR(TAG,
 		         "interleaved_compress: width (%" PRIu32 ") or height (%" PRIu32
-		         ") is greater than 64",
-		         nWidth, nHeight);
+		         ") is greater than %" PRIu16,
+		         nWidth, nHeight, UINT16_MAX);
 		return FALSE;
 	}
 
 	switch (bpp)
 	{
 		case 24:
-			DstFormat = PIXEL_FORMAT_BGRX32;
+			DstFormat = PIXEL_FORMAT_BGR24;
 			break;
 
 		case 16:
@@ -681,32 +1201,69 @@ BOOL interleaved_compress(BITMAP_INTERLEAVED_CONTEXT* WINPR_RESTRICT interleaved
 			DstFormat = PIXEL_FORMAT_RGB15;
 			break;
 
+		case 8:
+			/* there is no conversion to palette indices, 8 bpp input is sent as is */
+			if (SrcFormat != PIXEL_FORMAT_RGB8)
+			{
+				WLog_ERR(TAG, "interleaved_compress: 8 bpp requires %s input",
+				         FreeRDPGetColorFormatName(PIXEL_FORMAT_RGB8));
+				return FALSE;
+			}
+
+			DstFormat = PIXEL_FORMAT_RGB8;
+			break;
+
 		default:
 			return FALSE;
 	}
 
-	if (!freerdp_image_copy_no_overlap(interleaved->TempBuffer, DstFormat, 0, 0, 0, nWidth, nHeight,
-	                                   pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc, palette,
-	                                   FREERDP_KEEP_DST_ALPHA))
+	encoder.bpp = FreeRDPGetBytesPerPixel(DstFormat);
+	encoder.width = nWidth;
+	encoder.count = 1ULL * nWidth * nHeight;
+	encoder.stride = encoder.bpp * nWidth;
+
+	const size_t BufferSize = encoder.stride * (nHeight + 1ULL);
+
+	if (BufferSize > UINT32_MAX)
 		return FALSE;
 
-	s = Stream_New(pDstData, *pDstSize);
+	if (BufferSize > interleaved->TempSize)
+	{
+		BYTE* tmp = winpr_aligned_recalloc(interleaved->TempBuffer, BufferSize, sizeof(BYTE), 16);
+
+		if (!tmp)
+			return FALSE;
 
-	if (!s)
+		interleaved->TempBuffer = tmp;
+		interleaved->TempSize = (UINT32)BufferSize;
+	}
+
+	BYTE* pixels = &interleaved->TempBuffer[encoder.stride];
+	memset(interleaved->TempBuffer, 0, encoder.stride);
+
+	if (DstFormat == PIXEL_FORMAT_RGB8)
+	{
+		for (size_t y = 0; y < nHeight; y++)
+			memcpy(&pixels[(nHeight - 1 - y) * encoder.stride],
+			       &pSrcData[(nYSrc + y) * nSrcStep + nXSrc], nWidth);
+	}
+	/* the flip does not take nYSrc into account, start at the first line of the rectangle */
+	else if (!freerdp_image_copy_no_overlap(pixels, DstFormat, (UINT32)encoder.stride, 0, 0,
+	                                        nWidth, nHeight, &pSrcData[1ULL * nYSrc * nSrcStep],
+	                                        SrcFormat, nSrcStep, nXSrc, 0, palette,
+	                                        FREERDP_FLIP_VERTICAL | FREERDP_KEEP_DST_ALPHA))
 		return FALSE;
 
-	Stream_SetPosition(interleaved->bts, 0);
+	encoder.pixels = pixels;
+	encoder.fgPel = (1UL << (8 * encoder.bpp)) - 1;
+	encoder.firstLine = TRUE;
+	encoder.s = Stream_StaticInit(&sbuffer, pDstData, *pDstSize);
 
-	if (freerdp_bitmap_compress(interleaved->TempBuffer, nWidth, nHeight, s, bpp, maxSize,
-	                            nHeight - 1, interleaved->bts, 0) < 0)
-		status = FALSE;
-	else
-		status = TRUE;
+	if (!interleaved_encode(&encoder))
+		return FALSE;
 
-	Stream_SealLength(s);
-	*pDstSize = (UINT32)Stream_Length(s);
-	Stream_Free(s, FALSE);
-	return status;
+	*pDstSize = (UINT32)Stream_GetPosition(encoder.s);
+	return TRUE;
 }
 
 BOOL bitmap_interleaved_context_reset(BITMAP_INTERLEAVED_CONTEXT* WINPR_RESTRICT interleaved)
@@ -730,11 +1287,6 @@ BITMAP_INTERLEAVED_CONTEXT* bitmap_interleaved_context_new(WINPR_ATTR_UNUSED BOO
 
 		if (!interleaved->TempBuffer)
 			goto fail;
-
-		interleaved->bts = Stream_New(NULL, interleaved->TempSize);
-
-		if (!interleaved->bts)
-			goto fail;
 	}
 
 	return interleaved;
@@ -753,6 +1305,5 @@ void bitmap_interleaved_context_free(BITMAP_INTERLEAVED_CONTEXT* WINPR_RESTRICT
 		return;
 
 	winpr_aligned_free(interleaved->TempBuffer);
-	Stream_Free(interleaved->bts, TRUE);
 	winpr_aligned_free(interleaved);
 }
@@ -38,6 +38,25 @@
 	  0x07FFF000) >>                                                      \
 	 12)
 
+#define MPPC_MATCH_TABLE_SIZE 32768
+#define MPPC_MAX_MATCH_WAYS 8
+#define MPPC_DEFAULT_MATCH_WAYS 1
+#define MPPC_NICE_MATCH_LENGTH 64
+
+/**
+ * Bit writer with a 64 bit accumulator, the bits are stored MSB first in 32 bit words
+ * just like BitStream_Write_Bits does.
+ */
+typedef struct
+{
+	BYTE* buffer;
+	BYTE* pointer;
+	size_t capacity;
+	UINT64 accumulator;
+	UINT32 offset;
+	size_t position;
+} MPPC_BIT_WRITER;
+
 struct s_MPPC_CONTEXT
 {
 	ALIGN64 wBitStream* bs;
@@ -46,8 +65,9 @@ struct s_MPPC_CONTEXT
 	ALIGN64 UINT32 HistoryOffset;
 	ALIGN64 UINT32 HistoryBufferSize;
 	ALIGN64 BYTE HistoryBuffer[65536];
-	ALIGN64 UINT16 MatchBuffer[32768];
+	ALIGN64 UINT16 MatchBuffer[MPPC_MATCH_TABLE_SIZE * MPPC_MAX_MATCH_WAYS];
 	ALIGN64 UINT32 CompressionLevel;
+	ALIGN64 UINT32 MatchWays;
 };
 
 static const UINT32 MPPC_MATCH_TABLE[256] = {
@@ -432,29 +452,452 @@ int mppc_decompress(MPPC_CONTEXT* mppc, const BYTE* pSrcData, UINT32 SrcSize,
 	return 1;
 }
 
+static INLINE void mppc_bit_writer_attach(MPPC_BIT_WRITER* bw, BYTE* buffer, size_t capacity)
+{
+	WINPR_ASSERT(bw);
+
+	bw->buffer = buffer;
+	bw->pointer = buffer;
+	bw->capacity = capacity;
+	bw->accumulator = 0;
+	bw->offset = 0;
+	bw->position = 0;
+}
+
+/**
+ * Stores the upper 32 bits of the accumulator, bytes past the end of the buffer are dropped.
+ */
+static INLINE void mppc_bit_writer_store(MPPC_BIT_WRITER* bw)
+{
+	const size_t used = (size_t)(bw->pointer - bw->buffer);
+
+	if ((used + 4) <= bw->capacity)
+	{
+		bw->pointer[0] = (BYTE)(bw->accumulator >> 56);
+		bw->pointer[1] = (BYTE)(bw->accumulator >> 48);
+		bw->pointer[2] = (BYTE)(bw->accumulator >> 40);
+		bw->pointer[3] = (BYTE)(bw->accumulator >> 32);
+	}
+	else
+	{
+		for (size_t x = 0; (used + x) < bw->capacity; x++)
+			bw->pointer[x] = (BYTE)(bw->accumulator >> (56 - 8 * x));
+	}
+}
+
+static INLINE void mppc_write_bits(MPPC_BIT_WRITER* bw, UINT32 bits, UINT32 nbits)
+{
+	/* offset is below 32 and nbits at most 30, the accumulator never overflows */
+	bw->accumulator |= ((UINT64)bits) << (64 - bw->offset - nbits);
+	bw->offset += nbits;
+	bw->position += nbits;
+
+	if (bw->offset >= 32)
+	{
+		mppc_bit_writer_store(bw);
+		bw->accumulator <<= 32;
+		bw->offset -= 32;
+		bw->pointer += 4;
+	}
+}
+
+static INLINE void mppc_bit_writer_flush(MPPC_BIT_WRITER* bw)
+{
+	mppc_bit_writer_store(bw);
+}
+
+static INLINE size_t mppc_count_trailing_zeros(UINT64 value)
+{
+	WINPR_ASSERT(value != 0);
+
+#if defined(__GNUC__) || defined(__clang__)
+	return (size_t)__builtin_ctzll(value);
+#else
+	size_t count = 0;
+
+	while ((value & 0xFF) == 0)
+	{
+		value >>= 8;
+		count += 8;
+	}
+
+	while ((value & 1) == 0)
+	{
+		value >>= 1;
+		count++;
+	}
+
+	return count;
+#endif
+}
+
+static INLINE UINT32 mppc_bit_length(UINT32 value)
+{
+	WINPR_ASSERT(value != 0);
+
+#if defined(__GNUC__) || defined(__clang__)
+	return 32 - (UINT32)__builtin_clz(value);
+#else
+	UINT32 length = 0;
+
+	while (value)
+	{
+		value >>= 1;
+		length++;
+	}
+
+	return length;
+#endif
+}
+
+/**
+ * Returns the number of equal bytes at Ptr1 and Ptr2, at most MaxLength.
+ */
+static INLINE size_t mppc_find_match_length(const BYTE* Ptr1, const BYTE* Ptr2, size_t MaxLength)
+{
+	size_t Length = 0;
+
+	WINPR_ASSERT(Ptr1);
+	WINPR_ASSERT(Ptr2);
+
+#if !defined(__BIG_ENDIAN__)
+	/* compare 8 bytes at a time, the lowest differing bit is in the first differing byte */
+	while ((Length + sizeof(UINT64)) <= MaxLength)
+	{
+		UINT64 val1 = 0;
+		UINT64 val2 = 0;
+
+		memcpy(&val1, &Ptr1[Length], sizeof(val1));
+		memcpy(&val2, &Ptr2[Length], sizeof(val2));
+
+		const UINT64 diff = val1 ^ val2;
+
+		if (diff != 0)
+			return Length + (mppc_count_trailing_zeros(diff) >> 3);
+
+		Length += sizeof(UINT64);
+	}
+#endif
+
+	while ((Length < MaxLength) && (Ptr1[Length] == Ptr2[Length]))
+		Length++;
+
+	return Length;
+}
+
+/**
+ * The reference encoder for a single way, HistoryPtr and pSrcPtr point past the first byte of
+ * the data to match which is already stored in the history. The match is extended byte by
+ * byte through the history and stored behind HistoryPtr on the way, an overlapping match reads
+ * what was just stored. It does not extend past HistoryEnd.
+ *
+ * Most matches in drawing orders are only a few bytes long. At that length this loop is
+ * cheaper than the bucket search with its word compares and separate history copy.
+ *
+ * Returns the length of the match, 0 if there is none.
+ */
+static INLINE size_t mppc_find_match(const BYTE* HistoryBuffer, UINT16 Candidate,
+                                     BYTE* HistoryPtr, const BYTE* HistoryEnd,
+                                     const BYTE* pSrcPtr, const BYTE* pSrcEnd,
+                                     const BYTE** ppMatchPtr)
+{
+	const BYTE* MatchPtr = &HistoryBuffer[Candidate];
+
+	/* most candidates differ in the first byte, check that before the position */
+	if ((MatchPtr == HistoryBuffer) || (MatchPtr[-1] != pSrcPtr[-1]) ||
+	    (MatchPtr[0] != pSrcPtr[0]) || (MatchPtr[1] != pSrcPtr[1]) ||
+	    (&MatchPtr[1] > HistoryEnd) || (MatchPtr == (HistoryPtr - 1)) || (MatchPtr == HistoryPtr))
+		return 0;
+
+	*ppMatchPtr = &MatchPtr[-1];
+	HistoryPtr[0] = pSrcPtr[0];
+	HistoryPtr[1] = pSrcPtr[1];
+	MatchPtr += 2;
+
+	size_t Length = 2;
+
+	while ((&pSrcPtr[Length] < pSrcEnd) && (MatchPtr <= HistoryEnd) &&
+	       (*MatchPtr == pSrcPtr[Length]))
+	{
+		HistoryPtr[Length] = pSrcPtr[Length];
+		MatchPtr++;
+		Length++;
+	}
+
+	return Length + 1;
+}
+
+/**
+ * Examines the candidates of a match bucket for the source data at pSrcPtr, which has been
+ * written to the history up to HistoryPtr (exclusive) so far. The packet starting at pSrcData
+ * is stored in the history from HistoryStart on.
+ *
+ * A candidate behind the current position may overlap the data being matched, the decoder
+ * copies byte by byte so the overlapping part repeats the source itself. Candidates ahead of
+ * the current position are left over from before the history wrapped, they are used as long
+ * as the stale data is still in the history, the decoder keeps the same bytes there.
+ *
+ * Returns the length of the longest match, 0 if there is none.
+ */
+static INLINE size_t mppc_find_best_match(const BYTE* HistoryBuffer, const UINT16* MatchBucket,
+                                          UINT32 MatchWays, const BYTE* HistoryStart,
+                                          const BYTE* HistoryEnd, const BYTE* pSrcData,
+                                          const BYTE* pSrcPtr, size_t MaxLength,
+                                          const BYTE** ppMatchPtr)
+{
+	size_t BestLength = 0;
+	const BYTE* CurrentPtr = &HistoryStart[pSrcPtr - pSrcData];
+
+	WINPR_ASSERT(HistoryBuffer);
+	WINPR_ASSERT(MatchBucket);
+	WINPR_ASSERT(ppMatchPtr);
+	WINPR_ASSERT(MaxLength >= 3);
+
+	for (UINT32 way = 0; way < MatchWays; way++)
+	{
+		size_t Length = 0;
+
+		/* buckets fill from the front, the first empty entry ends the list */
+		if (MatchBucket[way] == 0)
+			break;
+
+		const BYTE* MatchPtr = &HistoryBuffer[MatchBucket[way] - 1];
+		const BYTE* RefPtr = MatchPtr;
+
+		/**
+		 * The history of the current packet is a copy of the source, comparing against the
+		 * source avoids reading back bytes just stored and covers an overlapping match.
+		 */
+		if ((MatchPtr >= HistoryStart) && (MatchPtr < CurrentPtr))
+			RefPtr = &pSrcData[MatchPtr - HistoryStart];
+
+		if ((&MatchPtr[2] > HistoryEnd) || (MatchPtr == CurrentPtr) ||
+		    (MatchPtr == (CurrentPtr - 1)) || (RefPtr[0] != pSrcPtr[0]) ||
+		    (RefPtr[1] != pSrcPtr[1]) || (RefPtr[2] != pSrcPtr[2]))
+			continue;
+
+		/**
+		 * The reference encoder does not extend a match past the end of the history written
+		 * before the current packet position, a single way keeps its output bit for bit.
+		 */
+		size_t Limit = (size_t)(HistoryEnd - MatchPtr) + 1;
+
+		if ((MatchPtr < CurrentPtr) && (MatchWays > 1))
+			Limit = MaxLength;
+
+		Limit = MIN(Limit, MaxLength);
+
+		/* only a longer match is of interest, check the byte that would make it longer */
+		if ((Limit <= BestLength) || (RefPtr[BestLength] != pSrcPtr[BestLength]))
+			continue;
+
+		if ((MatchPtr < HistoryStart) && ((size_t)(HistoryStart - MatchPtr) < Limit))
+		{
+			/* the match continues from the history of previous packets into this packet */
+			const size_t Available = (size_t)(HistoryStart - MatchPtr);
+
+			Length = 3 + mppc_find_match_length(&pSrcPtr[3], &MatchPtr[3], Available - 3);
+
+			if (Length == Available)
+				Length += mppc_find_match_length(&pSrcPtr[Length], pSrcData, Limit - Length);
+		}
+		else
+			Length = 3 + mppc_find_match_length(&pSrcPtr[3], &RefPtr[3], Limit - 3);
+
+		if (Length > BestLength)
+		{
+			BestLength = Length;
+			*ppMatchPtr = MatchPtr;
+
+			/* a long match is good enough, the remaining candidates rarely improve on it */
+			if ((BestLength == MaxLength) || (BestLength >= MPPC_NICE_MATCH_LENGTH))
+				break;
+		}
+	}
+
+	return BestLength;
+}
+
+/**
+ * Copies Length bytes, at least 2, without a library call. The copies at both ends overlap
+ * instead of running a byte loop, nothing past the match may be written as the history
+ * ahead can still be referenced.
+ */
+static INLINE void mppc_copy_history(BYTE* WINPR_RESTRICT pDst, const BYTE* WINPR_RESTRICT pSrc,
+                                     size_t Length)
+{
+	WINPR_ASSERT(Length >= 2);
+
+	if (Length < 4)
+	{
+		UINT16 head = 0;
+		UINT16 tail = 0;
+		memcpy(&head, pSrc, sizeof(head));
+		memcpy(&tail, &pSrc[Length - sizeof(tail)], sizeof(tail));
+		memcpy(pDst, &head, sizeof(head));
+		memcpy(&pDst[Length - sizeof(tail)], &tail, sizeof(tail));
+	}
+	else if (Length < 8)
+	{
+		UINT32 head = 0;
+		UINT32 tail = 0;
+		memcpy(&head, pSrc, sizeof(head));
+		memcpy(&tail, &pSrc[Length - sizeof(tail)], sizeof(tail));
+		memcpy(pDst, &head, sizeof(head));
+		memcpy(&pDst[Length - sizeof(tail)], &tail, sizeof(tail));
+	}
+	else
+	{
+		UINT64 val = 0;
+
+		for (size_t x = 0; (x + sizeof(val)) < Length; x += sizeof(val))
+		{
+			memcpy(&val, &pSrc[x], sizeof(val));
+			memcpy(&pDst[x], &val, sizeof(val));
+		}
+
+		memcpy(&val, &pSrc[Length - sizeof(val)], sizeof(val));
+		memcpy(&pDst[Length - sizeof(val)], &val, sizeof(val));
+	}
+}
+
+static INLINE void mppc_encode_literal(MPPC_BIT_WRITER* bw, UINT32 accumulator)
+{
+#if defined(DEBUG_MPPC)
+	WLog_DBG(TAG, "%" PRIu32 "", accumulator);
+#endif
+
+	if (accumulator < 0x80)
+	{
+		/* 8 bits of literal are encoded as-is */
+		mppc_write_bits(bw, accumulator, 8);
+	}
+	else
+	{
+		/* bits 10 followed by lower 7 bits of literal */
+		mppc_write_bits(bw, 0x100 | (accumulator & 0x7F), 9);
+	}
+}
+
+static INLINE void mppc_encode_copy_offset(MPPC_BIT_WRITER* bw, UINT32 CopyOffset,
+                                           UINT32 CompressionLevel)
+{
+	if (CompressionLevel) /* RDP5 */
+	{
+		if (CopyOffset < 64)
+		{
+			/* bits 11111 + lower 6 bits of CopyOffset */
+			mppc_write_bits(bw, 0x07C0 | (CopyOffset & 0x003F), 11);
+		}
+		else if (CopyOffset < 320)
+		{
+			/* bits 11110 + lower 8 bits of (CopyOffset - 64) */
+			mppc_write_bits(bw, 0x1E00 | ((CopyOffset - 64) & 0x00FF), 13);
+		}
+		else if (CopyOffset < 2368)
+		{
+			/* bits 1110 + lower 11 bits of (CopyOffset - 320) */
+			mppc_write_bits(bw, 0x7000 | ((CopyOffset - 320) & 0x07FF), 15);
+		}
+		else
+		{
+			/* bits 110 + lower 16 bits of (CopyOffset - 2368) */
+			mppc_write_bits(bw, 0x060000 | ((CopyOffset - 2368) & 0xFFFF), 19);
+		}
+	}
+	else /* RDP4 */
+	{
+		WINPR_ASSERT(CopyOffset < 8192);
+
+		if (CopyOffset < 64)
+		{
+			/* bits 1111 + lower 6 bits of CopyOffset */
+			mppc_write_bits(bw, 0x03C0 | (CopyOffset & 0x003F), 10);
+		}
+		else if (CopyOffset < 320)
+		{
+			/* bits 1110 + lower 8 bits of (CopyOffset - 64) */
+			mppc_write_bits(bw, 0x0E00 | ((CopyOffset - 64) & 0x00FF), 12);
+		}
+		else
+		{
+			/* bits 110 + lower 13 bits of (CopyOffset - 320) */
+			mppc_write_bits(bw, 0xC000 | ((CopyOffset - 320) & 0x1FFF), 16);
+		}
+	}
+}
+
+static INLINE void mppc_encode_length_of_match(MPPC_BIT_WRITER* bw, UINT32 LengthOfMatch,
+                                               UINT32 CompressionLevel)
+{
+	WINPR_ASSERT(LengthOfMatch >= 3);
+	WINPR_ASSERT(LengthOfMatch < (CompressionLevel ? 65536u : 8192u));
+	WINPR_UNUSED(CompressionLevel);
+
+	if (LengthOfMatch == 3)
+	{
+		/* 0 + 0 lower bits of LengthOfMatch */
+		mppc_write_bits(bw, 0, 1);
+	}
+	else
+	{
+		/**
+		 * LengthOfMatch [2^k, 2^(k+1) - 1] for k in [2, 15]:
+		 * k - 1 bits 1, one bit 0 and the k lower bits of LengthOfMatch
+		 */
+		const UINT32 k = mppc_bit_length(LengthOfMatch) - 1;
+		const UINT32 prefix = (1u << k) - 2u;
+		mppc_write_bits(bw, (prefix << k) | (LengthOfMatch & ((1u << k) - 1u)), 2 * k);
+	}
+}
+
+/* Returns FALSE if the literal would not fit into the DstSize output bytes */
+static INLINE BOOL mppc_encode_literal_checked(MPPC_BIT_WRITER* bw, UINT32 DstSize,
+                                               UINT32 accumulator)
+{
+	if (((bw->position / 8) + 2) > (DstSize - 1))
+		return FALSE;
+
+	mppc_encode_literal(bw, accumulator);
+	return TRUE;
+}
+
+/* Returns FALSE if the copy-tuple would not fit into the DstSize output bytes */
+static INLINE BOOL mppc_encode_match_checked(MPPC_BIT_WRITER* bw, UINT32 DstSize,
+                                             UINT32 CopyOffset, size_t LengthOfMatch,
+                                             UINT32 CompressionLevel)
+{
+#if defined(DEBUG_MPPC)
+	WLog_DBG(TAG, "<%" PRIu32 ",%" PRIuz ">", CopyOffset, LengthOfMatch);
+#endif
+
+	if (((bw->position / 8) + 7) > (DstSize - 1))
+		return FALSE;
+
+	mppc_encode_copy_offset(bw, CopyOffset, CompressionLevel);
+	mppc_encode_length_of_match(bw, (UINT32)LengthOfMatch, CompressionLevel);
+	return TRUE;
+}
+
 int mppc_compress(MPPC_CONTEXT* mppc, const BYTE* pSrcData, UINT32 SrcSize, BYTE* pDstBuffer,
                   const BYTE** ppDstData, UINT32* pDstSize, UINT32* pFlags)
 {
 	const BYTE* pSrcPtr = NULL;
 	const BYTE* pSrcEnd = NULL;
-	BYTE* MatchPtr = NULL;
+	const BYTE* MatchPtr = NULL;
 	UINT32 DstSize = 0;
 	BYTE* pDstData = NULL;
 	UINT32 MatchIndex = 0;
-	UINT32 accumulator = 0;
 	BOOL PacketFlushed = 0;
 	BOOL PacketAtFront = 0;
 	DWORD CopyOffset = 0;
-	DWORD LengthOfMatch = 0;
+	size_t LengthOfMatch = 0;
 	BYTE* HistoryBuffer = NULL;
 	BYTE* HistoryPtr = NULL;
 	UINT32 HistoryOffset = 0;
 	UINT32 HistoryBufferSize = 0;
-	BYTE Sym1 = 0;
-	BYTE Sym2 = 0;
-	BYTE Sym3 = 0;
 	UINT32 CompressionLevel = 0;
-	wBitStream* bs = NULL;
+	MPPC_BIT_WRITER bw = { 0 };
 
 	WINPR_ASSERT(mppc);
 	WINPR_ASSERT(pSrcData);
@@ -463,9 +906,6 @@ int mppc_compress(MPPC_CONTEXT* mppc, const BYTE* pSrcData, UINT32 SrcSize, BYTE
 	WINPR_ASSERT(pDstSize);
 	WINPR_ASSERT(pFlags);
 
-	bs = mppc->bs;
-	WINPR_ASSERT(bs);
-
 	HistoryBuffer = mppc->HistoryBuffer;
 	WINPR_ASSERT(HistoryBuffer);
 
@@ -489,6 +929,12 @@ int mppc_compress(MPPC_CONTEXT* mppc, const BYTE* pSrcData, UINT32 SrcSize, BYTE
 	}
 
 	HistoryPtr = &(HistoryBuffer[HistoryOffset]);
+	const BYTE* HistoryStart = HistoryPtr;
+
+	/* kept in locals, the history stores below could alias the context */
+	const BYTE* HistoryEnd = mppc->HistoryPtr;
+	UINT16* MatchBuffer = mppc->MatchBuffer;
+	const UINT32 MatchWays = mppc->MatchWays;
 	pDstData = pDstBuffer;
 	*ppDstData = pDstBuffer;
 
@@ -500,231 +946,89 @@ int mppc_compress(MPPC_CONTEXT* mppc, const BYTE* pSrcData, UINT32 SrcSize, BYTE
 	else
 		DstSize = *pDstSize;
 
-	BitStream_Attach(bs, pDstData, DstSize);
+	mppc_bit_writer_attach(&bw, pDstData, DstSize);
 	pSrcPtr = pSrcData;
 	pSrcEnd = &(pSrcData[SrcSize - 1]);
 
-	while (pSrcPtr < (pSrcEnd - 2))
+	/* the last byte of the packet is always sent as a literal */
+	if (MatchWays == 1)
 	{
-		Sym1 = pSrcPtr[0];
-		Sym2 = pSrcPtr[1];
-		Sym3 = pSrcPtr[2];
-		*HistoryPtr++ = *pSrcPtr++;
-		MatchIndex = MPPC_MATCH_INDEX(Sym1, Sym2, Sym3);
-		MatchPtr = &(HistoryBuffer[mppc->MatchBuffer[MatchIndex]]);
+		/* runs of the same 3 byte prefix keep pointing to the start of the run */
+		while (pSrcPtr < (pSrcEnd - 2))
+		{
+			MatchIndex = MPPC_MATCH_INDEX(pSrcPtr[0], pSrcPtr[1], pSrcPtr[2]);
+			*HistoryPtr++ = *pSrcPtr++;
 
-		if (MatchPtr != (HistoryPtr - 1))
-			mppc->MatchBuffer[MatchIndex] = (UINT16)(HistoryPtr - HistoryBuffer);
+			if (HistoryEnd < HistoryPtr)
+				HistoryEnd = HistoryPtr;
 
-		if (mppc->HistoryPtr < HistoryPtr)
-			mppc->HistoryPtr = HistoryPtr;
+			const UINT16 Position = (UINT16)(HistoryPtr - HistoryBuffer);
+			const UINT16 Candidate = MatchBuffer[MatchIndex];
 
-		if ((Sym1 != *(MatchPtr - 1)) || (Sym2 != MatchPtr[0]) || (Sym3 != MatchPtr[1]) ||
-		    (&MatchPtr[1] > mppc->HistoryPtr) || (MatchPtr == HistoryBuffer) ||
-		    (MatchPtr == (HistoryPtr - 1)) || (MatchPtr == HistoryPtr))
-		{
-			if (((bs->position / 8) + 2) > (DstSize - 1))
-			{
-				mppc_context_reset(mppc, TRUE);
-				*pFlags |= PACKET_FLUSHED;
-				*pFlags |= CompressionLevel;
-				*ppDstData = pSrcData;
-				*pDstSize = SrcSize;
-				return 1;
-			}
+			if (Candidate != (Position - 1))
+				MatchBuffer[MatchIndex] = Position;
 
-			accumulator = Sym1;
-#if defined(DEBUG_MPPC)
-			WLog_DBG(TAG, "%" PRIu32 "", accumulator);
-#endif
+			LengthOfMatch = mppc_find_match(HistoryBuffer, Candidate, HistoryPtr, HistoryEnd,
+			                                pSrcPtr, pSrcEnd, &MatchPtr);
 
-			if (accumulator < 0x80)
+			if (LengthOfMatch == 0)
 			{
-				/* 8 bits of literal are encoded as-is */
-				BitStream_Write_Bits(bs, accumulator, 8);
-			}
-			else
-			{
-				/* bits 10 followed by lower 7 bits of literal */
-				accumulator = 0x100 | (accumulator & 0x7F);
-				BitStream_Write_Bits(bs, accumulator, 9);
+				if (!mppc_encode_literal_checked(&bw, DstSize, pSrcPtr[-1]))
+					goto flush;
+
+				continue;
 			}
+
+			CopyOffset = (HistoryBufferSize - 1) & (UINT32)((HistoryPtr - 1) - MatchPtr);
+			HistoryPtr += LengthOfMatch - 1;
+			pSrcPtr += LengthOfMatch - 1;
+
+			if (!mppc_encode_match_checked(&bw, DstSize, CopyOffset, LengthOfMatch,
+			                               CompressionLevel))
+				goto flush;
 		}
-		else
+	}
+	else
+	{
+		while (pSrcPtr < (pSrcEnd - 2))
 		{
-			CopyOffset = (HistoryBufferSize - 1) & (HistoryPtr - MatchPtr);
-			*HistoryPtr++ = Sym2;
-			*HistoryPtr++ = Sym3;
-			pSrcPtr += 2;
-			LengthOfMatch = 3;
-			MatchPtr += 2;
+			MatchIndex = MPPC_MATCH_INDEX(pSrcPtr[0], pSrcPtr[1], pSrcPtr[2]);
+			UINT16* MatchBucket = &MatchBuffer[MatchIndex * MatchWays];
+			*HistoryPtr++ = *pSrcPtr++;
 
-			while ((*pSrcPtr == *MatchPtr) && (pSrcPtr < pSrcEnd) && (MatchPtr <= mppc->HistoryPtr))
-			{
-				MatchPtr++;
-				*HistoryPtr++ = *pSrcPtr++;
-				LengthOfMatch++;
-			}
+			if (HistoryEnd < HistoryPtr)
+				HistoryEnd = HistoryPtr;
 
-#if defined(DEBUG_MPPC)
-			WLog_DBG(TAG, "<%" PRIu32 ",%" PRIu32 ">", CopyOffset, LengthOfMatch);
-#endif
+			LengthOfMatch = mppc_find_best_match(HistoryBuffer, MatchBucket, MatchWays,
+			                                     HistoryStart, HistoryEnd, pSrcData, pSrcPtr - 1,
+			                                     (size_t)(pSrcEnd - pSrcPtr) + 1, &MatchPtr);
 
-			/* Encode CopyOffset */
+			const UINT16 Position = (UINT16)(HistoryPtr - HistoryBuffer);
 
-			if (((bs->position / 8) + 7) > (DstSize - 1))
+			if (MatchBucket[0] != (Position - 1))
 			{
-				mppc_context_reset(mppc, TRUE);
-				*pFlags |= PACKET_FLUSHED;
-				*pFlags |= CompressionLevel;
-				*ppDstData = pSrcData;
-				*pDstSize = SrcSize;
-				return 1;
-			}
+				for (UINT32 way = MatchWays - 1; way > 0; way--)
+					MatchBucket[way] = MatchBucket[way - 1];
 
-			if (CompressionLevel) /* RDP5 */
-			{
-				if (CopyOffset < 64)
-				{
-					/* bits 11111 + lower 6 bits of CopyOffset */
-					accumulator = 0x07C0 | (CopyOffset & 0x003F);
-					BitStream_Write_Bits(bs, accumulator, 11);
-				}
-				else if ((CopyOffset >= 64) && (CopyOffset < 320))
-				{
-					/* bits 11110 + lower 8 bits of (CopyOffset - 64) */
-					accumulator = 0x1E00 | ((CopyOffset - 64) & 0x00FF);
-					BitStream_Write_Bits(bs, accumulator, 13);
-				}
-				else if ((CopyOffset >= 320) && (CopyOffset < 2368))
-				{
-					/* bits 1110 + lower 11 bits of (CopyOffset - 320) */
-					accumulator = 0x7000 | ((CopyOffset - 320) & 0x07FF);
-					BitStream_Write_Bits(bs, accumulator, 15);
-				}
-				else
-				{
-					/* bits 110 + lower 16 bits of (CopyOffset - 2368) */
-					accumulator = 0x060000 | ((CopyOffset - 2368) & 0xFFFF);
-					BitStream_Write_Bits(bs, accumulator, 19);
-				}
+				MatchBucket[0] = Position;
 			}
-			else /* RDP4 */
+
+			if (LengthOfMatch == 0)
 			{
-				if (CopyOffset < 64)
-				{
-					/* bits 1111 + lower 6 bits of CopyOffset */
-					accumulator = 0x03C0 | (CopyOffset & 0x003F);
-					BitStream_Write_Bits(bs, accumulator, 10);
-				}
-				else if ((CopyOffset >= 64) && (CopyOffset < 320))
-				{
-					/* bits 1110 + lower 8 bits of (CopyOffset - 64) */
-					accumulator = 0x0E00 | ((CopyOffset - 64) & 0x00FF);
-					BitStream_Write_Bits(bs, accumulator, 12);
-				}
-				else if ((CopyOffset >= 320) && (CopyOffset < 8192))
-				{
-					/* bits 110 + lower 13 bits of (CopyOffset - 320) */
-					accumulator = 0xC000 | ((CopyOffset - 320) & 0x1FFF);
-					BitStream_Write_Bits(bs, accumulator, 16);
-				}
+				if (!mppc_encode_literal_checked(&bw, DstSize, pSrcPtr[-1]))
+					goto flush;
+
+				continue;
 			}
 
-			/* Encode LengthOfMatch */
+			CopyOffset = (HistoryBufferSize - 1) & (UINT32)((HistoryPtr - 1) - MatchPtr);
+			mppc_copy_history(HistoryPtr, pSrcPtr, LengthOfMatch - 1);
+			HistoryPtr += LengthOfMatch - 1;
+			pSrcPtr += LengthOfMatch - 1;
 
-			if (LengthOfMatch == 3)
-			{
-				/* 0 + 0 lower bits of LengthOfMatch */
-				BitStream_Write_Bits(bs, 0, 1);
-			}
-			else if ((LengthOfMatch >= 4) && (LengthOfMatch < 8))
-			{
-				/* 10 + 2 lower bits of LengthOfMatch */
-				accumulator = 0x0008 | (LengthOfMatch & 0x0003);
-				BitStream_Write_Bits(bs, accumulator, 4);
-			}
-			else if ((LengthOfMatch >= 8) && (LengthOfMatch < 16))
-			{
-				/* 110 + 3 lower bits of LengthOfMatch */
-				accumulator = 0x0030 | (LengthOfMatch & 0x0007);
-				BitStream_Write_Bits(bs, accumulator, 6);
-			}
-			else if ((LengthOfMatch >= 16) && (LengthOfMatch < 32))
-			{
-				/* 1110 + 4 lower bits of LengthOfMatch */
-				accumulator = 0x00E0 | (LengthOfMatch & 0x000F);
-				BitStream_Write_Bits(bs, accumulator, 8);
-			}
-			else if ((LengthOfMatch >= 32) && (LengthOfMatch < 64))
-			{
-				/* 11110 + 5 lower bits of LengthOfMatch */
-				accumulator = 0x03C0 | (LengthOfMatch & 0x001F);
-				BitStream_Write_Bits(bs, accumulator, 10);
-			}
-			else if ((LengthOfMatch >= 64) && (LengthOfMatch < 128))
-			{
-				/* 111110 + 6 lower bits of LengthOfMatch */
-				accumulator = 0x0F80 | (LengthOfMatch & 0x003F);
-				BitStream_Write_Bits(bs, accumulator, 12);
-			}
-			else if ((LengthOfMatch >= 128) && (LengthOfMatch < 256))
-			{
-				/* 1111110 + 7 lower bits of LengthOfMatch */
-				accumulator = 0x3F00 | (LengthOfMatch & 0x007F);
-				BitStream_Write_Bits(bs, accumulator, 14);
-			}
-			else if ((LengthOfMatch >= 256) && (LengthOfMatch < 512))
-			{
-				/* 11111110 + 8 lower bits of LengthOfMatch */
-				accumulator = 0xFE00 | (LengthOfMatch & 0x00FF);
-				BitStream_Write_Bits(bs, accumulator, 16);
-			}
-			else if ((LengthOfMatch >= 512) && (LengthOfMatch < 1024))
-			{
-				/* 111111110 + 9 lower bits of LengthOfMatch */
-				accumulator = 0x3FC00 | (LengthOfMatch & 0x01FF);
-				BitStream_Write_Bits(bs, accumulator, 18);
-			}
-			else if ((LengthOfMatch >= 1024) && (LengthOfMatch < 2048))
-			{
-				/* 1111111110 + 10 lower bits of LengthOfMatch */
-				accumulator = 0xFF800 | (LengthOfMatch & 0x03FF);
-				BitStream_Write_Bits(bs, accumulator, 20);
-			}
-			else if ((LengthOfMatch >= 2048) && (LengthOfMatch < 4096))
-			{
-				/* 11111111110 + 11 lower bits of LengthOfMatch */
-				accumulator = 0x3FF000 | (LengthOfMatch & 0x07FF);
-				BitStream_Write_Bits(bs, accumulator, 22);
-			}
-			else if ((LengthOfMatch >= 4096) && (LengthOfMatch < 8192))
-			{
-				/* 111111111110 + 12 lower bits of LengthOfMatch */
-				accumulator = 0xFFE000 | (LengthOfMatch & 0x0FFF);
-				BitStream_Write_Bits(bs, accumulator, 24);
-			}
-			else if (((LengthOfMatch >= 8192) && (LengthOfMatch < 16384)) &&
-			         CompressionLevel) /* RDP5 */
-			{
-				/* 1111111111110 + 13 lower bits of LengthOfMatch */
-				accumulator = 0x3FFC000 | (LengthOfMatch & 0x1FFF);
-				BitStream_Write_Bits(bs, accumulator, 26);
-			}
-			else if (((LengthOfMatch >= 16384) && (LengthOfMatch < 32768)) &&
-			         CompressionLevel) /* RDP5 */
-			{
-				/* 11111111111110 + 14 lower bits of LengthOfMatch */
-				accumulator = 0xFFF8000 | (LengthOfMatch & 0x3FFF);
-				BitStream_Write_Bits(bs, accumulator, 28);
-			}
-			else if (((LengthOfMatch >= 32768) && (LengthOfMatch < 65536)) &&
-			         CompressionLevel) /* RDP5 */
-			{
-				/* 111111111111110 + 15 lower bits of LengthOfMatch */
-				accumulator = 0x3FFF0000 | (LengthOfMatch & 0x7FFF);
-				BitStream_Write_Bits(bs, accumulator, 30);
-			}
+			if (!mppc_encode_match_checked(&bw, DstSize, CopyOffset, LengthOfMatch,
+			                               CompressionLevel))
+				goto flush;
 		}
 	}
 
@@ -732,37 +1036,13 @@ int mppc_compress(MPPC_CONTEXT* mppc, const BYTE* pSrcData, UINT32 SrcSize, BYTE
 
 	while (pSrcPtr <= pSrcEnd)
 	{
-		if (((bs->position / 8) + 2) > (DstSize - 1))
-		{
-			mppc_context_reset(mppc, TRUE);
-			*pFlags |= PACKET_FLUSHED;
-			*pFlags |= CompressionLevel;
-			*ppDstData = pSrcData;
-			*pDstSize = SrcSize;
-			return 1;
-		}
-
-		accumulator = *pSrcPtr;
-#if defined(DEBUG_MPPC)
-		WLog_DBG(TAG, "%" PRIu32 "", accumulator);
-#endif
-
-		if (accumulator < 0x80)
-		{
-			/* 8 bits of literal are encoded as-is */
-			BitStream_Write_Bits(bs, accumulator, 8);
-		}
-		else
-		{
-			/* bits 10 followed by lower 7 bits of literal */
-			accumulator = 0x100 | (accumulator & 0x7F);
-			BitStream_Write_Bits(bs, accumulator, 9);
-		}
+		if (!mppc_encode_literal_checked(&bw, DstSize, *pSrcPtr))
+			goto flush;
 
 		*HistoryPtr++ = *pSrcPtr++;
 	}
 
-	BitStream_Flush(bs);
+	mppc_bit_writer_flush(&bw);
 	*pFlags |= PACKET_COMPRESSED;
 	*pFlags |= CompressionLevel;
 
@@ -772,13 +1052,22 @@ int mppc_compress(MPPC_CONTEXT* mppc, const BYTE* pSrcData, UINT32 SrcSize, BYTE
 	if (PacketFlushed)
 		*pFlags |= PACKET_FLUSHED;
 
-	*pDstSize = ((bs->position + 7) / 8);
+	*pDstSize = (UINT32)((bw.position + 7) / 8);
 	mppc->HistoryPtr = HistoryPtr;
 	const intptr_t diff = HistoryPtr - HistoryBuffer;
 	if (diff > UINT32_MAX)
 		return -1;
 	mppc->HistoryOffset = (UINT32)diff;
 	return 1;
+
+flush:
+	/* the output would not be smaller, send the packet uncompressed */
+	mppc_context_reset(mppc, TRUE);
+	*pFlags |= PACKET_FLUSHED;
+	*pFlags |= CompressionLevel;
+	*ppDstData = pSrcData;
+	*pDstSize = SrcSize;
+	return 1;
 }
 
 void mppc_set_compression_level(MPPC_CONTEXT* mppc, DWORD CompressionLevel)
@@ -797,12 +1086,31 @@ void mppc_set_compression_level(MPPC_CONTEXT* mppc, DWORD CompressionLevel)
 	}
 }
 
+void mppc_set_match_ways(MPPC_CONTEXT* mppc, UINT32 MatchWays)
+{
+	WINPR_ASSERT(mppc);
+
+	if (MatchWays == 0)
+		MatchWays = MPPC_DEFAULT_MATCH_WAYS;
+
+	MatchWays = MIN(MatchWays, MPPC_MAX_MATCH_WAYS);
+
+	if (mppc->MatchWays == MatchWays)
+		return;
+
+	/* the bucket layout depends on the number of ways, start over with empty buckets */
+	mppc->MatchWays = MatchWays;
+	ZeroMemory(&(mppc->MatchBuffer), sizeof(mppc->MatchBuffer));
+}
+
 void mppc_context_reset(MPPC_CONTEXT* mppc, BOOL flush)
 {
 	WINPR_ASSERT(mppc);
+	WINPR_ASSERT(mppc->MatchWays <= MPPC_MAX_MATCH_WAYS);
 
 	ZeroMemory(&(mppc->HistoryBuffer), sizeof(mppc->HistoryBuffer));
-	ZeroMemory(&(mppc->MatchBuffer), sizeof(mppc->MatchBuffer));
+	ZeroMemory(&(mppc->MatchBuffer),
+	           sizeof(mppc->MatchBuffer[0]) * MPPC_MATCH_TABLE_SIZE * mppc->MatchWays);
 
 	if (flush)
 	{
@@ -824,6 +1132,7 @@ MPPC_CONTEXT* mppc_context_new(DWORD CompressionLevel, BOOL Compressor)
 		goto fail;
 
 	mppc->Compressor = Compressor;
+	mppc->MatchWays = MPPC_DEFAULT_MATCH_WAYS;
 
 	if (CompressionLevel < 1)
 	{
@@ -42,6 +42,12 @@ extern "C"
 
 	FREERDP_LOCAL void mppc_set_compression_level(MPPC_CONTEXT* mppc, DWORD CompressionLevel);
 
+	/**
+	 * Sets the number of candidates kept per hash bucket by the compressor,
+	 * 0 selects the default and values are clamped to [1, 8].
+	 */
+	FREERDP_LOCAL void mppc_set_match_ways(MPPC_CONTEXT* mppc, UINT32 MatchWays);
+
 	FREERDP_LOCAL void mppc_context_reset(MPPC_CONTEXT* mppc, BOOL flush);
 
 	FREERDP_LOCAL MPPC_CONTEXT* mppc_context_new(DWORD CompressionLevel, BOOL Compressor);
@@ -34,6 +34,11 @@
 
 #define TAG FREERDP_TAG("codec")
 
+#define NCRUSH_DEFAULT_CHAIN_DEPTH 32
+#define NCRUSH_NICE_MATCH_LENGTH 256
+/* the longest match the LOM tables can encode: index 28, 14 extra bits */
+#define NCRUSH_MAX_MATCH_LENGTH 16385
+
 struct s_NCRUSH_CONTEXT
 {
 	ALIGN64 BOOL Compressor;
@@ -48,6 +53,7 @@ struct s_NCRUSH_CONTEXT
 	ALIGN64 UINT16 MatchTable[65536];
 	ALIGN64 BYTE HuffTableCopyOffset[1024];
 	ALIGN64 BYTE HuffTableLOM[4096];
+	ALIGN64 UINT32 ChainDepth;
 };
 
 static const UINT16 HuffTableLEC[8192] = {
@@ -2342,143 +2348,121 @@ static int ncrush_hash_table_add(NCRUSH_CONTEXT* ncrush, const BYTE* pSrcData, U
 	return 1;
 }
 
-static intptr_t ncrush_find_match_length(const BYTE* Ptr1, const BYTE* Ptr2, const BYTE* HistoryPtr)
+static INLINE size_t ncrush_count_trailing_zeros(UINT64 value)
 {
-	BYTE val1 = 0;
-	BYTE val2 = 0;
-	const BYTE* Ptr = Ptr1;
+	WINPR_ASSERT(value != 0);
 
-	WINPR_ASSERT(Ptr1);
-	WINPR_ASSERT(Ptr2);
-	WINPR_ASSERT(HistoryPtr);
+#if defined(__GNUC__) || defined(__clang__)
+	return (size_t)__builtin_ctzll(value);
+#else
+	size_t count = 0;
 
-	do
+	while ((value & 0xFF) == 0)
 	{
-		if (Ptr1 > HistoryPtr)
-			break;
+		value >>= 8;
+		count += 8;
+	}
 
-		val1 = *Ptr1++;
-		val2 = *Ptr2++;
-	} while (val1 == val2);
+	while ((value & 1) == 0)
+	{
+		value >>= 1;
+		count++;
+	}
 
-	return Ptr1 - (Ptr + 1);
+	return count;
+#endif
 }
 
-static int ncrush_find_best_match(NCRUSH_CONTEXT* ncrush, UINT16 HistoryOffset,
-                                  UINT32* pMatchOffset)
+/**
+ * Returns the number of equal bytes at Ptr1 and Ptr2, at most MaxLength.
+ * Ptr2 is the older position, so both pointers may overlap.
+ */
+static INLINE size_t ncrush_find_match_length(const BYTE* Ptr1, const BYTE* Ptr2, size_t MaxLength)
 {
-	int Length = 0;
-
-	WINPR_ASSERT(ncrush);
-	WINPR_ASSERT(pMatchOffset);
+	size_t Length = 0;
 
-	if (!ncrush->MatchTable[HistoryOffset])
-		return -1;
-
-	int MatchLength = 2;
-	UINT16 Offset = HistoryOffset;
-	BYTE* HistoryBuffer = (BYTE*)ncrush->HistoryBuffer;
-
-	ncrush->MatchTable[0] = HistoryOffset;
-	UINT16 MatchOffset = ncrush->MatchTable[HistoryOffset];
-	UINT16 NextOffset = ncrush->MatchTable[Offset];
-	BYTE* MatchPtr = &HistoryBuffer[MatchLength];
+	WINPR_ASSERT(Ptr1);
+	WINPR_ASSERT(Ptr2);
 
-	for (int i = 0; i < 4; i++)
+#if !defined(__BIG_ENDIAN__)
+	/* compare 8 bytes at a time, the lowest differing bit is in the first differing byte */
+	while ((Length + sizeof(UINT64)) <= MaxLength)
 	{
-		int j = -1;
+		UINT64 val1 = 0;
+		UINT64 val2 = 0;
 
-		if (j < 0)
-		{
-			Offset = ncrush->MatchTable[NextOffset];
+		memcpy(&val1, &Ptr1[Length], sizeof(val1));
+		memcpy(&val2, &Ptr2[Length], sizeof(val2));
 
-			if (MatchPtr[NextOffset] == HistoryBuffer[HistoryOffset + MatchLength])
-				j = 0;
-		}
+		const UINT64 diff = val1 ^ val2;
 
-		if (j < 0)
-		{
-			NextOffset = ncrush->MatchTable[Offset];
+		if (diff != 0)
+			return Length + (ncrush_count_trailing_zeros(diff) >> 3);
 
-			if (MatchPtr[Offset] == HistoryBuffer[HistoryOffset + MatchLength])
-				j = 1;
-		}
+		Length += sizeof(UINT64);
+	}
+#endif
 
-		if (j < 0)
-		{
-			Offset = ncrush->MatchTable[NextOffset];
+	while ((Length < MaxLength) && (Ptr1[Length] == Ptr2[Length]))
+		Length++;
 
-			if (MatchPtr[NextOffset] == HistoryBuffer[HistoryOffset + MatchLength])
-				j = 2;
-		}
+	return Length;
+}
 
-		if (j < 0)
-		{
-			NextOffset = ncrush->MatchTable[Offset];
+/**
+ * Walks the hash chain of HistoryOffset and returns the length of the longest match found
+ * within ChainDepth candidates, 0 if there is none.
+ */
+static UINT32 ncrush_find_best_match(const NCRUSH_CONTEXT* ncrush, UINT32 HistoryOffset,
+                                     UINT32* pMatchOffset)
+{
+	WINPR_ASSERT(ncrush);
+	WINPR_ASSERT(pMatchOffset);
+	WINPR_ASSERT(HistoryOffset < ARRAYSIZE(ncrush->MatchTable));
 
-			if (MatchPtr[Offset] == HistoryBuffer[HistoryOffset + MatchLength])
-				j = 3;
-		}
+	const BYTE* HistoryBuffer = ncrush->HistoryBuffer;
+	const BYTE* Ptr = &HistoryBuffer[HistoryOffset];
+	const intptr_t available = ncrush->HistoryPtr - Ptr;
 
-		if (j < 0)
-		{
-			Offset = ncrush->MatchTable[NextOffset];
+	if (available < 2)
+		return 0;
 
-			if (MatchPtr[NextOffset] == HistoryBuffer[HistoryOffset + MatchLength])
-				j = 4;
-		}
+	const size_t MaxLength = MIN((size_t)available, NCRUSH_MAX_MATCH_LENGTH);
+	size_t MatchLength = 0;
+	UINT32 MatchOffset = 0;
+	UINT32 Offset = ncrush->MatchTable[HistoryOffset];
 
-		if (j < 0)
-		{
-			NextOffset = ncrush->MatchTable[Offset];
+	for (UINT32 depth = ncrush->ChainDepth; depth > 0; depth--)
+	{
+		/* offset 0 terminates the chain, entries always point backwards */
+		if ((Offset == 0) || (Offset >= HistoryOffset))
+			break;
 
-			if (MatchPtr[Offset] == HistoryBuffer[HistoryOffset + MatchLength])
-				j = 5;
-		}
+		const BYTE* MatchPtr = &HistoryBuffer[Offset];
 
-		if (j >= 0)
+		/* a candidate can only be longer if it also matches the byte after the current best */
+		if (MatchPtr[MatchLength] == Ptr[MatchLength])
 		{
-			if ((j % 2) == 0)
-				Offset = NextOffset;
+			const size_t Length = ncrush_find_match_length(Ptr, MatchPtr, MaxLength);
 
-			if ((Offset != HistoryOffset) && Offset)
+			if (Length > MatchLength)
 			{
-				const intptr_t len =
-				    ncrush_find_match_length(&HistoryBuffer[HistoryOffset + 2],
-				                             &HistoryBuffer[Offset + 2], ncrush->HistoryPtr);
-				WINPR_ASSERT(len < INT_MAX - 2);
-				WINPR_ASSERT(len > INT_MIN + 2);
+				MatchLength = Length;
+				MatchOffset = Offset;
 
-				Length = (int)len + 2;
-
-				if (Length < 2)
-					return -1;
-
-				if (Length > 16)
+				if ((MatchLength >= NCRUSH_NICE_MATCH_LENGTH) || (MatchLength == MaxLength))
 					break;
-
-				if (Length > MatchLength)
-				{
-					MatchLength = Length;
-					MatchOffset = Offset;
-				}
-
-				if ((Length <= MatchLength) ||
-				    (&HistoryBuffer[HistoryOffset + 2] < ncrush->HistoryPtr))
-				{
-					NextOffset = ncrush->MatchTable[Offset];
-					MatchPtr = &HistoryBuffer[MatchLength];
-					continue;
-				}
 			}
-
-			break;
 		}
+
+		Offset = ncrush->MatchTable[Offset];
 	}
 
-	ncrush->MatchTable[0] = 0;
+	if (MatchLength < 2)
+		return 0;
+
 	*pMatchOffset = MatchOffset;
-	return MatchLength;
+	return (UINT32)MatchLength;
 }
 
 static int ncrush_move_encoder_windows(NCRUSH_CONTEXT* ncrush, BYTE* HistoryPtr)
@@ -2554,6 +2538,9 @@ int ncrush_compress(NCRUSH_CONTEXT* ncrush, const BYTE* pSrcData, UINT32 SrcSize
 	UINT32 CopyOffsetIndex = 0;
 	UINT32 CopyOffsetBits = 0;
 	UINT32 CompressionLevel = 2;
+	BOOL NextMatchValid = FALSE;
+	UINT32 NextMatchLength = 0;
+	UINT32 NextMatchOffset = 0;
 
 	WINPR_ASSERT(ncrush);
 
@@ -2633,17 +2620,17 @@ int ncrush_compress(NCRUSH_CONTEXT* ncrush, const BYTE* pSrcData, UINT32 SrcSize
 		if (HistoryOffset >= 65536)
 			return -1004;
 
-		if (ncrush->MatchTable[HistoryOffset])
+		if (NextMatchValid)
+		{
+			/* already searched by the lazy evaluation of the previous position */
+			MatchLength = NextMatchLength;
+			MatchOffset = NextMatchOffset;
+			NextMatchValid = FALSE;
+		}
+		else if (ncrush->MatchTable[HistoryOffset])
 		{
-			int rc = 0;
-
 			MatchOffset = 0;
-			rc = ncrush_find_best_match(ncrush, WINPR_ASSERTING_INT_CAST(UINT16, HistoryOffset),
-			                            &MatchOffset);
-
-			if (rc < 0)
-				return -1005;
-			MatchLength = (UINT32)rc;
+			MatchLength = ncrush_find_best_match(ncrush, HistoryOffset, &MatchOffset);
 		}
 
 		if (MatchLength)
@@ -2652,6 +2639,19 @@ int ncrush_compress(NCRUSH_CONTEXT* ncrush, const BYTE* pSrcData, UINT32 SrcSize
 		if ((MatchLength == 2) && (CopyOffset >= 64))
 			MatchLength = 0;
 
+		/* lazy evaluation: emit a literal if the next position starts a longer match */
+		if ((MatchLength > 0) && (MatchLength < NCRUSH_NICE_MATCH_LENGTH) &&
+		    (ncrush->ChainDepth > 1) && ((SrcPtr + 1) < (SrcEndPtr - 2)) &&
+		    ncrush->MatchTable[HistoryOffset + 1])
+		{
+			NextMatchOffset = 0;
+			NextMatchLength = ncrush_find_best_match(ncrush, HistoryOffset + 1, &NextMatchOffset);
+			NextMatchValid = (NextMatchLength > MatchLength);
+
+			if (NextMatchValid)
+				MatchLength = 0;
+		}
+
 		if (MatchLength == 0)
 		{
 			/* Literal */
@@ -3007,6 +3007,13 @@ void ncrush_context_reset(NCRUSH_CONTEXT* ncrush, BOOL flush)
 	ncrush->HistoryPtr = &(ncrush->HistoryBuffer[ncrush->HistoryOffset]);
 }
 
+void ncrush_set_chain_depth(NCRUSH_CONTEXT* ncrush, UINT32 ChainDepth)
+{
+	WINPR_ASSERT(ncrush);
+
+	ncrush->ChainDepth = (ChainDepth == 0) ? NCRUSH_DEFAULT_CHAIN_DEPTH : ChainDepth;
+}
+
 NCRUSH_CONTEXT* ncrush_context_new(BOOL Compressor)
 {
 	NCRUSH_CONTEXT* ncrush = (NCRUSH_CONTEXT*)calloc(1, sizeof(NCRUSH_CONTEXT));
@@ -3018,6 +3025,7 @@ NCRUSH_CONTEXT* ncrush_context_new(BOOL Compressor)
 	ncrush->HistoryBufferSize = 65536;
 	ncrush->HistoryEndOffset = ncrush->HistoryBufferSize - 1;
 	ncrush->HistoryBufferFence = 0xABABABAB;
+	ncrush->ChainDepth = NCRUSH_DEFAULT_CHAIN_DEPTH;
 	ncrush->HistoryOffset = 0;
 	ncrush->HistoryPtr = &(ncrush->HistoryBuffer[ncrush->HistoryOffset]);
 
@@ -41,6 +41,12 @@ extern "C"
 	                                    UINT32 SrcSize, const BYTE** ppDstData, UINT32* pDstSize,
 	                                    UINT32 flags);
 
+	/**
+	 * Limits the number of hash chain candidates examined per position.
+	 * 0 selects the default, 1 additionally disables lazy match evaluation.
+	 */
+	FREERDP_LOCAL void ncrush_set_chain_depth(NCRUSH_CONTEXT* ncrush, UINT32 ChainDepth);
+
 	FREERDP_LOCAL void ncrush_context_reset(NCRUSH_CONTEXT* ncrush, BOOL flush);
 
 	FREERDP_LOCAL NCRUSH_CONTEXT* ncrush_context_new(BOOL Compressor);
@@ -0,0 +1,136 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * RDP6 Planar Codec - NEON Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/assert.h>
+#include <winpr/platform.h>
+#include <freerdp/config.h>
+
+#include "../planar_types.h"
+#include "planar_neon.h"
+
+#include "../../core/simd.h"
+
+#if defined(NEON_INTRINSICS_ENABLED)
+#include <arm_neon.h>
+
+static void planar_split_row32_neon(const BYTE* WINPR_RESTRICT pSrc, UINT32 width,
+                                    const BYTE offsets[4], BYTE* WINPR_RESTRICT planes[4])
+{
+	UINT32 x = 0;
+
+	for (; (x + 16) <= width; x += 16)
+	{
+		/* val[i] holds byte i of 16 pixels */
+		const uint8x16x4_t pixels = vld4q_u8(&pSrc[4ULL * x]);
+
+		for (size_t i = 0; i < 4; i++)
+		{
+			if (planes[i])
+				vst1q_u8(&planes[i][x], pixels.val[offsets[i]]);
+		}
+	}
+
+	if (x < width)
+	{
+		BYTE* tail[4] = { 0 };
+
+		for (size_t i = 0; i < 4; i++)
+			tail[i] = planes[i] ? &planes[i][x] : NULL;
+
+		planar_split_row32_generic(&pSrc[4ULL * x], width - x, offsets, tail);
+	}
+}
+
+static void planar_delta_encode_row_neon(const BYTE* WINPR_RESTRICT pCur,
+                                         const BYTE* WINPR_RESTRICT pPrev,
+                                         BYTE* WINPR_RESTRICT pDst, UINT32 width)
+{
+	UINT32 x = 0;
+
+	for (; (x + 16) <= width; x += 16)
+	{
+		const uint8x16_t delta = vsubq_u8(vld1q_u8(&pCur[x]), vld1q_u8(&pPrev[x]));
+		const uint8x16_t sign = vreinterpretq_u8_s8(vshrq_n_s8(vreinterpretq_s8_u8(delta), 7));
+		vst1q_u8(&pDst[x], veorq_u8(vshlq_n_u8(delta, 1), sign));
+	}
+
+	planar_delta_encode_row_generic(&pCur[x], &pPrev[x], &pDst[x], width - x);
+}
+
+/* NEON has no movemask, the weighted bits of each half are summed up pairwise */
+static INLINE UINT32 planar_movemask_neon(uint8x16_t eq)
+{
+	static const BYTE weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+	const uint8x16_t bits = vandq_u8(eq, vld1q_u8(weights));
+	uint8x8_t sum = vpadd_u8(vget_low_u8(bits), vget_high_u8(bits));
+	sum = vpadd_u8(sum, sum);
+	sum = vpadd_u8(sum, sum);
+	return vget_lane_u8(sum, 0) | ((UINT32)vget_lane_u8(sum, 1) << 8);
+}
+
+static void planar_match_row_neon(const BYTE* WINPR_RESTRICT pSrc, UINT32 width,
+                                  UINT64* WINPR_RESTRICT mask)
+{
+	UINT32 x = 0;
+
+	for (; (x + 64) <= width; x += 64)
+	{
+		UINT64 bits = 0;
+
+		for (size_t i = 0; i < 4; i++)
+		{
+			const BYTE* ptr = &pSrc[x + 16 * i];
+			const uint8x16_t cur = vld1q_u8(ptr);
+
+			/* the first byte of the scanline is compared to 0 */
+			const uint8x16_t prev =
+			    (ptr == pSrc) ? vextq_u8(vdupq_n_u8(0), cur, 15) : vld1q_u8(&ptr[-1]);
+			bits |= (UINT64)planar_movemask_neon(vceqq_u8(cur, prev)) << (16 * i);
+		}
+
+		mask[x / 64] = bits;
+	}
+
+	if (x < width)
+	{
+		UINT64 bits = 0;
+		BYTE symbol = (x > 0) ? pSrc[x - 1] : 0;
+
+		for (UINT32 i = x; i < width; i++)
+		{
+			if (pSrc[i] == symbol)
+				bits |= 1ULL << (i - x);
+
+			symbol = pSrc[i];
+		}
+
+		mask[x / 64] = bits;
+	}
+}
+#endif
+
+void planar_init_neon_int(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT context)
+{
+#if defined(NEON_INTRINSICS_ENABLED)
+	WINPR_ASSERT(context);
+	context->split_row32 = planar_split_row32_neon;
+	context->delta_encode_row = planar_delta_encode_row_neon;
+	context->match_row = planar_match_row_neon;
+#else
+	WINPR_UNUSED(context);
+#endif
+}
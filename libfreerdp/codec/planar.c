@@ -32,6 +32,11 @@
 #include <freerdp/codec/bitmap.h>
 #include <freerdp/codec/planar.h>
 
+#include "planar_types.h"
+#include "sse/planar_sse4_1.h"
+#include "sse/planar_avx2.h"
+#include "neon/planar_neon.h"
+
 #define TAG FREERDP_TAG("codec")
 
 #define PLANAR_ALIGN(val, align) \
@@ -67,35 +72,6 @@ typedef struct
 	BYTE formatHeader;
 } RDP6_BITMAP_STREAM;
 
-struct S_BITMAP_PLANAR_CONTEXT
-{
-	UINT32 maxWidth;
-	UINT32 maxHeight;
-	UINT32 maxPlaneSize;
-
-	BOOL AllowSkipAlpha;
-	BOOL AllowRunLengthEncoding;
-	BOOL AllowColorSubsampling;
-	BOOL AllowDynamicColorFidelity;
-
-	UINT32 ColorLossLevel;
-
-	BYTE* planes[4];
-	BYTE* planesBuffer;
-
-	BYTE* deltaPlanes[4];
-	BYTE* deltaPlanesBuffer;
-
-	BYTE* rlePlanes[4];
-	BYTE* rlePlanesBuffer;
-
-	BYTE* pTempData;
-	UINT32 nTempStep;
-
-	BOOL bgr;
-	BOOL topdown;
-};
-
 static INLINE UINT32 planar_invert_format(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT planar, BOOL alpha,
                                           UINT32 DstFormat)
 {
@@ -159,14 +135,6 @@ static INLINE UINT32 planar_invert_format(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT
 	return DstFormat;
 }
 
-static INLINE BOOL freerdp_bitmap_planar_compress_plane_rle(const BYTE* WINPR_RESTRICT inPlane,
-                                                            UINT32 width, UINT32 height,
-                                                            BYTE* WINPR_RESTRICT outPlane,
-                                                            UINT32* WINPR_RESTRICT dstSize);
-static INLINE BYTE* freerdp_bitmap_planar_delta_encode_plane(const BYTE* WINPR_RESTRICT inPlane,
-                                                             UINT32 width, UINT32 height,
-                                                             BYTE* WINPR_RESTRICT outPlane);
-
 static INLINE INT32 planar_skip_plane_rle(const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize,
                                           UINT32 nWidth, UINT32 nHeight)
 {
@@ -1099,11 +1067,89 @@ BOOL planar_decompress(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT planar,
 	return TRUE;
 }
 
+void planar_split_row32_generic(const BYTE* WINPR_RESTRICT pSrc, UINT32 width,
+                                const BYTE offsets[4], BYTE* WINPR_RESTRICT planes[4])
+{
+	for (size_t i = 0; i < 4; i++)
+	{
+		BYTE* plane = planes[i];
+
+		if (!plane)
+			continue;
+
+		const BYTE* channel = &pSrc[offsets[i]];
+
+		for (UINT32 x = 0; x < width; x++)
+			plane[x] = channel[4ULL * x];
+	}
+}
+
+void planar_delta_encode_row_generic(const BYTE* WINPR_RESTRICT pCur,
+                                     const BYTE* WINPR_RESTRICT pPrev, BYTE* WINPR_RESTRICT pDst,
+                                     UINT32 width)
+{
+	for (UINT32 x = 0; x < width; x++)
+	{
+		/* the decoder wraps around as well, the 8 bit difference is all that is needed */
+		const UINT32 delta = (pCur[x] - pPrev[x]) & 0xFF;
+		const UINT32 sign = (delta & 0x80) ? 0xFF : 0x00;
+		pDst[x] = (BYTE)(((delta << 1) ^ sign) & 0xFF);
+	}
+}
+
+void planar_match_row_generic(const BYTE* WINPR_RESTRICT pSrc, UINT32 width,
+                              UINT64* WINPR_RESTRICT mask)
+{
+	BYTE symbol = 0;
+
+	memset(mask, 0, sizeof(UINT64) * ((width + 63ULL) / 64ULL));
+
+	for (UINT32 x = 0; x < width; x++)
+	{
+		if (pSrc[x] == symbol)
+			mask[x / 64] |= 1ULL << (x % 64);
+
+		symbol = pSrc[x];
+	}
+}
+
+/**
+ * Finds the byte offset of each channel of a 32 bit format in the order of the planes
+ * (alpha, red, green, blue). An offset of 0xFF marks a format without alpha channel.
+ */
+static INLINE BOOL planar_channel_offsets(UINT32 format, BYTE offsets[4])
+{
+	BYTE pixel[4] = { 0 };
+
+	if (FreeRDPGetBytesPerPixel(format) != 4)
+		return FALSE;
+
+	/* alpha is 4, red 1, green 2 and blue 3, modulo 4 that is the plane index */
+	if (!FreeRDPWriteColor(pixel, format, FreeRDPGetColor(format, 1, 2, 3, 4)))
+		return FALSE;
+
+	memset(offsets, 0xFF, 4);
+
+	for (BYTE x = 0; x < ARRAYSIZE(pixel); x++)
+	{
+		if ((pixel[x] >= 1) && (pixel[x] <= 4))
+			offsets[pixel[x] % 4] = x;
+	}
+
+	/* the padding byte of a format without alpha is not read, alpha is 0xFF then */
+	if (!FreeRDPColorHasAlpha(format))
+		offsets[0] = 0xFF;
+
+	return (offsets[1] != 0xFF) && (offsets[2] != 0xFF) && (offsets[3] != 0xFF);
+}
+
 static INLINE BOOL freerdp_split_color_planes(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT planar,
                                               const BYTE* WINPR_RESTRICT data, UINT32 format,
                                               UINT32 width, UINT32 height, UINT32 scanline,
                                               BYTE* WINPR_RESTRICT planes[4])
 {
+	BYTE offsets[4] = { 0 };
+
 	WINPR_ASSERT(planar);
 
 	if ((width > INT32_MAX) || (height > INT32_MAX) || (scanline > INT32_MAX))
@@ -1112,6 +1158,31 @@ static INLINE BOOL freerdp_split_color_planes(BITMAP_PLANAR_CONTEXT* WINPR_RESTR
 	if (scanline == 0)
 		scanline = width * FreeRDPGetBytesPerPixel(format);
 
+	if (planar_channel_offsets(format, offsets))
+	{
+		/* the alpha plane is not sent with PLANAR_FORMAT_HEADER_NA */
+		const BOOL skipAlpha = planar->AllowSkipAlpha;
+		const BOOL fillAlpha = !skipAlpha && (offsets[0] == 0xFF);
+
+		if (fillAlpha)
+			memset(planes[0], 0xFF, 1ULL * width * height);
+
+		for (UINT32 i = 0; i < height; i++)
+		{
+			const UINT32 row = planar->topdown ? i : height - 1 - i;
+			const size_t offset = 1ULL * width * i;
+			BYTE* rowPlanes[4] = { &planes[0][offset], &planes[1][offset], &planes[2][offset],
+				                   &planes[3][offset] };
+
+			if (skipAlpha || fillAlpha)
+				rowPlanes[0] = NULL;
+
+			planar->split_row32(&data[1ULL * scanline * row], width, offsets, rowPlanes);
+		}
+
+		return TRUE;
+	}
+
 	if (planar->topdown)
 	{
 		UINT32 k = 0;
@@ -1268,71 +1339,104 @@ static INLINE UINT32 freerdp_bitmap_planar_write_rle_bytes(const BYTE* WINPR_RES
 	return (UINT32)diff;
 }
 
+static INLINE UINT32 planar_count_trailing_zeros(UINT64 value)
+{
+	WINPR_ASSERT(value != 0);
+
+#if defined(__GNUC__) || defined(__clang__)
+	return (UINT32)__builtin_ctzll(value);
+#else
+	UINT32 count = 0;
+
+	while ((value & 1) == 0)
+	{
+		value >>= 1;
+		count++;
+	}
+
+	return count;
+#endif
+}
+
+/* length of the sequence of bits equal to set starting at bit x, at most width - x */
+static INLINE UINT32 planar_count_bits(const UINT64* WINPR_RESTRICT mask, UINT32 x, UINT32 width,
+                                       BOOL set)
+{
+	UINT32 pos = x;
+
+	while (pos < width)
+	{
+		const UINT64 bits = set ? ~mask[pos / 64] : mask[pos / 64];
+		const UINT64 stop = bits >> (pos % 64);
+
+		if (stop != 0)
+		{
+			pos += planar_count_trailing_zeros(stop);
+			break;
+		}
+
+		pos += 64 - (pos % 64);
+	}
+
+	return MIN(pos, width) - x;
+}
+
+/**
+ * Encodes a scanline from the match mask of planar_match_row_fn, a set bit extends the current
+ * run and a clear bit adds a raw byte. A run shorter than 3 bytes is sent as raw bytes.
+ */
 static INLINE UINT32 freerdp_bitmap_planar_encode_rle_bytes(const BYTE* WINPR_RESTRICT pInBuffer,
+                                                            const UINT64* WINPR_RESTRICT mask,
                                                             UINT32 inBufferSize,
                                                             BYTE* WINPR_RESTRICT pOutBuffer,
                                                             UINT32 outBufferSize)
 {
-	BYTE symbol = 0;
-	const BYTE* pInput = NULL;
-	BYTE* pOutput = NULL;
-	const BYTE* pBytes = NULL;
+	UINT32 x = 0;
 	UINT32 cRawBytes = 0;
 	UINT32 nRunLength = 0;
-	UINT32 bSymbolMatch = 0;
 	UINT32 nBytesWritten = 0;
 	UINT32 nTotalBytesWritten = 0;
-	symbol = 0;
-	cRawBytes = 0;
-	nRunLength = 0;
-	pInput = pInBuffer;
-	pOutput = pOutBuffer;
-	nTotalBytesWritten = 0;
+	BYTE* pOutput = pOutBuffer;
 
 	if (!outBufferSize)
 		return 0;
 
-	do
+	while (x < inBufferSize)
 	{
-		if (!inBufferSize)
-			break;
-
-		bSymbolMatch = (symbol == *pInput) ? TRUE : FALSE;
-		symbol = *pInput;
-		pInput++;
-		inBufferSize--;
+		const UINT32 nRawBytes = planar_count_bits(mask, x, inBufferSize, FALSE);
 
-		if (nRunLength && !bSymbolMatch)
+		if (nRawBytes)
 		{
-			if (nRunLength < 3)
+			if (nRunLength >= 3)
 			{
-				cRawBytes += nRunLength;
-				nRunLength = 0;
-			}
-			else
-			{
-				pBytes = pInput - (cRawBytes + nRunLength + 1);
+				const BYTE* pBytes = &pInBuffer[x - (cRawBytes + nRunLength)];
 				nBytesWritten = freerdp_bitmap_planar_write_rle_bytes(pBytes, cRawBytes, nRunLength,
 				                                                      pOutput, outBufferSize);
-				nRunLength = 0;
 
 				if (!nBytesWritten || (nBytesWritten > outBufferSize))
-					return nRunLength;
+					return 0;
 
 				nTotalBytesWritten += nBytesWritten;
 				outBufferSize -= nBytesWritten;
 				pOutput += nBytesWritten;
 				cRawBytes = 0;
 			}
+			else
+				cRawBytes += nRunLength;
+
+			nRunLength = 0;
+			cRawBytes += nRawBytes;
+			x += nRawBytes;
 		}
 
-		nRunLength += bSymbolMatch;
-		cRawBytes += (!bSymbolMatch) ? TRUE : FALSE;
-	} while (outBufferSize);
+		const UINT32 nMatches = planar_count_bits(mask, x, inBufferSize, TRUE);
+		nRunLength += nMatches;
+		x += nMatches;
+	}
 
 	if (cRawBytes || nRunLength)
 	{
-		pBytes = pInput - (cRawBytes + nRunLength);
+		const BYTE* pBytes = &pInBuffer[inBufferSize - (cRawBytes + nRunLength)];
 		nBytesWritten = freerdp_bitmap_planar_write_rle_bytes(pBytes, cRawBytes, nRunLength,
 		                                                      pOutput, outBufferSize);
 
@@ -1342,36 +1446,32 @@ static INLINE UINT32 freerdp_bitmap_planar_encode_rle_bytes(const BYTE* WINPR_RE
 		nTotalBytesWritten += nBytesWritten;
 	}
 
-	if (inBufferSize)
-		return 0;
-
 	return nTotalBytesWritten;
 }
 
-BOOL freerdp_bitmap_planar_compress_plane_rle(const BYTE* WINPR_RESTRICT inPlane, UINT32 width,
-                                              UINT32 height, BYTE* WINPR_RESTRICT outPlane,
-                                              UINT32* WINPR_RESTRICT dstSize)
+static INLINE BOOL freerdp_bitmap_planar_compress_plane_rle(const BITMAP_PLANAR_CONTEXT* planar,
+                                                            const BYTE* WINPR_RESTRICT inPlane,
+                                                            UINT32 width, UINT32 height,
+                                                            BYTE* WINPR_RESTRICT outPlane,
+                                                            UINT32* WINPR_RESTRICT dstSize)
 {
-	UINT32 index = 0;
-	const BYTE* pInput = NULL;
-	BYTE* pOutput = NULL;
-	UINT32 outBufferSize = 0;
-	UINT32 nBytesWritten = 0;
+	const BYTE* pInput = inPlane;
+	BYTE* pOutput = outPlane;
+	UINT32 outBufferSize = *dstSize;
 	UINT32 nTotalBytesWritten = 0;
 
+	WINPR_ASSERT(planar);
+	WINPR_ASSERT(planar->matchMask);
+
 	if (!outPlane)
 		return FALSE;
 
-	index = 0;
-	pInput = inPlane;
-	pOutput = outPlane;
-	outBufferSize = *dstSize;
-	nTotalBytesWritten = 0;
-
-	while (outBufferSize)
+	for (UINT32 y = 0; y < height; y++)
 	{
-		nBytesWritten =
-		    freerdp_bitmap_planar_encode_rle_bytes(pInput, width, pOutput, outBufferSize);
+		planar->match_row(pInput, width, planar->matchMask);
+
+		const UINT32 nBytesWritten = freerdp_bitmap_planar_encode_rle_bytes(
+		    pInput, planar->matchMask, width, pOutput, outBufferSize);
 
 		if ((!nBytesWritten) || (nBytesWritten > outBufferSize))
 			return FALSE;
@@ -1380,17 +1480,14 @@ BOOL freerdp_bitmap_planar_compress_plane_rle(const BYTE* WINPR_RESTRICT inPlane
 		nTotalBytesWritten += nBytesWritten;
 		pOutput += nBytesWritten;
 		pInput += width;
-		index++;
-
-		if (index >= height)
-			break;
 	}
 
 	*dstSize = nTotalBytesWritten;
 	return TRUE;
 }
 
-static INLINE BOOL freerdp_bitmap_planar_compress_planes_rle(BYTE* WINPR_RESTRICT inPlanes[4],
+static INLINE BOOL freerdp_bitmap_planar_compress_planes_rle(const BITMAP_PLANAR_CONTEXT* planar,
+                                                             BYTE* WINPR_RESTRICT inPlanes[4],
                                                              UINT32 width, UINT32 height,
                                                              BYTE* WINPR_RESTRICT outPlanes,
                                                              UINT32* WINPR_RESTRICT dstSizes,
@@ -1407,8 +1504,8 @@ static INLINE BOOL freerdp_bitmap_planar_compress_planes_rle(BYTE* WINPR_RESTRIC
 	{
 		dstSizes[0] = outPlanesSize;
 
-		if (!freerdp_bitmap_planar_compress_plane_rle(inPlanes[0], width, height, outPlanes,
-		                                              &dstSizes[0]))
+		if (!freerdp_bitmap_planar_compress_plane_rle(planar, inPlanes[0], width, height,
+		                                              outPlanes, &dstSizes[0]))
 			return FALSE;
 
 		outPlanes += dstSizes[0];
@@ -1418,7 +1515,7 @@ static INLINE BOOL freerdp_bitmap_planar_compress_planes_rle(BYTE* WINPR_RESTRIC
 	/* LumaOrRedPlane */
 	dstSizes[1] = outPlanesSize;
 
-	if (!freerdp_bitmap_planar_compress_plane_rle(inPlanes[1], width, height, outPlanes,
+	if (!freerdp_bitmap_planar_compress_plane_rle(planar, inPlanes[1], width, height, outPlanes,
 	                                              &dstSizes[1]))
 		return FALSE;
 
@@ -1427,7 +1524,7 @@ static INLINE BOOL freerdp_bitmap_planar_compress_planes_rle(BYTE* WINPR_RESTRIC
 	/* OrangeChromaOrGreenPlane */
 	dstSizes[2] = outPlanesSize;
 
-	if (!freerdp_bitmap_planar_compress_plane_rle(inPlanes[2], width, height, outPlanes,
+	if (!freerdp_bitmap_planar_compress_plane_rle(planar, inPlanes[2], width, height, outPlanes,
 	                                              &dstSizes[2]))
 		return FALSE;
 
@@ -1436,62 +1533,46 @@ static INLINE BOOL freerdp_bitmap_planar_compress_planes_rle(BYTE* WINPR_RESTRIC
 	/* GreenChromeOrBluePlane */
 	dstSizes[3] = outPlanesSize;
 
-	if (!freerdp_bitmap_planar_compress_plane_rle(inPlanes[3], width, height, outPlanes,
+	if (!freerdp_bitmap_planar_compress_plane_rle(planar, inPlanes[3], width, height, outPlanes,
 	                                              &dstSizes[3]))
 		return FALSE;
 
 	return TRUE;
 }
 
-BYTE* freerdp_bitmap_planar_delta_encode_plane(const BYTE* WINPR_RESTRICT inPlane, UINT32 width,
-                                               UINT32 height, BYTE* WINPR_RESTRICT outPlane)
+static INLINE BOOL freerdp_bitmap_planar_delta_encode_plane(const BITMAP_PLANAR_CONTEXT* planar,
+                                                            const BYTE* WINPR_RESTRICT inPlane,
+                                                            UINT32 width, UINT32 height,
+                                                            BYTE* WINPR_RESTRICT outPlane)
 {
-	BYTE* outPtr = NULL;
-	const BYTE* srcPtr = NULL;
-	const BYTE* prevLinePtr = NULL;
-
-	if (!outPlane)
-	{
-		if (width * height == 0)
-			return NULL;
+	WINPR_ASSERT(planar);
 
-		if (!(outPlane = (BYTE*)calloc(height, width)))
-			return NULL;
-	}
+	if (!inPlane || !outPlane || (height == 0))
+		return FALSE;
 
 	// first line is copied as is
 	CopyMemory(outPlane, inPlane, width);
-	outPtr = outPlane + width;
-	srcPtr = inPlane + width;
-	prevLinePtr = inPlane;
 
 	for (UINT32 y = 1; y < height; y++)
 	{
-		for (UINT32 x = 0; x < width; x++, outPtr++, srcPtr++, prevLinePtr++)
-		{
-			INT32 delta = *srcPtr - *prevLinePtr;
-			BYTE s2c = WINPR_ASSERTING_INT_CAST(
-			    BYTE, (delta >= 0) ? delta : (~((BYTE)(-delta)) + 1) & 0xFF);
-			s2c = WINPR_ASSERTING_INT_CAST(
-			    BYTE,
-			    (s2c >= 0) ? (s2c << 1) & 0xFF : (((UINT32)(~((BYTE)s2c) + 1) << 1) - 1) & 0xFF);
-			*outPtr = s2c;
-		}
+		const size_t offset = 1ULL * width * y;
+		planar->delta_encode_row(&inPlane[offset], &inPlane[offset - width], &outPlane[offset],
+		                         width);
 	}
 
-	return outPlane;
+	return TRUE;
 }
 
-static INLINE BOOL freerdp_bitmap_planar_delta_encode_planes(BYTE* WINPR_RESTRICT inPlanes[4],
+static INLINE BOOL freerdp_bitmap_planar_delta_encode_planes(const BITMAP_PLANAR_CONTEXT* planar,
+                                                             BYTE* WINPR_RESTRICT inPlanes[4],
                                                              UINT32 width, UINT32 height,
-                                                             BYTE* WINPR_RESTRICT outPlanes[4])
+                                                             BYTE* WINPR_RESTRICT outPlanes[4],
+                                                             BOOL skipAlpha)
 {
-	for (UINT32 i = 0; i < 4; i++)
+	for (UINT32 i = skipAlpha ? 1 : 0; i < 4; i++)
 	{
-		outPlanes[i] =
-		    freerdp_bitmap_planar_delta_encode_plane(inPlanes[i], width, height, outPlanes[i]);
-
-		if (!outPlanes[i])
+		if (!freerdp_bitmap_planar_delta_encode_plane(planar, inPlanes[i], width, height,
+		                                              outPlanes[i]))
 			return FALSE;
 	}
 
@@ -1515,6 +1596,9 @@ BYTE* freerdp_bitmap_compress_planar(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT conte
 	if (context->AllowSkipAlpha)
 		FormatHeader |= PLANAR_FORMAT_HEADER_NA;
 
+	if ((1ULL * width * height) > context->maxPlaneSize)
+		return NULL;
+
 	planeSize = width * height;
 
 	if (!context->AllowSkipAlpha)
@@ -1526,15 +1610,15 @@ BYTE* freerdp_bitmap_compress_planar(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT conte
 
 	if (context->AllowRunLengthEncoding)
 	{
-		if (!freerdp_bitmap_planar_delta_encode_planes(context->planes, width, height,
-		                                               context->deltaPlanes))
-			return NULL;
-
-		if (!freerdp_bitmap_planar_compress_planes_rle(context->deltaPlanes, width, height,
-		                                               context->rlePlanesBuffer, dstSizes,
+		if (!freerdp_bitmap_planar_delta_encode_planes(context, context->planes, width, height,
+		                                               context->deltaPlanes,
 		                                               context->AllowSkipAlpha))
 			return NULL;
 
+		/* planes not fitting into the RLE buffer are sent uncompressed */
+		if (freerdp_bitmap_planar_compress_planes_rle(context, context->deltaPlanes, width,
+		                                              height, context->rlePlanesBuffer, dstSizes,
+		                                              context->AllowSkipAlpha))
 		{
 			uint32_t offset = 0;
 			FormatHeader |= PLANAR_FORMAT_HEADER_RLE;
@@ -1725,6 +1809,13 @@ BOOL freerdp_bitmap_planar_context_reset(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT c
 			return FALSE;
 		context->rlePlanesBuffer = tmp;
 
+		/* a scanline is at most maxPlaneSize bytes long */
+		tmp = winpr_aligned_recalloc(context->matchMask, (context->maxPlaneSize + 63ULL) / 64ULL,
+		                             sizeof(UINT64), 32);
+		if (!tmp)
+			return FALSE;
+		context->matchMask = tmp;
+
 		context->planes[0] = &context->planesBuffer[0ULL * context->maxPlaneSize];
 		context->planes[1] = &context->planesBuffer[1ULL * context->maxPlaneSize];
 		context->planes[2] = &context->planesBuffer[2ULL * context->maxPlaneSize];
@@ -1760,6 +1851,15 @@ BITMAP_PLANAR_CONTEXT* freerdp_bitmap_planar_context_new(DWORD flags, UINT32 max
 	if (context->ColorLossLevel)
 		context->AllowDynamicColorFidelity = TRUE;
 
+	context->split_row32 = planar_split_row32_generic;
+	context->delta_encode_row = planar_delta_encode_row_generic;
+	context->match_row = planar_match_row_generic;
+	planar_init_sse4_1(context);
+#if defined(WITH_AVX2)
+	planar_init_avx2(context);
+#endif
+	planar_init_neon(context);
+
 	if (!freerdp_bitmap_planar_context_reset(context, maxWidth, maxHeight))
 	{
 		WINPR_PRAGMA_DIAG_PUSH
@@ -1781,6 +1881,7 @@ void freerdp_bitmap_planar_context_free(BITMAP_PLANAR_CONTEXT* context)
 	winpr_aligned_free(context->planesBuffer);
 	winpr_aligned_free(context->deltaPlanesBuffer);
 	winpr_aligned_free(context->rlePlanesBuffer);
+	winpr_aligned_free(context->matchMask);
 	winpr_aligned_free(context);
 }
 
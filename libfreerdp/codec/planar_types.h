@@ -0,0 +1,98 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * RDP6 Planar Codec
+ *
+ * Copyright 2013 Marc-Andre Moreau <marcandre.moreau@gmail.com>
+ * Copyright 2016 Armin Novak <armin.novak@thincast.com>
+ * Copyright 2016 Thincast Technologies GmbH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CODEC_PLANAR_TYPES_H
+#define FREERDP_LIB_CODEC_PLANAR_TYPES_H
+
+#include <freerdp/config.h>
+
+#include <winpr/wtypes.h>
+
+#include <freerdp/api.h>
+#include <freerdp/codec/planar.h>
+
+/**
+ * Copies byte offsets[i] of each 32 bit pixel to planes[i][x], a NULL plane is skipped.
+ */
+typedef void (*planar_split_row32_fn)(const BYTE* WINPR_RESTRICT pSrc, UINT32 width,
+                                      const BYTE offsets[4], BYTE* WINPR_RESTRICT planes[4]);
+
+/**
+ * Encodes the difference to the previous scanline as a sign-magnitude byte,
+ * (delta << 1) for delta >= 0 and ((-delta) << 1) - 1 otherwise.
+ */
+typedef void (*planar_delta_encode_row_fn)(const BYTE* WINPR_RESTRICT pCur,
+                                           const BYTE* WINPR_RESTRICT pPrev,
+                                           BYTE* WINPR_RESTRICT pDst, UINT32 width);
+
+/**
+ * Sets bit x of mask if pSrc[x] equals pSrc[x - 1], pSrc[-1] is taken as 0.
+ * All (width + 63) / 64 words are written, the bits past width are 0.
+ */
+typedef void (*planar_match_row_fn)(const BYTE* WINPR_RESTRICT pSrc, UINT32 width,
+                                    UINT64* WINPR_RESTRICT mask);
+
+struct S_BITMAP_PLANAR_CONTEXT
+{
+	UINT32 maxWidth;
+	UINT32 maxHeight;
+	UINT32 maxPlaneSize;
+
+	BOOL AllowSkipAlpha;
+	BOOL AllowRunLengthEncoding;
+	BOOL AllowColorSubsampling;
+	BOOL AllowDynamicColorFidelity;
+
+	UINT32 ColorLossLevel;
+
+	BYTE* planes[4];
+	BYTE* planesBuffer;
+
+	BYTE* deltaPlanes[4];
+	BYTE* deltaPlanesBuffer;
+
+	BYTE* rlePlanes[4];
+	BYTE* rlePlanesBuffer;
+
+	BYTE* pTempData;
+	UINT32 nTempStep;
+
+	UINT64* matchMask;
+
+	BOOL bgr;
+	BOOL topdown;
+
+	/* encoder kernels, replaced by SIMD variants where available */
+	planar_split_row32_fn split_row32;
+	planar_delta_encode_row_fn delta_encode_row;
+	planar_match_row_fn match_row;
+};
+
+FREERDP_LOCAL void planar_split_row32_generic(const BYTE* WINPR_RESTRICT pSrc, UINT32 width,
+                                              const BYTE offsets[4],
+                                              BYTE* WINPR_RESTRICT planes[4]);
+FREERDP_LOCAL void planar_delta_encode_row_generic(const BYTE* WINPR_RESTRICT pCur,
+                                                   const BYTE* WINPR_RESTRICT pPrev,
+                                                   BYTE* WINPR_RESTRICT pDst, UINT32 width);
+FREERDP_LOCAL void planar_match_row_generic(const BYTE* WINPR_RESTRICT pSrc, UINT32 width,
+                                            UINT64* WINPR_RESTRICT mask);
+
+#endif /* FREERDP_LIB_CODEC_PLANAR_TYPES_H */
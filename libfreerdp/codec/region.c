@@ -71,6 +71,7 @@
 struct S_REGION16_DATA
 {
 	size_t nbRects;
+	size_t capacity;
 	RECTANGLE_16* rects;
 };
 
@@ -221,25 +222,42 @@ static REGION16_DATA* allocateRegion(size_t nbItems)
 	}
 
 	data->nbRects = nbItems;
+	data->capacity = nbItems;
 	return data;
 }
 
+/** grows the rectangle array to hold at least nbItems, doubling to keep appends amortized */
+static BOOL reserveRects(REGION16_DATA* data, size_t nbItems)
+{
+	WINPR_ASSERT(data);
+
+	if (nbItems <= data->capacity)
+		return TRUE;
+
+	const size_t capacity = MAX(MAX(nbItems, 2 * data->capacity), 16);
+	RECTANGLE_16* rects = realloc(data->rects, capacity * sizeof(RECTANGLE_16));
+	if (!rects)
+		return FALSE;
+
+	data->rects = rects;
+	data->capacity = capacity;
+	return TRUE;
+}
+
 static inline RECTANGLE_16* nextRect(REGION16_DATA* data, size_t index)
 {
 	WINPR_ASSERT(data);
 	if (index + 1 > data->nbRects)
 	{
-		RECTANGLE_16* rects = realloc(data->rects, (index + 1) * sizeof(RECTANGLE_16));
-		if (!rects)
+		if (!reserveRects(data, index + 1))
 		{
 			freeRegion(data);
 			return NULL;
 		}
 
 		const RECTANGLE_16 empty = { 0 };
-		rects[index] = empty;
+		data->rects[index] = empty;
 		data->nbRects = index + 1;
-		data->rects = rects;
 	}
 	return &data->rects[index];
 }
@@ -260,21 +278,28 @@ static BOOL resizeRegion(REGION16* region, size_t nbItems)
 		return region->data != NULL;
 	}
 
-	RECTANGLE_16* rects = realloc(region->data->rects, nbItems * sizeof(RECTANGLE_16));
-	if (!rects)
+	/* shrinking keeps the allocation, it is reused by the next in place union */
+	if (nbItems > region->data->capacity)
 	{
-		free(region->data->rects);
-		region->data->nbRects = 0;
-		region->data->rects = NULL;
-		return FALSE;
+		RECTANGLE_16* rects = realloc(region->data->rects, nbItems * sizeof(RECTANGLE_16));
+		if (!rects)
+		{
+			free(region->data->rects);
+			region->data->nbRects = 0;
+			region->data->capacity = 0;
+			region->data->rects = NULL;
+			return FALSE;
+		}
+
+		region->data->rects = rects;
+		region->data->capacity = nbItems;
 	}
 
 	for (size_t x = region->data->nbRects; x < nbItems; x++)
 	{
 		const RECTANGLE_16 empty = { 0 };
-		rects[x] = empty;
+		region->data->rects[x] = empty;
 	}
-	region->data->rects = rects;
 	region->data->nbRects = nbItems;
 	return TRUE;
 }
@@ -573,6 +598,115 @@ static BOOL region16_simplify_bands(REGION16* region)
 	return TRUE;
 }
 
+/** returns the first rectangle of the band ending at endPtr */
+static RECTANGLE_16* band_start(RECTANGLE_16* first, RECTANGLE_16* endPtr)
+{
+	WINPR_ASSERT(first);
+	WINPR_ASSERT(endPtr > first);
+
+	RECTANGLE_16* band = endPtr - 1;
+
+	while ((band > first) && ((band - 1)->top == band->top))
+		band--;
+
+	return band;
+}
+
+/** compute if the rectangle is fully included in a single rectangle of the region */
+static BOOL region16_contains_rect(const REGION16* region, const RECTANGLE_16* rect)
+{
+	UINT32 nbRects = 0;
+	const RECTANGLE_16* extents = region16_extents(region);
+
+	if ((rect->left < extents->left) || (rect->top < extents->top) ||
+	    (rect->right > extents->right) || (rect->bottom > extents->bottom))
+		return FALSE;
+
+	const RECTANGLE_16* band = region16_rects(region, &nbRects);
+	const RECTANGLE_16* endPtr = band + nbRects;
+
+	while ((band < endPtr) && (band->top <= rect->top))
+	{
+		const UINT16 refY = band->top;
+
+		if (rectangle_contained_in_band(band, endPtr, rect))
+			return TRUE;
+
+		while ((band < endPtr) && (band->top == refY))
+			band++;
+	}
+
+	return FALSE;
+}
+
+/** adds a rectangle that starts at or below the bottom of the region, in place */
+static BOOL region16_append_below(REGION16* region, const RECTANGLE_16* rect)
+{
+	REGION16_DATA* data = region->data;
+	RECTANGLE_16* endPtr = &data->rects[data->nbRects];
+	RECTANGLE_16* band = band_start(data->rects, endPtr);
+
+	if ((endPtr - band == 1) && (band->bottom == rect->top) && (band->left == rect->left) &&
+	    (band->right == rect->right))
+		band->bottom = rect->bottom;
+	else
+	{
+		if (!reserveRects(data, data->nbRects + 1))
+			return FALSE;
+
+		data->rects[data->nbRects++] = *rect;
+	}
+
+	region->extents.left = MIN(region->extents.left, rect->left);
+	region->extents.right = MAX(region->extents.right, rect->right);
+	region->extents.bottom = rect->bottom;
+	return TRUE;
+}
+
+/** adds a rectangle right of the last band with the same top and bottom, in place */
+static BOOL region16_append_right(REGION16* region, const RECTANGLE_16* rect)
+{
+	REGION16_DATA* data = region->data;
+	RECTANGLE_16* last = &data->rects[data->nbRects - 1];
+
+	if (rect->left == last->right)
+		last->right = rect->right;
+	else
+	{
+		if (!reserveRects(data, data->nbRects + 1))
+			return FALSE;
+
+		data->rects[data->nbRects++] = *rect;
+	}
+
+	region->extents.right = MAX(region->extents.right, rect->right);
+
+	/* the grown band may now match the one above it */
+	RECTANGLE_16* endPtr = &data->rects[data->nbRects];
+	RECTANGLE_16* band = band_start(data->rects, endPtr);
+
+	if (band == data->rects)
+		return TRUE;
+
+	RECTANGLE_16* previous = band_start(data->rects, band);
+	const size_t bandItems = WINPR_ASSERTING_INT_CAST(size_t, endPtr - band);
+
+	if ((previous->bottom != band->top) || (band - previous != endPtr - band))
+		return TRUE;
+
+	for (size_t x = 0; x < bandItems; x++)
+	{
+		if ((previous[x].left != band[x].left) || (previous[x].right != band[x].right))
+			return TRUE;
+	}
+
+	for (size_t x = 0; x < bandItems; x++)
+		previous[x].bottom = band->bottom;
+
+	data->nbRects -= bandItems;
+	return TRUE;
+}
+
 BOOL region16_union_rect(REGION16* dst, const REGION16* src, const RECTANGLE_16* rect)
 {
 	const RECTANGLE_16* nextBand = NULL;
@@ -604,6 +738,22 @@ BOOL region16_union_rect(REGION16* dst, const REGION16* src, const RECTANGLE_16*
 		return TRUE;
 	}
 
+	/* accumulating dirty rectangles mostly hits one of these, they work without a copy */
+	if ((dst == src) && !rectangle_is_empty(rect))
+	{
+		const RECTANGLE_16* lastRect = &dst->data->rects[dst->data->nbRects - 1];
+
+		if (rect->top >= srcExtents->bottom)
+			return region16_append_below(dst, rect);
+
+		if ((rect->top == lastRect->top) && (rect->bottom == lastRect->bottom) &&
+		    (rect->left >= lastRect->right))
+			return region16_append_right(dst, rect);
+
+		if (region16_contains_rect(dst, rect))
+			return TRUE;
+	}
+
 	REGION16_DATA* newItems = allocateRegion(WINPR_ASSERTING_INT_CAST(size_t, nrSrcRects + 1));
 
 	if (!newItems)
@@ -765,6 +915,223 @@ BOOL region16_union_rect(REGION16* dst, const REGION16* src, const RECTANGLE_16*
 	return region16_simplify_bands(dst);
 }
 
+#define UNION_RECTS_CHUNK 64
+
+static int region16_compare_rects(const void* pa, const void* pb)
+{
+	const RECTANGLE_16* a = pa;
+	const RECTANGLE_16* b = pb;
+
+	if (a->top != b->top)
+		return (a->top < b->top) ? -1 : 1;
+
+	if (a->left != b->left)
+		return (a->left < b->left) ? -1 : 1;
+
+	return 0;
+}
+
+static BOOL appendRect(REGION16_DATA* data, const RECTANGLE_16* rect)
+{
+	if (!reserveRects(data, data->nbRects + 1))
+		return FALSE;
+
+	data->rects[data->nbRects++] = *rect;
+	return TRUE;
+}
+
+static BOOL region16_sweep_union(REGION16* dst, const REGION16* src, const RECTANGLE_16* rects,
+                                 size_t count)
+{
+	BOOL rc = FALSE;
+	UINT32 nbSrcRects = 0;
+	size_t nbItems = 0;
+	size_t nbActive = 0;
+	size_t next = 0;
+	size_t previousBand = 0;
+	size_t previousItems = 0;
+	UINT16 y = 0;
+
+	WINPR_ASSERT(dst);
+	WINPR_ASSERT(src);
+	WINPR_ASSERT(rects || (count == 0));
+
+	const RECTANGLE_16* srcRects = region16_rects(src, &nbSrcRects);
+	RECTANGLE_16* items = calloc(nbSrcRects + count + 1, sizeof(RECTANGLE_16));
+	const RECTANGLE_16** active = calloc(nbSrcRects + count + 1, sizeof(RECTANGLE_16*));
+	REGION16_DATA* newItems = allocateRegion(0);
+
+	if (!items || !active || !newItems)
+		goto fail;
+
+	if (nbSrcRects > 0)
+		memcpy(items, srcRects, nbSrcRects * sizeof(RECTANGLE_16));
+	nbItems = nbSrcRects;
+
+	for (size_t x = 0; x < count; x++)
+	{
+		if (!rectangle_is_empty(&rects[x]))
+			items[nbItems++] = rects[x];
+	}
+
+	if (nbItems == nbSrcRects)
+	{
+		rc = region16_copy(dst, src);
+		goto fail;
+	}
+
+	qsort(items, nbItems, sizeof(RECTANGLE_16), region16_compare_rects);
+
+	/* sweep from top to bottom, a band ends wherever a rectangle starts or ends */
+	while ((next < nbItems) || (nbActive > 0))
+	{
+		if (nbActive == 0)
+			y = items[next].top;
+
+		/* the active rectangles are kept sorted by left */
+		while ((next < nbItems) && (items[next].top == y))
+		{
+			const RECTANGLE_16* item = &items[next++];
+			size_t pos = nbActive++;
+
+			while ((pos > 0) && (active[pos - 1]->left > item->left))
+			{
+				active[pos] = active[pos - 1];
+				pos--;
+			}
+
+			active[pos] = item;
+		}
+
+		UINT16 bottom = (next < nbItems) ? items[next].top : UINT16_MAX;
+
+		for (size_t x = 0; x < nbActive; x++)
+			bottom = MIN(bottom, active[x]->bottom);
+
+		/* items of a band must not overlap or touch */
+		const size_t bandStart = newItems->nbRects;
+		RECTANGLE_16 current = { active[0]->left, y, active[0]->right, bottom };
+
+		for (size_t x = 1; x < nbActive; x++)
+		{
+			if (active[x]->left <= current.right)
+				current.right = MAX(current.right, active[x]->right);
+			else
+			{
+				if (!appendRect(newItems, &current))
+					goto fail;
+
+				current.left = active[x]->left;
+				current.right = active[x]->right;
+			}
+		}
+
+		if (!appendRect(newItems, &current))
+			goto fail;
+
+		const size_t bandItems = newItems->nbRects - bandStart;
+		RECTANGLE_16* band = &newItems->rects[bandStart];
+		RECTANGLE_16* previous = &newItems->rects[previousBand];
+		BOOL merge = (bandStart > 0) && (previousItems == bandItems) && (previous->bottom == y);
+
+		for (size_t x = 0; merge && (x < bandItems); x++)
+		{
+			if ((previous[x].left != band[x].left) || (previous[x].right != band[x].right))
+				merge = FALSE;
+		}
+
+		if (merge)
+		{
+			for (size_t x = 0; x < bandItems; x++)
+				previous[x].bottom = bottom;
+
+			newItems->nbRects = bandStart;
+		}
+		else
+		{
+			previousBand = bandStart;
+			previousItems = bandItems;
+		}
+
+		size_t kept = 0;
+
+		for (size_t x = 0; x < nbActive; x++)
+		{
+			if (active[x]->bottom > bottom)
+				active[kept++] = active[x];
+		}
+
+		nbActive = kept;
+		y = bottom;
+	}
+
+	RECTANGLE_16 extents = newItems->rects[0];
+	extents.bottom = newItems->rects[newItems->nbRects - 1].bottom;
+
+	for (size_t x = 1; x < newItems->nbRects; x++)
+	{
+		extents.left = MIN(extents.left, newItems->rects[x].left);
+		extents.right = MAX(extents.right, newItems->rects[x].right);
+	}
+
+	freeRegion(dst->data);
+	dst->data = newItems;
+	dst->extents = extents;
+	newItems = NULL;
+	rc = TRUE;
+
+fail:
+	freeRegion(newItems);
+	free(active);
+	free(items);
+	return rc;
+}
+
+BOOL region16_union_rects(REGION16* dst, const REGION16* src, const RECTANGLE_16* rects,
+                          size_t count)
+{
+	BOOL rc = FALSE;
+	REGION16 chunk = { 0 };
+	const REGION16* current = src;
+
+	WINPR_ASSERT(dst);
+	WINPR_ASSERT(src);
+	WINPR_ASSERT(rects || (count == 0));
+
+	if ((count == 1) && !rectangle_is_empty(rects))
+		return region16_union_rect(dst, src, rects);
+
+	if (count <= UNION_RECTS_CHUNK)
+		return region16_sweep_union(dst, src, rects, count);
+
+	/* the sweep slows down with the number of overlapping rectangles, merging the
+	 * union of each chunk keeps that number low */
+	region16_init(&chunk);
+
+	for (size_t x = 0; x < count; x += UNION_RECTS_CHUNK)
+	{
+		UINT32 nbChunkRects = 0;
+		const size_t nbRects = MIN(count - x, UNION_RECTS_CHUNK);
+
+		region16_clear(&chunk);
+
+		if (!region16_sweep_union(&chunk, &chunk, &rects[x], nbRects))
+			goto fail;
+
+		const RECTANGLE_16* chunkRects = region16_rects(&chunk, &nbChunkRects);
+
+		if (!region16_sweep_union(dst, current, chunkRects, nbChunkRects))
+			goto fail;
+
+		current = dst;
+	}
+
+	rc = TRUE;
+fail:
+	region16_uninit(&chunk);
+	return rc;
+}
+
 BOOL region16_intersects_rect(const REGION16* src, const RECTANGLE_16* arg2)
 {
 	const RECTANGLE_16* endPtr = NULL;
@@ -49,6 +49,7 @@
 #include "rfx_rlgr.h"
 
 #include "sse/rfx_sse2.h"
+#include "sse/rfx_avx2.h"
 #include "neon/rfx_neon.h"
 
 #define TAG FREERDP_TAG("codec")
@@ -333,6 +334,9 @@ RFX_CONTEXT* rfx_context_new_ex(BOOL encoder, UINT32 ThreadingFlags)
 	context->rlgr_decode = rfx_rlgr_decode;
 	context->rlgr_encode = rfx_rlgr_encode;
 	rfx_init_sse2(context);
+#if defined(WITH_AVX2)
+	rfx_init_avx2(context);
+#endif
 	rfx_init_neon(context);
 	context->state = RFX_STATE_SEND_HEADERS;
 	context->expectedDataBlockType = WBT_FRAME_BEGIN;
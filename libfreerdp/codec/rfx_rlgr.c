@@ -33,11 +33,8 @@
 #include <winpr/crt.h>
 #include <winpr/print.h>
 #include <winpr/sysinfo.h>
-#include <winpr/bitstream.h>
 #include <winpr/intrin.h>
 
-#include "rfx_bitstream.h"
-
 #include "rfx_rlgr.h"
 
 /* Constants used in RLGR1/RLGR3 algorithm */
@@ -84,8 +81,14 @@ static inline uint32_t UpdateParam(uint32_t* param, int32_t deltaP)
 	return (*param) >> LSGR;
 }
 
+/* number of 0 bits in RL mode after which kp is saturated at KPMAX from any start value */
+#define RLGR_RUN_STEPS (KPMAX / UP_GR)
+
 static BOOL g_LZCNT = FALSE;
 
+/* run length of vk leading 0 bits in RL mode, indexed by [kp][vk] */
+static UINT32 rfx_rlgr_run_length[KPMAX + 1][RLGR_RUN_STEPS + 1] = { 0 };
+
 static INIT_ONCE rfx_rlgr_init_once = INIT_ONCE_STATIC_INIT;
 
 static BOOL CALLBACK rfx_rlgr_init(PINIT_ONCE once, PVOID param, PVOID* context)
@@ -95,6 +98,16 @@ static BOOL CALLBACK rfx_rlgr_init(PINIT_ONCE once, PVOID param, PVOID* context)
 	WINPR_UNUSED(context);
 
 	g_LZCNT = IsProcessorFeaturePresentEx(PF_EX_LZCNT);
+
+	for (UINT32 kp = 0; kp <= KPMAX; kp++)
+	{
+		for (UINT32 vk = 0; vk < RLGR_RUN_STEPS; vk++)
+		{
+			const UINT32 k = MIN(kp + vk * UP_GR, KPMAX) >> LSGR;
+			rfx_rlgr_run_length[kp][vk + 1] = rfx_rlgr_run_length[kp][vk] + (1u << k);
+		}
+	}
+
 	return TRUE;
 }
 
@@ -149,221 +162,229 @@ static INLINE UINT32 lzcnt_s(UINT32 x)
 	return __lzcnt(x);
 }
 
-int rfx_rlgr_decode(RLGR_MODE mode, const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize,
-                    INT16* WINPR_RESTRICT pDstData, UINT32 rDstSize)
+static INLINE UINT32 lzcnt64_s(UINT64 x)
 {
-	uint32_t vk = 0;
-	size_t run = 0;
-	size_t cnt = 0;
-	size_t size = 0;
-	size_t offset = 0;
-	INT16 mag = 0;
-	UINT32 k = 0;
-	UINT32 kp = 0;
-	UINT32 kr = 0;
-	UINT32 krp = 0;
-	UINT16 code = 0;
-	UINT32 sign = 0;
-	UINT32 nIdx = 0;
-	UINT32 val1 = 0;
-	UINT32 val2 = 0;
-	INT16* pOutput = NULL;
-	wBitStream* bs = NULL;
-	wBitStream s_bs = { 0 };
-	const SSIZE_T DstSize = rDstSize;
+	const UINT32 hi = (UINT32)(x >> 32);
 
-	InitOnceExecuteOnce(&rfx_rlgr_init_once, rfx_rlgr_init, NULL, NULL);
+	if (hi)
+		return lzcnt_s(hi);
+	return 32 + lzcnt_s((UINT32)x);
+}
 
-	k = 1;
-	kp = k << LSGR;
+/*
+ * Big endian bit reader with a 64 bit accumulator. The next unread bit is the MSB of acc,
+ * avail bits of acc are valid. Bits past the end of the input read as 0.
+ */
+typedef struct
+{
+	const BYTE* data;
+	size_t size;
+	size_t next;
+	UINT64 acc;
+	UINT32 avail;
+	UINT64 left;
+} RFX_RLGR_READER;
+
+static INLINE void rfx_rlgr_reader_init(RFX_RLGR_READER* r, const BYTE* data, UINT32 size)
+{
+	r->data = data;
+	r->size = size;
+	r->next = 0;
+	r->acc = 0;
+	r->avail = 0;
+	r->left = 8ull * size;
+}
 
-	kr = 1;
-	krp = kr << LSGR;
+static INLINE void rfx_rlgr_reader_refill(RFX_RLGR_READER* r)
+{
+	if ((r->avail <= 56) && (r->next + 8 <= r->size))
+	{
+		const BYTE* p = &r->data[r->next];
+		const UINT64 v = ((UINT64)p[0] << 56) | ((UINT64)p[1] << 48) | ((UINT64)p[2] << 40) |
+		                 ((UINT64)p[3] << 32) | ((UINT64)p[4] << 24) | ((UINT64)p[5] << 16) |
+		                 ((UINT64)p[6] << 8) | (UINT64)p[7];
+
+		/* the bits of a partially loaded byte are stored again with the next refill */
+		r->acc |= v >> r->avail;
+		r->next += (63 - r->avail) >> 3;
+		r->avail |= 56;
+	}
+	else
+	{
+		while ((r->avail <= 55) && (r->next < r->size))
+		{
+			r->acc |= (UINT64)r->data[r->next++] << (56 - r->avail);
+			r->avail += 8;
+		}
+	}
+}
 
-	if ((mode != RLGR1) && (mode != RLGR3))
-		mode = RLGR1;
+static INLINE void rfx_rlgr_reader_skip(RFX_RLGR_READER* r, UINT32 nbits)
+{
+	WINPR_ASSERT(nbits <= r->avail);
+	WINPR_ASSERT(nbits < 64);
 
-	if (!pSrcData || !SrcSize)
-		return -1;
+	r->acc <<= nbits;
+	r->avail -= nbits;
+	r->left -= nbits;
+}
 
-	if (!pDstData || !DstSize)
-		return -1;
+/* read nbits (0 to 32), the caller checks there are enough bits left */
+static INLINE UINT32 rfx_rlgr_reader_get(RFX_RLGR_READER* r, UINT32 nbits)
+{
+	if (nbits == 0)
+		return 0;
 
-	pOutput = pDstData;
+	if (r->avail < nbits)
+		rfx_rlgr_reader_refill(r);
 
-	bs = &s_bs;
+	const UINT32 val = (UINT32)(r->acc >> (64 - nbits));
+	rfx_rlgr_reader_skip(r, nbits);
+	return val;
+}
 
-	BitStream_Attach(bs, pSrcData, SrcSize);
-	BitStream_Fetch(bs);
+/* count and skip a run of bits equal to bit, stops at the end of the input */
+static INLINE UINT64 rfx_rlgr_reader_run(RFX_RLGR_READER* r, BOOL bit)
+{
+	UINT64 count = 0;
 
-	while ((BitStream_GetRemainingLength(bs) > 0) && ((pOutput - pDstData) < DstSize))
+	for (;;)
 	{
-		if (k)
-		{
-			/* Run-Length (RL) Mode */
+		if (r->avail < 32)
+			rfx_rlgr_reader_refill(r);
 
-			run = 0;
+		if (r->avail == 0)
+			break;
 
-			/* count number of leading 0s */
+		const UINT64 mask = UINT64_MAX << (64 - r->avail);
+		const UINT64 bits = (bit ? ~r->acc : r->acc) & mask;
 
-			cnt = lzcnt_s(bs->accumulator);
+		if (bits)
+		{
+			const UINT32 cnt = lzcnt64_s(bits);
+			rfx_rlgr_reader_skip(r, cnt);
+			return count + cnt;
+		}
 
-			size_t nbits = BitStream_GetRemainingLength(bs);
+		count += r->avail;
+		rfx_rlgr_reader_skip(r, r->avail);
+	}
 
-			if (cnt > nbits)
-				cnt = WINPR_ASSERTING_INT_CAST(uint32_t, nbits);
+	return count;
+}
 
-			vk = WINPR_ASSERTING_INT_CAST(uint32_t, cnt);
+/* krp update after a GR code with vk leading 1s */
+static INLINE UINT32 rfx_rlgr_update_krp(UINT32 krp, UINT64 vk)
+{
+	if (!vk)
+		return (krp > 2) ? krp - 2 : 0;
+	if (vk == 1)
+		return krp;
+	return (UINT32)MIN(krp + vk, KPMAX);
+}
 
-			while ((cnt == 32) && (BitStream_GetRemainingLength(bs) > 0))
-			{
-				BitStream_Shift32(bs);
+static INLINE INT16 rfx_rlgr_2mag_sign(UINT32 val)
+{
+	if (val & 1)
+		return WINPR_ASSERTING_INT_CAST(INT16, (val + 1) >> 1) * -1;
+	return WINPR_ASSERTING_INT_CAST(INT16, val >> 1);
+}
 
-				cnt = lzcnt_s(bs->accumulator);
+int rfx_rlgr_decode(RLGR_MODE mode, const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize,
+                    INT16* WINPR_RESTRICT pDstData, UINT32 rDstSize)
+{
+	UINT32 kp = 1 << LSGR;
+	UINT32 k = kp >> LSGR;
+	UINT32 krp = 1 << LSGR;
+	UINT32 kr = krp >> LSGR;
+	RFX_RLGR_READER r = { 0 };
 
-				nbits = BitStream_GetRemainingLength(bs);
+	InitOnceExecuteOnce(&rfx_rlgr_init_once, rfx_rlgr_init, NULL, NULL);
 
-				if (cnt > nbits)
-					cnt = nbits;
+	if ((mode != RLGR1) && (mode != RLGR3))
+		mode = RLGR1;
 
-				WINPR_ASSERT(cnt + vk <= UINT32_MAX);
-				vk += WINPR_ASSERTING_INT_CAST(uint32_t, cnt);
-			}
+	if (!pSrcData || !SrcSize)
+		return -1;
 
-			BitStream_Shift(bs, (vk % 32));
+	if (!pDstData || !rDstSize)
+		return -1;
 
-			if (BitStream_GetRemainingLength(bs) < 1)
-				break;
+	INT16* pOutput = pDstData;
+	const INT16* pEnd = &pDstData[rDstSize];
 
-			BitStream_Shift(bs, 1);
+	rfx_rlgr_reader_init(&r, pSrcData, SrcSize);
 
-			while (vk--)
-			{
-				const UINT32 add = (1 << k); /* add (1 << k) to run length */
-				run += add;
+	while ((r.left > 0) && (pOutput < pEnd))
+	{
+		if (k)
+		{
+			/* Run-Length (RL) Mode */
 
-				/* update k, kp params */
+			/* number of leading 0s, each adds (1 << k) to the run length */
+			const UINT64 vk = rfx_rlgr_reader_run(&r, FALSE);
+			UINT64 run = 0;
 
-				kp += UP_GR;
+			if (r.left < 1)
+				break;
 
-				if (kp > KPMAX)
-					kp = KPMAX;
+			rfx_rlgr_reader_skip(&r, 1);
 
-				k = kp >> LSGR;
+			if (vk > RLGR_RUN_STEPS)
+			{
+				run = rfx_rlgr_run_length[kp][RLGR_RUN_STEPS] +
+				      ((vk - RLGR_RUN_STEPS) << (KPMAX >> LSGR));
+				kp = KPMAX;
+			}
+			else
+			{
+				run = rfx_rlgr_run_length[kp][vk];
+				kp = MIN(kp + (UINT32)vk * UP_GR, KPMAX);
 			}
 
+			k = kp >> LSGR;
+
 			/* next k bits contain run length remainder */
 
-			if (BitStream_GetRemainingLength(bs) < k)
+			if (r.left < k)
 				break;
 
-			bs->mask = ((1 << k) - 1);
-			run += ((bs->accumulator >> (32 - k)) & bs->mask);
-			BitStream_Shift(bs, k);
+			run += rfx_rlgr_reader_get(&r, k);
 
 			/* read sign bit */
 
-			if (BitStream_GetRemainingLength(bs) < 1)
+			if (r.left < 1)
 				break;
 
-			sign = (bs->accumulator & 0x80000000) ? 1 : 0;
-			BitStream_Shift(bs, 1);
+			const UINT32 sign = rfx_rlgr_reader_get(&r, 1);
 
 			/* count number of leading 1s */
 
-			cnt = lzcnt_s(~(bs->accumulator));
+			const UINT64 vk1 = rfx_rlgr_reader_run(&r, TRUE);
 
-			nbits = BitStream_GetRemainingLength(bs);
-
-			if (cnt > nbits)
-				cnt = nbits;
-
-			vk = WINPR_ASSERTING_INT_CAST(uint32_t, cnt);
-
-			while ((cnt == 32) && (BitStream_GetRemainingLength(bs) > 0))
-			{
-				BitStream_Shift32(bs);
-
-				cnt = lzcnt_s(~(bs->accumulator));
-
-				nbits = BitStream_GetRemainingLength(bs);
-
-				if (cnt > nbits)
-					cnt = nbits;
-
-				WINPR_ASSERT(cnt + vk <= UINT32_MAX);
-				vk += WINPR_ASSERTING_INT_CAST(uint32_t, cnt);
-			}
-
-			BitStream_Shift(bs, (vk % 32));
-
-			if (BitStream_GetRemainingLength(bs) < 1)
+			if (r.left < 1)
 				break;
 
-			BitStream_Shift(bs, 1);
+			rfx_rlgr_reader_skip(&r, 1);
 
 			/* next kr bits contain code remainder */
 
-			if (BitStream_GetRemainingLength(bs) < kr)
+			if (r.left < kr)
 				break;
 
-			bs->mask = ((1 << kr) - 1);
-			if (kr > 0)
-				code = (UINT16)((bs->accumulator >> (32 - kr)) & bs->mask);
-			else
-				code = 0;
-			BitStream_Shift(bs, kr);
-
-			/* add (vk << kr) to code */
-
-			code |= (vk << kr);
-
-			if (!vk)
-			{
-				/* update kr, krp params */
-
-				if (krp > 2)
-					krp -= 2;
-				else
-					krp = 0;
-
-				kr = krp >> LSGR;
-			}
-			else if (vk != 1)
-			{
-				/* update kr, krp params */
-
-				krp += vk;
-
-				if (krp > KPMAX)
-					krp = KPMAX;
+			const UINT16 code = (UINT16)(rfx_rlgr_reader_get(&r, kr) | (vk1 << kr));
 
-				kr = krp >> LSGR;
-			}
+			krp = rfx_rlgr_update_krp(krp, vk1);
+			kr = krp >> LSGR;
 
 			/* update k, kp params */
 
-			if (kp > DN_GR)
-				kp -= DN_GR;
-			else
-				kp = 0;
-
+			kp = (kp > DN_GR) ? kp - DN_GR : 0;
 			k = kp >> LSGR;
 
-			/* compute magnitude from code */
-
-			if (sign)
-				mag = WINPR_ASSERTING_INT_CAST(int16_t, (code + 1)) * -1;
-			else
-				mag = WINPR_ASSERTING_INT_CAST(int16_t, code + 1);
-
-			/* write to output stream */
+			/* write the run of zeros and the magnitude computed from code */
 
-			offset = WINPR_ASSERTING_INT_CAST(size_t, (pOutput)-pDstData);
-			size = run;
-
-			if ((offset + size) > rDstSize)
-				size = WINPR_ASSERTING_INT_CAST(size_t, DstSize) - offset;
+			const size_t size = (size_t)MIN(run, (UINT64)(pEnd - pOutput));
 
 			if (size)
 			{
@@ -371,10 +392,12 @@ int rfx_rlgr_decode(RLGR_MODE mode, const BYTE* WINPR_RESTRICT pSrcData, UINT32
 				pOutput += size;
 			}
 
-			if ((pOutput - pDstData) < DstSize)
+			if (pOutput < pEnd)
 			{
-				*pOutput = mag;
-				pOutput++;
+				if (sign)
+					*pOutput++ = WINPR_ASSERTING_INT_CAST(int16_t, (code + 1)) * -1;
+				else
+					*pOutput++ = WINPR_ASSERTING_INT_CAST(int16_t, code + 1);
 			}
 		}
 		else
@@ -383,234 +406,156 @@ int rfx_rlgr_decode(RLGR_MODE mode, const BYTE* WINPR_RESTRICT pSrcData, UINT32
 
 			/* count number of leading 1s */
 
-			cnt = lzcnt_s(~(bs->accumulator));
+			const UINT64 vk = rfx_rlgr_reader_run(&r, TRUE);
 
-			size_t nbits = BitStream_GetRemainingLength(bs);
-
-			if (cnt > nbits)
-				cnt = nbits;
-
-			vk = WINPR_ASSERTING_INT_CAST(uint32_t, cnt);
-
-			while ((cnt == 32) && (BitStream_GetRemainingLength(bs) > 0))
-			{
-				BitStream_Shift32(bs);
-
-				cnt = lzcnt_s(~(bs->accumulator));
-
-				nbits = BitStream_GetRemainingLength(bs);
-
-				if (cnt > nbits)
-					cnt = nbits;
-
-				WINPR_ASSERT(cnt + vk <= UINT32_MAX);
-				vk += WINPR_ASSERTING_INT_CAST(uint32_t, cnt);
-			}
-
-			BitStream_Shift(bs, (vk % 32));
-
-			if (BitStream_GetRemainingLength(bs) < 1)
+			if (r.left < 1)
 				break;
 
-			BitStream_Shift(bs, 1);
+			rfx_rlgr_reader_skip(&r, 1);
 
 			/* next kr bits contain code remainder */
 
-			if (BitStream_GetRemainingLength(bs) < kr)
+			if (r.left < kr)
 				break;
 
-			bs->mask = ((1 << kr) - 1);
-			if (kr > 0)
-				code = (UINT16)((bs->accumulator >> (32 - kr)) & bs->mask);
-			else
-				code = 0;
-			BitStream_Shift(bs, kr);
-
-			/* add (vk << kr) to code */
-
-			code |= (vk << kr);
-
-			if (!vk)
-			{
-				/* update kr, krp params */
-
-				if (krp > 2)
-					krp -= 2;
-				else
-					krp = 0;
-
-				kr = (krp >> LSGR) & UINT32_MAX;
-			}
-			else if (vk != 1)
-			{
-				/* update kr, krp params */
-
-				krp += vk;
-
-				if (krp > KPMAX)
-					krp = KPMAX;
+			const UINT16 code = (UINT16)(rfx_rlgr_reader_get(&r, kr) | (vk << kr));
 
-				kr = krp >> LSGR;
-			}
+			krp = rfx_rlgr_update_krp(krp, vk);
+			kr = krp >> LSGR;
 
 			if (mode == RLGR1) /* RLGR1 */
 			{
-				if (!code)
-				{
-					/* update k, kp params */
-
-					kp += UQ_GR;
-
-					if (kp > KPMAX)
-						kp = KPMAX;
-
-					k = kp >> LSGR;
+				/* update k, kp params */
 
-					mag = 0;
-				}
+				if (!code)
+					kp = MIN(kp + UQ_GR, KPMAX);
 				else
-				{
-					/* update k, kp params */
-
-					if (kp > DQ_GR)
-						kp -= DQ_GR;
-					else
-						kp = 0;
-
-					k = kp >> LSGR;
+					kp = (kp > DQ_GR) ? kp - DQ_GR : 0;
 
-					/*
-					 * code = 2 * mag - sign
-					 * sign + code = 2 * mag
-					 */
-
-					if (code & 1)
-						mag = WINPR_ASSERTING_INT_CAST(INT16, (code + 1) >> 1) * -1;
-					else
-						mag = WINPR_ASSERTING_INT_CAST(INT16, code >> 1);
-				}
+				k = kp >> LSGR;
 
-				if ((pOutput - pDstData) < DstSize)
-				{
-					*pOutput = mag;
-					pOutput++;
-				}
+				/*
+				 * code = 2 * mag - sign
+				 * sign + code = 2 * mag
+				 */
+				*pOutput++ = rfx_rlgr_2mag_sign(code);
 			}
-			else if (mode == RLGR3) /* RLGR3 */
+			else /* RLGR3 */
 			{
-				nIdx = 0;
+				UINT32 nIdx = 0;
 
 				if (code)
 				{
-					mag = WINPR_ASSERTING_INT_CAST(int16_t, code);
+					const INT16 mag = WINPR_ASSERTING_INT_CAST(int16_t, code);
 					nIdx = 32 - lzcnt_s(WINPR_ASSERTING_INT_CAST(uint32_t, mag));
 				}
 
-				if (BitStream_GetRemainingLength(bs) < nIdx)
+				if (r.left < nIdx)
 					break;
 
-				bs->mask = ((1 << nIdx) - 1);
-				if (nIdx > 0)
-					val1 = ((bs->accumulator >> (32 - nIdx)) & bs->mask);
-				else
-					val1 = 0;
-				BitStream_Shift(bs, nIdx);
+				const UINT32 val1 = rfx_rlgr_reader_get(&r, nIdx);
+				const UINT32 val2 = code - val1;
 
-				val2 = code - val1;
+				/* update k, kp params */
 
 				if (val1 && val2)
-				{
-					/* update k, kp params */
-
-					if (kp > 2 * DQ_GR)
-						kp -= (2 * DQ_GR);
-					else
-						kp = 0;
-
-					k = kp >> LSGR;
-				}
+					kp = (kp > 2 * DQ_GR) ? kp - 2 * DQ_GR : 0;
 				else if (!val1 && !val2)
-				{
-					/* update k, kp params */
-
-					kp += (2 * UQ_GR);
+					kp = MIN(kp + 2 * UQ_GR, KPMAX);
 
-					if (kp > KPMAX)
-						kp = KPMAX;
-
-					k = kp >> LSGR;
-				}
-
-				if (val1 & 1)
-					mag = WINPR_ASSERTING_INT_CAST(int16_t, (val1 + 1) >> 1) * -1;
-				else
-					mag = WINPR_ASSERTING_INT_CAST(int16_t, val1 >> 1);
-
-				if ((pOutput - pDstData) < DstSize)
-				{
-					*pOutput = mag;
-					pOutput++;
-				}
+				k = kp >> LSGR;
 
-				if (val2 & 1)
-					mag = WINPR_ASSERTING_INT_CAST(int16_t, (val2 + 1) >> 1) * -1;
-				else
-					mag = WINPR_ASSERTING_INT_CAST(int16_t, val2 >> 1);
+				*pOutput++ = rfx_rlgr_2mag_sign(val1);
 
-				if ((pOutput - pDstData) < DstSize)
-				{
-					*pOutput = WINPR_ASSERTING_INT_CAST(int16_t, mag);
-					pOutput++;
-				}
+				if (pOutput < pEnd)
+					*pOutput++ = rfx_rlgr_2mag_sign(val2);
 			}
 		}
 	}
 
-	offset = WINPR_ASSERTING_INT_CAST(size_t, (pOutput - pDstData));
+	if (pOutput < pEnd)
+		ZeroMemory(pOutput, (size_t)(pEnd - pOutput) * sizeof(INT16));
+
+	return 1;
+}
 
-	if (offset < rDstSize)
+/*
+ * Big endian bit writer with a 64 bit accumulator, holding less than 32 pending bits between
+ * calls. Bits are OR'ed into the (zeroed) output buffer and silently dropped past its end.
+ */
+typedef struct
+{
+	BYTE* buffer;
+	size_t size;
+	size_t pos;
+	UINT64 acc;
+	UINT32 bits;
+} RFX_RLGR_WRITER;
+
+static INLINE void rfx_rlgr_writer_emit(RFX_RLGR_WRITER* w, UINT32 val, size_t nbytes)
+{
+	if (w->pos + 4 <= w->size)
 	{
-		size = WINPR_ASSERTING_INT_CAST(size_t, DstSize) - offset;
-		ZeroMemory(pOutput, size * 2);
-		pOutput += size;
+		BYTE* p = &w->buffer[w->pos];
+		p[0] |= (BYTE)(val >> 24);
+		p[1] |= (BYTE)(val >> 16);
+		p[2] |= (BYTE)(val >> 8);
+		p[3] |= (BYTE)val;
 	}
+	else
+	{
+		for (size_t x = 0; (x < nbytes) && (w->pos + x < w->size); x++)
+			w->buffer[w->pos + x] |= (BYTE)(val >> (24 - 8 * x));
+	}
+
+	w->pos += nbytes;
+}
 
-	offset = WINPR_ASSERTING_INT_CAST(size_t, (pOutput - pDstData));
+/* emit the lowest nbits (0 to 32) of val */
+static INLINE void rfx_rlgr_writer_put(RFX_RLGR_WRITER* w, UINT32 val, UINT32 nbits)
+{
+	WINPR_ASSERT(nbits <= 32);
+	WINPR_ASSERT(w->bits < 32);
 
-	if ((DstSize < 0) || (offset != (size_t)DstSize))
-		return -1;
+	const UINT64 mask = (1ull << nbits) - 1ull;
 
-	return 1;
+	w->acc = (w->acc << nbits) | (val & mask);
+	w->bits += nbits;
+
+	if (w->bits >= 32)
+	{
+		w->bits -= 32;
+		rfx_rlgr_writer_emit(w, (UINT32)(w->acc >> w->bits), 4);
+	}
 }
 
-/* Returns the next coefficient (a signed int) to encode, from the input stream */
-#define GetNextInput(_n)    \
-	do                      \
-	{                       \
-		if (data_size > 0)  \
-		{                   \
-			(_n) = *data++; \
-			data_size--;    \
-		}                   \
-		else                \
-		{                   \
-			(_n) = 0;       \
-		}                   \
-	} while (0)
+/* emit count bits of the same value */
+static INLINE void rfx_rlgr_writer_put_run(RFX_RLGR_WRITER* w, UINT32 count, UINT8 bit)
+{
+	const UINT32 val = bit ? UINT32_MAX : 0;
+
+	for (; count >= 32; count -= 32)
+		rfx_rlgr_writer_put(w, val, 32);
 
-/* Emit bitPattern to the output bitstream */
-#define OutputBits(numBits, bitPattern) rfx_bitstream_put_bits(bs, bitPattern, numBits)
+	rfx_rlgr_writer_put(w, val, count);
+}
 
-/* Emit a bit (0 or 1), count number of times, to the output bitstream */
-static inline void OutputBit(RFX_BITSTREAM* bs, uint32_t count, UINT8 bit)
+/* pad with 0 bits, returns the number of bytes written to the buffer */
+static INLINE size_t rfx_rlgr_writer_flush(RFX_RLGR_WRITER* w)
 {
-	UINT16 _b = ((bit) ? 0xFFFF : 0);
-	const uint32_t rem = count % 16;
-	for (uint32_t x = 0; x < count - rem; x += 16)
-		rfx_bitstream_put_bits(bs, _b, 16);
+	/* the bit by bit encoder padded a partial byte with (8 - free bits) 0 bits, which adds an
+	 * extra 0 byte if more than half of the last byte was used. Keep the output identical. */
+	rfx_rlgr_writer_put(w, 0, w->bits % 8);
 
-	if (rem > 0)
-		rfx_bitstream_put_bits(bs, _b, rem);
+	if (w->bits > 0)
+	{
+		const UINT32 nbytes = (w->bits + 7) / 8;
+		const UINT32 val = (UINT32)(w->acc << (32 - w->bits));
+		rfx_rlgr_writer_emit(w, val, nbytes);
+		w->bits = 0;
+	}
+
+	return MIN(w->pos, w->size);
 }
 
 /* Converts the input value to (2 * abs(input) - sign(input)), where sign(input) = (input < 0 ? 1 :
@@ -623,22 +568,20 @@ static inline UINT32 Get2MagSign(INT32 input)
 }
 
 /* Outputs the Golomb/Rice encoding of a non-negative integer */
-#define CodeGR(krp, val) rfx_rlgr_code_gr(bs, krp, val)
-
-static void rfx_rlgr_code_gr(RFX_BITSTREAM* bs, uint32_t* krp, UINT32 val)
+static INLINE void rfx_rlgr_code_gr(RFX_RLGR_WRITER* w, uint32_t* krp, UINT32 val)
 {
-	uint32_t kr = *krp >> LSGR;
-
-	/* unary part of GR code */
+	const uint32_t kr = *krp >> LSGR;
 
+	/* unary part of GR code, a 0 and the kr bit remainder */
 	const uint32_t vk = val >> kr;
-	OutputBit(bs, vk, 1);
-	OutputBit(bs, 1, 0);
+	const UINT32 rem = val & ((1u << kr) - 1u);
 
-	/* remainder part of GR code, if needed */
-	if (kr)
+	if (vk + 1 + kr <= 32)
+		rfx_rlgr_writer_put(w, (UINT32)((((1ull << vk) - 1ull) << (kr + 1)) | rem), vk + 1 + kr);
+	else
 	{
-		OutputBits(kr, val & ((1 << kr) - 1));
+		rfx_rlgr_writer_put_run(w, vk, 1);
+		rfx_rlgr_writer_put(w, rem, kr + 1);
 	}
 
 	/* update krp, only if it is not equal to 1 */
@@ -652,143 +595,134 @@ static void rfx_rlgr_code_gr(RFX_BITSTREAM* bs, uint32_t* krp, UINT32 val)
 	}
 }
 
+/* Returns the number of leading zero coefficients, checking four at a time */
+static INLINE size_t rfx_rlgr_zero_run(const INT16* WINPR_RESTRICT data, size_t size)
+{
+	size_t x = 0;
+
+	for (; x + 4 <= size; x += 4)
+	{
+		UINT64 v = 0;
+		memcpy(&v, &data[x], sizeof(v));
+
+		if (v)
+			break;
+	}
+
+	while ((x < size) && (data[x] == 0))
+		x++;
+
+	return x;
+}
+
 int rfx_rlgr_encode(RLGR_MODE mode, const INT16* WINPR_RESTRICT data, UINT32 data_size,
                     BYTE* WINPR_RESTRICT buffer, UINT32 buffer_size)
 {
-	uint32_t k = 0;
-	uint32_t kp = 0;
-	uint32_t krp = 0;
-	RFX_BITSTREAM* bs = NULL;
+	RFX_RLGR_WRITER w = { 0 };
 
-	if (!(bs = (RFX_BITSTREAM*)winpr_aligned_calloc(1, sizeof(RFX_BITSTREAM), 32)))
-		return 0;
-
-	rfx_bitstream_attach(bs, buffer, buffer_size);
+	w.buffer = buffer;
+	w.size = buffer_size;
 
 	/* initialize the parameters */
-	k = 1;
-	kp = 1 << LSGR;
-	krp = 1 << LSGR;
+	uint32_t k = 1;
+	uint32_t kp = 1 << LSGR;
+	uint32_t krp = 1 << LSGR;
 
-	/* process all the input coefficients */
-	while (data_size > 0)
-	{
-		int input = 0;
+	const INT16* end = &data[data_size];
 
+	/* process all the input coefficients, missing ones are encoded as 0 */
+	while (data < end)
+	{
 		if (k)
 		{
-			uint32_t numZeros = 0;
-			uint32_t runmax = 0;
-			BYTE sign = 0;
-
 			/* RUN-LENGTH MODE */
 
 			/* collect the run of zeros in the input stream */
-			numZeros = 0;
-			GetNextInput(input);
-			while (input == 0 && data_size > 0)
+			const size_t zeros = rfx_rlgr_zero_run(data, (size_t)(end - data));
+			uint32_t numZeros = 0;
+			int input = 0;
+
+			if (data + zeros < end)
 			{
-				numZeros++;
-				GetNextInput(input);
+				numZeros = (uint32_t)zeros;
+				input = data[zeros];
+				data += zeros + 1;
+			}
+			else
+			{
+				/* the last zero is encoded like a nonzero value */
+				numZeros = (uint32_t)(zeros - 1);
+				data = end;
 			}
 
-			// emit output zeros
-			runmax = 1 << k;
+			/* emit a 0 bit for each full run */
+			uint32_t runs = 0;
+			uint32_t runmax = 1 << k;
 			while (numZeros >= runmax)
 			{
-				OutputBit(bs, 1, 0); /* output a zero bit */
+				runs++;
 				numZeros -= runmax;
 				k = UpdateParam(&kp, UP_GR); /* update kp, k */
 				runmax = 1 << k;
 			}
 
-			/* output a 1 to terminate runs */
-			OutputBit(bs, 1, 1);
-
-			/* output the remaining run length using k bits */
-			OutputBits(k, numZeros);
-
-			/* note: when we reach here and the last byte being encoded is 0, we still
-			   need to output the last two bits, otherwise mstsc will crash */
+			rfx_rlgr_writer_put_run(&w, runs, 0);
 
 			/* encode the nonzero value using GR coding */
 			const UINT32 mag =
 			    (UINT32)(input < 0 ? -input : input); /* absolute value of input coefficient */
-			sign = (input < 0 ? 1 : 0);         /* sign of input coefficient */
+			const UINT32 sign = (input < 0 ? 1 : 0);    /* sign of input coefficient */
+
+			/* a 1 to terminate runs, the remaining run length using k bits and the sign bit */
+			rfx_rlgr_writer_put(&w, (((1u << k) | numZeros) << 1) | sign, k + 2);
 
-			OutputBit(bs, 1, sign);          /* output the sign bit */
-			CodeGR(&krp, mag ? mag - 1 : 0); /* output GR code for (mag - 1) */
+			/* note: when we reach here and the last byte being encoded is 0, we still
+			   need to output the last two bits, otherwise mstsc will crash */
+			rfx_rlgr_code_gr(&w, &krp, mag ? mag - 1 : 0); /* output GR code for (mag - 1) */
 
 			k = UpdateParam(&kp, -DN_GR);
 		}
-		else
+		else if (mode == RLGR1)
 		{
-			/* GOLOMB-RICE MODE */
-
-			if (mode == RLGR1)
-			{
-				UINT32 twoMs = 0;
-
-				/* RLGR1 variant */
-
-				/* convert input to (2*magnitude - sign), encode using GR code */
-				GetNextInput(input);
-				twoMs = Get2MagSign(input);
-				CodeGR(&krp, twoMs);
-
-				/* update k, kp */
-				/* NOTE: as of Aug 2011, the algorithm is still wrongly documented
-				   and the update direction is reversed */
-				if (twoMs)
-				{
-					k = UpdateParam(&kp, -DQ_GR);
-				}
-				else
-				{
-					k = UpdateParam(&kp, UQ_GR);
-				}
-			}
-			else /* mode == RLGR3 */
-			{
-				UINT32 twoMs1 = 0;
-				UINT32 twoMs2 = 0;
-				UINT32 sum2Ms = 0;
-				UINT32 nIdx = 0;
+			/* GOLOMB-RICE MODE, RLGR1 variant */
 
-				/* RLGR3 variant */
+			/* convert input to (2*magnitude - sign), encode using GR code */
+			const UINT32 twoMs = Get2MagSign(*data++);
+			rfx_rlgr_code_gr(&w, &krp, twoMs);
 
-				/* convert the next two input values to (2*magnitude - sign) and */
-				/* encode their sum using GR code */
-
-				GetNextInput(input);
-				twoMs1 = Get2MagSign(input);
-				GetNextInput(input);
-				twoMs2 = Get2MagSign(input);
-				sum2Ms = twoMs1 + twoMs2;
-
-				CodeGR(&krp, sum2Ms);
-
-				/* encode binary representation of the first input (twoMs1). */
-				GetMinBits(sum2Ms, nIdx);
-				OutputBits(nIdx, twoMs1);
-
-				/* update k,kp for the two input values */
-
-				if (twoMs1 && twoMs2)
-				{
-					k = UpdateParam(&kp, -2 * DQ_GR);
-				}
-				else if (!twoMs1 && !twoMs2)
-				{
-					k = UpdateParam(&kp, 2 * UQ_GR);
-				}
-			}
+			/* update k, kp */
+			/* NOTE: as of Aug 2011, the algorithm is still wrongly documented
+			   and the update direction is reversed */
+			if (twoMs)
+				k = UpdateParam(&kp, -DQ_GR);
+			else
+				k = UpdateParam(&kp, UQ_GR);
+		}
+		else
+		{
+			/* GOLOMB-RICE MODE, RLGR3 variant */
+
+			/* convert the next two input values to (2*magnitude - sign) and */
+			/* encode their sum using GR code */
+			const UINT32 twoMs1 = Get2MagSign(*data++);
+			const UINT32 twoMs2 = (data < end) ? Get2MagSign(*data++) : 0;
+			const UINT32 sum2Ms = twoMs1 + twoMs2;
+			UINT32 nIdx = 0;
+
+			rfx_rlgr_code_gr(&w, &krp, sum2Ms);
+
+			/* encode binary representation of the first input (twoMs1). */
+			GetMinBits(sum2Ms, nIdx);
+			rfx_rlgr_writer_put(&w, twoMs1, nIdx);
+
+			/* update k,kp for the two input values */
+			if (twoMs1 && twoMs2)
+				k = UpdateParam(&kp, -2 * DQ_GR);
+			else if (!twoMs1 && !twoMs2)
+				k = UpdateParam(&kp, 2 * UQ_GR);
 		}
 	}
 
-	rfx_bitstream_flush(bs);
-	uint32_t processed_size = rfx_bitstream_get_processed_bytes(bs);
-	winpr_aligned_free(bs);
-
+	const size_t processed_size = rfx_rlgr_writer_flush(&w);
 	return WINPR_ASSERTING_INT_CAST(int, processed_size);
 }
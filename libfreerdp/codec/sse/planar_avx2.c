@@ -0,0 +1,171 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * RDP6 Planar Codec - AVX2 Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/assert.h>
+#include <winpr/platform.h>
+#include <freerdp/config.h>
+
+#include "../planar_types.h"
+#include "planar_avx2.h"
+
+#include "../../core/simd.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <immintrin.h>
+
+/* the kernels compute exactly what the SSE4.1 versions compute, 32 bytes at a time */
+
+static void planar_split_row32_avx2(const BYTE* WINPR_RESTRICT pSrc, UINT32 width,
+                                    const BYTE offsets[4], BYTE* WINPR_RESTRICT planes[4])
+{
+	BYTE shuffle[32] = { 0 };
+	UINT32 x = 0;
+
+	/* gathers the channels of 4 pixels per 128 bit lane, one 32 bit element per plane */
+	for (size_t i = 0; i < 4; i++)
+	{
+		for (size_t j = 0; j < 4; j++)
+		{
+			const BYTE index = (offsets[i] < 4) ? (BYTE)(4 * j + offsets[i]) : 0x80;
+			shuffle[4 * i + j] = index;
+			shuffle[16 + 4 * i + j] = index;
+		}
+	}
+
+	const __m256i mask = _mm256_loadu_si256((const __m256i*)shuffle);
+
+	/* 8 pixels per vector in the order of the planes, 8 bytes each */
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	for (; (x + 32) <= width; x += 32)
+	{
+		const __m256i* src = (const __m256i*)&pSrc[4ULL * x];
+		__m256i s[4];
+
+		for (size_t i = 0; i < 4; i++)
+		{
+			const __m256i val = _mm256_shuffle_epi8(_mm256_loadu_si256(&src[i]), mask);
+			s[i] = _mm256_permutevar8x32_epi32(val, order);
+		}
+
+		const __m256i t0 = _mm256_unpacklo_epi64(s[0], s[1]);
+		const __m256i t1 = _mm256_unpackhi_epi64(s[0], s[1]);
+		const __m256i t2 = _mm256_unpacklo_epi64(s[2], s[3]);
+		const __m256i t3 = _mm256_unpackhi_epi64(s[2], s[3]);
+		const __m256i channels[4] = { _mm256_permute2x128_si256(t0, t2, 0x20),
+			                          _mm256_permute2x128_si256(t1, t3, 0x20),
+			                          _mm256_permute2x128_si256(t0, t2, 0x31),
+			                          _mm256_permute2x128_si256(t1, t3, 0x31) };
+
+		for (size_t i = 0; i < 4; i++)
+		{
+			if (planes[i])
+				_mm256_storeu_si256((__m256i*)&planes[i][x], channels[i]);
+		}
+	}
+
+	if (x < width)
+	{
+		BYTE* tail[4] = { 0 };
+
+		for (size_t i = 0; i < 4; i++)
+			tail[i] = planes[i] ? &planes[i][x] : NULL;
+
+		planar_split_row32_generic(&pSrc[4ULL * x], width - x, offsets, tail);
+	}
+}
+
+static void planar_delta_encode_row_avx2(const BYTE* WINPR_RESTRICT pCur,
+                                         const BYTE* WINPR_RESTRICT pPrev,
+                                         BYTE* WINPR_RESTRICT pDst, UINT32 width)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	UINT32 x = 0;
+
+	for (; (x + 32) <= width; x += 32)
+	{
+		const __m256i cur = _mm256_loadu_si256((const __m256i*)&pCur[x]);
+		const __m256i prev = _mm256_loadu_si256((const __m256i*)&pPrev[x]);
+		const __m256i delta = _mm256_sub_epi8(cur, prev);
+		const __m256i sign = _mm256_cmpgt_epi8(zero, delta);
+		_mm256_storeu_si256((__m256i*)&pDst[x],
+		                    _mm256_xor_si256(_mm256_add_epi8(delta, delta), sign));
+	}
+
+	planar_delta_encode_row_generic(&pCur[x], &pPrev[x], &pDst[x], width - x);
+}
+
+static void planar_match_row_avx2(const BYTE* WINPR_RESTRICT pSrc, UINT32 width,
+                                  UINT64* WINPR_RESTRICT mask)
+{
+	UINT32 x = 0;
+
+	for (; (x + 64) <= width; x += 64)
+	{
+		UINT64 bits = 0;
+
+		for (size_t i = 0; i < 2; i++)
+		{
+			const BYTE* ptr = &pSrc[x + 32 * i];
+			const __m256i cur = _mm256_loadu_si256((const __m256i*)ptr);
+			__m256i prev;
+
+			if (ptr == pSrc)
+			{
+				/* the first byte of the scanline is compared to 0 */
+				const __m256i low = _mm256_permute2x128_si256(cur, cur, 0x08);
+				prev = _mm256_alignr_epi8(cur, low, 15);
+			}
+			else
+				prev = _mm256_loadu_si256((const __m256i*)&ptr[-1]);
+
+			const UINT32 eq = (UINT32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(cur, prev));
+			bits |= (UINT64)eq << (32 * i);
+		}
+
+		mask[x / 64] = bits;
+	}
+
+	if (x < width)
+	{
+		UINT64 bits = 0;
+		BYTE symbol = (x > 0) ? pSrc[x - 1] : 0;
+
+		for (UINT32 i = x; i < width; i++)
+		{
+			if (pSrc[i] == symbol)
+				bits |= 1ULL << (i - x);
+
+			symbol = pSrc[i];
+		}
+
+		mask[x / 64] = bits;
+	}
+}
+#endif
+
+void planar_init_avx2_int(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT context)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	WINPR_ASSERT(context);
+	context->split_row32 = planar_split_row32_avx2;
+	context->delta_encode_row = planar_delta_encode_row_avx2;
+	context->match_row = planar_match_row_avx2;
+#else
+	WINPR_UNUSED(context);
+#endif
+}
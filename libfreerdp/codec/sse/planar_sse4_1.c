@@ -0,0 +1,148 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * RDP6 Planar Codec - SSE4.1 Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/assert.h>
+#include <winpr/platform.h>
+#include <freerdp/config.h>
+
+#include "../planar_types.h"
+#include "planar_sse4_1.h"
+
+#include "../../core/simd.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <smmintrin.h>
+
+static void planar_split_row32_sse4_1(const BYTE* WINPR_RESTRICT pSrc, UINT32 width,
+                                      const BYTE offsets[4], BYTE* WINPR_RESTRICT planes[4])
+{
+	BYTE shuffle[16] = { 0 };
+	UINT32 x = 0;
+
+	/* gathers the channels of 4 pixels, one 32 bit lane per plane */
+	for (size_t i = 0; i < 4; i++)
+	{
+		for (size_t j = 0; j < 4; j++)
+			shuffle[4 * i + j] = (offsets[i] < 4) ? (BYTE)(4 * j + offsets[i]) : 0x80;
+	}
+
+	const __m128i mask = _mm_loadu_si128((const __m128i*)shuffle);
+
+	for (; (x + 16) <= width; x += 16)
+	{
+		const __m128i* src = (const __m128i*)&pSrc[4ULL * x];
+		const __m128i s0 = _mm_shuffle_epi8(_mm_loadu_si128(&src[0]), mask);
+		const __m128i s1 = _mm_shuffle_epi8(_mm_loadu_si128(&src[1]), mask);
+		const __m128i s2 = _mm_shuffle_epi8(_mm_loadu_si128(&src[2]), mask);
+		const __m128i s3 = _mm_shuffle_epi8(_mm_loadu_si128(&src[3]), mask);
+		const __m128i t0 = _mm_unpacklo_epi32(s0, s1);
+		const __m128i t1 = _mm_unpackhi_epi32(s0, s1);
+		const __m128i t2 = _mm_unpacklo_epi32(s2, s3);
+		const __m128i t3 = _mm_unpackhi_epi32(s2, s3);
+		const __m128i channels[4] = { _mm_unpacklo_epi64(t0, t2), _mm_unpackhi_epi64(t0, t2),
+			                          _mm_unpacklo_epi64(t1, t3), _mm_unpackhi_epi64(t1, t3) };
+
+		for (size_t i = 0; i < 4; i++)
+		{
+			if (planes[i])
+				_mm_storeu_si128((__m128i*)&planes[i][x], channels[i]);
+		}
+	}
+
+	if (x < width)
+	{
+		BYTE* tail[4] = { 0 };
+
+		for (size_t i = 0; i < 4; i++)
+			tail[i] = planes[i] ? &planes[i][x] : NULL;
+
+		planar_split_row32_generic(&pSrc[4ULL * x], width - x, offsets, tail);
+	}
+}
+
+static void planar_delta_encode_row_sse4_1(const BYTE* WINPR_RESTRICT pCur,
+                                           const BYTE* WINPR_RESTRICT pPrev,
+                                           BYTE* WINPR_RESTRICT pDst, UINT32 width)
+{
+	const __m128i zero = _mm_setzero_si128();
+	UINT32 x = 0;
+
+	for (; (x + 16) <= width; x += 16)
+	{
+		const __m128i cur = _mm_loadu_si128((const __m128i*)&pCur[x]);
+		const __m128i prev = _mm_loadu_si128((const __m128i*)&pPrev[x]);
+		const __m128i delta = _mm_sub_epi8(cur, prev);
+		const __m128i sign = _mm_cmpgt_epi8(zero, delta);
+		_mm_storeu_si128((__m128i*)&pDst[x], _mm_xor_si128(_mm_add_epi8(delta, delta), sign));
+	}
+
+	planar_delta_encode_row_generic(&pCur[x], &pPrev[x], &pDst[x], width - x);
+}
+
+static void planar_match_row_sse4_1(const BYTE* WINPR_RESTRICT pSrc, UINT32 width,
+                                    UINT64* WINPR_RESTRICT mask)
+{
+	UINT32 x = 0;
+
+	for (; (x + 64) <= width; x += 64)
+	{
+		UINT64 bits = 0;
+
+		for (size_t i = 0; i < 4; i++)
+		{
+			const BYTE* ptr = &pSrc[x + 16 * i];
+			const __m128i cur = _mm_loadu_si128((const __m128i*)ptr);
+
+			/* the first byte of the scanline is compared to 0 */
+			const __m128i prev = (ptr == pSrc) ? _mm_slli_si128(cur, 1)
+			                                   : _mm_loadu_si128((const __m128i*)&ptr[-1]);
+			const UINT32 eq = (UINT32)_mm_movemask_epi8(_mm_cmpeq_epi8(cur, prev));
+			bits |= (UINT64)eq << (16 * i);
+		}
+
+		mask[x / 64] = bits;
+	}
+
+	if (x < width)
+	{
+		UINT64 bits = 0;
+		BYTE symbol = (x > 0) ? pSrc[x - 1] : 0;
+
+		for (UINT32 i = x; i < width; i++)
+		{
+			if (pSrc[i] == symbol)
+				bits |= 1ULL << (i - x);
+
+			symbol = pSrc[i];
+		}
+
+		mask[x / 64] = bits;
+	}
+}
+#endif
+
+void planar_init_sse4_1_int(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT context)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	WINPR_ASSERT(context);
+	context->split_row32 = planar_split_row32_sse4_1;
+	context->delta_encode_row = planar_delta_encode_row_sse4_1;
+	context->match_row = planar_match_row_sse4_1;
+#else
+	WINPR_UNUSED(context);
+#endif
+}
@@ -0,0 +1,35 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * RDP6 Planar Codec - SSE4.1 Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CODEC_PLANAR_SSE4_1_H
+#define FREERDP_LIB_CODEC_PLANAR_SSE4_1_H
+
+#include <winpr/sysinfo.h>
+
+#include <freerdp/codec/planar.h>
+#include <freerdp/api.h>
+
+FREERDP_LOCAL void planar_init_sse4_1_int(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT context);
+static inline void planar_init_sse4_1(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT context)
+{
+	if (!IsProcessorFeaturePresent(PF_SSE4_1_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	planar_init_sse4_1_int(context);
+}
+
+#endif /* FREERDP_LIB_CODEC_PLANAR_SSE4_1_H */
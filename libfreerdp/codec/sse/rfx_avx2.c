@@ -0,0 +1,467 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * RemoteFX Codec Library - AVX2 Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/assert.h>
+#include <winpr/cast.h>
+#include <winpr/platform.h>
+#include <freerdp/config.h>
+
+#include "../rfx_types.h"
+#include "rfx_avx2.h"
+
+#include "../../core/simd.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <immintrin.h>
+
+/*
+ * The kernels below compute exactly what the SSE2 versions compute, 16 coefficients per
+ * instruction instead of 8. The subband width 8 of the third DWT level fills a vector with
+ * two rows, the row boundaries are then handled per 128 bit lane.
+ */
+
+static inline __m256i mm256_load(const INT16* ptr)
+{
+	return _mm256_loadu_si256((const __m256i*)ptr);
+}
+
+static inline void mm256_store(INT16* ptr, __m256i val)
+{
+	_mm256_storeu_si256((__m256i*)ptr, val);
+}
+
+/* [carry[15], v[0] .. v[14]] */
+static inline __m256i mm256_shift_in_first(__m256i v, __m256i carry)
+{
+	const __m256i x = _mm256_permute2x128_si256(carry, v, 0x21);
+	return _mm256_alignr_epi8(v, x, 14);
+}
+
+/* [v[1] .. v[15], next[0]] */
+static inline __m256i mm256_shift_in_last(__m256i v, __m256i next)
+{
+	const __m256i x = _mm256_permute2x128_si256(v, next, 0x21);
+	return _mm256_alignr_epi8(x, v, 2);
+}
+
+/* per 128 bit lane [v[0], v[0] .. v[6]] */
+static inline __m256i mm256_lane_mirror_first(__m256i v)
+{
+	return _mm256_alignr_epi8(v, _mm256_slli_si256(v, 14), 14);
+}
+
+/* per 128 bit lane [v[1] .. v[7], v[7]] */
+static inline __m256i mm256_lane_mirror_last(__m256i v)
+{
+	return _mm256_alignr_epi8(_mm256_srli_si256(v, 14), v, 2);
+}
+
+/* split 32 consecutive coefficients into even and odd ones */
+static inline void mm256_deinterleave(const INT16* WINPR_RESTRICT src, __m256i* even, __m256i* odd)
+{
+	const __m256i mask = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15, 0,
+	                                      1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+	const __m256i a = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(mm256_load(src), mask), 0xD8);
+	const __m256i b =
+	    _mm256_permute4x64_epi64(_mm256_shuffle_epi8(mm256_load(src + 16), mask), 0xD8);
+	*even = _mm256_permute2x128_si256(a, b, 0x20);
+	*odd = _mm256_permute2x128_si256(a, b, 0x31);
+}
+
+/* store 32 coefficients, alternating between even and odd */
+static inline void mm256_interleave(INT16* WINPR_RESTRICT dst, __m256i even, __m256i odd)
+{
+	const __m256i lo = _mm256_unpacklo_epi16(even, odd);
+	const __m256i hi = _mm256_unpackhi_epi16(even, odd);
+	mm256_store(dst, _mm256_permute2x128_si256(lo, hi, 0x20));
+	mm256_store(dst + 16, _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+static inline void rfx_quantization_decode_block_avx2(INT16* WINPR_RESTRICT buffer,
+                                                      const size_t buffer_size, const UINT32 factor)
+{
+	if (factor == 0)
+		return;
+
+	const __m128i shift = _mm_cvtsi32_si128(WINPR_ASSERTING_INT_CAST(int, factor));
+
+	for (size_t x = 0; x < buffer_size; x += 16)
+	{
+		const __m256i a = mm256_load(&buffer[x]);
+		mm256_store(&buffer[x], _mm256_sll_epi16(a, shift));
+	}
+}
+
+static void rfx_quantization_decode_avx2(INT16* WINPR_RESTRICT buffer,
+                                         const UINT32* WINPR_RESTRICT quantVals)
+{
+	WINPR_ASSERT(buffer);
+	WINPR_ASSERT(quantVals);
+
+	rfx_quantization_decode_block_avx2(&buffer[0], 1024, quantVals[8] - 1);    /* HL1 */
+	rfx_quantization_decode_block_avx2(&buffer[1024], 1024, quantVals[7] - 1); /* LH1 */
+	rfx_quantization_decode_block_avx2(&buffer[2048], 1024, quantVals[9] - 1); /* HH1 */
+	rfx_quantization_decode_block_avx2(&buffer[3072], 256, quantVals[5] - 1);  /* HL2 */
+	rfx_quantization_decode_block_avx2(&buffer[3328], 256, quantVals[4] - 1);  /* LH2 */
+	rfx_quantization_decode_block_avx2(&buffer[3584], 256, quantVals[6] - 1);  /* HH2 */
+	rfx_quantization_decode_block_avx2(&buffer[3840], 64, quantVals[2] - 1);   /* HL3 */
+	rfx_quantization_decode_block_avx2(&buffer[3904], 64, quantVals[1] - 1);   /* LH3 */
+	rfx_quantization_decode_block_avx2(&buffer[3968], 64, quantVals[3] - 1);   /* HH3 */
+	rfx_quantization_decode_block_avx2(&buffer[4032], 64, quantVals[0] - 1);   /* LL3 */
+}
+
+/*
+ * The band quantization and the final scaling by 2^5 are done in one pass over the band, with
+ * the same rounding as two separate passes.
+ */
+static inline void rfx_quantization_encode_block_avx2(INT16* WINPR_RESTRICT buffer,
+                                                      const size_t buffer_size, const UINT32 factor)
+{
+	const __m128i shift = _mm_cvtsi32_si128(WINPR_ASSERTING_INT_CAST(int, factor));
+	const __m256i half =
+	    _mm256_set1_epi16((factor == 0) ? 0 : WINPR_ASSERTING_INT_CAST(INT16, 1 << (factor - 1)));
+	const __m256i half5 = _mm256_set1_epi16(1 << 4);
+
+	for (size_t x = 0; x < buffer_size; x += 16)
+	{
+		__m256i a = mm256_load(&buffer[x]);
+		a = _mm256_sra_epi16(_mm256_add_epi16(a, half), shift);
+		a = _mm256_srai_epi16(_mm256_add_epi16(a, half5), 5);
+		mm256_store(&buffer[x], a);
+	}
+}
+
+static void rfx_quantization_encode_avx2(INT16* WINPR_RESTRICT buffer,
+                                         const UINT32* WINPR_RESTRICT quantization_values)
+{
+	WINPR_ASSERT(buffer);
+	WINPR_ASSERT(quantization_values);
+	for (size_t x = 0; x < 10; x++)
+	{
+		WINPR_ASSERT(quantization_values[x] >= 6);
+		WINPR_ASSERT(quantization_values[x] <= INT16_MAX + 6);
+	}
+
+	rfx_quantization_encode_block_avx2(buffer, 1024, quantization_values[8] - 6);        /* HL1 */
+	rfx_quantization_encode_block_avx2(buffer + 1024, 1024, quantization_values[7] - 6); /* LH1 */
+	rfx_quantization_encode_block_avx2(buffer + 2048, 1024, quantization_values[9] - 6); /* HH1 */
+	rfx_quantization_encode_block_avx2(buffer + 3072, 256, quantization_values[5] - 6);  /* HL2 */
+	rfx_quantization_encode_block_avx2(buffer + 3328, 256, quantization_values[4] - 6);  /* LH2 */
+	rfx_quantization_encode_block_avx2(buffer + 3584, 256, quantization_values[6] - 6);  /* HH2 */
+	rfx_quantization_encode_block_avx2(buffer + 3840, 64, quantization_values[2] - 6);   /* HL3 */
+	rfx_quantization_encode_block_avx2(buffer + 3904, 64, quantization_values[1] - 6);   /* LH3 */
+	rfx_quantization_encode_block_avx2(buffer + 3968, 64, quantization_values[3] - 6);   /* HH3 */
+	rfx_quantization_encode_block_avx2(buffer + 4032, 64, quantization_values[0] - 6);   /* LL3 */
+}
+
+static inline void rfx_dwt_2d_decode_block_horiz_avx2(const INT16* WINPR_RESTRICT l,
+                                                      const INT16* WINPR_RESTRICT h,
+                                                      INT16* WINPR_RESTRICT dst,
+                                                      size_t subband_width)
+{
+	const __m256i one = _mm256_set1_epi16(1);
+
+	if (subband_width == 8)
+	{
+		for (size_t y = 0; y < subband_width; y += 2)
+		{
+			/* dst[2n] = l[n] - ((h[n-1] + h[n] + 1) >> 1); */
+			const __m256i l_n = mm256_load(l);
+			const __m256i h_n = mm256_load(h);
+			const __m256i h_n_m = mm256_lane_mirror_first(h_n);
+			__m256i tmp_n = _mm256_add_epi16(_mm256_add_epi16(h_n, h_n_m), one);
+			const __m256i dst_n = _mm256_sub_epi16(l_n, _mm256_srai_epi16(tmp_n, 1));
+
+			/* dst[2n + 1] = (h[n] << 1) + ((dst[2n] + dst[2n + 2]) >> 1); */
+			const __m256i dst_n_p = mm256_lane_mirror_last(dst_n);
+			tmp_n = _mm256_srai_epi16(_mm256_add_epi16(dst_n_p, dst_n), 1);
+			tmp_n = _mm256_add_epi16(tmp_n, _mm256_slli_epi16(h_n, 1));
+			mm256_interleave(dst, dst_n, tmp_n);
+			l += 16;
+			h += 16;
+			dst += 32;
+		}
+
+		return;
+	}
+
+	for (size_t y = 0; y < subband_width; y++)
+	{
+		__m256i h_n = mm256_load(h);
+		__m256i h_n_m = mm256_shift_in_first(h_n, _mm256_set1_epi16(h[0]));
+		__m256i tmp_n = _mm256_add_epi16(_mm256_add_epi16(h_n, h_n_m), one);
+		__m256i dst_n = _mm256_sub_epi16(mm256_load(l), _mm256_srai_epi16(tmp_n, 1));
+
+		for (size_t n = 0; n < subband_width; n += 16)
+		{
+			__m256i dst_n_p = _mm256_setzero_si256();
+			__m256i next = _mm256_setzero_si256();
+			__m256i h_next = _mm256_setzero_si256();
+
+			if (n + 16 < subband_width)
+			{
+				/* even coefficients of the next block */
+				h_next = mm256_load(h + 16);
+				h_n_m = mm256_shift_in_first(h_next, h_n);
+				tmp_n = _mm256_add_epi16(_mm256_add_epi16(h_next, h_n_m), one);
+				next = _mm256_sub_epi16(mm256_load(l + 16), _mm256_srai_epi16(tmp_n, 1));
+				dst_n_p = mm256_shift_in_last(dst_n, next);
+			}
+			else
+				dst_n_p = mm256_shift_in_last(dst_n, _mm256_set1_epi16(
+				                                         (INT16)_mm256_extract_epi16(dst_n, 15)));
+
+			tmp_n = _mm256_srai_epi16(_mm256_add_epi16(dst_n_p, dst_n), 1);
+			tmp_n = _mm256_add_epi16(tmp_n, _mm256_slli_epi16(h_n, 1));
+			mm256_interleave(dst, dst_n, tmp_n);
+			dst_n = next;
+			h_n = h_next;
+			l += 16;
+			h += 16;
+			dst += 32;
+		}
+	}
+}
+
+static inline void rfx_dwt_2d_decode_block_vert_avx2(const INT16* WINPR_RESTRICT l,
+                                                     const INT16* WINPR_RESTRICT h,
+                                                     INT16* WINPR_RESTRICT dst,
+                                                     size_t subband_width)
+{
+	const size_t total_width = subband_width + subband_width;
+	const __m256i one = _mm256_set1_epi16(1);
+
+	for (size_t x = 0; x < total_width; x += 16)
+	{
+		const INT16* l_ptr = l + x;
+		const INT16* h_ptr = h + x;
+		INT16* dst_ptr = dst + x;
+		__m256i h_n_m = mm256_load(h_ptr);
+
+		/* dst[2n] = l[n] - ((h[n-1] + h[n] + 1) >> 1); */
+		__m256i tmp_n = _mm256_add_epi16(_mm256_add_epi16(h_n_m, one), h_n_m);
+		__m256i dst_n = _mm256_sub_epi16(mm256_load(l_ptr), _mm256_srai_epi16(tmp_n, 1));
+		mm256_store(dst_ptr, dst_n);
+
+		for (size_t n = 1; n < subband_width; n++)
+		{
+			l_ptr += total_width;
+			h_ptr += total_width;
+
+			const __m256i h_n = mm256_load(h_ptr);
+			tmp_n = _mm256_add_epi16(_mm256_add_epi16(h_n, one), h_n_m);
+			const __m256i dst_n_p =
+			    _mm256_sub_epi16(mm256_load(l_ptr), _mm256_srai_epi16(tmp_n, 1));
+
+			/* dst[2n + 1] = (h[n] << 1) + ((dst[2n] + dst[2n + 2]) >> 1); */
+			tmp_n = _mm256_srai_epi16(_mm256_add_epi16(dst_n, dst_n_p), 1);
+			tmp_n = _mm256_add_epi16(tmp_n, _mm256_slli_epi16(h_n_m, 1));
+			mm256_store(dst_ptr + total_width, tmp_n);
+			mm256_store(dst_ptr + 2 * total_width, dst_n_p);
+			dst_ptr += 2 * total_width;
+			dst_n = dst_n_p;
+			h_n_m = h_n;
+		}
+
+		tmp_n = _mm256_srai_epi16(_mm256_add_epi16(dst_n, dst_n), 1);
+		tmp_n = _mm256_add_epi16(tmp_n, _mm256_slli_epi16(h_n_m, 1));
+		mm256_store(dst_ptr + total_width, tmp_n);
+	}
+}
+
+static inline void rfx_dwt_2d_decode_block_avx2(INT16* WINPR_RESTRICT buffer,
+                                                INT16* WINPR_RESTRICT idwt, size_t subband_width)
+{
+	/* Inverse DWT in horizontal direction, results in 2 sub-bands in L, H order in tmp buffer idwt.
+	 */
+	/* The 4 sub-bands are stored in HL(0), LH(1), HH(2), LL(3) order. */
+	/* The lower part L uses LL(3) and HL(0). */
+	/* The higher part H uses LH(1) and HH(2). */
+	const INT16* ll = buffer + 3ULL * subband_width * subband_width;
+	const INT16* hl = buffer;
+	INT16* l_dst = idwt;
+	rfx_dwt_2d_decode_block_horiz_avx2(ll, hl, l_dst, subband_width);
+	const INT16* lh = buffer + 1ULL * subband_width * subband_width;
+	const INT16* hh = buffer + 2ULL * subband_width * subband_width;
+	INT16* h_dst = idwt + 2ULL * subband_width * subband_width;
+	rfx_dwt_2d_decode_block_horiz_avx2(lh, hh, h_dst, subband_width);
+	/* Inverse DWT in vertical direction, results are stored in original buffer. */
+	rfx_dwt_2d_decode_block_vert_avx2(l_dst, h_dst, buffer, subband_width);
+}
+
+static void rfx_dwt_2d_decode_avx2(INT16* WINPR_RESTRICT buffer, INT16* WINPR_RESTRICT dwt_buffer)
+{
+	WINPR_ASSERT(buffer);
+	WINPR_ASSERT(dwt_buffer);
+
+	rfx_dwt_2d_decode_block_avx2(&buffer[3840], dwt_buffer, 8);
+	rfx_dwt_2d_decode_block_avx2(&buffer[3072], dwt_buffer, 16);
+	rfx_dwt_2d_decode_block_avx2(&buffer[0], dwt_buffer, 32);
+}
+
+static inline void rfx_dwt_2d_encode_block_vert_avx2(const INT16* WINPR_RESTRICT src,
+                                                     INT16* WINPR_RESTRICT l,
+                                                     INT16* WINPR_RESTRICT h, size_t subband_width)
+{
+	const size_t total_width = subband_width << 1;
+
+	for (size_t x = 0; x < total_width; x += 16)
+	{
+		const INT16* src_ptr = src + x;
+		INT16* l_ptr = l + x;
+		INT16* h_ptr = h + x;
+		__m256i src_2n = mm256_load(src_ptr);
+		__m256i h_n_m = _mm256_setzero_si256();
+
+		for (size_t n = 0; n < subband_width; n++)
+		{
+			const __m256i src_2n_1 = mm256_load(src_ptr + total_width);
+			__m256i src_2n_2 = src_2n;
+
+			if (n < subband_width - 1)
+				src_2n_2 = mm256_load(src_ptr + 2ULL * total_width);
+
+			/* h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1 */
+			__m256i h_n = _mm256_srai_epi16(_mm256_add_epi16(src_2n, src_2n_2), 1);
+			h_n = _mm256_srai_epi16(_mm256_sub_epi16(src_2n_1, h_n), 1);
+			mm256_store(h_ptr, h_n);
+
+			if (n == 0)
+				h_n_m = h_n;
+
+			/* l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1) */
+			__m256i l_n = _mm256_srai_epi16(_mm256_add_epi16(h_n_m, h_n), 1);
+			l_n = _mm256_add_epi16(l_n, src_2n);
+			mm256_store(l_ptr, l_n);
+			src_2n = src_2n_2;
+			h_n_m = h_n;
+			src_ptr += 2ULL * total_width;
+			l_ptr += total_width;
+			h_ptr += total_width;
+		}
+	}
+}
+
+static inline void rfx_dwt_2d_encode_block_horiz_avx2(const INT16* WINPR_RESTRICT src,
+                                                      INT16* WINPR_RESTRICT l,
+                                                      INT16* WINPR_RESTRICT h,
+                                                      size_t subband_width)
+{
+	__m256i src_2n = _mm256_setzero_si256();
+	__m256i src_2n_1 = _mm256_setzero_si256();
+
+	if (subband_width == 8)
+	{
+		for (size_t y = 0; y < subband_width; y += 2)
+		{
+			mm256_deinterleave(src, &src_2n, &src_2n_1);
+			const __m256i src_2n_2 = mm256_lane_mirror_last(src_2n);
+
+			/* h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1 */
+			__m256i h_n = _mm256_srai_epi16(_mm256_add_epi16(src_2n, src_2n_2), 1);
+			h_n = _mm256_srai_epi16(_mm256_sub_epi16(src_2n_1, h_n), 1);
+			mm256_store(h, h_n);
+
+			/* l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1) */
+			const __m256i h_n_m = mm256_lane_mirror_first(h_n);
+			__m256i l_n = _mm256_srai_epi16(_mm256_add_epi16(h_n_m, h_n), 1);
+			l_n = _mm256_add_epi16(l_n, src_2n);
+			mm256_store(l, l_n);
+			src += 32;
+			l += 16;
+			h += 16;
+		}
+
+		return;
+	}
+
+	for (size_t y = 0; y < subband_width; y++)
+	{
+		__m256i h_n_m = _mm256_setzero_si256();
+
+		for (size_t n = 0; n < subband_width; n += 16)
+		{
+			const INT16 src16 = ((n + 16) == subband_width) ? src[30] : src[32];
+			mm256_deinterleave(src, &src_2n, &src_2n_1);
+			const __m256i src_2n_2 = mm256_shift_in_last(src_2n, _mm256_set1_epi16(src16));
+
+			/* h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1 */
+			__m256i h_n = _mm256_srai_epi16(_mm256_add_epi16(src_2n, src_2n_2), 1);
+			h_n = _mm256_srai_epi16(_mm256_sub_epi16(src_2n_1, h_n), 1);
+			mm256_store(h, h_n);
+
+			if (n == 0)
+				h_n_m = _mm256_broadcastw_epi16(_mm256_castsi256_si128(h_n));
+
+			/* l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1) */
+			__m256i l_n = mm256_shift_in_first(h_n, h_n_m);
+			l_n = _mm256_srai_epi16(_mm256_add_epi16(l_n, h_n), 1);
+			l_n = _mm256_add_epi16(l_n, src_2n);
+			mm256_store(l, l_n);
+			h_n_m = h_n;
+			src += 32;
+			l += 16;
+			h += 16;
+		}
+	}
+}
+
+static inline void rfx_dwt_2d_encode_block_avx2(INT16* WINPR_RESTRICT buffer,
+                                                INT16* WINPR_RESTRICT dwt, size_t subband_width)
+{
+	/* DWT in vertical direction, results in 2 sub-bands in L, H order in tmp buffer dwt. */
+	INT16* l_src = dwt;
+	INT16* h_src = dwt + 2ULL * subband_width * subband_width;
+	rfx_dwt_2d_encode_block_vert_avx2(buffer, l_src, h_src, subband_width);
+	/* DWT in horizontal direction, results in 4 sub-bands in HL(0), LH(1), HH(2), LL(3) order,
+	 * stored in original buffer. */
+	/* The lower part L generates LL(3) and HL(0). */
+	/* The higher part H generates LH(1) and HH(2). */
+	INT16* ll = buffer + 3ULL * subband_width * subband_width;
+	INT16* hl = buffer;
+	INT16* lh = buffer + 1ULL * subband_width * subband_width;
+	INT16* hh = buffer + 2ULL * subband_width * subband_width;
+	rfx_dwt_2d_encode_block_horiz_avx2(l_src, ll, hl, subband_width);
+	rfx_dwt_2d_encode_block_horiz_avx2(h_src, lh, hh, subband_width);
+}
+
+static void rfx_dwt_2d_encode_avx2(INT16* WINPR_RESTRICT buffer, INT16* WINPR_RESTRICT dwt_buffer)
+{
+	WINPR_ASSERT(buffer);
+	WINPR_ASSERT(dwt_buffer);
+
+	rfx_dwt_2d_encode_block_avx2(buffer, dwt_buffer, 32);
+	rfx_dwt_2d_encode_block_avx2(buffer + 3072, dwt_buffer, 16);
+	rfx_dwt_2d_encode_block_avx2(buffer + 3840, dwt_buffer, 8);
+}
+#endif
+
+void rfx_init_avx2_int(RFX_CONTEXT* WINPR_RESTRICT context)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	PROFILER_RENAME(context->priv->prof_rfx_quantization_decode, "rfx_quantization_decode_avx2")
+	PROFILER_RENAME(context->priv->prof_rfx_quantization_encode, "rfx_quantization_encode_avx2")
+	PROFILER_RENAME(context->priv->prof_rfx_dwt_2d_decode, "rfx_dwt_2d_decode_avx2")
+	PROFILER_RENAME(context->priv->prof_rfx_dwt_2d_encode, "rfx_dwt_2d_encode_avx2")
+	context->quantization_decode = rfx_quantization_decode_avx2;
+	context->quantization_encode = rfx_quantization_encode_avx2;
+	context->dwt_2d_decode = rfx_dwt_2d_decode_avx2;
+	context->dwt_2d_encode = rfx_dwt_2d_encode_avx2;
+#else
+	WINPR_UNUSED(context);
+#endif
+}
@@ -0,0 +1,163 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * XCrush (RDP6.1) Bulk Data Compression - SSE2 Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/assert.h>
+#include <winpr/crt.h>
+
+#include <freerdp/config.h>
+#include <freerdp/types.h>
+
+#include "xcrush_sse2.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <emmintrin.h>
+
+#define XCRUSH_SSE2_BLOCK 1024
+
+/*
+ * The chunk accumulator is updated as acc = rotl(acc, 1) ^ s[t] with
+ * s[t] = data[t] ^ data[t - 32] (data[t] for t < 32). After 32 steps every
+ * input has been rotated back to its original position, so
+ *
+ *   acc[t] = acc[t - 32] ^ XOR(k = 0..31) rotl(s[t - k], k)
+ *
+ * Only the low 7 bits are tested. An 8 bit input rotated by k reaches them
+ * for k <= 6 (shifted left) and for k >= 25 (shifted right by 32 - k), which
+ * leaves 14 taps that can be evaluated for 16 positions at a time.
+ */
+
+static INLINE BYTE xcrush_input(const BYTE* WINPR_RESTRICT data, size_t t)
+{
+	return (t >= 32) ? (BYTE)(data[t] ^ data[t - 32]) : data[t];
+}
+
+static INLINE BYTE xcrush_window(const BYTE* WINPR_RESTRICT data, size_t t)
+{
+	BYTE value = 0;
+
+	for (size_t k = 0; (k <= 6) && (k <= t); k++)
+		value ^= (BYTE)((xcrush_input(data, t - k) << k) & 0x7F);
+
+	for (size_t r = 1; r <= 7; r++)
+	{
+		if (t + r >= 32)
+			value ^= (BYTE)((xcrush_input(data, t + r - 32) >> r) & 0x7F);
+	}
+
+	return value;
+}
+
+/* 16 bit shifts, the mask drops the bits crossing over from the neighbouring byte */
+static INLINE __m128i xcrush_tap_left(const BYTE* WINPR_RESTRICT input, int k)
+{
+	const __m128i val = _mm_loadu_si128((const __m128i*)&input[32 - k]);
+	const __m128i mask = _mm_set1_epi8((char)(0x7F & (0xFF << k)));
+	return _mm_and_si128(_mm_sll_epi16(val, _mm_cvtsi32_si128(k)), mask);
+}
+
+static INLINE __m128i xcrush_tap_right(const BYTE* WINPR_RESTRICT input, int r)
+{
+	const __m128i val = _mm_loadu_si128((const __m128i*)&input[r]);
+	const __m128i mask = _mm_set1_epi8((char)(0xFF >> r));
+	return _mm_and_si128(_mm_srl_epi16(val, _mm_cvtsi32_si128(r)), mask);
+}
+
+/* taps of 16 consecutive positions, input points at the input of the first one minus 32 */
+static INLINE __m128i xcrush_window_sse2(const BYTE* WINPR_RESTRICT input)
+{
+	__m128i left = xcrush_tap_left(input, 0);
+	__m128i right = xcrush_tap_right(input, 1);
+
+	left = _mm_xor_si128(left, xcrush_tap_left(input, 1));
+	right = _mm_xor_si128(right, xcrush_tap_right(input, 2));
+	left = _mm_xor_si128(left, xcrush_tap_left(input, 2));
+	right = _mm_xor_si128(right, xcrush_tap_right(input, 3));
+	left = _mm_xor_si128(left, xcrush_tap_left(input, 3));
+	right = _mm_xor_si128(right, xcrush_tap_right(input, 4));
+	left = _mm_xor_si128(left, xcrush_tap_left(input, 4));
+	right = _mm_xor_si128(right, xcrush_tap_right(input, 5));
+	left = _mm_xor_si128(left, xcrush_tap_left(input, 5));
+	right = _mm_xor_si128(right, xcrush_tap_right(input, 6));
+	left = _mm_xor_si128(left, xcrush_tap_left(input, 6));
+	right = _mm_xor_si128(right, xcrush_tap_right(input, 7));
+	return _mm_xor_si128(left, right);
+}
+
+void xcrush_compute_chunk_boundaries_sse2(const BYTE* WINPR_RESTRICT data, UINT32 count,
+                                          UINT64* WINPR_RESTRICT boundaries)
+{
+	WINPR_ASSERT(data);
+	WINPR_ASSERT(boundaries);
+	WINPR_ASSERT(count >= 64);
+
+	const size_t end = 32ull + count;
+	BYTE ring[32] = { 0 };
+	size_t t = 0;
+
+	/* the first 64 positions read before the start of data, evaluate them one by one */
+	for (; t < 64; t++)
+	{
+		const BYTE value = ring[t % 32] ^ xcrush_window(data, t);
+		ring[t % 32] = value;
+
+		if ((t >= 32) && (value == 0))
+			boundaries[t / 64] |= 1ull << (t % 64);
+	}
+
+	__m128i lo = _mm_loadu_si128((const __m128i*)&ring[0]);
+	__m128i hi = _mm_loadu_si128((const __m128i*)&ring[16]);
+	const __m128i zero = _mm_setzero_si128();
+
+	while (t + 32 <= end)
+	{
+		BYTE input[XCRUSH_SSE2_BLOCK + 32];
+		const size_t length = MIN(XCRUSH_SSE2_BLOCK, (end - t) & ~(size_t)31);
+
+		/* inputs of the positions t - 32 to t + length - 1 */
+		for (size_t x = 0; x < length + 32; x += 16)
+		{
+			const __m128i cur = _mm_loadu_si128((const __m128i*)&data[t - 32 + x]);
+			const __m128i old = _mm_loadu_si128((const __m128i*)&data[t - 64 + x]);
+			_mm_storeu_si128((__m128i*)&input[x], _mm_xor_si128(cur, old));
+		}
+
+		for (size_t x = 0; x < length; x += 32)
+		{
+			lo = _mm_xor_si128(lo, xcrush_window_sse2(&input[x]));
+			hi = _mm_xor_si128(hi, xcrush_window_sse2(&input[x + 16]));
+
+			const UINT64 mlo = (UINT32)_mm_movemask_epi8(_mm_cmpeq_epi8(lo, zero));
+			const UINT64 mhi = (UINT32)_mm_movemask_epi8(_mm_cmpeq_epi8(hi, zero));
+			boundaries[(t + x) / 64] |= (mlo | (mhi << 16)) << ((t + x) % 64);
+		}
+
+		t += length;
+	}
+
+	_mm_storeu_si128((__m128i*)&ring[0], lo);
+	_mm_storeu_si128((__m128i*)&ring[16], hi);
+
+	for (; t < end; t++)
+	{
+		const BYTE value = ring[t % 32] ^ xcrush_window(data, t);
+		ring[t % 32] = value;
+
+		if (value == 0)
+			boundaries[t / 64] |= 1ull << (t % 64);
+	}
+}
+#endif
@@ -156,6 +156,115 @@ fail:
 	return rc;
 }
 
+/* window borders, text and a gradient, exercising runs, fg/bg images and color images */
+static void fill_screen(BYTE* data, UINT32 format, size_t step, UINT32 w, UINT32 h)
+{
+	const size_t bpp = FreeRDPGetBytesPerPixel(format);
+	UINT32 seed = w * h;
+
+	for (UINT32 y = 0; y < h; y++)
+	{
+		for (UINT32 x = 0; x < w; x++)
+		{
+			UINT32 color = FreeRDPGetColor(format, 0xF0, 0xF0, 0xF0, 0xFF);
+			seed = seed * 1103515245u + 12345u;
+
+			if ((y % 100 < 20) && (x % 300 < 200))
+				color = FreeRDPGetColor(format, 0x20, 0x40, (BYTE)(x + y), 0xFF);
+			else if ((y % 100 > 40) && (y % 100 < 52) && ((seed >> 16) % 3 == 0))
+				color = FreeRDPGetColor(format, 0, 0, 0, 0xFF);
+			else if ((y % 100 > 60) && (y % 100 < 64))
+				color = ((x + y) % 2) ? FreeRDPGetColor(format, 0xFF, 0, 0, 0xFF)
+				                      : FreeRDPGetColor(format, 0, 0, 0xFF, 0xFF);
+			else if (y % 100 > 90)
+				color = FreeRDPGetColor(format, (BYTE)(seed >> 16), (BYTE)(seed >> 8),
+				                        (BYTE)(seed >> 24), 0xFF);
+
+			FreeRDPWriteColor(&data[y * step + x * bpp], format, color);
+		}
+	}
+}
+
+static BOOL run_encode_decode_screen(UINT16 bpp, UINT32 w, UINT32 h,
+                                     BITMAP_INTERLEAVED_CONTEXT* encoder,
+                                     BITMAP_INTERLEAVED_CONTEXT* decoder)
+{
+	BOOL rc = FALSE;
+	const UINT32 format = (bpp == 8) ? PIXEL_FORMAT_RGB8 : PIXEL_FORMAT_BGRX32;
+	const UINT32 DstFormat = PIXEL_FORMAT_BGRX32;
+	const size_t step = 4ULL * (w + 7);
+	const size_t SrcSize = step * (h + 3);
+	const int maxDiff = 4 * ((bpp < 24) ? 2 : 1);
+	UINT32 DstSize = (UINT32)(SrcSize + 1024);
+	BYTE* pSrcData = calloc(1, SrcSize);
+	BYTE* pDstData = calloc(1, SrcSize);
+	BYTE* tmp = calloc(1, DstSize);
+	gdiPalette palette = { 0 };
+
+	if (!pSrcData || !pDstData || !tmp)
+		goto fail;
+
+	/* the 8 bpp test data are palette indices, any palette does */
+	palette.format = PIXEL_FORMAT_BGRX32;
+	for (size_t x = 0; x < ARRAYSIZE(palette.palette); x++)
+		palette.palette[x] = (UINT32)(x * 0x010101);
+
+	if (bpp == 8)
+	{
+		for (size_t y = 0; y < h + 3; y++)
+		{
+			for (size_t x = 0; x < w; x++)
+				pSrcData[y * step + x] = (BYTE)(((y % 7) < 3) ? (x / 5) : ((x * y) % 3));
+		}
+	}
+	else
+		fill_screen(pSrcData, format, step, w, h + 3);
+
+	if (!interleaved_compress(encoder, tmp, &DstSize, w, h, pSrcData, format, step, 3, 2,
+	                          &palette, bpp))
+		goto fail;
+
+	if (!interleaved_decompress(decoder, tmp, DstSize, w, h, bpp, pDstData, DstFormat, step, 3,
+	                            2, w, h, &palette))
+		goto fail;
+
+	for (UINT32 i = 2; i < h + 2; i++)
+	{
+		const BYTE* srcLine = &pSrcData[i * step];
+		const BYTE* dstLine = &pDstData[i * step];
+
+		for (UINT32 j = 3; j < w + 3; j++)
+		{
+			BYTE r = 0;
+			BYTE g = 0;
+			BYTE b = 0;
+			BYTE dr = 0;
+			BYTE dg = 0;
+			BYTE db = 0;
+			const UINT32 srcColor =
+			    FreeRDPReadColor(&srcLine[1ULL * j * FreeRDPGetBytesPerPixel(format)], format);
+			const UINT32 dstColor = FreeRDPReadColor(&dstLine[4ULL * j], DstFormat);
+			FreeRDPSplitColor(srcColor, format, &r, &g, &b, NULL, &palette);
+			FreeRDPSplitColor(dstColor, DstFormat, &dr, &dg, &db, NULL, NULL);
+
+			if ((abs(r - dr) > maxDiff) || (abs(g - dg) > maxDiff) || (abs(b - db) > maxDiff))
+			{
+				(void)fprintf(stderr, "%" PRIu16 " bpp %" PRIu32 "x%" PRIu32
+				                      " differs at %" PRIu32 "x%" PRIu32 "\n",
+				              bpp, w, h, j, i);
+				goto fail;
+			}
+		}
+	}
+
+	rc = TRUE;
+fail:
+	free(pSrcData);
+	free(pDstData);
+	free(tmp);
+	return rc;
+}
+
 static BOOL TestColorConversion(void)
 {
 	const UINT32 formats[] = { PIXEL_FORMAT_RGB15,  PIXEL_FORMAT_BGR15, PIXEL_FORMAT_ABGR15,
@@ -208,6 +317,20 @@ int TestFreeRDPCodecInterleaved(int argc, char* argv[])
 	if (!run_encode_decode(15, encoder, decoder))
 		goto fail;
 
+	{
+		const UINT16 bpps[] = { 8, 15, 16, 24 };
+		const UINT32 sizes[][2] = { { 4, 1 }, { 12, 3 }, { 64, 64 }, { 132, 67 }, { 1024, 768 } };
+
+		for (size_t x = 0; x < ARRAYSIZE(bpps); x++)
+		{
+			for (size_t y = 0; y < ARRAYSIZE(sizes); y++)
+			{
+				if (!run_encode_decode_screen(bpps[x], sizes[y][0], sizes[y][1], encoder, decoder))
+					goto fail;
+			}
+		}
+	}
+
 	if (!TestColorConversion())
 		goto fail;
 
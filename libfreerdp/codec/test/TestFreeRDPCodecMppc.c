@@ -4,6 +4,7 @@
 
 #include <freerdp/freerdp.h>
 #include <freerdp/log.h>
+#include <freerdp/utils/profiler.h>
 
 #include "../mppc.h"
 
@@ -988,6 +989,8 @@ static int test_MppcCompressBufferRdp5(void)
 	if (!mppc)
 		return -1;
 
+	/* a single way follows the reference encoder bit for bit */
+	mppc_set_match_ways(mppc, 1);
 	status = mppc_compress(mppc, pSrcData, SrcSize, OutputBuffer, &pDstData, &DstSize, &Flags);
 
 	if (status < 0)
@@ -1063,8 +1066,158 @@ fail:
 	return rc;
 }
 
+#define TEST_CORPUS_PACKETS 64
+
+static UINT32 test_rand(UINT32* state)
+{
+	*state = *state * 1103515245u + 12345u;
+	return *state >> 8;
+}
+
+/* drawing order like records: fixed layout, a few changing fields */
+static size_t test_fill_orders(BYTE* data, size_t size, UINT32* state)
+{
+	size_t x = 0;
+
+	for (size_t record = 0; x + 16 <= size; record++)
+	{
+		const UINT32 r = test_rand(state);
+		data[x++] = 0x09;
+		data[x++] = (BYTE)(r % 6);
+		data[x++] = 0x1F;
+		data[x++] = 0x00;
+		data[x++] = (BYTE)record;
+		data[x++] = (BYTE)(record >> 8);
+		data[x++] = (BYTE)(r >> 8);
+		data[x++] = 0x00;
+		data[x++] = 0x40;
+		data[x++] = 0x00;
+		data[x++] = 0x12;
+		data[x++] = 0x00;
+		data[x++] = (BYTE)(r >> 16);
+		data[x++] = 0xCC;
+		data[x++] = 0xCC;
+		data[x++] = 0xFF;
+	}
+
+	return x;
+}
+
+/* 32bpp scanlines: flat areas, gradients and noise */
+static size_t test_fill_bitmap(BYTE* data, size_t size, UINT32* state)
+{
+	for (size_t x = 0; x < size; x += 4)
+	{
+		const size_t pixel = x / 4;
+		const size_t col = pixel % 256;
+		BYTE value = 0xF0;
+
+		if (col >= 192)
+			value = (BYTE)test_rand(state);
+		else if (col >= 64)
+			value = (BYTE)(col + (pixel / 256));
+
+		for (size_t y = 0; (y < 4) && (x + y < size); y++)
+			data[x + y] = (y == 3) ? 0xFF : value;
+	}
+
+	return size;
+}
+
+/* text with a small vocabulary */
+static size_t test_fill_text(BYTE* data, size_t size, UINT32* state)
+{
+	const char* words[] = { "the ",    "remote ", "desktop ", "protocol ", "bulk ",
+		                    "update ", "order ",  "glyph ",   "cache ",    "bitmap " };
+	size_t x = 0;
+
+	while (x < size)
+	{
+		const char* word = words[test_rand(state) % ARRAYSIZE(words)];
+		const size_t len = MIN(strlen(word), size - x);
+		memcpy(&data[x], word, len);
+		x += len;
+	}
+
+	return x;
+}
+
+static BOOL test_MppcRoundTrip(const char* name,
+                               size_t (*fill)(BYTE* data, size_t size, UINT32* state),
+                               UINT32 CompressionLevel, UINT32 MatchWays)
+{
+	BOOL rc = FALSE;
+	UINT32 state = 42;
+	UINT64 totalSrc = 0;
+	UINT64 totalDst = 0;
+	const size_t maxSize = CompressionLevel ? 15000 : 6000;
+	BYTE* data = calloc(16384, sizeof(BYTE));
+	BYTE* buffer = calloc(65536, sizeof(BYTE));
+	MPPC_CONTEXT* encoder = mppc_context_new(CompressionLevel, TRUE);
+	MPPC_CONTEXT* decoder = mppc_context_new(CompressionLevel, FALSE);
+	char pname[64] = { 0 };
+
+	PROFILER_DEFINE(profiler)
+	(void)_snprintf(pname, sizeof(pname), "MPPC RDP%d %-7s ways %" PRIu32,
+	                CompressionLevel ? 5 : 4, name, MatchWays);
+	PROFILER_CREATE(profiler, pname)
+
+	if (!data || !buffer || !encoder || !decoder)
+		goto fail;
+
+	mppc_set_match_ways(encoder, MatchWays);
+
+	for (size_t i = 0; i < TEST_CORPUS_PACKETS; i++)
+	{
+		UINT32 Flags = 0;
+		const BYTE* pDstData = NULL;
+		const BYTE* pDecData = NULL;
+		UINT32 DecSize = 0;
+		UINT32 DstSize = 65536;
+		const UINT32 SrcSize = (UINT32)fill(data, 1024 + (test_rand(&state) % maxSize), &state);
+
+		PROFILER_ENTER(profiler)
+		const int status =
+		    mppc_compress(encoder, data, SrcSize, buffer, &pDstData, &DstSize, &Flags);
+		PROFILER_EXIT(profiler)
+
+		if (status < 0)
+			goto fail;
+
+		totalSrc += SrcSize;
+		totalDst += DstSize;
+
+		if (mppc_decompress(decoder, pDstData, DstSize, &pDecData, &DecSize, Flags) < 0)
+			goto fail;
+
+		if ((DecSize != SrcSize) || (memcmp(pDecData, data, SrcSize) != 0))
+		{
+			printf("MPPC %s round trip mismatch at packet %" PRIuz ", ways %" PRIu32 "\n", name,
+			       i, MatchWays);
+			goto fail;
+		}
+	}
+
+	printf("MPPC RDP%d %-7s ways %" PRIu32 ": %" PRIu64 " -> %" PRIu64 " bytes (%.2f%%)\n",
+	       CompressionLevel ? 5 : 4, name, MatchWays, totalSrc, totalDst,
+	       100.0 * (double)totalDst / (double)totalSrc);
+	rc = TRUE;
+fail:
+	PROFILER_PRINT_HEADER
+	PROFILER_PRINT(profiler)
+	PROFILER_PRINT_FOOTER
+	PROFILER_FREE(profiler)
+	mppc_context_free(encoder);
+	mppc_context_free(decoder);
+	free(data);
+	free(buffer);
+	return rc;
+}
+
 int TestFreeRDPCodecMppc(int argc, char* argv[])
 {
+	const UINT32 ways[] = { 1, 2, 0, 8 };
+
 	WINPR_UNUSED(argc);
 	WINPR_UNUSED(argv);
 
@@ -1089,5 +1242,20 @@ int TestFreeRDPCodecMppc(int argc, char* argv[])
 	if (test_MppcDecompressBufferRdp5() < 0)
 		return -1;
 
+	for (UINT32 level = 0; level < 2; level++)
+	{
+		for (size_t x = 0; x < ARRAYSIZE(ways); x++)
+		{
+			if (!test_MppcRoundTrip("orders", test_fill_orders, level, ways[x]))
+				return -1;
+
+			if (!test_MppcRoundTrip("bitmap", test_fill_bitmap, level, ways[x]))
+				return -1;
+
+			if (!test_MppcRoundTrip("text", test_fill_text, level, ways[x]))
+				return -1;
+		}
+	}
+
 	return 0;
 }
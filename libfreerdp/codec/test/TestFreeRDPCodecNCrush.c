@@ -1,6 +1,8 @@
 #include <winpr/crt.h>
 #include <winpr/print.h>
 
+#include <freerdp/utils/profiler.h>
+
 #include "../ncrush.h"
 
 static const BYTE TEST_BELLS_DATA[] = "for.whom.the.bell.tolls,.the.bell.tolls.for.thee!";
@@ -107,8 +109,155 @@ fail:
 	return rc;
 }
 
+#define TEST_CORPUS_PACKETS 64
+
+static UINT32 test_rand(UINT32* state)
+{
+	*state = *state * 1103515245u + 12345u;
+	return *state >> 8;
+}
+
+/* drawing order like records: fixed layout, a few changing fields */
+static size_t test_fill_orders(BYTE* data, size_t size, UINT32* state)
+{
+	size_t x = 0;
+
+	for (size_t record = 0; x + 16 <= size; record++)
+	{
+		const UINT32 r = test_rand(state);
+		data[x++] = 0x09;
+		data[x++] = (BYTE)(r % 6);
+		data[x++] = 0x1F;
+		data[x++] = 0x00;
+		data[x++] = (BYTE)record;
+		data[x++] = (BYTE)(record >> 8);
+		data[x++] = (BYTE)(r >> 8);
+		data[x++] = 0x00;
+		data[x++] = 0x40;
+		data[x++] = 0x00;
+		data[x++] = 0x12;
+		data[x++] = 0x00;
+		data[x++] = (BYTE)(r >> 16);
+		data[x++] = 0xCC;
+		data[x++] = 0xCC;
+		data[x++] = 0xFF;
+	}
+
+	return x;
+}
+
+/* 32bpp scanlines: flat areas, gradients and noise */
+static size_t test_fill_bitmap(BYTE* data, size_t size, UINT32* state)
+{
+	for (size_t x = 0; x < size; x += 4)
+	{
+		const size_t pixel = x / 4;
+		const size_t col = pixel % 256;
+		BYTE value = 0xF0;
+
+		if (col >= 192)
+			value = (BYTE)test_rand(state);
+		else if (col >= 64)
+			value = (BYTE)(col + (pixel / 256));
+
+		for (size_t y = 0; (y < 4) && (x + y < size); y++)
+			data[x + y] = (y == 3) ? 0xFF : value;
+	}
+
+	return size;
+}
+
+/* text with a small vocabulary */
+static size_t test_fill_text(BYTE* data, size_t size, UINT32* state)
+{
+	const char* words[] = { "the ",    "remote ", "desktop ", "protocol ", "bulk ",
+		                    "update ", "order ",  "glyph ",   "cache ",    "bitmap " };
+	size_t x = 0;
+
+	while (x < size)
+	{
+		const char* word = words[test_rand(state) % ARRAYSIZE(words)];
+		const size_t len = MIN(strlen(word), size - x);
+		memcpy(&data[x], word, len);
+		x += len;
+	}
+
+	return x;
+}
+
+static BOOL test_NCrushRoundTrip(const char* name,
+                                 size_t (*fill)(BYTE* data, size_t size, UINT32* state),
+                                 UINT32 ChainDepth)
+{
+	BOOL rc = FALSE;
+	UINT32 state = 42;
+	UINT64 totalSrc = 0;
+	UINT64 totalDst = 0;
+	BYTE* data = calloc(16384, sizeof(BYTE));
+	BYTE* buffer = calloc(65536, sizeof(BYTE));
+	NCRUSH_CONTEXT* encoder = ncrush_context_new(TRUE);
+	NCRUSH_CONTEXT* decoder = ncrush_context_new(FALSE);
+	char pname[64] = { 0 };
+
+	PROFILER_DEFINE(profiler)
+	(void)_snprintf(pname, sizeof(pname), "NCRUSH %-7s depth %3" PRIu32, name, ChainDepth);
+	PROFILER_CREATE(profiler, pname)
+
+	if (!data || !buffer || !encoder || !decoder)
+		goto fail;
+
+	ncrush_set_chain_depth(encoder, ChainDepth);
+
+	for (size_t i = 0; i < TEST_CORPUS_PACKETS; i++)
+	{
+		UINT32 Flags = 0;
+		const BYTE* pDstData = NULL;
+		const BYTE* pDecData = NULL;
+		UINT32 DecSize = 0;
+		UINT32 DstSize = 65536;
+		const UINT32 SrcSize = (UINT32)fill(data, 1024 + (test_rand(&state) % 15000), &state);
+
+		PROFILER_ENTER(profiler)
+		const int status =
+		    ncrush_compress(encoder, data, SrcSize, buffer, &pDstData, &DstSize, &Flags);
+		PROFILER_EXIT(profiler)
+
+		if (status < 0)
+			goto fail;
+
+		totalSrc += SrcSize;
+		totalDst += DstSize;
+
+		if (ncrush_decompress(decoder, pDstData, DstSize, &pDecData, &DecSize, Flags) < 0)
+			goto fail;
+
+		if ((DecSize != SrcSize) || (memcmp(pDecData, data, SrcSize) != 0))
+		{
+			printf("NCrush %s round trip mismatch at packet %" PRIuz ", depth %" PRIu32 "\n",
+			       name, i, ChainDepth);
+			goto fail;
+		}
+	}
+
+	printf("NCrush %-7s depth %3" PRIu32 ": %" PRIu64 " -> %" PRIu64 " bytes (%.2f%%)\n", name,
+	       ChainDepth, totalSrc, totalDst, 100.0 * (double)totalDst / (double)totalSrc);
+	rc = TRUE;
+fail:
+	PROFILER_PRINT_HEADER
+	PROFILER_PRINT(profiler)
+	PROFILER_PRINT_FOOTER
+	PROFILER_FREE(profiler)
+	ncrush_context_free(encoder);
+	ncrush_context_free(decoder);
+	free(data);
+	free(buffer);
+	return rc;
+}
+
 int TestFreeRDPCodecNCrush(int argc, char* argv[])
 {
+	const UINT32 depths[] = { 1, 4, 0, 256 };
+
 	WINPR_UNUSED(argc);
 	WINPR_UNUSED(argv);
 
@@ -118,5 +267,17 @@ int TestFreeRDPCodecNCrush(int argc, char* argv[])
 	if (!test_NCrushDecompressBells())
 		return -1;
 
+	for (size_t x = 0; x < ARRAYSIZE(depths); x++)
+	{
+		if (!test_NCrushRoundTrip("orders", test_fill_orders, depths[x]))
+			return -1;
+
+		if (!test_NCrushRoundTrip("bitmap", test_fill_bitmap, depths[x]))
+			return -1;
+
+		if (!test_NCrushRoundTrip("text", test_fill_text, depths[x]))
+			return -1;
+	}
+
 	return 0;
 }
@@ -0,0 +1,254 @@
+#include <freerdp/config.h>
+
+#include <winpr/crt.h>
+#include <winpr/print.h>
+
+#include <freerdp/freerdp.h>
+#include <freerdp/codec/color.h>
+#include <freerdp/codec/planar.h>
+#include <freerdp/utils/profiler.h>
+
+#include "../planar_types.h"
+
+#define TEST_MAX_WIDTH 1024
+
+static UINT32 test_rand(UINT32* state)
+{
+	*state = *state * 1103515245u + 12345u;
+	return *state >> 8;
+}
+
+/* runs of random length mixed with noise, like the delta planes of screen content */
+static void test_fill(BYTE* data, size_t size, UINT32* state)
+{
+	for (size_t x = 0; x < size;)
+	{
+		const size_t run = 1 + test_rand(state) % 40;
+		const size_t length = MIN(size - x, run);
+		const BYTE value = (test_rand(state) % 3 == 0) ? 0 : (BYTE)test_rand(state);
+		const BOOL noise = (test_rand(state) % 2) == 0;
+
+		for (size_t y = 0; y < length; y++)
+			data[x + y] = noise ? (BYTE)test_rand(state) : value;
+
+		x += length;
+	}
+}
+
+static BOOL test_kernels(const BITMAP_PLANAR_CONTEXT* planar, UINT32 width, UINT32* state)
+{
+	const BYTE offsets[][4] = { { 3, 2, 1, 0 }, { 3, 0, 1, 2 }, { 0, 1, 2, 3 }, { 0xFF, 2, 1, 0 } };
+	BYTE src[4 * TEST_MAX_WIDTH + 1] = { 0 };
+	BYTE prev[TEST_MAX_WIDTH + 1] = { 0 };
+	BYTE expected[4][TEST_MAX_WIDTH + 1] = { 0 };
+	BYTE actual[4][TEST_MAX_WIDTH + 1] = { 0 };
+	UINT64 expectedMask[TEST_MAX_WIDTH / 64 + 1] = { 0 };
+	UINT64 actualMask[TEST_MAX_WIDTH / 64 + 1] = { 0 };
+
+	test_fill(src, 4ULL * width, state);
+	test_fill(prev, width, state);
+
+	for (size_t i = 0; i < ARRAYSIZE(offsets); i++)
+	{
+		BYTE* expectedPlanes[4] = { expected[0], expected[1], expected[2], expected[3] };
+		BYTE* actualPlanes[4] = { actual[0], actual[1], actual[2], actual[3] };
+
+		if (offsets[i][0] == 0xFF)
+		{
+			expectedPlanes[0] = NULL;
+			actualPlanes[0] = NULL;
+		}
+
+		/* the byte past the row must not be written */
+		memset(actual, 0xCC, sizeof(actual));
+		memset(expected, 0xCC, sizeof(expected));
+		planar_split_row32_generic(src, width, offsets[i], expectedPlanes);
+		planar->split_row32(src, width, offsets[i], actualPlanes);
+
+		if (memcmp(expected, actual, sizeof(expected)) != 0)
+		{
+			(void)fprintf(stderr, "split of %" PRIu32 " pixels differs\n", width);
+			return FALSE;
+		}
+	}
+
+	memset(actual, 0xCC, sizeof(actual));
+	memset(expected, 0xCC, sizeof(expected));
+	planar_delta_encode_row_generic(src, prev, expected[0], width);
+	planar->delta_encode_row(src, prev, actual[0], width);
+
+	if (memcmp(expected, actual, sizeof(expected)) != 0)
+	{
+		(void)fprintf(stderr, "delta encoding of %" PRIu32 " bytes differs\n", width);
+		return FALSE;
+	}
+
+	planar_match_row_generic(src, width, expectedMask);
+	planar->match_row(src, width, actualMask);
+
+	if (memcmp(expectedMask, actualMask, sizeof(UINT64) * ((width + 63) / 64)) != 0)
+	{
+		(void)fprintf(stderr, "match mask of %" PRIu32 " bytes differs\n", width);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL test_compress(UINT32 format, DWORD flags, UINT32 width, UINT32 height, UINT32* state)
+{
+	BOOL rc = FALSE;
+	UINT32 size = 0;
+	UINT32 genericSize = 0;
+	BYTE* compressed = NULL;
+	BYTE* genericCompressed = NULL;
+	char name[64] = { 0 };
+	const size_t bpp = FreeRDPGetBytesPerPixel(format);
+	BYTE* src = calloc(1ULL * width * height, bpp);
+	BYTE* dst = calloc(1ULL * width * height, bpp);
+	BITMAP_PLANAR_CONTEXT* planar = freerdp_bitmap_planar_context_new(flags, width, height);
+	BITMAP_PLANAR_CONTEXT* generic = freerdp_bitmap_planar_context_new(flags, width, height);
+
+	PROFILER_DEFINE(profiler_encode)
+	PROFILER_DEFINE(profiler_generic)
+	PROFILER_DEFINE(profiler_decode)
+	(void)_snprintf(name, sizeof(name), "planar %s encode", FreeRDPGetColorFormatName(format));
+	PROFILER_CREATE(profiler_encode, name)
+	(void)_snprintf(name, sizeof(name), "planar %s generic", FreeRDPGetColorFormatName(format));
+	PROFILER_CREATE(profiler_generic, name)
+	(void)_snprintf(name, sizeof(name), "planar %s decode", FreeRDPGetColorFormatName(format));
+	PROFILER_CREATE(profiler_decode, name)
+
+	if (!src || !dst || !planar || !generic)
+		goto fail;
+
+	generic->split_row32 = planar_split_row32_generic;
+	generic->delta_encode_row = planar_delta_encode_row_generic;
+	generic->match_row = planar_match_row_generic;
+	freerdp_planar_topdown_image(planar, TRUE);
+	freerdp_planar_topdown_image(generic, TRUE);
+
+	for (size_t i = 0; i < 20; i++)
+	{
+		/* rows repeat with some changes, as text and window borders do */
+		test_fill(src, bpp * width, state);
+
+		for (size_t y = 1; y < height; y++)
+		{
+			BYTE* line = &src[y * width * bpp];
+			memcpy(line, &src[(y - 1) * width * bpp], width * bpp);
+
+			if (test_rand(state) % 4 == 0)
+				test_fill(line, bpp * width, state);
+		}
+
+		free(compressed);
+		free(genericCompressed);
+
+		PROFILER_ENTER(profiler_encode)
+		compressed =
+		    freerdp_bitmap_compress_planar(planar, src, format, width, height, 0, NULL, &size);
+		PROFILER_EXIT(profiler_encode)
+
+		PROFILER_ENTER(profiler_generic)
+		genericCompressed = freerdp_bitmap_compress_planar(generic, src, format, width, height, 0,
+		                                                   NULL, &genericSize);
+		PROFILER_EXIT(profiler_generic)
+
+		if (!compressed || !genericCompressed || (size != genericSize) ||
+		    (memcmp(compressed, genericCompressed, size) != 0))
+		{
+			(void)fprintf(stderr, "%s %" PRIu32 "x%" PRIu32 " differs from the generic encoder\n",
+			              FreeRDPGetColorFormatName(format), width, height);
+			goto fail;
+		}
+
+		PROFILER_ENTER(profiler_decode)
+		const BOOL status = planar_decompress(planar, compressed, size, width, height, dst,
+		                                      format, 0, 0, 0, width, height, FALSE);
+		PROFILER_EXIT(profiler_decode)
+
+		if (!status)
+			goto fail;
+
+		for (size_t x = 0; x < 1ULL * width * height; x++)
+		{
+			BYTE r[2] = { 0 };
+			BYTE g[2] = { 0 };
+			BYTE b[2] = { 0 };
+			BYTE a[2] = { 0 };
+
+			FreeRDPSplitColor(FreeRDPReadColor(&src[x * bpp], format), format, &r[0], &g[0],
+			                  &b[0], &a[0], NULL);
+			FreeRDPSplitColor(FreeRDPReadColor(&dst[x * bpp], format), format, &r[1], &g[1],
+			                  &b[1], &a[1], NULL);
+
+			if ((r[0] != r[1]) || (g[0] != g[1]) || (b[0] != b[1]) ||
+			    (!(flags & PLANAR_FORMAT_HEADER_NA) && (a[0] != a[1])))
+			{
+				(void)fprintf(stderr, "%s %" PRIu32 "x%" PRIu32 " round trip failed at %" PRIuz
+				                      "\n",
+				              FreeRDPGetColorFormatName(format), width, height, x);
+				goto fail;
+			}
+		}
+	}
+
+	rc = TRUE;
+fail:
+	PROFILER_PRINT_HEADER
+	PROFILER_PRINT(profiler_encode)
+	PROFILER_PRINT(profiler_generic)
+	PROFILER_PRINT(profiler_decode)
+	PROFILER_PRINT_FOOTER
+	PROFILER_FREE(profiler_encode)
+	PROFILER_FREE(profiler_generic)
+	PROFILER_FREE(profiler_decode)
+	freerdp_bitmap_planar_context_free(planar);
+	freerdp_bitmap_planar_context_free(generic);
+	free(compressed);
+	free(genericCompressed);
+	free(src);
+	free(dst);
+	return rc;
+}
+
+int TestFreeRDPCodecPlanarEncode(int argc, char* argv[])
+{
+	const UINT32 formats[] = { PIXEL_FORMAT_BGRX32, PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_RGBA32,
+		                       PIXEL_FORMAT_XRGB32, PIXEL_FORMAT_ABGR32, PIXEL_FORMAT_RGB24 };
+	const DWORD flags[] = { PLANAR_FORMAT_HEADER_RLE,
+		                    PLANAR_FORMAT_HEADER_RLE | PLANAR_FORMAT_HEADER_NA };
+	UINT32 state = 42;
+	int rc = -1;
+	BITMAP_PLANAR_CONTEXT* planar = freerdp_bitmap_planar_context_new(0, 64, 64);
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!planar)
+		goto fail;
+
+	for (UINT32 width = 1; width <= TEST_MAX_WIDTH; width += (width < 200) ? 1 : 97)
+	{
+		if (!test_kernels(planar, width, &state))
+			goto fail;
+	}
+
+	for (size_t x = 0; x < ARRAYSIZE(formats); x++)
+	{
+		for (size_t y = 0; y < ARRAYSIZE(flags); y++)
+		{
+			if (!test_compress(formats[x], flags[y], 64, 64, &state))
+				goto fail;
+
+			if (!test_compress(formats[x], flags[y], 37, 11, &state))
+				goto fail;
+		}
+	}
+
+	rc = 0;
+fail:
+	freerdp_bitmap_planar_context_free(planar);
+	return rc;
+}
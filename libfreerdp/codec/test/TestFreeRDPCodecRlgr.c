@@ -0,0 +1,210 @@
+#include <freerdp/config.h>
+
+#include <winpr/crt.h>
+#include <winpr/print.h>
+
+#include <freerdp/freerdp.h>
+#include <freerdp/codec/rfx.h>
+#include <freerdp/utils/profiler.h>
+
+#include "../rfx_rlgr.h"
+
+#define TILE_COEFFICIENTS 4096
+
+static const INT16 test_coefficients[64] = {
+	0, 0,    0, 0, 0, 0, 0, 3, 0, 0, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 12, -7, 1, 1, 0, 2, 0, 0, 0, 0,
+	0, -130, 0, 0, 0, 0, 0, 0, 0, 0, 0,  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  0,  0, 0, 0, 0, 5, -2, 0, 1
+};
+
+static const BYTE test_rlgr1[] = { 0x3a, 0x28, 0x3b, 0xff, 0xad, 0x41, 0x0c, 0x01,
+	                               0x7f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	                               0xd0, 0x00, 0x1a, 0x02, 0x44, 0x03, 0x40, 0x00 };
+
+static const BYTE test_rlgr3[] = { 0x3a, 0x28, 0x3b, 0xff, 0xad, 0x41, 0x2c, 0x81, 0x7f,
+	                               0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xd0, 0x00,
+	                               0x38, 0x02, 0x48, 0x03, 0x40, 0x00, 0x00 };
+
+static UINT32 test_rand(UINT32* state)
+{
+	*state = *state * 1103515245u + 12345u;
+	return *state >> 8;
+}
+
+/* coefficients of a quantized tile, density in percent of nonzero values */
+static void test_fill_tile(INT16* data, UINT32 density, UINT32 amplitude, UINT32* state)
+{
+	for (size_t x = 0; x < TILE_COEFFICIENTS; x++)
+	{
+		data[x] = 0;
+
+		if (test_rand(state) % 100 < density)
+		{
+			const INT32 val = (INT32)(test_rand(state) % (2 * amplitude + 1)) - (INT32)amplitude;
+			data[x] = (INT16)val;
+		}
+	}
+
+	/* a trailing 0 in run-length mode is encoded as mag - 1 == 0, i.e. decodes to +1 */
+	if (data[TILE_COEFFICIENTS - 1] == 0)
+		data[TILE_COEFFICIENTS - 1] = 1;
+}
+
+static BOOL test_rlgr_vector(RLGR_MODE mode, const BYTE* expected, size_t expectedSize)
+{
+	BYTE buffer[256] = { 0 };
+	INT16 decoded[ARRAYSIZE(test_coefficients)] = { 0 };
+
+	const int rc = rfx_rlgr_encode(mode, test_coefficients, ARRAYSIZE(test_coefficients), buffer,
+	                               sizeof(buffer));
+
+	if ((rc < 0) || ((size_t)rc != expectedSize) || (memcmp(buffer, expected, expectedSize) != 0))
+	{
+		(void)fprintf(stderr, "RLGR%d encoding does not match the reference\n",
+		              (mode == RLGR1) ? 1 : 3);
+		winpr_HexDump(__func__, WLOG_ERROR, buffer, (size_t)MAX(rc, 0));
+		return FALSE;
+	}
+
+	if (rfx_rlgr_decode(mode, expected, (UINT32)expectedSize, decoded, ARRAYSIZE(decoded)) < 0)
+		return FALSE;
+
+	for (size_t x = 0; x < ARRAYSIZE(decoded); x++)
+	{
+		if (decoded[x] != test_coefficients[x])
+		{
+			(void)fprintf(stderr, "RLGR%d decoding mismatch at %" PRIuz "\n",
+			              (mode == RLGR1) ? 1 : 3, x);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL test_rlgr_truncated(RLGR_MODE mode)
+{
+	BYTE buffer[8] = { 0 };
+	INT16 decoded[ARRAYSIZE(test_coefficients)] = { 0 };
+
+	/* output past the end of the buffer is dropped */
+	const int rc = rfx_rlgr_encode(mode, test_coefficients, ARRAYSIZE(test_coefficients), buffer,
+	                               sizeof(buffer));
+
+	if ((rc != sizeof(buffer)) || (memcmp(buffer, test_rlgr1, sizeof(buffer)) != 0))
+		return FALSE;
+
+	/* a truncated stream decodes the available coefficients, the rest is 0 */
+	if (rfx_rlgr_decode(mode, buffer, sizeof(buffer), decoded, ARRAYSIZE(decoded)) < 0)
+		return FALSE;
+
+	for (size_t x = 0; x < 10; x++)
+	{
+		if (decoded[x] != test_coefficients[x])
+			return FALSE;
+	}
+
+	for (size_t x = 34; x < ARRAYSIZE(decoded); x++)
+	{
+		if (decoded[x] != 0)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL test_rlgr_roundtrip(RLGR_MODE mode, UINT32 density, UINT32 amplitude)
+{
+	BOOL rc = FALSE;
+	UINT32 state = density * 1000 + amplitude;
+	const size_t bufferSize = TILE_COEFFICIENTS * sizeof(INT16) * 2;
+	INT16* data = calloc(TILE_COEFFICIENTS, sizeof(INT16));
+	INT16* decoded = calloc(TILE_COEFFICIENTS, sizeof(INT16));
+	BYTE* buffer = calloc(1, bufferSize);
+	char name[64] = { 0 };
+
+	PROFILER_DEFINE(profiler_encode)
+	PROFILER_DEFINE(profiler_decode)
+	(void)_snprintf(name, sizeof(name), "RLGR%d %3" PRIu32 "%% x %5" PRIu32 " encode",
+	                (mode == RLGR1) ? 1 : 3, density, amplitude);
+	PROFILER_CREATE(profiler_encode, name)
+	(void)_snprintf(name, sizeof(name), "RLGR%d %3" PRIu32 "%% x %5" PRIu32 " decode",
+	                (mode == RLGR1) ? 1 : 3, density, amplitude);
+	PROFILER_CREATE(profiler_decode, name)
+
+	if (!data || !decoded || !buffer)
+		goto fail;
+
+	for (size_t i = 0; i < 100; i++)
+	{
+		test_fill_tile(data, density, amplitude, &state);
+		memset(buffer, 0, bufferSize);
+
+		PROFILER_ENTER(profiler_encode)
+		const int size = rfx_rlgr_encode(mode, data, TILE_COEFFICIENTS, buffer, bufferSize);
+		PROFILER_EXIT(profiler_encode)
+
+		if ((size <= 0) || ((size_t)size >= bufferSize))
+			goto fail;
+
+		PROFILER_ENTER(profiler_decode)
+		const int status =
+		    rfx_rlgr_decode(mode, buffer, (UINT32)size, decoded, TILE_COEFFICIENTS);
+		PROFILER_EXIT(profiler_decode)
+
+		if (status < 0)
+			goto fail;
+
+		if (memcmp(data, decoded, TILE_COEFFICIENTS * sizeof(INT16)) != 0)
+		{
+			(void)fprintf(stderr, "RLGR%d round trip failed, density %" PRIu32
+			                      "%%, amplitude %" PRIu32 "\n",
+			              (mode == RLGR1) ? 1 : 3, density, amplitude);
+			goto fail;
+		}
+	}
+
+	rc = TRUE;
+fail:
+	PROFILER_PRINT_HEADER
+	PROFILER_PRINT(profiler_encode)
+	PROFILER_PRINT(profiler_decode)
+	PROFILER_PRINT_FOOTER
+	PROFILER_FREE(profiler_encode)
+	PROFILER_FREE(profiler_decode)
+	free(data);
+	free(decoded);
+	free(buffer);
+	return rc;
+}
+
+int TestFreeRDPCodecRlgr(int argc, char* argv[])
+{
+	const UINT32 densities[] = { 0, 1, 10, 30, 60, 100 };
+	const UINT32 amplitudes[] = { 1, 15, 255, 4095 };
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!test_rlgr_vector(RLGR1, test_rlgr1, sizeof(test_rlgr1)))
+		return -1;
+
+	if (!test_rlgr_vector(RLGR3, test_rlgr3, sizeof(test_rlgr3)))
+		return -1;
+
+	if (!test_rlgr_truncated(RLGR1))
+		return -1;
+
+	for (size_t x = 0; x < ARRAYSIZE(densities); x++)
+	{
+		for (size_t y = 0; y < ARRAYSIZE(amplitudes); y++)
+		{
+			if (!test_rlgr_roundtrip(RLGR1, densities[x], amplitudes[y]))
+				return -1;
+
+			if (!test_rlgr_roundtrip(RLGR3, densities[x], amplitudes[y]))
+				return -1;
+		}
+	}
+
+	return 0;
+}
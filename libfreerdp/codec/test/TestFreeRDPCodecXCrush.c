@@ -1,6 +1,8 @@
 #include <winpr/crt.h>
 #include <winpr/print.h>
 
+#include <freerdp/settings_types.h>
+
 #include "../xcrush.h"
 
 static const BYTE TEST_BELLS_DATA[] = "for.whom.the.bell.tolls,.the.bell.tolls.for.thee!";
@@ -109,9 +111,106 @@ static const struct test_argument tests[] = {
 	  sizeof(TEST_BELLS_DATA_XCRUSH) - 1 }
 };
 
+static UINT32 test_rand(UINT32* state)
+{
+	*state = *state * 1103515245u + 12345u;
+	return *state >> 8;
+}
+
+/* packets assembled from a pool of blocks, so that content recurs at long distances */
+static UINT32 test_fill_packet(BYTE* data, const BYTE* pool, size_t poolSize, UINT32* state)
+{
+	const UINT32 size = 2048 + (test_rand(state) % 14000);
+	UINT32 x = 0;
+
+	while (x < size)
+	{
+		const size_t len = MIN(64 + (test_rand(state) % 512), size - x);
+		const size_t offset = test_rand(state) % (poolSize - len);
+
+		memcpy(&data[x], &pool[offset], len);
+		x += (UINT32)len;
+
+		/* some fresh bytes in between */
+		for (size_t y = 0; (y < 8) && (x < size); y++)
+			data[x++] = (BYTE)test_rand(state);
+	}
+
+	return size;
+}
+
+static BOOL test_roundtrip(UINT32 effort)
+{
+	BOOL rc = FALSE;
+	UINT32 state = 23;
+	UINT64 totalSrc = 0;
+	UINT64 totalDst = 0;
+	const size_t poolSize = 256 * 1024;
+	BYTE* pool = calloc(poolSize, sizeof(BYTE));
+	BYTE* data = calloc(16384, sizeof(BYTE));
+	BYTE* buffer = calloc(65536, sizeof(BYTE));
+	XCRUSH_CONTEXT* encoder = xcrush_context_new(TRUE);
+	XCRUSH_CONTEXT* decoder = xcrush_context_new(FALSE);
+
+	if (!pool || !data || !buffer || !encoder || !decoder)
+		goto fail;
+
+	for (size_t x = 0; x < poolSize; x++)
+		pool[x] = (BYTE)((test_rand(&state) % 4) ? (x / 16) : test_rand(&state));
+
+	xcrush_set_compression_effort(encoder, effort);
+
+	for (size_t i = 0; i < 256; i++)
+	{
+		UINT32 Flags = 0;
+		const BYTE* pDstData = NULL;
+		const BYTE* pDecData = NULL;
+		UINT32 DecSize = 0;
+		UINT32 DstSize = 65536;
+		const UINT32 SrcSize = test_fill_packet(data, pool, poolSize, &state);
+
+		if (xcrush_compress(encoder, data, SrcSize, buffer, &pDstData, &DstSize, &Flags) < 0)
+			goto fail;
+
+		totalSrc += SrcSize;
+		totalDst += DstSize;
+
+		if (Flags & PACKET_COMPRESSED)
+		{
+			if (xcrush_decompress(decoder, pDstData, DstSize, &pDecData, &DecSize, Flags) < 0)
+				goto fail;
+		}
+		else
+		{
+			pDecData = pDstData;
+			DecSize = DstSize;
+		}
+
+		if ((DecSize != SrcSize) || (memcmp(pDecData, data, SrcSize) != 0))
+		{
+			printf("XCrush round trip mismatch at packet %" PRIuz ", effort %" PRIu32 "\n", i,
+			       effort);
+			goto fail;
+		}
+	}
+
+	printf("XCrush effort %" PRIu32 ": %" PRIu64 " -> %" PRIu64 " bytes (%.2f%%)\n", effort,
+	       totalSrc, totalDst, 100.0 * (double)totalDst / (double)totalSrc);
+	rc = TRUE;
+fail:
+	xcrush_context_free(encoder);
+	xcrush_context_free(decoder);
+	free(pool);
+	free(data);
+	free(buffer);
+	return rc;
+}
+
 int TestFreeRDPCodecXCrush(int argc, char* argv[])
 {
 	int rc = 0;
+	const UINT32 efforts[] = { COMPRESSION_EFFORT_FAST, COMPRESSION_EFFORT_DEFAULT,
+		                       COMPRESSION_EFFORT_BEST };
 
 	WINPR_UNUSED(argc);
 	WINPR_UNUSED(argv);
@@ -124,5 +223,11 @@ int TestFreeRDPCodecXCrush(int argc, char* argv[])
 			rc = -1;
 	}
 
+	for (size_t x = 0; x < ARRAYSIZE(efforts); x++)
+	{
+		if (!test_roundtrip(efforts[x]))
+			rc = -1;
+	}
+
 	return rc;
 }
@@ -19,6 +19,7 @@
 
 #include <winpr/crt.h>
 #include <winpr/print.h>
+#include <winpr/sysinfo.h>
 
 #include <freerdp/codec/region.h>
 
@@ -828,6 +829,257 @@ out:
 	return retCode;
 }
 
+static UINT32 test_rand(UINT32* state)
+{
+	*state = *state * 1103515245u + 12345u;
+	return *state >> 8;
+}
+
+/* fills rects with count dirty rectangles of a 1920x1080 screen, returns the number used */
+static size_t dirtyRectStream(RECTANGLE_16* rects, size_t count, int kind, UINT32* state)
+{
+	size_t n = 0;
+
+	switch (kind)
+	{
+		case 0: /* typing, glyphs appended left to right and line by line */
+			for (UINT16 y = 100; (y + 16 <= 1080) && (n < count); y += 16)
+			{
+				for (UINT16 x = 40; (x + 8 <= 1200) && (n < count); x += 8)
+					rects[n++] = (RECTANGLE_16){ x, y, x + 8, y + 16 };
+			}
+			break;
+
+		case 1: /* scrolling, full width strips */
+			for (UINT16 y = 0; (y + 24 <= 1080) && (n < count); y += 24)
+				rects[n++] = (RECTANGLE_16){ 0, y, 1920, y + 24 };
+			break;
+
+		case 2: /* 64x64 tiles of a desktop update, some of them unchanged */
+			for (UINT16 y = 0; (y < 1080) && (n < count); y += 64)
+			{
+				for (UINT16 x = 0; (x < 1920) && (n < count); x += 64)
+				{
+					if (test_rand(state) % 3 != 0)
+						rects[n++] = (RECTANGLE_16){ x, y, x + 64, MIN(y + 64, 1080) };
+				}
+			}
+			break;
+
+		default: /* a window moving around, the old and new positions overlap */
+			for (UINT16 x = 0; n + 1 < count; x += 7)
+			{
+				const UINT16 left = (UINT16)(test_rand(state) % 1100);
+				const UINT16 top = (UINT16)(test_rand(state) % 460);
+				rects[n++] = (RECTANGLE_16){ left, top, left + 800, top + 600 };
+				rects[n++] = (RECTANGLE_16){ left + x % 13, top + 3, left + 812, top + 611 };
+			}
+			break;
+	}
+
+	return n;
+}
+
+static void markRegion(const REGION16* region, BYTE* map)
+{
+	UINT32 nbRects = 0;
+	const RECTANGLE_16* rects = region16_rects(region, &nbRects);
+
+	for (UINT32 i = 0; i < nbRects; i++)
+	{
+		for (size_t y = rects[i].top; y < rects[i].bottom; y++)
+			memset(&map[y * 1920 + rects[i].left], 1, rects[i].right - rects[i].left);
+	}
+}
+
+/* the bands of a region must be sorted and must not overlap */
+static BOOL checkRegion(const REGION16* region)
+{
+	UINT32 nbRects = 0;
+	const RECTANGLE_16* rects = region16_rects(region, &nbRects);
+
+	for (UINT32 i = 1; i < nbRects; i++)
+	{
+		const RECTANGLE_16* prev = &rects[i - 1];
+		const RECTANGLE_16* cur = &rects[i];
+
+		if (prev->top == cur->top)
+		{
+			if ((prev->bottom != cur->bottom) || (prev->right > cur->left))
+				return FALSE;
+		}
+		else if (prev->bottom > cur->top)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* region1 must cover the same area as region2 with at most as many rectangles */
+static BOOL compareRegions(const REGION16* region1, const REGION16* region2, BYTE* maps)
+{
+	const size_t mapSize = 1920ULL * 1080ULL;
+
+	if (!checkRegion(region1) || (region16_n_rects(region1) > region16_n_rects(region2)))
+	{
+		(void)fprintf(stderr, "invalid region of %d rects, expecting at most %d\n",
+		              region16_n_rects(region1), region16_n_rects(region2));
+		return FALSE;
+	}
+
+	if (!region16_is_empty(region2) &&
+	    !compareRectangles(region16_extents(region1), region16_extents(region2), 1))
+		return FALSE;
+
+	memset(maps, 0, 2 * mapSize);
+	markRegion(region1, maps);
+	markRegion(region2, &maps[mapSize]);
+	return memcmp(maps, &maps[mapSize], mapSize) == 0;
+}
+
+static int test_union_rects(void)
+{
+	int retCode = -1;
+	UINT32 state = 42;
+	REGION16 expected;
+	REGION16 region;
+	REGION16 tmp;
+	RECTANGLE_16 rects[512] = { 0 };
+	BYTE* maps = calloc(2, 1920ULL * 1080ULL);
+
+	region16_init(&expected);
+	region16_init(&region);
+	region16_init(&tmp);
+
+	if (!maps)
+		goto out;
+
+	for (int kind = 0; kind < 5; kind++)
+	{
+		for (size_t count = 1; count <= ARRAYSIZE(rects); count = count * 3 + 1)
+		{
+			size_t n = 0;
+
+			if (kind < 4)
+				n = dirtyRectStream(rects, count, kind, &state);
+			else
+			{
+				/* random rectangles on a small area, they overlap a lot */
+				for (; n < count; n++)
+				{
+					const UINT16 left = (UINT16)(test_rand(&state) % 60);
+					const UINT16 top = (UINT16)(test_rand(&state) % 60);
+					rects[n] = (RECTANGLE_16){ left, top,
+						                       (UINT16)(left + 1 + test_rand(&state) % 20),
+						                       (UINT16)(top + 1 + test_rand(&state) % 20) };
+				}
+			}
+
+			/* one rectangle after the other, through a temporary to skip the in-place paths */
+			region16_clear(&expected);
+
+			for (size_t x = 0; x < n; x++)
+			{
+				if (!region16_union_rect(&tmp, &expected, &rects[x]) ||
+				    !region16_copy(&expected, &tmp))
+					goto out;
+			}
+
+			region16_clear(&region);
+
+			for (size_t x = 0; x < n; x++)
+			{
+				if (!region16_union_rect(&region, &region, &rects[x]))
+					goto out;
+			}
+
+			if (!compareRegions(&region, &expected, maps))
+				goto out;
+
+			region16_clear(&region);
+
+			if (!region16_union_rects(&region, &region, rects, n / 2) ||
+			    !region16_union_rects(&region, &region, &rects[n / 2], n - n / 2))
+				goto out;
+
+			if (!compareRegions(&region, &expected, maps))
+				goto out;
+		}
+	}
+
+	retCode = 0;
+out:
+	if (retCode < 0)
+		(void)fprintf(stderr, "batched union differs\n");
+	region16_uninit(&expected);
+	region16_uninit(&region);
+	region16_uninit(&tmp);
+	free(maps);
+	return retCode;
+}
+
+static int test_union_rects_speed(void)
+{
+	const char* names[] = { "typing", "scrolling", "tiles", "window move" };
+	int retCode = -1;
+	UINT32 state = 42;
+	REGION16 region;
+	REGION16 tmp;
+	RECTANGLE_16 rects[2048] = { 0 };
+
+	region16_init(&region);
+	region16_init(&tmp);
+
+	for (int kind = 0; kind < 4; kind++)
+	{
+		UINT64 elapsed[3] = { 0 };
+		const size_t n = dirtyRectStream(rects, ARRAYSIZE(rects), kind, &state);
+
+		for (size_t i = 0; i < 10; i++)
+		{
+			UINT64 start = winpr_GetTickCount64NS();
+			region16_clear(&region);
+
+			for (size_t x = 0; x < n; x++)
+			{
+				if (!region16_union_rect(&tmp, &region, &rects[x]) ||
+				    !region16_copy(&region, &tmp))
+					goto out;
+			}
+
+			elapsed[0] += winpr_GetTickCount64NS() - start;
+			start = winpr_GetTickCount64NS();
+			region16_clear(&region);
+
+			for (size_t x = 0; x < n; x++)
+			{
+				if (!region16_union_rect(&region, &region, &rects[x]))
+					goto out;
+			}
+
+			elapsed[1] += winpr_GetTickCount64NS() - start;
+			start = winpr_GetTickCount64NS();
+			region16_clear(&region);
+
+			if (!region16_union_rects(&region, &region, rects, n))
+				goto out;
+
+			elapsed[2] += winpr_GetTickCount64NS() - start;
+		}
+
+		(void)fprintf(stderr,
+		              "%-12s %4" PRIuz " rects: copy %8" PRIu64 "us, in place %8" PRIu64
+		              "us, batched %8" PRIu64 "us\n",
+		              names[kind], n, elapsed[0] / 10000, elapsed[1] / 10000, elapsed[2] / 10000);
+	}
+
+	retCode = 0;
+out:
+	region16_uninit(&region);
+	region16_uninit(&tmp);
+	return retCode;
+}
+
 typedef int (*TestFunction)(void);
 struct UnitaryTest
 {
@@ -849,6 +1101,8 @@ static struct UnitaryTest tests[] = { { "Basic trivial tests", test_basic },
 	                                  { "norbert's case", test_norbert_case },
 	                                  { "norbert's case 2", test_norbert2_case },
 	                                  { "empty rectangle case", test_empty_rectangle },
+	                                  { "batched union", test_union_rects },
+	                                  { "batched union speed", test_union_rects_speed },
 
 	                                  { NULL, NULL } };
 
@@ -28,8 +28,12 @@
 #include <winpr/print.h>
 #include <winpr/bitstream.h>
 
+#include <winpr/sysinfo.h>
+
 #include <freerdp/log.h>
+#include <freerdp/settings_types.h>
 #include "xcrush.h"
+#include "sse/xcrush_sse2.h"
 
 #pragma pack(push, 1)
 
@@ -70,6 +74,9 @@ typedef struct
 
 #pragma pack(pop)
 
+typedef void (*xcrush_compute_chunk_boundaries_fn)(const BYTE* WINPR_RESTRICT data, UINT32 count,
+                                                   UINT64* WINPR_RESTRICT boundaries);
+
 struct s_XCRUSH_CONTEXT
 {
 	ALIGN64 BOOL Compressor;
@@ -91,6 +98,10 @@ struct s_XCRUSH_CONTEXT
 	ALIGN64 UINT32 OptimizedMatchCount;
 	ALIGN64 XCRUSH_MATCH_INFO OriginalMatches[1000];
 	ALIGN64 XCRUSH_MATCH_INFO OptimizedMatches[1000];
+	ALIGN64 UINT64 ChunkBoundaries[16384 / 64];
+	ALIGN64 xcrush_compute_chunk_boundaries_fn ComputeChunkBoundaries;
+	ALIGN64 UINT32 MaxChunkMatches;
+	ALIGN64 BOOL OptimizeMatches;
 };
 
 //#define DEBUG_XCRUSH 1
@@ -216,23 +227,33 @@ static int xcrush_append_chunk(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
 	return 1;
 }
 
-static int xcrush_compute_chunks(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
-                                 const BYTE* WINPR_RESTRICT data, UINT32 size,
-                                 UINT32* WINPR_RESTRICT pIndex)
+static INLINE UINT32 xcrush_count_trailing_zeros(UINT64 value)
+{
+	WINPR_ASSERT(value != 0);
+
+#if defined(__GNUC__) || defined(__clang__)
+	return (UINT32)__builtin_ctzll(value);
+#else
+	UINT32 count = 0;
+
+	while ((value & 1) == 0)
+	{
+		value >>= 1;
+		count++;
+	}
+
+	return count;
+#endif
+}
+
+static void xcrush_compute_chunk_boundaries(const BYTE* WINPR_RESTRICT data, UINT32 count,
+                                            UINT64* WINPR_RESTRICT boundaries)
 {
-	UINT32 offset = 0;
 	UINT32 rotation = 0;
 	UINT32 accumulator = 0;
 
-	WINPR_ASSERT(xcrush);
 	WINPR_ASSERT(data);
-	WINPR_ASSERT(pIndex);
-
-	*pIndex = 0;
-	xcrush->SignatureIndex = 0;
-
-	if (size < 128)
-		return 0;
+	WINPR_ASSERT(boundaries);
 
 	for (UINT32 i = 0; i < 32; i++)
 	{
@@ -240,44 +261,55 @@ static int xcrush_compute_chunks(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
 		accumulator = data[i] ^ rotation;
 	}
 
-	for (UINT32 i = 0; i < size - 64; i++)
+	for (UINT32 i = 0; i < count; i++)
 	{
 		rotation = _rotl(accumulator, 1);
 		accumulator = data[i + 32] ^ data[i] ^ rotation;
 
 		if (!(accumulator & 0x7F))
 		{
-			if (!xcrush_append_chunk(xcrush, data, &offset, i + 32))
-				return 0;
+			const UINT32 end = i + 32;
+			boundaries[end / 64] |= 1ull << (end % 64);
 		}
+	}
+}
 
-		i++;
-		rotation = _rotl(accumulator, 1);
-		accumulator = data[i + 32] ^ data[i] ^ rotation;
+static int xcrush_compute_chunks(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
+                                 const BYTE* WINPR_RESTRICT data, UINT32 size,
+                                 UINT32* WINPR_RESTRICT pIndex)
+{
+	UINT32 offset = 0;
 
-		if (!(accumulator & 0x7F))
-		{
-			if (!xcrush_append_chunk(xcrush, data, &offset, i + 32))
-				return 0;
-		}
+	WINPR_ASSERT(xcrush);
+	WINPR_ASSERT(data);
+	WINPR_ASSERT(pIndex);
 
-		i++;
-		rotation = _rotl(accumulator, 1);
-		accumulator = data[i + 32] ^ data[i] ^ rotation;
+	*pIndex = 0;
+	xcrush->SignatureIndex = 0;
 
-		if (!(accumulator & 0x7F))
-		{
-			if (!xcrush_append_chunk(xcrush, data, &offset, i + 32))
-				return 0;
-		}
+	if (size < 128)
+		return 0;
 
-		i++;
-		rotation = _rotl(accumulator, 1);
-		accumulator = data[i + 32] ^ data[i] ^ rotation;
+	if (size > 16384)
+		return 0;
 
-		if (!(accumulator & 0x7F))
+	/* the accumulator is tested at the ends of 32 byte windows, in steps of 4 */
+	const UINT32 count = (size - 64 + 3) & ~3u;
+	const UINT32 words = (32 + count + 63) / 64;
+
+	ZeroMemory(xcrush->ChunkBoundaries, words * sizeof(UINT64));
+	xcrush->ComputeChunkBoundaries(data, count, xcrush->ChunkBoundaries);
+
+	for (UINT32 i = 0; i < words; i++)
+	{
+		UINT64 bits = xcrush->ChunkBoundaries[i];
+
+		while (bits)
 		{
-			if (!xcrush_append_chunk(xcrush, data, &offset, i + 32))
+			const UINT32 end = i * 64 + xcrush_count_trailing_zeros(bits);
+			bits &= bits - 1;
+
+			if (!xcrush_append_chunk(xcrush, data, &offset, end))
 				return 0;
 		}
 	}
@@ -408,7 +440,7 @@ static int xcrush_insert_chunk(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
 
 static int xcrush_find_match_length(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, UINT32 MatchOffset,
                                     UINT32 ChunkOffset, UINT32 HistoryOffset, UINT32 SrcSize,
-                                    UINT32 MaxMatchLength,
+                                    UINT32 MaxMatchLength, UINT32 ReverseLimit,
                                     XCRUSH_MATCH_INFO* WINPR_RESTRICT MatchInfo)
 {
 	UINT32 MatchSymbol = 0;
@@ -479,7 +511,7 @@ static int xcrush_find_match_length(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, UINT3
 	ReverseMatchPtr = MatchBuffer - 1;
 	ReverseChunkPtr = ChunkBuffer - 1;
 
-	while ((ReverseMatchPtr > &HistoryBuffer[HistoryOffset]) && (ReverseChunkPtr > HistoryBuffer) &&
+	while ((ReverseMatchPtr > &HistoryBuffer[ReverseLimit]) && (ReverseChunkPtr > HistoryBuffer) &&
 	       (*ReverseMatchPtr == *ReverseChunkPtr))
 	{
 		ReverseMatchLength++;
@@ -511,7 +543,6 @@ static int xcrush_find_all_matches(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, UINT32
 {
 	UINT32 j = 0;
 	int status = 0;
-	UINT32 ChunkIndex = 0;
 	UINT32 ChunkCount = 0;
 	XCRUSH_CHUNK* chunk = NULL;
 	UINT32 MatchLength = 0;
@@ -537,8 +568,18 @@ static int xcrush_find_all_matches(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, UINT32
 		if (status < 0)
 			return status;
 
-		if (chunk && (SrcOffset + HistoryOffset + Signatures[i].size >= PrevMatchEnd))
+		/* without the optimization pass matches must not overlap, start after the previous */
+		const BOOL search = xcrush->OptimizeMatches
+		                        ? (SrcOffset + HistoryOffset + Signatures[i].size >= PrevMatchEnd)
+		                        : (offset >= PrevMatchEnd);
+
+		if (chunk && search)
 		{
+			UINT32 ReverseLimit = HistoryOffset;
+
+			if (!xcrush->OptimizeMatches && (PrevMatchEnd > HistoryOffset + 1))
+				ReverseLimit = PrevMatchEnd - 1;
+
 			ChunkCount = 0;
 			MaxMatchLength = 0;
 
@@ -547,8 +588,9 @@ static int xcrush_find_all_matches(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, UINT32
 				if ((chunk->offset < HistoryOffset) || (chunk->offset < offset) ||
 				    (chunk->offset > SrcSize + HistoryOffset))
 				{
-					status = xcrush_find_match_length(xcrush, offset, chunk->offset, HistoryOffset,
-					                                  SrcSize, MaxMatchLength, &MatchInfo);
+					status =
+					    xcrush_find_match_length(xcrush, offset, chunk->offset, HistoryOffset,
+					                             SrcSize, MaxMatchLength, ReverseLimit, &MatchInfo);
 
 					if (status < 0)
 						return status; /* error */
@@ -567,9 +609,7 @@ static int xcrush_find_all_matches(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, UINT32
 					}
 				}
 
-				ChunkIndex = ChunkCount++;
-
-				if (ChunkIndex > 4)
+				if (++ChunkCount >= xcrush->MaxChunkMatches)
 					break;
 
 				status = xcrush_find_next_matching_chunk(xcrush, chunk, &chunk);
@@ -1020,13 +1060,19 @@ static int xcrush_compress_l1(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
 			xcrush->OriginalMatchCount = (UINT32)status;
 			xcrush->OptimizedMatchCount = 0;
 
-			if (xcrush->OriginalMatchCount)
+			if (xcrush->OriginalMatchCount && xcrush->OptimizeMatches)
 			{
 				status = xcrush_optimize_matches(xcrush);
 
 				if (status < 0)
 					return status;
 			}
+			else if (xcrush->OriginalMatchCount)
+			{
+				CopyMemory(xcrush->OptimizedMatches, xcrush->OriginalMatches,
+				           xcrush->OriginalMatchCount * sizeof(XCRUSH_MATCH_INFO));
+				xcrush->OptimizedMatchCount = xcrush->OriginalMatchCount;
+			}
 
 			if (xcrush->OptimizedMatchCount)
 			{
@@ -1183,6 +1229,28 @@ void xcrush_context_reset(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, BOOL flush)
 	mppc_context_reset(xcrush->mppc, flush);
 }
 
+void xcrush_set_compression_effort(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, UINT32 Effort)
+{
+	WINPR_ASSERT(xcrush);
+
+	switch (Effort)
+	{
+		case COMPRESSION_EFFORT_FAST:
+			xcrush->MaxChunkMatches = 2;
+			xcrush->OptimizeMatches = FALSE;
+			break;
+		case COMPRESSION_EFFORT_BEST:
+			xcrush->MaxChunkMatches = 32;
+			xcrush->OptimizeMatches = TRUE;
+			break;
+		case COMPRESSION_EFFORT_DEFAULT:
+		default:
+			xcrush->MaxChunkMatches = 6;
+			xcrush->OptimizeMatches = TRUE;
+			break;
+	}
+}
+
 XCRUSH_CONTEXT* xcrush_context_new(BOOL Compressor)
 {
 	XCRUSH_CONTEXT* xcrush = (XCRUSH_CONTEXT*)calloc(1, sizeof(XCRUSH_CONTEXT));
@@ -1195,6 +1263,12 @@ XCRUSH_CONTEXT* xcrush_context_new(BOOL Compressor)
 	if (!xcrush->mppc)
 		goto fail;
 	xcrush->HistoryBufferSize = 2000000;
+	xcrush->ComputeChunkBoundaries = xcrush_compute_chunk_boundaries;
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	if (IsProcessorFeaturePresent(PF_SSE2_INSTRUCTIONS_AVAILABLE))
+		xcrush->ComputeChunkBoundaries = xcrush_compute_chunk_boundaries_sse2;
+#endif
+	xcrush_set_compression_effort(xcrush, COMPRESSION_EFFORT_DEFAULT);
 	xcrush_context_reset(xcrush, FALSE);
 
 	return xcrush;
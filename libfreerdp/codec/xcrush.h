@@ -43,6 +43,13 @@ extern "C"
 	                                    const BYTE** WINPR_RESTRICT ppDstData,
 	                                    UINT32* WINPR_RESTRICT pDstSize, UINT32 flags);
 
+	/**
+	 * Selects one of the COMPRESSION_EFFORT_* levels: the number of chunks with the same
+	 * signature examined for a match and whether overlapping matches are trimmed afterwards.
+	 */
+	FREERDP_LOCAL void xcrush_set_compression_effort(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
+	                                                 UINT32 Effort);
+
 	FREERDP_LOCAL void xcrush_context_reset(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, BOOL flush);
 
 	FREERDP_LOCAL XCRUSH_CONTEXT* xcrush_context_new(BOOL Compressor);
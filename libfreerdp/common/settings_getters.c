@@ -340,6 +340,9 @@ BOOL freerdp_settings_get_bool(WINPR_ATTR_UNUSED const rdpSettings* settings,
 		case FreeRDP_KerberosRdgIsProxy:
 			return settings->KerberosRdgIsProxy;
 
+		case FreeRDP_KernelTlsOffload:
+			return settings->KernelTlsOffload;
+
 		case FreeRDP_ListMonitors:
 			return settings->ListMonitors;
 
@@ -1044,6 +1047,10 @@ BOOL freerdp_settings_set_bool(WINPR_ATTR_UNUSED rdpSettings* settings,
 			settings->KerberosRdgIsProxy = cnv.c;
 			break;
 
+		case FreeRDP_KernelTlsOffload:
+			settings->KernelTlsOffload = cnv.c;
+			break;
+
 		case FreeRDP_ListMonitors:
 			settings->ListMonitors = cnv.c;
 			break;
@@ -1688,9 +1695,18 @@ UINT32 freerdp_settings_get_uint32(WINPR_ATTR_UNUSED const rdpSettings* settings
 		case FreeRDP_CompDeskSupportLevel:
 			return settings->CompDeskSupportLevel;
 
+		case FreeRDP_CompressionEffort:
+			return settings->CompressionEffort;
+
 		case FreeRDP_CompressionLevel:
 			return settings->CompressionLevel;
 
+		case FreeRDP_CompressionMatchDepth:
+			return settings->CompressionMatchDepth;
+
+		case FreeRDP_CompressionMatchWays:
+			return settings->CompressionMatchWays;
+
 		case FreeRDP_ConnectionType:
 			return settings->ConnectionType;
 
@@ -2112,10 +2128,22 @@ BOOL freerdp_settings_set_uint32(WINPR_ATTR_UNUSED rdpSettings* settings,
 			settings->CompDeskSupportLevel = cnv.c;
 			break;
 
+		case FreeRDP_CompressionEffort:
+			settings->CompressionEffort = cnv.c;
+			break;
+
 		case FreeRDP_CompressionLevel:
 			settings->CompressionLevel = cnv.c;
 			break;
 
+		case FreeRDP_CompressionMatchDepth:
+			settings->CompressionMatchDepth = cnv.c;
+			break;
+
+		case FreeRDP_CompressionMatchWays:
+			settings->CompressionMatchWays = cnv.c;
+			break;
+
 		case FreeRDP_ConnectionType:
 			settings->ConnectionType = cnv.c;
 			break;
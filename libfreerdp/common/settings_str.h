@@ -146,6 +146,7 @@ static const struct settings_str_entry settings_map[] = {
 	{ FreeRDP_IgnoreInvalidDevices, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_IgnoreInvalidDevices" },
 	{ FreeRDP_JpegCodec, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_JpegCodec" },
 	{ FreeRDP_KerberosRdgIsProxy, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_KerberosRdgIsProxy" },
+	{ FreeRDP_KernelTlsOffload, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_KernelTlsOffload" },
 	{ FreeRDP_ListMonitors, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_ListMonitors" },
 	{ FreeRDP_LocalConnection, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_LocalConnection" },
 	{ FreeRDP_LogonErrors, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_LogonErrors" },
@@ -309,7 +310,12 @@ static const struct settings_str_entry settings_map[] = {
 	{ FreeRDP_ColorPointerCacheSize, FREERDP_SETTINGS_TYPE_UINT32,
 	  "FreeRDP_ColorPointerCacheSize" },
 	{ FreeRDP_CompDeskSupportLevel, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_CompDeskSupportLevel" },
+	{ FreeRDP_CompressionEffort, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_CompressionEffort" },
 	{ FreeRDP_CompressionLevel, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_CompressionLevel" },
+	{ FreeRDP_CompressionMatchDepth, FREERDP_SETTINGS_TYPE_UINT32,
+	  "FreeRDP_CompressionMatchDepth" },
+	{ FreeRDP_CompressionMatchWays, FREERDP_SETTINGS_TYPE_UINT32,
+	  "FreeRDP_CompressionMatchWays" },
 	{ FreeRDP_ConnectionType, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_ConnectionType" },
 	{ FreeRDP_CookieMaxLength, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_CookieMaxLength" },
 	{ FreeRDP_DesktopHeight, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_DesktopHeight" },
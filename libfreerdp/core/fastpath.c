@@ -1134,7 +1134,8 @@ BOOL fastpath_send_multiple_input_pdu(rdpFastPath* fastpath, wStream* s, size_t
 	Stream_SetPosition(s, length);
 	Stream_SealLength(s);
 
-	if (transport_write(rdp->transport, s) < 0)
+	/* input must not wait for a corked frame */
+	if (transport_write_immediate(rdp->transport, s) < 0)
 		goto fail;
 
 	rc = TRUE;
@@ -1162,6 +1163,23 @@ wStream* fastpath_update_pdu_init_new(WINPR_ATTR_UNUSED rdpFastPath* fastpath)
 	return s;
 }
 
+static BOOL fastpath_update_is_pointer(BYTE updateCode)
+{
+	switch (updateCode)
+	{
+		case FASTPATH_UPDATETYPE_PTR_NULL:
+		case FASTPATH_UPDATETYPE_PTR_DEFAULT:
+		case FASTPATH_UPDATETYPE_PTR_POSITION:
+		case FASTPATH_UPDATETYPE_COLOR:
+		case FASTPATH_UPDATETYPE_CACHED:
+		case FASTPATH_UPDATETYPE_POINTER:
+		case FASTPATH_UPDATETYPE_LARGE_POINTER:
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
 BOOL fastpath_send_update_pdu(rdpFastPath* fastpath, BYTE updateCode, wStream* s,
                               BOOL skipCompression)
 {
@@ -1183,6 +1201,9 @@ BOOL fastpath_send_update_pdu(rdpFastPath* fastpath, BYTE updateCode, wStream* s
 	fs = fastpath->fs;
 	settings = rdp->settings;
 
+	/* pointer updates must not wait for a corked frame */
+	const BOOL immediate = fastpath_update_is_pointer(updateCode);
+
 	if (!settings)
 		return FALSE;
 
@@ -1353,7 +1374,12 @@ BOOL fastpath_send_update_pdu(rdpFastPath* fastpath, BYTE updateCode, wStream* s
 
 		Stream_SealLength(fs);
 
-		if (transport_write(rdp->transport, fs) < 0)
+		if (immediate)
+		{
+			if (transport_write_immediate(rdp->transport, fs) < 0)
+				status = FALSE;
+		}
+		else if (transport_write(rdp->transport, fs) < 0)
 		{
 			status = FALSE;
 		}
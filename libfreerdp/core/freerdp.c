@@ -395,11 +395,12 @@ DWORD freerdp_get_event_handles(rdpContext* context, HANDLE* events, DWORD count
 	if (nCount == 0)
 		return 0;
 
-	if (events && (nCount < count + 2))
+	if (events && (nCount + 4 <= count))
 	{
 		events[nCount++] = freerdp_channels_get_event_handle(context->instance);
 		events[nCount++] = getChannelErrorEventHandle(context);
 		events[nCount++] = utils_get_abort_event(context->rdp);
+		events[nCount++] = input_get_event_handle(context->input);
 	}
 	else
 		return 0;
@@ -615,6 +616,7 @@ BOOL freerdp_disconnect(freerdp* instance)
 		return FALSE;
 
 	rdp = instance->context->rdp;
+	(void)input_flush(instance->context->input);
 	utils_abort_connect(rdp);
 
 	if (!rdp_client_disconnect(rdp))
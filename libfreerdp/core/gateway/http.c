@@ -1272,6 +1272,26 @@ static BOOL sleep_or_timeout_(rdpTls* tls, UINT64 startMS, UINT32 timeoutMS, con
 	return FALSE;
 }
 
+/**
+ * @brief number of bytes of \b available new data (starting at \b position) that belong to the
+ * HTTP header. Everything after the terminating \r\n\r\n is left for the body or the
+ * protocol running on top of the connection.
+ */
+static size_t http_header_consume_length(const BYTE* buffer, size_t position, size_t available)
+{
+	const char terminator[] = { '\r', '\n', '\r', '\n' };
+	const size_t start = (position > 3) ? position - 3 : 0;
+	const size_t end = position + available;
+
+	for (size_t x = start; x + sizeof(terminator) <= end; x++)
+	{
+		if (memcmp(&buffer[x], terminator, sizeof(terminator)) == 0)
+			return x + sizeof(terminator) - position;
+	}
+
+	return available;
+}
+
 static SSIZE_T http_response_recv_line(rdpTls* tls, HttpResponse* response)
 {
 	WINPR_ASSERT(tls);
@@ -1283,15 +1303,33 @@ static SSIZE_T http_response_recv_line(rdpTls* tls, HttpResponse* response)
 	const UINT64 startMS = GetTickCount64();
 	while (payloadOffset <= 0)
 	{
-		size_t bodyLength = 0;
-		size_t position = 0;
-		int status = -1;
-		size_t s = 0;
-		char* end = NULL;
-		/* Read until we encounter \r\n\r\n */
+		if (!Stream_EnsureRemainingCapacity(response->data, 1024))
+			goto out_error;
+
+		const size_t position = Stream_GetPosition(response->data);
+		if (position > RESPONSE_SIZE_LIMIT)
+		{
+			WLog_ERR(TAG, "Request header too large! (%" PRIuz " bytes) Aborting!", position);
+			goto out_error;
+		}
+
+		/* Peek at whatever is already decrypted and consume it up to the end of the header.
+		 * This avoids a BIO_read per byte while leaving the body (or websocket / RDG data
+		 * following the header) untouched in the TLS layer. */
 		ERR_clear_error();
+		const size_t capacity = MIN(Stream_GetRemainingCapacity(response->data), INT32_MAX);
+		int status = (int)BIO_peek(tls->bio, Stream_Pointer(response->data), (long)capacity);
+		if (status > 0)
+		{
+#ifdef FREERDP_HAVE_VALGRIND_MEMCHECK_H
+			VALGRIND_MAKE_MEM_DEFINED(Stream_Pointer(response->data), status);
+#endif
+			const size_t rd = http_header_consume_length(Stream_Buffer(response->data), position,
+			                                             (size_t)status);
+			ERR_clear_error();
+			status = BIO_read(tls->bio, Stream_Pointer(response->data), (int)rd);
+		}
 
-		status = BIO_read(tls->bio, Stream_Pointer(response->data), 1);
 		if (status <= 0)
 		{
 			if (sleep_or_timeout(tls, startMS, timeoutMS))
@@ -1304,26 +1342,12 @@ static SSIZE_T http_response_recv_line(rdpTls* tls, HttpResponse* response)
 #endif
 		Stream_Seek(response->data, (size_t)status);
 
-		if (!Stream_EnsureRemainingCapacity(response->data, 1024))
-			goto out_error;
-
-		position = Stream_GetPosition(response->data);
-
-		if (position < 4)
+		const size_t end = Stream_GetPosition(response->data);
+		if (end < 4)
 			continue;
-		else if (position > RESPONSE_SIZE_LIMIT)
-		{
-			WLog_ERR(TAG, "Request header too large! (%" PRIdz " bytes) Aborting!", bodyLength);
-			goto out_error;
-		}
-
-		/* Always check at most the lase 8 bytes for occurrence of the desired
-		 * sequence of \r\n\r\n */
-		s = (position > 8) ? 8 : position;
-		end = (char*)Stream_Pointer(response->data) - s;
 
-		if (string_strnstr(end, "\r\n\r\n", s) != NULL)
-			payloadOffset = WINPR_ASSERTING_INT_CAST(SSIZE_T, Stream_GetPosition(response->data));
+		if (memcmp(Stream_Pointer(response->data) - 4, "\r\n\r\n", 4) == 0)
+			payloadOffset = WINPR_ASSERTING_INT_CAST(SSIZE_T, end);
 	}
 
 out_error:
@@ -1621,8 +1621,8 @@ static int rdg_write_websocket_data_packet(rdpRdg* rdg, const BYTE* buf, int isi
 		UINT8 u8[4];
 	} maskingKey;
 
-	wStream* sWS =
-	    websocket_context_packet_new(payloadSize, WebsocketBinaryOpcode, &maskingKey.u32);
+	wStream* sWS = websocket_context_packet_new(rdg->transferEncoding.context.websocket,
+	                                            payloadSize, WebsocketBinaryOpcode, &maskingKey.u32);
 	if (!sWS)
 		return FALSE;
 
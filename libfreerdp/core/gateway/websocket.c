@@ -34,10 +34,39 @@ struct s_websocket_context
 	BYTE lengthAndMaskPosition;
 	WEBSOCKET_STATE state;
 	wStream* responseStreamBuffer;
+	wStreamPool* packetPool;
 };
 
 static int websocket_write_all(BIO* bio, const BYTE* data, size_t length);
 
+/**
+ * Copy \b len bytes from \b src to \b dst applying the websocket mask.
+ * The masking key is used in wire (little endian) byte order, 8 bytes are processed per
+ * iteration which the compiler is free to vectorize further.
+ */
+static void websocket_mask_copy(BYTE* WINPR_RESTRICT dst, const BYTE* WINPR_RESTRICT src,
+                                size_t len, UINT32 maskingKey)
+{
+	BYTE key[8] = { 0 };
+	for (size_t x = 0; x < sizeof(key); x++)
+		key[x] = (BYTE)(maskingKey >> (8 * (x % 4)));
+
+	UINT64 key64 = 0;
+	memcpy(&key64, key, sizeof(key64));
+
+	size_t pos = 0;
+	for (; pos + sizeof(UINT64) <= len; pos += sizeof(UINT64))
+	{
+		UINT64 data = 0;
+		memcpy(&data, &src[pos], sizeof(data));
+		data ^= key64;
+		memcpy(&dst[pos], &data, sizeof(data));
+	}
+
+	for (; pos < len; pos++)
+		dst[pos] = src[pos] ^ key[pos % 4];
+}
+
 BOOL websocket_context_mask_and_send(BIO* bio, wStream* sPacket, wStream* sDataPacket,
                                      UINT32 maskingKey)
 {
@@ -45,31 +74,21 @@ BOOL websocket_context_mask_and_send(BIO* bio, wStream* sPacket, wStream* sDataP
 	Stream_SetPosition(sDataPacket, 0);
 
 	if (!Stream_EnsureRemainingCapacity(sPacket, len))
-		return FALSE;
-
-	/* mask as much as possible with 32bit access */
-	size_t streamPos = 0;
-	for (; streamPos + 4 <= len; streamPos += 4)
-	{
-		const uint32_t data = Stream_Get_UINT32(sDataPacket);
-		Stream_Write_UINT32(sPacket, data ^ maskingKey);
-	}
-
-	/* mask the rest byte by byte */
-	for (; streamPos < len; streamPos++)
 	{
-		BYTE data = 0;
-		BYTE* partialMask = ((BYTE*)&maskingKey) + (streamPos % 4);
-		Stream_Read_UINT8(sDataPacket, data);
-		Stream_Write_UINT8(sPacket, data ^ *partialMask);
+		Stream_Release(sPacket);
+		return FALSE;
 	}
 
+	/* mask directly from the payload into the frame, no intermediate copy */
+	websocket_mask_copy(Stream_Pointer(sPacket), Stream_ConstPointer(sDataPacket), len,
+	                    maskingKey);
+	Stream_Seek(sPacket, len);
 	Stream_SealLength(sPacket);
 
 	ERR_clear_error();
 	const size_t size = Stream_Length(sPacket);
 	const int status = websocket_write_all(bio, Stream_Buffer(sPacket), size);
-	Stream_Free(sPacket, TRUE);
+	Stream_Release(sPacket);
 
 	if ((status < 0) || ((size_t)status != size))
 		return FALSE;
@@ -77,7 +96,8 @@ BOOL websocket_context_mask_and_send(BIO* bio, wStream* sPacket, wStream* sDataP
 	return TRUE;
 }
 
-wStream* websocket_context_packet_new(size_t len, WEBSOCKET_OPCODE opcode, UINT32* pMaskingKey)
+wStream* websocket_context_packet_new(websocket_context* context, size_t len,
+                                      WEBSOCKET_OPCODE opcode, UINT32* pMaskingKey)
 {
 	WINPR_ASSERT(pMaskingKey);
 	if (len > INT_MAX)
@@ -91,7 +111,12 @@ wStream* websocket_context_packet_new(size_t len, WEBSOCKET_OPCODE opcode, UINT3
 	else
 		fullLen = len + 14; /* 2 byte "mini header" + 8 byte length + 4 byte masking key */
 
-	wStream* sWS = Stream_New(NULL, fullLen);
+	/* frames are sent immediately, recycle the buffers if we have a context */
+	wStream* sWS = NULL;
+	if (context)
+		sWS = StreamPool_Take(context->packetPool, fullLen);
+	else
+		sWS = Stream_New(NULL, fullLen);
 	if (!sWS)
 		return NULL;
 
@@ -133,7 +158,7 @@ BOOL websocket_context_write_wstream(websocket_context* context, BIO* bio, wStre
 
 	const size_t len = Stream_Length(sPacket);
 	uint32_t maskingKey = 0;
-	wStream* sWS = websocket_context_packet_new(len, opcode, &maskingKey);
+	wStream* sWS = websocket_context_packet_new(context, len, opcode, &maskingKey);
 	if (!sWS)
 		return FALSE;
 
@@ -470,6 +495,10 @@ websocket_context* websocket_context_new(void)
 	if (!context->responseStreamBuffer)
 		goto fail;
 
+	context->packetPool = StreamPool_New(TRUE, 4096);
+	if (!context->packetPool)
+		goto fail;
+
 	if (!websocket_context_reset(context))
 		goto fail;
 
@@ -485,6 +514,7 @@ void websocket_context_free(websocket_context* context)
 		return;
 
 	Stream_Free(context->responseStreamBuffer, TRUE);
+	StreamPool_Free(context->packetPool);
 	free(context);
 }
 
@@ -66,10 +66,14 @@ FREERDP_LOCAL int websocket_context_write(websocket_context* context, BIO* bio,
 FREERDP_LOCAL int websocket_context_read(websocket_context* encodingContext, BIO* bio,
                                          BYTE* pBuffer, size_t size);
 
-WINPR_ATTR_MALLOC(Stream_Free, 1)
-FREERDP_LOCAL wStream* websocket_context_packet_new(size_t len, WEBSOCKET_OPCODE opcode,
-                                                    UINT32* pMaskingKey);
+/** @brief allocate a frame with header and masking key written.
+ *  If \b context is not \b NULL the stream is taken from the frame pool of the context.
+ */
+WINPR_ATTR_MALLOC(Stream_Release, 1)
+FREERDP_LOCAL wStream* websocket_context_packet_new(websocket_context* context, size_t len,
+                                                    WEBSOCKET_OPCODE opcode, UINT32* pMaskingKey);
 
+/** @brief mask \b sDataPacket into \b sPacket and send it. \b sPacket is released. */
 FREERDP_LOCAL BOOL websocket_context_mask_and_send(BIO* bio, wStream* sPacket, wStream* sDataPacket,
                                                    UINT32 maskingKey);
 
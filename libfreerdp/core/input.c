@@ -22,6 +22,9 @@
 
 #include <winpr/crt.h>
 #include <winpr/assert.h>
+#include <winpr/endian.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
 
 #include <freerdp/input.h>
 #include <freerdp/log.h>
@@ -40,6 +43,19 @@
 #define INPUT_EVENT_MOUSEX 0x8002
 #define INPUT_EVENT_MOUSEREL 0x8004
 
+/* A fast-path input PDU carries at most 15 events without the optional numEvents field */
+#define INPUT_BATCH_MAX_EVENTS 15
+/* Batches older than this are sent with the next event, even without a flush from the loop */
+#define INPUT_BATCH_MAX_DELAY_MS 8
+
+/* Event may wait in the batch for more input instead of being sent right away */
+#define INPUT_BATCH_DEFER 0x01
+/* Plain pointer move that may be merged with a directly preceding one, implies INPUT_BATCH_DEFER */
+#define INPUT_BATCH_MERGE 0x02
+/* Event of a sequence queued between input_batch_sequence_begin and input_batch_sequence_end,
+ * the event count and age limits do not split it */
+#define INPUT_BATCH_SEQUENCE 0x04
+
 static void rdp_write_client_input_pdu_header(wStream* s, UINT16 number)
 {
 	WINPR_ASSERT(s);
@@ -334,74 +350,236 @@ static BOOL input_send_keyboard_pause_event(rdpInput* input)
 	                                 RDP_SCANCODE_CODE(RDP_SCANCODE_NUMLOCK));
 }
 
-static BOOL input_send_fastpath_synchronize_event(rdpInput* input, UINT32 flags)
+/* must be called with batchLock held */
+static BOOL input_batch_flush_locked(rdp_input_internal* in)
 {
-	UINT16 sec_flags = 0;
-	wStream* s = NULL;
-	rdpRdp* rdp = NULL;
+	WINPR_ASSERT(in);
+
+	wStream* s = in->batch;
+	const size_t count = in->batchEvents;
+
+	if (!s)
+		return TRUE;
+
+	in->batch = NULL;
+	in->batchEvents = 0;
+	in->batchMergeable = FALSE;
+	(void)ResetEvent(in->batchEvent);
+
+	WINPR_ASSERT(in->common.context);
+	rdpRdp* rdp = in->common.context->rdp;
+	WINPR_ASSERT(rdp);
+	return fastpath_send_multiple_input_pdu(rdp->fastpath, s, count, in->batchSecFlags);
+}
+
+/**
+ * Merges a plain pointer move into the previous one, which must be the last queued event of the
+ * same type: absolute moves keep the latest position, relative moves add up their deltas.
+ */
+static BOOL input_batch_merge(BYTE eventCode, BYTE* last, const BYTE* payload)
+{
+	switch (eventCode)
+	{
+		case FASTPATH_INPUT_EVENT_MOUSE:
+			memcpy(last, payload, 6);
+			return TRUE;
+
+		case TS_FP_RELPOINTER_EVENT:
+		{
+			const INT32 x = winpr_Data_Get_INT16(&last[2]) + winpr_Data_Get_INT16(&payload[2]);
+			const INT32 y = winpr_Data_Get_INT16(&last[4]) + winpr_Data_Get_INT16(&payload[4]);
+
+			if ((x < INT16_MIN) || (x > INT16_MAX) || (y < INT16_MIN) || (y > INT16_MAX))
+				return FALSE;
+
+			winpr_Data_Write_INT16(&last[2], (INT16)x);
+			winpr_Data_Write_INT16(&last[4], (INT16)y);
+			return TRUE;
+		}
+
+		default:
+			return FALSE;
+	}
+}
+
+/**
+ * Queues a fast-path input event. Events are sent in order, several per PDU. Deferred events
+ * (pointer moves) stay queued until a non deferred event arrives, the batch is full or older than
+ * INPUT_BATCH_MAX_DELAY_MS, or the event loop calls input_flush. Events of a sequence are only
+ * sent once its last, non deferred, event was queued.
+ */
+static BOOL input_send_fastpath_event(rdpInput* input, BYTE eventFlags, BYTE eventCode,
+                                      const BYTE* payload, size_t length, UINT32 batchFlags)
+{
+	const BOOL mergeable = (batchFlags & INPUT_BATCH_MERGE) != 0;
+	const BOOL defer = (batchFlags & (INPUT_BATCH_DEFER | INPUT_BATCH_MERGE)) != 0;
+	const BOOL sequence = (batchFlags & INPUT_BATCH_SEQUENCE) != 0;
+	BOOL rc = FALSE;
+	rdp_input_internal* in = input_cast(input);
 
-	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
+	WINPR_ASSERT(eventCode < 8);
+	WINPR_ASSERT(eventFlags < 0x20);
+	WINPR_ASSERT(payload || (length == 0));
 
-	rdp = input->context->rdp;
+	rdpRdp* rdp = input->context->rdp;
 	WINPR_ASSERT(rdp);
 
-	if (!input_ensure_client_running(input))
+	EnterCriticalSection(&in->batchLock);
+	if (mergeable && in->batchMergeable)
+	{
+		BYTE* last = Stream_Buffer(in->batch) + in->batchMergeOffset;
+
+		if (((last[0] >> 5) == eventCode) && input_batch_merge(eventCode, &last[1], payload))
+			goto flush;
+	}
+
+	if (!sequence && in->batch && (in->batchEvents >= INPUT_BATCH_MAX_EVENTS))
+	{
+		if (!input_batch_flush_locked(in))
+			goto out;
+	}
+
+	if (!in->batch)
+	{
+		in->batchSecFlags = 0;
+		in->batch = fastpath_input_pdu_init_header(rdp->fastpath, &in->batchSecFlags);
+		if (!in->batch)
+			goto out;
+		in->batchStart = GetTickCount64();
+		(void)SetEvent(in->batchEvent);
+	}
+
+	if (!Stream_EnsureRemainingCapacity(in->batch, 1 + length))
+		goto out;
+
+	in->batchMergeOffset = Stream_GetPosition(in->batch);
+	in->batchMergeable = mergeable;
+	Stream_Write_UINT8(in->batch, (UINT8)(eventFlags | (eventCode << 5))); /* eventHeader */
+	Stream_Write(in->batch, payload, length);
+	in->batchEvents++;
+
+flush:
+	rc = TRUE;
+	if (!defer || (!sequence && (GetTickCount64() - in->batchStart >= INPUT_BATCH_MAX_DELAY_MS)))
+		rc = input_batch_flush_locked(in);
+
+out:
+	LeaveCriticalSection(&in->batchLock);
+	return rc;
+}
+
+/**
+ * Starts a sequence of count events that must reach the server in one PDU. batchLock is held
+ * until input_batch_sequence_end, so neither input_flush nor other threads can split it, and
+ * the pending batch is sent first if the sequence would not fit.
+ */
+static BOOL input_batch_sequence_begin(rdpInput* input, size_t count)
+{
+	rdp_input_internal* in = input_cast(input);
+
+	WINPR_ASSERT(count <= INPUT_BATCH_MAX_EVENTS);
+
+	EnterCriticalSection(&in->batchLock);
+	if (in->batch && (in->batchEvents + count > INPUT_BATCH_MAX_EVENTS))
+	{
+		if (!input_batch_flush_locked(in))
+		{
+			LeaveCriticalSection(&in->batchLock);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL input_batch_sequence_end(rdpInput* input, BOOL rc)
+{
+	rdp_input_internal* in = input_cast(input);
+
+	LeaveCriticalSection(&in->batchLock);
+	return rc;
+}
+
+BOOL input_flush(rdpInput* input)
+{
+	if (!input)
 		return FALSE;
 
-	/* The FastPath Synchronization eventFlags has identical values as SlowPath */
-	s = fastpath_input_pdu_init(rdp->fastpath, (BYTE)flags, FASTPATH_INPUT_EVENT_SYNC, &sec_flags);
+	rdp_input_internal* in = input_cast(input);
 
-	if (!s)
+	EnterCriticalSection(&in->batchLock);
+	const BOOL rc = input_batch_flush_locked(in);
+	LeaveCriticalSection(&in->batchLock);
+	return rc;
+}
+
+void input_discard(rdpInput* input)
+{
+	if (!input)
+		return;
+
+	rdp_input_internal* in = input_cast(input);
+
+	EnterCriticalSection(&in->batchLock);
+	if (in->batch)
+		Stream_Release(in->batch);
+	in->batch = NULL;
+	in->batchEvents = 0;
+	in->batchMergeable = FALSE;
+	(void)ResetEvent(in->batchEvent);
+	LeaveCriticalSection(&in->batchLock);
+}
+
+HANDLE input_get_event_handle(rdpInput* input)
+{
+	if (!input)
+		return NULL;
+
+	rdp_input_internal* in = input_cast(input);
+	return in->batchEvent;
+}
+
+static BOOL input_send_fastpath_synchronize_event(rdpInput* input, UINT32 flags)
+{
+	WINPR_ASSERT(input);
+	WINPR_ASSERT(input->context);
+
+	if (!input_ensure_client_running(input))
 		return FALSE;
 
-	return fastpath_send_input_pdu(rdp->fastpath, s, sec_flags);
+	/* The FastPath Synchronization eventFlags has identical values as SlowPath */
+	return input_send_fastpath_event(input, (BYTE)flags, FASTPATH_INPUT_EVENT_SYNC, NULL, 0, 0);
 }
 
 static BOOL input_send_fastpath_keyboard_event(rdpInput* input, UINT16 flags, UINT8 code)
 {
-	UINT16 sec_flags = 0;
-	wStream* s = NULL;
 	BYTE eventFlags = 0;
-	rdpRdp* rdp = NULL;
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
 	eventFlags |= (flags & KBD_FLAGS_RELEASE) ? FASTPATH_INPUT_KBDFLAGS_RELEASE : 0;
 	eventFlags |= (flags & KBD_FLAGS_EXTENDED) ? FASTPATH_INPUT_KBDFLAGS_EXTENDED : 0;
 	eventFlags |= (flags & KBD_FLAGS_EXTENDED1) ? FASTPATH_INPUT_KBDFLAGS_PREFIX_E1 : 0;
-	s = fastpath_input_pdu_init(rdp->fastpath, eventFlags, FASTPATH_INPUT_EVENT_SCANCODE,
-	                            &sec_flags);
-
-	if (!s)
-		return FALSE;
 
 	WINPR_ASSERT(code <= UINT8_MAX);
-	Stream_Write_UINT8(s, code); /* keyCode (1 byte) */
-	return fastpath_send_input_pdu(rdp->fastpath, s, sec_flags);
+	return input_send_fastpath_event(input, eventFlags, FASTPATH_INPUT_EVENT_SCANCODE, &code,
+	                                 sizeof(code), 0);
 }
 
 static BOOL input_send_fastpath_unicode_keyboard_event(rdpInput* input, UINT16 flags, UINT16 code)
 {
-	UINT16 sec_flags = 0;
-	wStream* s = NULL;
 	BYTE eventFlags = 0;
-	rdpRdp* rdp = NULL;
+	BYTE payload[2] = { 0 };
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 	WINPR_ASSERT(input->context->settings);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
@@ -412,29 +590,20 @@ static BOOL input_send_fastpath_unicode_keyboard_event(rdpInput* input, UINT16 f
 	}
 
 	eventFlags |= (flags & KBD_FLAGS_RELEASE) ? FASTPATH_INPUT_KBDFLAGS_RELEASE : 0;
-	s = fastpath_input_pdu_init(rdp->fastpath, eventFlags, FASTPATH_INPUT_EVENT_UNICODE,
-	                            &sec_flags);
-
-	if (!s)
-		return FALSE;
-
-	Stream_Write_UINT16(s, code); /* unicodeCode (2 bytes) */
-	return fastpath_send_input_pdu(rdp->fastpath, s, sec_flags);
+	winpr_Data_Write_UINT16(payload, code); /* unicodeCode (2 bytes) */
+	return input_send_fastpath_event(input, eventFlags, FASTPATH_INPUT_EVENT_UNICODE, payload,
+	                                 sizeof(payload), 0);
 }
 
 static BOOL input_send_fastpath_mouse_event(rdpInput* input, UINT16 flags, UINT16 x, UINT16 y)
 {
-	UINT16 sec_flags = 0;
-	wStream* s = NULL;
-	rdpRdp* rdp = NULL;
+	wStream sbuffer = { 0 };
+	BYTE payload[6] = { 0 };
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 	WINPR_ASSERT(input->context->settings);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
@@ -450,28 +619,24 @@ static BOOL input_send_fastpath_mouse_event(rdpInput* input, UINT16 flags, UINT1
 		}
 	}
 
-	s = fastpath_input_pdu_init(rdp->fastpath, 0, FASTPATH_INPUT_EVENT_MOUSE, &sec_flags);
-
-	if (!s)
-		return FALSE;
-
+	wStream* s = Stream_StaticInit(&sbuffer, payload, sizeof(payload));
 	input_write_mouse_event(s, flags, x, y);
-	return fastpath_send_input_pdu(rdp->fastpath, s, sec_flags);
+
+	/* consecutive moves without button changes only need the latest position */
+	return input_send_fastpath_event(input, 0, FASTPATH_INPUT_EVENT_MOUSE, payload,
+	                                 sizeof(payload),
+	                                 (flags == PTR_FLAGS_MOVE) ? INPUT_BATCH_MERGE : 0);
 }
 
 static BOOL input_send_fastpath_extended_mouse_event(rdpInput* input, UINT16 flags, UINT16 x,
                                                      UINT16 y)
 {
-	UINT16 sec_flags = 0;
-	wStream* s = NULL;
-	rdpRdp* rdp = NULL;
+	wStream sbuffer = { 0 };
+	BYTE payload[6] = { 0 };
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
@@ -484,29 +649,21 @@ static BOOL input_send_fastpath_extended_mouse_event(rdpInput* input, UINT16 fla
 		return TRUE;
 	}
 
-	s = fastpath_input_pdu_init(rdp->fastpath, 0, FASTPATH_INPUT_EVENT_MOUSEX, &sec_flags);
-
-	if (!s)
-		return FALSE;
-
+	wStream* s = Stream_StaticInit(&sbuffer, payload, sizeof(payload));
 	input_write_extended_mouse_event(s, flags, x, y);
-	return fastpath_send_input_pdu(rdp->fastpath, s, sec_flags);
+	return input_send_fastpath_event(input, 0, FASTPATH_INPUT_EVENT_MOUSEX, payload,
+	                                 sizeof(payload), 0);
 }
 
 static BOOL input_send_fastpath_relmouse_event(rdpInput* input, UINT16 flags, INT16 xDelta,
                                                INT16 yDelta)
 {
-	UINT16 sec_flags = 0;
-	wStream* s = NULL;
-	rdpRdp* rdp = NULL;
+	BYTE payload[6] = { 0 };
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 	WINPR_ASSERT(input->context->settings);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
@@ -516,26 +673,23 @@ static BOOL input_send_fastpath_relmouse_event(rdpInput* input, UINT16 flags, IN
 		return FALSE;
 	}
 
-	s = fastpath_input_pdu_init(rdp->fastpath, 0, TS_FP_RELPOINTER_EVENT, &sec_flags);
-
-	if (!s)
-		return FALSE;
+	winpr_Data_Write_UINT16(&payload[0], flags); /* pointerFlags (2 bytes) */
+	winpr_Data_Write_INT16(&payload[2], xDelta); /* xDelta (2 bytes) */
+	winpr_Data_Write_INT16(&payload[4], yDelta); /* yDelta (2 bytes) */
 
-	Stream_Write_UINT16(s, flags); /* pointerFlags (2 bytes) */
-	Stream_Write_INT16(s, xDelta); /* xDelta (2 bytes) */
-	Stream_Write_INT16(s, yDelta); /* yDelta (2 bytes) */
-	return fastpath_send_input_pdu(rdp->fastpath, s, sec_flags);
+	/* consecutive plain moves are summed up */
+	return input_send_fastpath_event(input, 0, TS_FP_RELPOINTER_EVENT, payload, sizeof(payload),
+	                                 (flags == PTR_FLAGS_MOVE) ? INPUT_BATCH_MERGE : 0);
 }
 
 static BOOL input_send_fastpath_qoe_event(rdpInput* input, UINT32 timestampMS)
 {
+	BYTE payload[4] = { 0 };
+
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 	WINPR_ASSERT(input->context->settings);
 
-	rdpRdp* rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
@@ -545,55 +699,40 @@ static BOOL input_send_fastpath_qoe_event(rdpInput* input, UINT32 timestampMS)
 		return FALSE;
 	}
 
-	UINT16 sec_flags = 0;
-	wStream* s = fastpath_input_pdu_init(rdp->fastpath, 0, TS_FP_QOETIMESTAMP_EVENT, &sec_flags);
-
-	if (!s)
-		return FALSE;
-
-	if (!Stream_EnsureRemainingCapacity(s, 4))
-	{
-		Stream_Free(s, TRUE);
-		return FALSE;
-	}
-
-	Stream_Write_UINT32(s, timestampMS);
-	return fastpath_send_input_pdu(rdp->fastpath, s, sec_flags);
+	winpr_Data_Write_UINT32(payload, timestampMS);
+	return input_send_fastpath_event(input, 0, TS_FP_QOETIMESTAMP_EVENT, payload, sizeof(payload),
+	                                 0);
 }
 
 static BOOL input_send_fastpath_focus_in_event(rdpInput* input, UINT16 toggleStates)
 {
-	UINT16 sec_flags = 0;
-	wStream* s = NULL;
-	BYTE eventFlags = 0;
-	rdpRdp* rdp = NULL;
+	const BYTE tab = 0x0f;
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
-	s = fastpath_input_pdu_init_header(rdp->fastpath, &sec_flags);
-
-	if (!s)
+	if (!input_batch_sequence_begin(input, 3))
 		return FALSE;
 
 	/* send a tab up like mstsc.exe */
-	eventFlags = FASTPATH_INPUT_KBDFLAGS_RELEASE | FASTPATH_INPUT_EVENT_SCANCODE << 5;
-	Stream_Write_UINT8(s, eventFlags); /* Key Release event (1 byte) */
-	Stream_Write_UINT8(s, 0x0f);       /* keyCode (1 byte) */
+	if (!input_send_fastpath_event(input, FASTPATH_INPUT_KBDFLAGS_RELEASE,
+	                               FASTPATH_INPUT_EVENT_SCANCODE, &tab, sizeof(tab),
+	                               INPUT_BATCH_SEQUENCE | INPUT_BATCH_DEFER))
+		return input_batch_sequence_end(input, FALSE);
+
 	/* send the toggle key states */
-	eventFlags = (toggleStates & 0x1F) | FASTPATH_INPUT_EVENT_SYNC << 5;
-	Stream_Write_UINT8(s, eventFlags); /* toggle state (1 byte) */
+	if (!input_send_fastpath_event(input, toggleStates & 0x1F, FASTPATH_INPUT_EVENT_SYNC, NULL, 0,
+	                               INPUT_BATCH_SEQUENCE | INPUT_BATCH_DEFER))
+		return input_batch_sequence_end(input, FALSE);
+
 	/* send another tab up like mstsc.exe */
-	eventFlags = FASTPATH_INPUT_KBDFLAGS_RELEASE | FASTPATH_INPUT_EVENT_SCANCODE << 5;
-	Stream_Write_UINT8(s, eventFlags); /* Key Release event (1 byte) */
-	Stream_Write_UINT8(s, 0x0f);       /* keyCode (1 byte) */
-	return fastpath_send_multiple_input_pdu(rdp->fastpath, s, 3, sec_flags);
+	const BOOL rc = input_send_fastpath_event(input, FASTPATH_INPUT_KBDFLAGS_RELEASE,
+	                                          FASTPATH_INPUT_EVENT_SCANCODE, &tab, sizeof(tab),
+	                                          INPUT_BATCH_SEQUENCE);
+	return input_batch_sequence_end(input, rc);
 }
 
 static BOOL input_send_fastpath_keyboard_pause_event(rdpInput* input)
@@ -602,39 +741,41 @@ static BOOL input_send_fastpath_keyboard_pause_event(rdpInput* input)
 	 * and pause-up sent nothing.  However, reverse engineering mstsc shows
 	 * it sending the following sequence:
 	 */
-	UINT16 sec_flags = 0;
-	wStream* s = NULL;
-	const BYTE keyDownEvent = FASTPATH_INPUT_EVENT_SCANCODE << 5;
-	const BYTE keyUpEvent = (FASTPATH_INPUT_EVENT_SCANCODE << 5) | FASTPATH_INPUT_KBDFLAGS_RELEASE;
-	rdpRdp* rdp = NULL;
+	const struct
+	{
+		BYTE flags;
+		BYTE code;
+	} sequence[] = {
+		/* Control down (0x1D) */
+		{ FASTPATH_INPUT_KBDFLAGS_PREFIX_E1, RDP_SCANCODE_CODE(RDP_SCANCODE_LCONTROL) },
+		/* Numlock down (0x45) */
+		{ 0, RDP_SCANCODE_CODE(RDP_SCANCODE_NUMLOCK) },
+		/* Control up (0x1D) */
+		{ FASTPATH_INPUT_KBDFLAGS_RELEASE | FASTPATH_INPUT_KBDFLAGS_PREFIX_E1,
+		  RDP_SCANCODE_CODE(RDP_SCANCODE_LCONTROL) },
+		/* Numlock up (0x45) */
+		{ FASTPATH_INPUT_KBDFLAGS_RELEASE, RDP_SCANCODE_CODE(RDP_SCANCODE_NUMLOCK) },
+	};
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
-	s = fastpath_input_pdu_init_header(rdp->fastpath, &sec_flags);
-
-	if (!s)
+	if (!input_batch_sequence_begin(input, ARRAYSIZE(sequence)))
 		return FALSE;
 
-	/* Control down (0x1D) */
-	Stream_Write_UINT8(s, keyDownEvent | FASTPATH_INPUT_KBDFLAGS_PREFIX_E1);
-	Stream_Write_UINT8(s, RDP_SCANCODE_CODE(RDP_SCANCODE_LCONTROL));
-	/* Numlock down (0x45) */
-	Stream_Write_UINT8(s, keyDownEvent);
-	Stream_Write_UINT8(s, RDP_SCANCODE_CODE(RDP_SCANCODE_NUMLOCK));
-	/* Control up (0x1D) */
-	Stream_Write_UINT8(s, keyUpEvent | FASTPATH_INPUT_KBDFLAGS_PREFIX_E1);
-	Stream_Write_UINT8(s, RDP_SCANCODE_CODE(RDP_SCANCODE_LCONTROL));
-	/* Numlock down (0x45) */
-	Stream_Write_UINT8(s, keyUpEvent);
-	Stream_Write_UINT8(s, RDP_SCANCODE_CODE(RDP_SCANCODE_NUMLOCK));
-	return fastpath_send_multiple_input_pdu(rdp->fastpath, s, 4, sec_flags);
+	for (size_t x = 0; x < ARRAYSIZE(sequence); x++)
+	{
+		const UINT32 batchFlags =
+		    INPUT_BATCH_SEQUENCE | ((x + 1 < ARRAYSIZE(sequence)) ? INPUT_BATCH_DEFER : 0);
+
+		if (!input_send_fastpath_event(input, sequence[x].flags, FASTPATH_INPUT_EVENT_SCANCODE,
+		                               &sequence[x].code, sizeof(sequence[x].code), batchFlags))
+			return input_batch_sequence_end(input, FALSE);
+	}
+	return input_batch_sequence_end(input, TRUE);
 }
 
 static BOOL input_recv_sync_event(rdpInput* input, wStream* s)
@@ -1075,6 +1216,15 @@ rdpInput* input_new(rdpRdp* rdp)
 		return NULL;
 	}
 
+	input->batchEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (!input->batchEvent)
+	{
+		MessageQueue_Free(input->queue);
+		free(input);
+		return NULL;
+	}
+
+	InitializeCriticalSection(&input->batchLock);
 	return &input->common;
 }
 
@@ -1085,6 +1235,9 @@ void input_free(rdpInput* input)
 		rdp_input_internal* in = input_cast(input);
 
 		MessageQueue_Free(in->queue);
+		input_discard(input);
+		(void)CloseHandle(in->batchEvent);
+		DeleteCriticalSection(&in->batchLock);
 		free(in);
 	}
 }
@@ -41,6 +41,16 @@ typedef struct
 	UINT64 lastInputTimestamp;
 	UINT16 lastX;
 	UINT16 lastY;
+
+	/* fast-path events not yet sent, guarded by batchLock */
+	CRITICAL_SECTION batchLock;
+	HANDLE batchEvent;
+	wStream* batch;
+	size_t batchEvents;
+	UINT16 batchSecFlags;
+	UINT64 batchStart;
+	size_t batchMergeOffset;
+	BOOL batchMergeable;
 } rdp_input_internal;
 
 static INLINE rdp_input_internal* input_cast(rdpInput* input)
@@ -58,6 +68,10 @@ static INLINE rdp_input_internal* input_cast(rdpInput* input)
 FREERDP_LOCAL BOOL input_recv(rdpInput* input, wStream* s);
 
 FREERDP_LOCAL int input_process_events(rdpInput* input);
+
+FREERDP_LOCAL BOOL input_flush(rdpInput* input);
+FREERDP_LOCAL void input_discard(rdpInput* input);
+FREERDP_LOCAL HANDLE input_get_event_handle(rdpInput* input);
 FREERDP_LOCAL BOOL input_register_client_callbacks(rdpInput* input);
 
 FREERDP_LOCAL void input_free(rdpInput* input);
@@ -328,8 +328,15 @@ static BOOL freerdp_peer_check_fds(freerdp_peer* peer)
 	WINPR_ASSERT(peer->context);
 
 	rdp = peer->context->rdp;
+
+	/* Replies to everything received in this iteration are gathered into full size writes.
+	 * Not during the connection sequence, parts of it wait for the client to answer. */
+	const BOOL corked = rdp_is_active_state(rdp) && transport_cork(rdp->transport);
 	status = rdp_check_fds(rdp);
 
+	if (corked && !transport_uncork(rdp->transport))
+		return FALSE;
+
 	if (status < 0)
 		return FALSE;
 
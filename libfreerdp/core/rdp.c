@@ -962,7 +962,14 @@ BOOL rdp_send_data_pdu(rdpRdp* rdp, wStream* s, BYTE type, UINT16 channel_id, UI
 	           Stream_Length(s), channel_id);
 
 	rdp->outPackets++;
-	if (transport_write(rdp->transport, s) < 0)
+
+	/* slow path input and pointer updates must not wait for a corked frame */
+	if ((type == DATA_PDU_TYPE_INPUT) || (type == DATA_PDU_TYPE_POINTER))
+	{
+		if (transport_write_immediate(rdp->transport, s) < 0)
+			goto fail;
+	}
+	else if (transport_write(rdp->transport, s) < 0)
 		goto fail;
 
 	rc = TRUE;
@@ -2256,6 +2263,10 @@ int rdp_check_fds(rdpRdp* rdp)
 	WINPR_ASSERT(rdp);
 	transport = rdp->transport;
 
+	/* send pointer moves collected since the last iteration, they are not worth failing for */
+	if (!input_flush(rdp->input))
+		WLog_Print(rdp->log, WLOG_DEBUG, "rdp_check_fds: input_flush() failed");
+
 	tsg = transport_get_tsg(transport);
 	if (tsg)
 	{
@@ -2452,6 +2463,9 @@ static void rdp_reset_free(rdpRdp* rdp)
 {
 	WINPR_ASSERT(rdp);
 
+	/* pending input is allocated from the transport about to be freed */
+	input_discard(rdp->input);
+
 	(void)security_lock(rdp);
 	rdp_free_rc4_decrypt_keys(rdp);
 	rdp_free_rc4_encrypt_keys(rdp);
@@ -613,6 +613,10 @@ BOOL WTSVirtualChannelManagerCheckFileDescriptorEx(HANDLE hServer, BOOL autoOpen
 			return FALSE;
 	}
 
+	/* channel data queued since the last call goes out in as few writes as possible */
+	WINPR_ASSERT(vcm->rdp);
+	const BOOL corked = rdp_is_active_state(vcm->rdp) && transport_cork(vcm->rdp->transport);
+
 	while (MessageQueue_Peek(vcm->queue, &message, TRUE))
 	{
 		BYTE* buffer = NULL;
@@ -635,6 +639,9 @@ BOOL WTSVirtualChannelManagerCheckFileDescriptorEx(HANDLE hServer, BOOL autoOpen
 			break;
 	}
 
+	if (corked && !transport_uncork(vcm->rdp->transport))
+		status = FALSE;
+
 	return status;
 }
 
@@ -90,6 +90,23 @@
 #include <linux/vm_sockets.h>
 #endif
 
+#if defined(HAVE_LINUX_TLS_H) && defined(BIO_CTRL_GET_KTLS_SEND) && !defined(OPENSSL_NO_KTLS)
+#include <linux/tls.h>
+#define TRANSPORT_BIO_KTLS
+
+/* OpenSSL hands the session keys to the BIO with these controls, they are not part of the
+ * public headers but have been stable since OpenSSL 3.0 */
+#if !defined(BIO_CTRL_SET_KTLS)
+#define BIO_CTRL_SET_KTLS 72
+#endif
+#if !defined(BIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG)
+#define BIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG 74
+#endif
+#if !defined(BIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG)
+#define BIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG 75
+#endif
+#endif
+
 #define TAG FREERDP_TAG("core")
 
 /* Simple Socket BIO */
@@ -98,11 +115,105 @@ typedef struct
 {
 	SOCKET socket;
 	HANDLE hEvent;
+#if defined(TRANSPORT_BIO_KTLS)
+	BOOL ktlsUlp;
+	BOOL ktlsSend;
+	int ktlsRecordType; /* non application data record type of the next write */
+#endif
 } WINPR_BIO_SIMPLE_SOCKET;
 
 static int transport_bio_simple_init(BIO* bio, SOCKET socket, int shutdown);
 static int transport_bio_simple_uninit(BIO* bio);
 
+#if defined(TRANSPORT_BIO_KTLS)
+static size_t transport_bio_ktls_crypto_info_size(const struct tls_crypto_info* info)
+{
+	switch (info->cipher_type)
+	{
+		case TLS_CIPHER_AES_GCM_128:
+			return sizeof(struct tls12_crypto_info_aes_gcm_128);
+#if defined(TLS_CIPHER_AES_GCM_256)
+		case TLS_CIPHER_AES_GCM_256:
+			return sizeof(struct tls12_crypto_info_aes_gcm_256);
+#endif
+#if defined(TLS_CIPHER_AES_CCM_128)
+		case TLS_CIPHER_AES_CCM_128:
+			return sizeof(struct tls12_crypto_info_aes_ccm_128);
+#endif
+#if defined(TLS_CIPHER_CHACHA20_POLY1305)
+		case TLS_CIPHER_CHACHA20_POLY1305:
+			return sizeof(struct tls12_crypto_info_chacha20_poly1305);
+#endif
+		default:
+			return 0;
+	}
+}
+
+/**
+ * Moves the transmit direction of the socket to kernel TLS. Only sending is offloaded, the
+ * receive path would have to deal with non application data records the kernel hands out.
+ */
+static long transport_bio_ktls_start(WINPR_BIO_SIMPLE_SOCKET* ptr, long isTx, void* cryptoInfo)
+{
+	WINPR_ASSERT(ptr);
+
+	if (!isTx || !cryptoInfo)
+		return 0;
+
+	const size_t size = transport_bio_ktls_crypto_info_size(cryptoInfo);
+	if (size == 0)
+		return 0;
+
+	if (!ptr->ktlsUlp)
+	{
+		if (setsockopt((int)ptr->socket, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) != 0)
+		{
+			WLog_DBG(TAG, "TCP_ULP tls not available: %s", strerror(errno));
+			return 0;
+		}
+		ptr->ktlsUlp = TRUE;
+	}
+
+	if (setsockopt((int)ptr->socket, SOL_TLS, TLS_TX, cryptoInfo, (socklen_t)size) != 0)
+	{
+		WLog_DBG(TAG, "TLS_TX not available: %s", strerror(errno));
+		return 0;
+	}
+
+	ptr->ktlsSend = TRUE;
+	return 1;
+}
+
+static int transport_bio_ktls_send_record(WINPR_BIO_SIMPLE_SOCKET* ptr, const char* buf, int size)
+{
+	char control[CMSG_SPACE(sizeof(unsigned char))] = { 0 };
+	struct iovec iov = { .iov_base = WINPR_CAST_CONST_PTR_AWAY(buf, void*),
+		                 .iov_len = (size_t)size };
+	struct msghdr msg = { 0 };
+
+	WINPR_ASSERT(ptr);
+
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_TLS;
+	cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(unsigned char));
+	*CMSG_DATA(cmsg) = (unsigned char)ptr->ktlsRecordType;
+
+	const ssize_t status = sendmsg((int)ptr->socket, &msg, 0);
+	if (status < 0)
+		return -1;
+
+	/* the kernel sends a record in one piece */
+	ptr->ktlsRecordType = 0;
+	return size;
+}
+#endif
+
 static int transport_bio_simple_write(BIO* bio, const char* buf, int size)
 {
 	int error = 0;
@@ -113,7 +224,12 @@ static int transport_bio_simple_write(BIO* bio, const char* buf, int size)
 		return 0;
 
 	BIO_clear_flags(bio, BIO_FLAGS_WRITE);
-	status = _send(ptr->socket, buf, size, 0);
+#if defined(TRANSPORT_BIO_KTLS)
+	if (ptr->ktlsRecordType != 0)
+		status = transport_bio_ktls_send_record(ptr, buf, size);
+	else
+#endif
+		status = _send(ptr->socket, buf, size, 0);
 
 	if (status <= 0)
 	{
@@ -338,6 +454,27 @@ static long transport_bio_simple_ctrl(BIO* bio, int cmd, long arg1, void* arg2)
 			status = 1;
 			break;
 
+#if defined(TRANSPORT_BIO_KTLS)
+		case BIO_CTRL_SET_KTLS:
+			if (!BIO_get_init(bio))
+				return 0;
+			return transport_bio_ktls_start(ptr, arg1, arg2);
+
+		case BIO_CTRL_GET_KTLS_SEND:
+			return BIO_get_init(bio) && ptr->ktlsSend;
+
+		case BIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG:
+			if (!BIO_get_init(bio) || !ptr->ktlsSend)
+				return 0;
+			ptr->ktlsRecordType = (int)arg1;
+			return 1;
+
+		case BIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG:
+			if (BIO_get_init(bio))
+				ptr->ktlsRecordType = 0;
+			return 1;
+#endif
+
 		default:
 			status = 0;
 			break;
@@ -350,6 +487,11 @@ static int transport_bio_simple_init(BIO* bio, SOCKET socket, int shutdown)
 {
 	WINPR_BIO_SIMPLE_SOCKET* ptr = (WINPR_BIO_SIMPLE_SOCKET*)BIO_get_data(bio);
 	ptr->socket = socket;
+#if defined(TRANSPORT_BIO_KTLS)
+	ptr->ktlsUlp = FALSE;
+	ptr->ktlsSend = FALSE;
+	ptr->ktlsRecordType = 0;
+#endif
 	BIO_set_shutdown(bio, shutdown);
 	BIO_set_flags(bio, BIO_FLAGS_SHOULD_RETRY);
 	BIO_set_init(bio, 1);
@@ -454,8 +596,90 @@ typedef struct
 	BOOL readBlocked;
 	BOOL writeBlocked;
 	RingBuffer xmitBuffer;
+#if defined(TRANSPORT_BIO_KTLS)
+	BOOL ktlsControlRecord; /* the next write is a kernel TLS record that must not be split */
+#endif
 } WINPR_BIO_BUFFERED_SOCKET;
 
+#if defined(TRANSPORT_BIO_KTLS)
+static int transport_bio_buffered_write(BIO* bio, const char* buf, int num);
+
+/* control records bypass the ring buffer, their record type only applies to a single write */
+static int transport_bio_buffered_write_control_record(BIO* bio, const char* buf, int num)
+{
+	WINPR_BIO_BUFFERED_SOCKET* ptr = (WINPR_BIO_BUFFERED_SOCKET*)BIO_get_data(bio);
+	BIO* next_bio = BIO_next(bio);
+
+	WINPR_ASSERT(ptr);
+	WINPR_ASSERT(ringbuffer_used(&ptr->xmitBuffer) == 0);
+
+	ERR_clear_error();
+	const int status = BIO_write(next_bio, buf, num);
+
+	if (status > 0)
+	{
+		ptr->ktlsControlRecord = FALSE;
+		return status;
+	}
+
+	if (!BIO_should_retry(next_bio))
+	{
+		BIO_clear_flags(bio, BIO_FLAGS_SHOULD_RETRY);
+		return -1;
+	}
+
+	BIO_set_flags(bio, BIO_FLAGS_WRITE | BIO_FLAGS_SHOULD_RETRY);
+	ptr->writeBlocked = TRUE;
+	return -1;
+}
+
+/* writes out everything queued, waiting for the socket if it would block */
+static BOOL transport_bio_buffered_drain(BIO* bio)
+{
+	WINPR_BIO_BUFFERED_SOCKET* ptr = (WINPR_BIO_BUFFERED_SOCKET*)BIO_get_data(bio);
+	BIO* next_bio = BIO_next(bio);
+
+	WINPR_ASSERT(ptr);
+
+	while (ringbuffer_used(&ptr->xmitBuffer) > 0)
+	{
+		if (transport_bio_buffered_write(bio, NULL, 0) < 0)
+			return FALSE;
+
+		if ((ringbuffer_used(&ptr->xmitBuffer) > 0) && (BIO_wait_write(next_bio, 100) < 0))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* records queued before the switch were already encrypted by OpenSSL and must not go through
+ * the kernel. If they cannot be sent, refuse and OpenSSL stays with user space TLS. */
+static long transport_bio_buffered_set_ktls(BIO* bio, long arg1, void* arg2)
+{
+	if (!transport_bio_buffered_drain(bio))
+		return 0;
+
+	return BIO_ctrl(BIO_next(bio), BIO_CTRL_SET_KTLS, arg1, arg2);
+}
+
+static long transport_bio_buffered_set_control_record(BIO* bio, long type)
+{
+	WINPR_BIO_BUFFERED_SOCKET* ptr = (WINPR_BIO_BUFFERED_SOCKET*)BIO_get_data(bio);
+	BIO* next_bio = BIO_next(bio);
+
+	WINPR_ASSERT(ptr);
+
+	/* everything queued before the control record has to reach the kernel first */
+	if (!transport_bio_buffered_drain(bio))
+		return 0;
+
+	const long status = BIO_ctrl(next_bio, BIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG, type, NULL);
+	ptr->ktlsControlRecord = (status > 0);
+	return status;
+}
+#endif
+
 static int transport_bio_buffered_write(BIO* bio, const char* buf, int num)
 {
 	int ret = num;
@@ -473,6 +697,11 @@ static int transport_bio_buffered_write(BIO* bio, const char* buf, int num)
 	ptr->writeBlocked = FALSE;
 	BIO_clear_flags(bio, BIO_FLAGS_WRITE);
 
+#if defined(TRANSPORT_BIO_KTLS)
+	if (ptr->ktlsControlRecord && buf)
+		return transport_bio_buffered_write_control_record(bio, buf, num);
+#endif
+
 	/* we directly append extra bytes in the xmit buffer, this could be prevented
 	 * but for now it makes the code more simple.
 	 */
@@ -599,6 +828,21 @@ static long transport_bio_buffered_ctrl(BIO* bio, int cmd, long arg1, void* arg2
 			status = (int)ptr->writeBlocked;
 			break;
 
+#if defined(TRANSPORT_BIO_KTLS)
+		case BIO_CTRL_SET_KTLS:
+			status = transport_bio_buffered_set_ktls(bio, arg1, arg2);
+			break;
+
+		case BIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG:
+			status = transport_bio_buffered_set_control_record(bio, arg1);
+			break;
+
+		case BIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG:
+			ptr->ktlsControlRecord = FALSE;
+			status = BIO_ctrl(BIO_next(bio), cmd, arg1, arg2);
+			break;
+#endif
+
 		default:
 			status = BIO_ctrl(BIO_next(bio), cmd, arg1, arg2);
 			break;
@@ -53,6 +53,7 @@
 #define BIO_C_WAIT_READ 1107
 #define BIO_C_WAIT_WRITE 1108
 #define BIO_C_SET_HANDLE 1109
+#define BIO_C_PEEK 1110
 
 static INLINE long BIO_set_socket(BIO* b, SOCKET s, long c)
 {
@@ -92,6 +93,14 @@ static INLINE long BIO_wait_write(BIO* b, long c)
 	return BIO_ctrl(b, BIO_C_WAIT_WRITE, c, NULL);
 }
 
+/** @brief copy up to \b size readable bytes to \b buf without consuming them
+ *  @return the number of bytes copied, <= 0 if nothing is available (check BIO_should_retry)
+ */
+static INLINE long BIO_peek(BIO* b, void* buf, long size)
+{
+	return BIO_ctrl(b, BIO_C_PEEK, size, buf);
+}
+
 FREERDP_LOCAL BIO_METHOD* BIO_s_simple_socket(void);
 FREERDP_LOCAL BIO_METHOD* BIO_s_buffered_socket(void);
 
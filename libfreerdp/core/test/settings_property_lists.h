@@ -97,6 +97,7 @@ static const size_t bool_list_indices[] = {
 	FreeRDP_IgnoreInvalidDevices,
 	FreeRDP_JpegCodec,
 	FreeRDP_KerberosRdgIsProxy,
+	FreeRDP_KernelTlsOffload,
 	FreeRDP_ListMonitors,
 	FreeRDP_LocalConnection,
 	FreeRDP_LogonErrors,
@@ -236,7 +237,10 @@ static const size_t uint32_list_indices[] = {
 	FreeRDP_ColorDepth,
 	FreeRDP_ColorPointerCacheSize,
 	FreeRDP_CompDeskSupportLevel,
+	FreeRDP_CompressionEffort,
 	FreeRDP_CompressionLevel,
+	FreeRDP_CompressionMatchDepth,
+	FreeRDP_CompressionMatchWays,
 	FreeRDP_ConnectionType,
 	FreeRDP_CookieMaxLength,
 	FreeRDP_DesktopHeight,
@@ -64,6 +64,8 @@
 #define TAG FREERDP_TAG("core.transport")
 
 #define BUFFER_SIZE 16384
+/* PDUs written while corked are gathered up to the payload size of a full TLS record */
+#define TRANSPORT_CORK_SIZE 16384
 
 struct rdp_transport
 {
@@ -88,6 +90,8 @@ struct rdp_transport
 	CRITICAL_SECTION ReadLock;
 	CRITICAL_SECTION WriteLock;
 	UINT64 written;
+	size_t corked;
+	wStream* CorkBuffer;
 	HANDLE rereadEvent;
 	BOOL haveMoreBytesToRead;
 	wLog* log;
@@ -1138,37 +1142,16 @@ int transport_write(rdpTransport* transport, wStream* s)
 	return IFCALLRESULT(-1, transport->io.WritePdu, transport, s);
 }
 
-static int transport_default_write(rdpTransport* transport, wStream* s)
+/* must be called with WriteLock held, writes length bytes starting at the current position of s */
+static int transport_write_bio(rdpTransport* transport, wStream* s, size_t length)
 {
 	int status = -1;
 	rdpContext* context = transport_get_context(transport);
+	const size_t writtenlength = length;
 
 	WINPR_ASSERT(transport);
 	WINPR_ASSERT(context);
 
-	if (!s)
-		return -1;
-
-	Stream_AddRef(s);
-
-	rdpRdp* rdp = context->rdp;
-	if (!rdp)
-		goto fail;
-
-	EnterCriticalSection(&(transport->WriteLock));
-	if (!transport->frontBio)
-		goto out_cleanup;
-
-	size_t length = Stream_GetPosition(s);
-	size_t writtenlength = length;
-	Stream_SetPosition(s, 0);
-
-	if (length > 0)
-	{
-		rdp->outBytes += length;
-		WLog_Packet(transport->log, WLOG_TRACE, Stream_Buffer(s), length, WLOG_PACKET_OUTBOUND);
-	}
-
 	while (length > 0)
 	{
 		ERR_clear_error();
@@ -1184,21 +1167,20 @@ static int transport_default_write(rdpTransport* transport, wStream* s)
 			if (!BIO_should_retry(transport->frontBio))
 			{
 				WLog_ERR_BIO(transport, "BIO_should_retry", transport->frontBio);
-				goto out_cleanup;
+				return status;
 			}
 
 			/* non-blocking can live with blocked IOs */
 			if (!transport->blocking)
 			{
 				WLog_ERR_BIO(transport, "BIO_write", transport->frontBio);
-				goto out_cleanup;
+				return status;
 			}
 
 			if (BIO_wait_write(transport->frontBio, 100) < 0)
 			{
 				WLog_ERR_BIO(transport, "BIO_wait_write", transport->frontBio);
-				status = -1;
-				goto out_cleanup;
+				return -1;
 			}
 
 			continue;
@@ -1212,46 +1194,174 @@ static int transport_default_write(rdpTransport* transport, wStream* s)
 				if (BIO_wait_write(transport->frontBio, 100) < 0)
 				{
 					WLog_Print(transport->log, WLOG_ERROR, "error when selecting for write");
-					status = -1;
-					goto out_cleanup;
+					return -1;
 				}
 
 				if (BIO_flush(transport->frontBio) < 1)
 				{
 					WLog_Print(transport->log, WLOG_ERROR, "error when flushing outputBuffer");
-					status = -1;
-					goto out_cleanup;
+					return -1;
 				}
 			}
 		}
 
 		const size_t ustatus = (size_t)status;
 		if (ustatus > length)
-		{
-			status = -1;
-			goto out_cleanup;
-		}
+			return -1;
 
 		length -= ustatus;
 		Stream_Seek(s, ustatus);
 	}
 
 	transport->written += writtenlength;
-out_cleanup:
+	return status;
+}
 
-	if (status < 0)
+/* must be called with WriteLock held */
+static int transport_write_cork_buffer(rdpTransport* transport)
+{
+	WINPR_ASSERT(transport);
+
+	wStream* s = transport->CorkBuffer;
+	if (!s || (Stream_GetPosition(s) == 0))
+		return 1;
+
+	const size_t length = Stream_GetPosition(s);
+	Stream_SetPosition(s, 0);
+	const int status = transport_write_bio(transport, s, length);
+	Stream_SetPosition(s, 0);
+	return status;
+}
+
+static void transport_write_failed(rdpTransport* transport)
+{
+	WINPR_ASSERT(transport);
+
+	/* A write error indicates that the peer has dropped the connection */
+	transport->layer = TRANSPORT_LAYER_CLOSED;
+	freerdp_set_last_error_if_not(transport_get_context(transport),
+	                              FREERDP_ERROR_CONNECT_TRANSPORT_FAILED);
+}
+
+static int transport_default_write(rdpTransport* transport, wStream* s)
+{
+	int status = -1;
+	rdpContext* context = transport_get_context(transport);
+
+	WINPR_ASSERT(transport);
+	WINPR_ASSERT(context);
+
+	if (!s)
+		return -1;
+
+	Stream_AddRef(s);
+
+	rdpRdp* rdp = context->rdp;
+	if (!rdp)
+		goto fail;
+
+	EnterCriticalSection(&(transport->WriteLock));
+	if (!transport->frontBio)
+		goto out_cleanup;
+
+	const size_t length = Stream_GetPosition(s);
+	Stream_SetPosition(s, 0);
+
+	if (length > 0)
 	{
-		/* A write error indicates that the peer has dropped the connection */
-		transport->layer = TRANSPORT_LAYER_CLOSED;
-		freerdp_set_last_error_if_not(context, FREERDP_ERROR_CONNECT_TRANSPORT_FAILED);
+		rdp->outBytes += length;
+		WLog_Packet(transport->log, WLOG_TRACE, Stream_Buffer(s), length, WLOG_PACKET_OUTBOUND);
+	}
+
+	if ((transport->corked > 0) && (length > 0) && (length < TRANSPORT_CORK_SIZE))
+	{
+		wStream* cork = transport->CorkBuffer;
+		WINPR_ASSERT(cork);
+
+		if (Stream_GetPosition(cork) + length > TRANSPORT_CORK_SIZE)
+		{
+			status = transport_write_cork_buffer(transport);
+			if (status < 0)
+				goto out_cleanup;
+		}
+
+		Stream_Write(cork, Stream_ConstPointer(s), length);
+		Stream_Seek(s, length);
+		status = (int)length;
+	}
+	else
+	{
+		/* larger PDUs fill records on their own, anything gathered must go out first */
+		status = transport_write_cork_buffer(transport);
+		if (status >= 0)
+			status = transport_write_bio(transport, s, length);
 	}
 
+out_cleanup:
+	if (status < 0)
+		transport_write_failed(transport);
+
 	LeaveCriticalSection(&(transport->WriteLock));
 fail:
 	Stream_Release(s);
 	return status;
 }
 
+BOOL transport_cork(rdpTransport* transport)
+{
+	BOOL rc = FALSE;
+
+	WINPR_ASSERT(transport);
+
+	EnterCriticalSection(&(transport->WriteLock));
+	if (!transport->CorkBuffer)
+		transport->CorkBuffer = Stream_New(NULL, TRANSPORT_CORK_SIZE);
+
+	if (transport->CorkBuffer)
+	{
+		transport->corked++;
+		rc = TRUE;
+	}
+	LeaveCriticalSection(&(transport->WriteLock));
+	return rc;
+}
+
+BOOL transport_uncork(rdpTransport* transport)
+{
+	BOOL rc = TRUE;
+
+	WINPR_ASSERT(transport);
+
+	EnterCriticalSection(&(transport->WriteLock));
+	WINPR_ASSERT(transport->corked > 0);
+	transport->corked--;
+
+	if ((transport->corked == 0) && transport->frontBio)
+	{
+		if (transport_write_cork_buffer(transport) < 0)
+		{
+			transport_write_failed(transport);
+			rc = FALSE;
+		}
+	}
+	LeaveCriticalSection(&(transport->WriteLock));
+	return rc;
+}
+
+int transport_write_immediate(rdpTransport* transport, wStream* s)
+{
+	WINPR_ASSERT(transport);
+
+	/* the write lock is recursive, hold it so no other thread corks in between */
+	EnterCriticalSection(&(transport->WriteLock));
+	const size_t corked = transport->corked;
+	transport->corked = 0;
+	const int status = transport_write(transport, s);
+	transport->corked = corked;
+	LeaveCriticalSection(&(transport->WriteLock));
+	return status;
+}
+
 BOOL transport_get_public_key(rdpTransport* transport, const BYTE** data, DWORD* length)
 {
 	return IFCALLRESULT(FALSE, transport->io.GetPublicKey, transport, data, length);
@@ -1628,6 +1738,10 @@ static BOOL transport_default_disconnect(rdpTransport* transport)
 	transport->frontBio = NULL;
 	transport->layer = TRANSPORT_LAYER_TCP;
 	transport->earlyUserAuth = FALSE;
+
+	/* gathered PDUs belong to the connection that just went away */
+	if (transport->CorkBuffer)
+		Stream_SetPosition(transport->CorkBuffer, 0);
 	LeaveCriticalSection(&(transport->WriteLock));
 	LeaveCriticalSection(&(transport->ReadLock));
 	return status;
@@ -1726,6 +1840,7 @@ void transport_free(rdpTransport* transport)
 
 	nla_free(transport->nla);
 	StreamPool_Free(transport->ReceivePool);
+	Stream_Free(transport->CorkBuffer, TRUE);
 	(void)CloseHandle(transport->connectedEvent);
 	(void)CloseHandle(transport->rereadEvent);
 	(void)CloseHandle(transport->ioEvent);
@@ -105,6 +105,20 @@ FREERDP_LOCAL BOOL transport_accept_rdstls(rdpTransport* transport);
 FREERDP_LOCAL int transport_read_pdu(rdpTransport* transport, wStream* s);
 FREERDP_LOCAL int transport_write(rdpTransport* transport, wStream* s);
 
+/**
+ * Gather PDUs written from now on into full size writes until the matching transport_uncork.
+ * Calls nest, the gathered data is written when the last one is uncorked or as soon as it would
+ * exceed a TLS record. Only for code that does not wait for an answer before uncorking.
+ */
+FREERDP_LOCAL BOOL transport_cork(rdpTransport* transport);
+FREERDP_LOCAL BOOL transport_uncork(rdpTransport* transport);
+
+/**
+ * Like transport_write, but ignores an open cork: gathered data and \b s are written right away.
+ * For latency sensitive PDUs (input, pointer) that must not wait for a frame to complete.
+ */
+FREERDP_LOCAL int transport_write_immediate(rdpTransport* transport, wStream* s);
+
 FREERDP_LOCAL BOOL transport_get_public_key(rdpTransport* transport, const BYTE** data,
                                             DWORD* length);
 
@@ -1030,6 +1030,18 @@ static BOOL s_update_begin_paint(rdpContext* context)
 	if (!s)
 		return FALSE;
 
+	/* Everything sent until EndPaint belongs to one frame, gather it into full size writes.
+	 * An implicit paint has no EndPaint it could rely on, it must not hold the transport back. */
+	if (!update->implicitPaint)
+	{
+		if (!transport_cork(context->rdp->transport))
+		{
+			Stream_Free(s, TRUE);
+			return FALSE;
+		}
+		update->corked = TRUE;
+	}
+
 	Stream_SealLength(s);
 	Stream_GetLength(s, update->offsetOrders);
 	Stream_Seek(s, 2); /* numberOrders (2 bytes) */
@@ -1064,8 +1076,14 @@ static BOOL s_update_end_paint(rdpContext* context)
 	update->numberOrders = 0;
 	update->offsetOrders = 0;
 	update->us = NULL;
+	update->implicitPaint = FALSE;
 	Stream_Free(s, TRUE);
-	return TRUE;
+
+	if (!update->corked)
+		return TRUE;
+
+	update->corked = FALSE;
+	return transport_uncork(context->rdp->transport);
 }
 
 static BOOL update_flush(rdpContext* context)
@@ -1077,9 +1095,12 @@ static BOOL update_flush(rdpContext* context)
 
 	if (update->numberOrders > 0)
 	{
+		/* EndPaint uncorks and writes the orders, an implicit paint continues uncorked */
+		const BOOL implicitPaint = update->implicitPaint;
 		if (!update_end_paint(&update->common))
 			return FALSE;
 
+		update->implicitPaint = implicitPaint;
 		if (!update_begin_paint(&update->common))
 			return FALSE;
 	}
@@ -1100,8 +1121,12 @@ static BOOL update_check_flush(rdpContext* context, size_t size)
 
 	if (!s)
 	{
+		update->implicitPaint = TRUE;
 		if (!update_begin_paint(&update->common))
+		{
+			update->implicitPaint = FALSE;
 			return FALSE;
+		}
 		s = update->us;
 	}
 
@@ -65,6 +65,8 @@ typedef struct
 	rdpBounds previousBounds;
 	CRITICAL_SECTION mux;
 	BOOL withinBeginEndPaint;
+	BOOL implicitPaint; /* started by an order sent outside of BeginPaint/EndPaint */
+	BOOL corked;
 } rdp_update_internal;
 
 typedef struct
@@ -478,6 +478,46 @@ static long bio_rdp_tls_ctrl(BIO* bio, int cmd, long num, void* ptr)
 
 			break;
 
+		case BIO_C_PEEK:
+		{
+			if (!ptr || (num <= 0))
+			{
+				status = 0;
+				break;
+			}
+
+			const int size = (num > INT32_MAX) ? INT32_MAX : (int)num;
+			BIO_clear_flags(bio, BIO_FLAGS_READ | BIO_FLAGS_WRITE | BIO_FLAGS_IO_SPECIAL);
+			EnterCriticalSection(&tls->lock);
+			const int rc = SSL_peek(tls->ssl, ptr, size);
+			const int error = SSL_get_error(tls->ssl, rc);
+			LeaveCriticalSection(&tls->lock);
+
+			status = rc;
+			if (rc <= 0)
+			{
+				switch (error)
+				{
+					case SSL_ERROR_WANT_READ:
+						BIO_set_flags(bio, BIO_FLAGS_READ | BIO_FLAGS_SHOULD_RETRY);
+						break;
+
+					case SSL_ERROR_WANT_WRITE:
+						BIO_set_flags(bio, BIO_FLAGS_WRITE | BIO_FLAGS_SHOULD_RETRY);
+						break;
+
+					default:
+						BIO_clear_flags(bio, BIO_FLAGS_SHOULD_RETRY);
+						break;
+				}
+			}
+#ifdef FREERDP_HAVE_VALGRIND_MEMCHECK_H
+			else
+				VALGRIND_MAKE_MEM_DEFINED(ptr, rc);
+#endif
+		}
+		break;
+
 		default:
 			status = BIO_ctrl(ssl_rbio, cmd, num, ptr);
 			break;
@@ -788,6 +828,16 @@ static BOOL tls_prepare(rdpTls* tls, BIO* underlying, SSL_METHOD* method, int op
 	SSL_CTX_set_mode(tls->ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER | SSL_MODE_ENABLE_PARTIAL_WRITE);
 	SSL_CTX_set_options(tls->ctx, WINPR_ASSERTING_INT_CAST(uint64_t, options));
 	SSL_CTX_set_read_ahead(tls->ctx, 1);
+
+	if (freerdp_settings_get_bool(settings, FreeRDP_KernelTlsOffload))
+	{
+#if defined(SSL_OP_ENABLE_KTLS)
+		/* falls back to user space encryption if the kernel or the cipher do not support it */
+		SSL_CTX_set_options(tls->ctx, SSL_OP_ENABLE_KTLS);
+#else
+		WLog_WARN(TAG, "Kernel TLS offload not available - requires OpenSSL 3.0 with KTLS");
+#endif
+	}
 #if OPENSSL_VERSION_NUMBER >= 0x10100000L || defined(LIBRESSL_VERSION_NUMBER)
 	UINT16 version = freerdp_settings_get_uint16(settings, FreeRDP_TLSMinVersion);
 	if (!SSL_CTX_set_min_proto_version(tls->ctx, version))
@@ -948,6 +998,15 @@ TlsHandshakeResult freerdp_tls_handshake(rdpTls* tls)
 		return TLS_HANDSHAKE_CONTINUE;
 	}
 
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+	if (freerdp_settings_get_bool(tls->context->settings, FreeRDP_KernelTlsOffload))
+	{
+		const BOOL ktls = BIO_get_ktls_send(SSL_get_wbio(tls->ssl)) ? TRUE : FALSE;
+		WLog_INFO(TAG, "Kernel TLS offload %s", ktls ? "enabled for sending"
+		                                             : "not available, using user space TLS");
+	}
+#endif
+
 	int verify_status = 0;
 	rdpCertificate* cert = tls_get_certificate(tls, tls->isClientMode);
 
@@ -25,6 +25,7 @@
 
 #include <winpr/assert.h>
 #include <winpr/cast.h>
+#include <winpr/pool.h>
 
 #include <freerdp/api.h>
 #include <freerdp/log.h>
@@ -79,6 +80,249 @@ static DWORD gfx_align_scanline(DWORD widthInBytes, DWORD alignment)
 	return scanline;
 }
 
+#ifdef WITH_GFX_H264
+typedef struct
+{
+	BYTE* data;
+	UINT32 length;
+	size_t dataSize;
+	RECTANGLE_16* rects;
+	UINT32 numRects;
+	size_t rectsSize;
+} gdiGfxDecodeStream;
+
+/* A surface command whose decode runs on the thread pool while the channel
+ * thread continues parsing the frame. AVC decoders are per surface, so jobs on
+ * different surfaces never share codec state. */
+typedef struct
+{
+	gdiGfxSurface* surface;
+	PTP_WORK work;
+	BOOL pending;
+	UINT16 codecId;
+	BYTE LC;
+	INT32 rc;
+	gdiGfxDecodeStream streams[2];
+} gdiGfxDecodeJob;
+
+static BOOL gdi_gfx_decode_stream_set(gdiGfxDecodeStream* stream,
+                                      const RDPGFX_AVC420_BITMAP_STREAM* bs)
+{
+	WINPR_ASSERT(stream);
+	WINPR_ASSERT(bs);
+
+	if (stream->dataSize < bs->length)
+	{
+		BYTE* tmp = realloc(stream->data, bs->length);
+		if (!tmp)
+			return FALSE;
+		stream->data = tmp;
+		stream->dataSize = bs->length;
+	}
+
+	if (stream->rectsSize < bs->meta.numRegionRects)
+	{
+		RECTANGLE_16* tmp = realloc(stream->rects, sizeof(RECTANGLE_16) * bs->meta.numRegionRects);
+		if (!tmp)
+			return FALSE;
+		stream->rects = tmp;
+		stream->rectsSize = bs->meta.numRegionRects;
+	}
+
+	if (bs->length > 0)
+		memcpy(stream->data, bs->data, bs->length);
+	if (bs->meta.numRegionRects > 0)
+		memcpy(stream->rects, bs->meta.regionRects,
+		       sizeof(RECTANGLE_16) * bs->meta.numRegionRects);
+	stream->length = bs->length;
+	stream->numRects = bs->meta.numRegionRects;
+	return TRUE;
+}
+
+static void CALLBACK gdi_gfx_decode_work_callback(PTP_CALLBACK_INSTANCE instance, void* context,
+                                                  PTP_WORK work)
+{
+	gdiGfxDecodeJob* job = context;
+	WINPR_UNUSED(instance);
+	WINPR_UNUSED(work);
+
+	WINPR_ASSERT(job);
+	gdiGfxSurface* surface = job->surface;
+	WINPR_ASSERT(surface);
+
+	const gdiGfxDecodeStream* s1 = &job->streams[0];
+	const gdiGfxDecodeStream* s2 = &job->streams[1];
+	if (job->codecId == RDPGFX_CODECID_AVC420)
+		job->rc = avc420_decompress(surface->h264, s1->data, s1->length, surface->data,
+		                            surface->format, surface->scanline, surface->width,
+		                            surface->height, s1->rects, s1->numRects);
+	else
+		job->rc = avc444_decompress(surface->h264, job->LC, s1->rects, s1->numRects, s1->data,
+		                            s1->length, s2->rects, s2->numRects, s2->data, s2->length,
+		                            surface->data, surface->format, surface->scanline,
+		                            surface->width, surface->height, job->codecId);
+}
+
+static void gdi_gfx_decode_job_free(gdiGfxDecodeJob* job)
+{
+	if (!job)
+		return;
+
+	if (job->work)
+	{
+		WaitForThreadpoolWorkCallbacks(job->work, FALSE);
+		CloseThreadpoolWork(job->work);
+	}
+
+	for (size_t x = 0; x < ARRAYSIZE(job->streams); x++)
+	{
+		free(job->streams[x].data);
+		free(job->streams[x].rects);
+	}
+	free(job);
+}
+
+static gdiGfxDecodeJob* gdi_gfx_decode_job_get(rdpGdi* gdi, gdiGfxSurface* surface)
+{
+	WINPR_ASSERT(gdi);
+	WINPR_ASSERT(surface);
+
+	/* Outside of a frame every command is presented immediately, so there is
+	 * nothing to overlap the decode with. */
+	if (!gdi->inGfxFrame)
+		return NULL;
+
+	const UINT32 ThreadingFlags =
+	    freerdp_settings_get_uint32(gdi->context->settings, FreeRDP_ThreadingFlags);
+	if (ThreadingFlags & THREADING_FLAGS_DISABLE_THREADS)
+		return NULL;
+
+	gdiGfxDecodeJob* job = surface->decodeJob;
+	if (job)
+		return job;
+
+	job = calloc(1, sizeof(gdiGfxDecodeJob));
+	if (!job)
+		return NULL;
+
+	job->surface = surface;
+	job->work = CreateThreadpoolWork(gdi_gfx_decode_work_callback, job, NULL);
+	if (!job->work)
+	{
+		gdi_gfx_decode_job_free(job);
+		return NULL;
+	}
+
+	surface->decodeJob = job;
+	return job;
+}
+
+static UINT gdi_gfx_decode_job_submit(gdiGfxDecodeJob* job, UINT16 codecId, BYTE LC,
+                                      const RDPGFX_AVC420_BITMAP_STREAM* avc1,
+                                      const RDPGFX_AVC420_BITMAP_STREAM* avc2)
+{
+	WINPR_ASSERT(job);
+	WINPR_ASSERT(!job->pending);
+	WINPR_ASSERT(avc1);
+
+	if (!gdi_gfx_decode_stream_set(&job->streams[0], avc1))
+		return ERROR_NOT_ENOUGH_MEMORY;
+	if (avc2 && !gdi_gfx_decode_stream_set(&job->streams[1], avc2))
+		return ERROR_NOT_ENOUGH_MEMORY;
+
+	job->codecId = codecId;
+	job->LC = LC;
+	job->rc = 0;
+	job->pending = TRUE;
+	SubmitThreadpoolWork(job->work);
+	return CHANNEL_RC_OK;
+}
+#endif
+
+/**
+ * Waits for a pending asynchronous decode on @surface and publishes its result
+ * to the invalid region and the UpdateSurfaceArea callback.
+ * Must be called with context->mux held.
+ *
+ * @return 0 on success, otherwise a Win32 error code
+ */
+static UINT gdi_gfx_surface_complete(RdpgfxClientContext* context, gdiGfxSurface* surface)
+{
+	WINPR_ASSERT(context);
+	if (!surface)
+		return CHANNEL_RC_OK;
+
+#ifdef WITH_GFX_H264
+	gdiGfxDecodeJob* job = surface->decodeJob;
+	if (!job || !job->pending)
+		return CHANNEL_RC_OK;
+
+	WaitForThreadpoolWorkCallbacks(job->work, FALSE);
+	job->pending = FALSE;
+
+	if (job->rc < 0)
+	{
+		WLog_WARN(TAG, "%s decode failure: %" PRId32 ", ignoring update.",
+		          rdpgfx_get_codec_id_string(job->codecId), job->rc);
+		return CHANNEL_RC_OK;
+	}
+
+	const size_t count = (job->codecId == RDPGFX_CODECID_AVC420) ? 1 : 2;
+	for (size_t x = 0; x < count; x++)
+	{
+		const gdiGfxDecodeStream* stream = &job->streams[x];
+		region16_union_rects(&(surface->invalidRegion), &(surface->invalidRegion), stream->rects,
+		                     stream->numRects);
+
+		const UINT status = IFCALLRESULT(CHANNEL_RC_OK, context->UpdateSurfaceArea, context,
+		                                 surface->surfaceId, stream->numRects, stream->rects);
+		if (status != CHANNEL_RC_OK)
+			return status;
+	}
+#endif
+	return CHANNEL_RC_OK;
+}
+
+static UINT gdi_gfx_surface_complete_id(RdpgfxClientContext* context, UINT16 surfaceId)
+{
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(context->GetSurfaceData);
+	return gdi_gfx_surface_complete(context,
+	                                (gdiGfxSurface*)context->GetSurfaceData(context, surfaceId));
+}
+
+/**
+ * Completes the pending decodes of all surfaces, in surface order.
+ *
+ * @return 0 on success, otherwise a Win32 error code
+ */
+static UINT gdi_gfx_surface_complete_all(RdpgfxClientContext* context)
+{
+	UINT status = CHANNEL_RC_OK;
+	WINPR_ASSERT(context);
+
+#ifdef WITH_GFX_H264
+	UINT16 count = 0;
+	UINT16* pSurfaceIds = NULL;
+
+	EnterCriticalSection(&context->mux);
+
+	WINPR_ASSERT(context->GetSurfaceIds);
+	context->GetSurfaceIds(context, &pSurfaceIds, &count);
+
+	for (UINT32 index = 0; index < count; index++)
+	{
+		const UINT rc = gdi_gfx_surface_complete_id(context, pSurfaceIds[index]);
+		if (status == CHANNEL_RC_OK)
+			status = rc;
+	}
+
+	free(pSurfaceIds);
+	LeaveCriticalSection(&context->mux);
+#endif
+	return status;
+}
+
 /**
  * Function description
  *
@@ -108,6 +352,9 @@ static UINT gdi_ResetGraphics(RdpgfxClientContext* context,
 	settings = gdi->context->settings;
 	WINPR_ASSERT(settings);
 	EnterCriticalSection(&context->mux);
+	if (gdi_gfx_surface_complete_all(context) != CHANNEL_RC_OK)
+		goto fail;
+
 	DesktopWidth = resetGraphics->width;
 	DesktopHeight = resetGraphics->height;
 
@@ -309,6 +556,9 @@ static UINT gdi_StartFrame(RdpgfxClientContext* context, const RDPGFX_START_FRAM
 static UINT gdi_call_update_surfaces(RdpgfxClientContext* context)
 {
 	WINPR_ASSERT(context);
+	const UINT rc = gdi_gfx_surface_complete_all(context);
+	if (rc != CHANNEL_RC_OK)
+		return rc;
 	return IFCALLRESULT(CHANNEL_RC_OK, context->UpdateSurfaces, context);
 }
 
@@ -445,8 +695,7 @@ static UINT gdi_SurfaceCommand_RemoteFX(rdpGdi* gdi, RdpgfxClientContext* contex
 	if (status != CHANNEL_RC_OK)
 		goto fail;
 
-	for (UINT32 x = 0; x < nrRects; x++)
-		region16_union_rect(&surface->invalidRegion, &surface->invalidRegion, &rects[x]);
+	region16_union_rects(&surface->invalidRegion, &surface->invalidRegion, rects, nrRects);
 
 	status = gdi_interFrameUpdate(gdi, context);
 
@@ -612,6 +861,10 @@ static UINT gdi_SurfaceCommand_AVC420(rdpGdi* gdi, RdpgfxClientContext* context,
 	if (!bs)
 		return ERROR_INTERNAL_ERROR;
 
+	gdiGfxDecodeJob* job = gdi_gfx_decode_job_get(gdi, surface);
+	if (job)
+		return gdi_gfx_decode_job_submit(job, RDPGFX_CODECID_AVC420, 0, bs, NULL);
+
 	meta = &(bs->meta);
 	rc = avc420_decompress(surface->h264, bs->data, bs->length, surface->data, surface->format,
 	                       surface->scanline, surface->width, surface->height, meta->regionRects,
@@ -623,11 +876,8 @@ static UINT gdi_SurfaceCommand_AVC420(rdpGdi* gdi, RdpgfxClientContext* context,
 		return CHANNEL_RC_OK;
 	}
 
-	for (UINT32 i = 0; i < meta->numRegionRects; i++)
-	{
-		region16_union_rect(&(surface->invalidRegion), &(surface->invalidRegion),
-		                    &(meta->regionRects[i]));
-	}
+	region16_union_rects(&(surface->invalidRegion), &(surface->invalidRegion), meta->regionRects,
+	                     meta->numRegionRects);
 
 	status = IFCALLRESULT(CHANNEL_RC_OK, context->UpdateSurfaceArea, context, surface->surfaceId,
 	                      meta->numRegionRects, meta->regionRects);
@@ -701,6 +951,12 @@ static UINT gdi_SurfaceCommand_AVC444(rdpGdi* gdi, RdpgfxClientContext* context,
 	avc2 = &bs->bitstream[1];
 	meta1 = &avc1->meta;
 	meta2 = &avc2->meta;
+
+	gdiGfxDecodeJob* job = gdi_gfx_decode_job_get(gdi, surface);
+	if (job)
+		return gdi_gfx_decode_job_submit(job, WINPR_ASSERTING_INT_CAST(UINT16, cmd->codecId),
+		                                 bs->LC, avc1, avc2);
+
 	rc = avc444_decompress(surface->h264, bs->LC, meta1->regionRects, meta1->numRegionRects,
 	                       avc1->data, avc1->length, meta2->regionRects, meta2->numRegionRects,
 	                       avc2->data, avc2->length, surface->data, surface->format,
@@ -712,11 +968,8 @@ static UINT gdi_SurfaceCommand_AVC444(rdpGdi* gdi, RdpgfxClientContext* context,
 		return CHANNEL_RC_OK;
 	}
 
-	for (UINT32 i = 0; i < meta1->numRegionRects; i++)
-	{
-		region16_union_rect(&(surface->invalidRegion), &(surface->invalidRegion),
-		                    &(meta1->regionRects[i]));
-	}
+	region16_union_rects(&(surface->invalidRegion), &(surface->invalidRegion), meta1->regionRects,
+	                     meta1->numRegionRects);
 
 	status = IFCALLRESULT(CHANNEL_RC_OK, context->UpdateSurfaceArea, context, surface->surfaceId,
 	                      meta1->numRegionRects, meta1->regionRects);
@@ -724,11 +977,8 @@ static UINT gdi_SurfaceCommand_AVC444(rdpGdi* gdi, RdpgfxClientContext* context,
 	if (status != CHANNEL_RC_OK)
 		goto fail;
 
-	for (UINT32 i = 0; i < meta2->numRegionRects; i++)
-	{
-		region16_union_rect(&(surface->invalidRegion), &(surface->invalidRegion),
-		                    &(meta2->regionRects[i]));
-	}
+	region16_union_rects(&(surface->invalidRegion), &(surface->invalidRegion), meta2->regionRects,
+	                     meta2->numRegionRects);
 
 	status = IFCALLRESULT(CHANNEL_RC_OK, context->UpdateSurfaceArea, context, surface->surfaceId,
 	                      meta2->numRegionRects, meta2->regionRects);
@@ -1012,8 +1262,7 @@ static UINT gdi_SurfaceCommand_Progressive(rdpGdi* gdi, RdpgfxClientContext* con
 	if (status != CHANNEL_RC_OK)
 		goto fail;
 
-	for (UINT32 x = 0; x < nrRects; x++)
-		region16_union_rect(&surface->invalidRegion, &surface->invalidRegion, &rects[x]);
+	region16_union_rects(&surface->invalidRegion, &surface->invalidRegion, rects, nrRects);
 
 	region16_uninit(&invalidRegion);
 
@@ -1052,6 +1301,13 @@ static UINT gdi_SurfaceCommand(RdpgfxClientContext* context, const RDPGFX_SURFAC
 	dump_cmd(cmd, gdi->frameId);
 #endif
 
+	status = gdi_gfx_surface_complete_id(context, (UINT16)MIN(UINT16_MAX, cmd->surfaceId));
+	if (status != CHANNEL_RC_OK)
+	{
+		LeaveCriticalSection(&context->mux);
+		return status;
+	}
+
 	switch (codecId)
 	{
 		case RDPGFX_CODECID_UNCOMPRESSED:
@@ -1218,6 +1474,7 @@ static UINT gdi_DeleteSurface(RdpgfxClientContext* context,
 			                  surface->windowId);
 
 #ifdef WITH_GFX_H264
+		gdi_gfx_decode_job_free(surface->decodeJob);
 		h264_context_free(surface->h264);
 #endif
 		region16_uninit(&surface->invalidRegion);
@@ -1281,6 +1538,11 @@ static UINT gdi_SolidFill(RdpgfxClientContext* context, const RDPGFX_SOLID_FILL_
 	if (!surface)
 		goto fail;
 
+	status = gdi_gfx_surface_complete(context, surface);
+	if (status != CHANNEL_RC_OK)
+		goto fail;
+	status = ERROR_INTERNAL_ERROR;
+
 	const BYTE b = solidFill->fillPixel.B;
 	const BYTE g = solidFill->fillPixel.G;
 	const BYTE r = solidFill->fillPixel.R;
@@ -1358,6 +1620,13 @@ static UINT gdi_SurfaceToSurface(RdpgfxClientContext* context,
 	if (!surfaceSrc || !surfaceDst)
 		goto fail;
 
+	status = gdi_gfx_surface_complete(context, surfaceSrc);
+	if ((status == CHANNEL_RC_OK) && !sameSurface)
+		status = gdi_gfx_surface_complete(context, surfaceDst);
+	if (status != CHANNEL_RC_OK)
+		goto fail;
+	status = ERROR_INTERNAL_ERROR;
+
 	if (!is_rect_valid(rectSrc, surfaceSrc->width, surfaceSrc->height))
 		goto fail;
 
@@ -1451,6 +1720,11 @@ static UINT gdi_SurfaceToCache(RdpgfxClientContext* context,
 	if (!surface)
 		goto fail;
 
+	rc = gdi_gfx_surface_complete(context, surface);
+	if (rc != CHANNEL_RC_OK)
+		goto fail;
+	rc = ERROR_INTERNAL_ERROR;
+
 	if (!is_rect_valid(rect, surface->width, surface->height))
 		goto fail;
 
@@ -1507,6 +1781,11 @@ static UINT gdi_CacheToSurface(RdpgfxClientContext* context,
 	if (!surface || !cacheEntry)
 		goto fail;
 
+	status = gdi_gfx_surface_complete(context, surface);
+	if (status != CHANNEL_RC_OK)
+		goto fail;
+	status = ERROR_INTERNAL_ERROR;
+
 	for (UINT16 index = 0; index < cacheToSurface->destPtsCount; index++)
 	{
 		const RDPGFX_POINT16* destPt = &cacheToSurface->destPts[index];
@@ -1700,6 +1979,11 @@ static UINT gdi_MapSurfaceToOutput(RdpgfxClientContext* context,
 	if (!surface)
 		goto fail;
 
+	rc = gdi_gfx_surface_complete(context, surface);
+	if (rc != CHANNEL_RC_OK)
+		goto fail;
+	rc = ERROR_INTERNAL_ERROR;
+
 	if (surface->windowMapped)
 	{
 		WLog_WARN(TAG, "surface already windowMapped when trying to set outputMapped");
@@ -1732,6 +2016,11 @@ gdi_MapSurfaceToScaledOutput(RdpgfxClientContext* context,
 	if (!surface)
 		goto fail;
 
+	rc = gdi_gfx_surface_complete(context, surface);
+	if (rc != CHANNEL_RC_OK)
+		goto fail;
+	rc = ERROR_INTERNAL_ERROR;
+
 	if (surface->windowMapped)
 	{
 		WLog_WARN(TAG, "surface already windowMapped when trying to set outputMapped");
@@ -1768,6 +2057,11 @@ static UINT gdi_MapSurfaceToWindow(RdpgfxClientContext* context,
 	if (!surface)
 		goto fail;
 
+	rc = gdi_gfx_surface_complete(context, surface);
+	if (rc != CHANNEL_RC_OK)
+		goto fail;
+	rc = ERROR_INTERNAL_ERROR;
+
 	if (surface->outputMapped)
 	{
 		WLog_WARN(TAG, "surface already outputMapped when trying to set windowMapped");
@@ -1811,6 +2105,11 @@ gdi_MapSurfaceToScaledWindow(RdpgfxClientContext* context,
 	if (!surface)
 		goto fail;
 
+	rc = gdi_gfx_surface_complete(context, surface);
+	if (rc != CHANNEL_RC_OK)
+		goto fail;
+	rc = ERROR_INTERNAL_ERROR;
+
 	if (surface->outputMapped)
 	{
 		WLog_WARN(TAG, "surface already outputMapped when trying to set windowMapped");
@@ -1914,6 +2213,11 @@ BOOL gdi_graphics_pipeline_init_ex(rdpGdi* gdi, RdpgfxClientContext* gfx,
 	return TRUE;
 }
 
+UINT gdi_graphics_pipeline_update_surfaces(RdpgfxClientContext* gfx)
+{
+	return gdi_call_update_surfaces(gfx);
+}
+
 void gdi_graphics_pipeline_uninit(rdpGdi* gdi, RdpgfxClientContext* gfx)
 {
 	if (gdi)
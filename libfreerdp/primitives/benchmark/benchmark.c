@@ -20,9 +20,18 @@
 
 #include <stdio.h>
 
+#include <winpr/crt.h>
 #include <winpr/crypto.h>
 #include <winpr/sysinfo.h>
+#include <winpr/stream.h>
 #include <freerdp/primitives.h>
+#include <freerdp/settings.h>
+#include <freerdp/codec/rfx.h>
+
+/* RemoteFX tiles of a 3840x2160 frame */
+#define RFX_BENCHMARK_WIDTH 3840
+#define RFX_BENCHMARK_HEIGHT 2160
+#define RFX_BENCHMARK_TILES ((RFX_BENCHMARK_WIDTH / 64) * ((RFX_BENCHMARK_HEIGHT + 63) / 64))
 
 typedef struct
 {
@@ -198,6 +207,130 @@ static BOOL primitives_RGB2444_benchmark_run(primitives_YUV_benchmark* bench, pr
 	return TRUE;
 }
 
+static BOOL primitives_RemoteFX_benchmark_run(primitives_t* prims)
+{
+	BOOL rc = FALSE;
+	const prim_size_t roi = { 64, 64 };
+	INT16* planes = winpr_aligned_calloc(6ull * 64 * 64, sizeof(INT16), 32);
+	BYTE* tile = winpr_aligned_calloc(64ull * 64, 4, 32);
+
+	if (!planes || !tile)
+		goto fail;
+
+	winpr_RAND(tile, 64ull * 64 * 4);
+	for (size_t i = 0; i < 3ull * 64 * 64; i++)
+		planes[i] = tile[i];
+
+	const INT16* rgb[3] = { &planes[0], &planes[4096], &planes[8192] };
+	INT16* ycbcr[3] = { &planes[12288], &planes[16384], &planes[20480] };
+	const INT16* cycbcr[3] = { ycbcr[0], ycbcr[1], ycbcr[2] };
+
+	for (size_t x = 0; x < 10; x++)
+	{
+		const UINT64 start = winpr_GetTickCount64NS();
+		for (size_t t = 0; t < RFX_BENCHMARK_TILES; t++)
+		{
+			if (prims->RGBToYCbCr_16s16s_P3P3(rgb, 64 * sizeof(INT16), ycbcr, 64 * sizeof(INT16),
+			                                  &roi) != PRIMITIVES_SUCCESS)
+			{
+				(void)fprintf(stderr, "Running RGBToYCbCr_16s16s_P3P3 failed\n");
+				goto fail;
+			}
+		}
+		const UINT64 mid = winpr_GetTickCount64NS();
+		for (size_t t = 0; t < RFX_BENCHMARK_TILES; t++)
+		{
+			if (prims->yCbCrToRGB_16s8u_P3AC4R(cycbcr, 64 * sizeof(INT16), tile, 64 * 4,
+			                                   PIXEL_FORMAT_BGRX32, &roi) != PRIMITIVES_SUCCESS)
+			{
+				(void)fprintf(stderr, "Running yCbCrToRGB_16s8u_P3AC4R failed\n");
+				goto fail;
+			}
+		}
+		const UINT64 end = winpr_GetTickCount64NS();
+		char buffer[32] = { 0 };
+		printf("[%" PRIuz "] RGBToYCbCr_16s16s_P3P3 %d tiles took %sns\n", x, RFX_BENCHMARK_TILES,
+		       print_time(mid - start, buffer, sizeof(buffer)));
+		printf("[%" PRIuz "] yCbCrToRGB_16s8u_P3AC4R %d tiles took %sns\n", x,
+		       RFX_BENCHMARK_TILES, print_time(end - mid, buffer, sizeof(buffer)));
+	}
+
+	rc = TRUE;
+fail:
+	winpr_aligned_free(planes);
+	winpr_aligned_free(tile);
+	return rc;
+}
+
+/* The complete tile pipeline, RemoteFX uses the best implementation available */
+static BOOL rfx_benchmark_run(void)
+{
+	BOOL rc = FALSE;
+	const UINT32 stride = RFX_BENCHMARK_WIDTH * 4;
+	const RFX_RECT rect = { 0, 0, RFX_BENCHMARK_WIDTH, RFX_BENCHMARK_HEIGHT };
+	RFX_CONTEXT* encoder = rfx_context_new_ex(TRUE, THREADING_FLAGS_DISABLE_THREADS);
+	RFX_CONTEXT* decoder = rfx_context_new_ex(FALSE, THREADING_FLAGS_DISABLE_THREADS);
+	BYTE* frame = calloc(stride, RFX_BENCHMARK_HEIGHT);
+	BYTE* output = calloc(stride, RFX_BENCHMARK_HEIGHT);
+	wStream* s = Stream_New(NULL, 1024);
+
+	if (!encoder || !decoder || !frame || !output || !s)
+		goto fail;
+
+	if (!rfx_context_reset(encoder, RFX_BENCHMARK_WIDTH, RFX_BENCHMARK_HEIGHT))
+		goto fail;
+
+	rfx_context_set_pixel_format(encoder, PIXEL_FORMAT_BGRX32);
+
+	/* smooth gradients with some noise, close to desktop content for the DWT */
+	for (size_t y = 0; y < RFX_BENCHMARK_HEIGHT; y++)
+	{
+		BYTE* line = &frame[y * stride];
+		winpr_RAND(line, stride);
+
+		for (size_t x = 0; x < RFX_BENCHMARK_WIDTH; x++)
+		{
+			line[4 * x + 0] = (BYTE)(x / 16 + (line[4 * x + 0] & 0x07));
+			line[4 * x + 1] = (BYTE)(y / 9 + (line[4 * x + 1] & 0x07));
+			line[4 * x + 2] = (BYTE)((x + y) / 24 + (line[4 * x + 2] & 0x07));
+		}
+	}
+
+	for (size_t x = 0; x < 10; x++)
+	{
+		Stream_SetPosition(s, 0);
+		const UINT64 start = winpr_GetTickCount64NS();
+		if (!rfx_compose_message(encoder, s, &rect, 1, frame, RFX_BENCHMARK_WIDTH,
+		                         RFX_BENCHMARK_HEIGHT, stride))
+		{
+			(void)fprintf(stderr, "Running rfx_compose_message failed\n");
+			goto fail;
+		}
+		const UINT64 mid = winpr_GetTickCount64NS();
+		if (!rfx_process_message(decoder, Stream_Buffer(s), (UINT32)Stream_GetPosition(s), 0, 0,
+		                         output, PIXEL_FORMAT_BGRX32, stride, RFX_BENCHMARK_HEIGHT, NULL))
+		{
+			(void)fprintf(stderr, "Running rfx_process_message failed\n");
+			goto fail;
+		}
+		const UINT64 end = winpr_GetTickCount64NS();
+		char buffer[32] = { 0 };
+		printf("[%" PRIuz "] RemoteFX encode %dx%d took %sns\n", x, RFX_BENCHMARK_WIDTH,
+		       RFX_BENCHMARK_HEIGHT, print_time(mid - start, buffer, sizeof(buffer)));
+		printf("[%" PRIuz "] RemoteFX decode %dx%d took %sns\n", x, RFX_BENCHMARK_WIDTH,
+		       RFX_BENCHMARK_HEIGHT, print_time(end - mid, buffer, sizeof(buffer)));
+	}
+
+	rc = TRUE;
+fail:
+	Stream_Free(s, TRUE);
+	free(frame);
+	free(output);
+	rfx_context_free(encoder);
+	rfx_context_free(decoder);
+	return rc;
+}
+
 int main(int argc, char* argv[])
 {
 	WINPR_UNUSED(argc);
@@ -245,7 +378,19 @@ int main(int argc, char* argv[])
 			goto fail;
 		}
 		printf("\n");
+
+		printf("Running RemoteFX color conversion benchmark on %s implementation:\n", hintstr);
+		if (!primitives_RemoteFX_benchmark_run(prim))
+		{
+			(void)fprintf(stderr, "RemoteFX color conversion benchmark failed\n");
+			goto fail;
+		}
+		printf("\n");
 	}
+
+	printf("Running RemoteFX tile pipeline benchmark:\n");
+	if (!rfx_benchmark_run())
+		(void)fprintf(stderr, "RemoteFX tile pipeline benchmark failed\n");
 fail:
 	primitives_YUV_benchmark_free(&bench);
 	return 0;
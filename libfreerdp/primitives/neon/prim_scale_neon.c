@@ -0,0 +1,132 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Optimized image scaling
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/log.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_internal.h"
+#include "prim_scale.h"
+
+#if defined(NEON_INTRINSICS_ENABLED)
+#include <arm_neon.h>
+
+/* sum of two taps for the four channels of a pixel, the weights are never negative */
+static inline uint32x4_t neon_scale_taps(uint32x4_t sum, const BYTE* WINPR_RESTRICT src,
+                                         const INT16* WINPR_RESTRICT w)
+{
+	const uint16x8_t pixels = vmovl_u8(vld1_u8(src));
+	sum = vmlal_n_u16(sum, vget_low_u16(pixels), (uint16_t)w[0]);
+	return vmlal_n_u16(sum, vget_high_u16(pixels), (uint16_t)w[1]);
+}
+
+/* two output pixels per iteration */
+static void neon_scale_row_h(const BYTE* WINPR_RESTRICT pSrc, BYTE* WINPR_RESTRICT pDst,
+                             UINT32 width, const UINT32* WINPR_RESTRICT offsets,
+                             const INT16* WINPR_RESTRICT weights, UINT32 taps)
+{
+	const uint32x4_t round = vdupq_n_u32(PRIM_SCALE_ONE / 2);
+	UINT32 x = 0;
+
+	for (; x + 2 <= width; x += 2)
+	{
+		const BYTE* src0 = &pSrc[4ULL * offsets[x]];
+		const BYTE* src1 = &pSrc[4ULL * offsets[x + 1]];
+		const INT16* w0 = &weights[1ULL * x * taps];
+		const INT16* w1 = &w0[taps];
+		uint32x4_t sum0 = round;
+		uint32x4_t sum1 = round;
+
+		for (UINT32 t = 0; t < taps; t += 2)
+		{
+			sum0 = neon_scale_taps(sum0, &src0[4ULL * t], &w0[t]);
+			sum1 = neon_scale_taps(sum1, &src1[4ULL * t], &w1[t]);
+		}
+
+		const uint16x8_t sum = vcombine_u16(vshrn_n_u32(sum0, PRIM_SCALE_BITS),
+		                                    vshrn_n_u32(sum1, PRIM_SCALE_BITS));
+		vst1_u8(&pDst[4ULL * x], vqmovn_u16(sum));
+	}
+
+	for (; x < width; x++)
+		prim_scale_pixel_h(pSrc, pDst, x, offsets, weights, taps);
+}
+
+/* 16 bytes per iteration */
+static void neon_scale_row_v(const BYTE* const* WINPR_RESTRICT rows,
+                             const INT16* WINPR_RESTRICT weights, UINT32 taps,
+                             BYTE* WINPR_RESTRICT pDst, size_t bytes)
+{
+	const uint32x4_t round = vdupq_n_u32(PRIM_SCALE_ONE / 2);
+	size_t x = 0;
+
+	for (; x + 16 <= bytes; x += 16)
+	{
+		uint32x4_t sum[4] = { round, round, round, round };
+
+		for (UINT32 t = 0; t < taps; t++)
+		{
+			const uint8x16_t data = vld1q_u8(&rows[t][x]);
+			const uint16x8_t lo = vmovl_u8(vget_low_u8(data));
+			const uint16x8_t hi = vmovl_u8(vget_high_u8(data));
+			const uint16_t w = (uint16_t)weights[t];
+
+			sum[0] = vmlal_n_u16(sum[0], vget_low_u16(lo), w);
+			sum[1] = vmlal_n_u16(sum[1], vget_high_u16(lo), w);
+			sum[2] = vmlal_n_u16(sum[2], vget_low_u16(hi), w);
+			sum[3] = vmlal_n_u16(sum[3], vget_high_u16(hi), w);
+		}
+
+		const uint16x8_t lo = vcombine_u16(vshrn_n_u32(sum[0], PRIM_SCALE_BITS),
+		                                   vshrn_n_u32(sum[1], PRIM_SCALE_BITS));
+		const uint16x8_t hi = vcombine_u16(vshrn_n_u32(sum[2], PRIM_SCALE_BITS),
+		                                   vshrn_n_u32(sum[3], PRIM_SCALE_BITS));
+		vst1q_u8(&pDst[x], vcombine_u8(vqmovn_u16(lo), vqmovn_u16(hi)));
+	}
+
+	for (; x < bytes; x++)
+		prim_scale_byte_v(rows, weights, taps, pDst, x);
+}
+
+static pstatus_t neon_image_scale(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32 nDstStep,
+                                  UINT32 nXDst, UINT32 nYDst, UINT32 nDstWidth, UINT32 nDstHeight,
+                                  const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+                                  UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc, UINT32 nSrcWidth,
+                                  UINT32 nSrcHeight)
+{
+	static const prim_scale_kernels kernels = { neon_scale_row_h, neon_scale_row_v };
+
+	return prim_image_scale(&kernels, pDstData, DstFormat, nDstStep, nXDst, nYDst, nDstWidth,
+	                        nDstHeight, pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc, nSrcWidth,
+	                        nSrcHeight);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_scale_neon_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(NEON_INTRINSICS_ENABLED)
+	WLog_VRB(PRIM_TAG, "NEON optimizations");
+	prims->image_scale = neon_image_scale;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or neon intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
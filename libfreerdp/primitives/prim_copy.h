@@ -40,6 +40,14 @@ pstatus_t generic_image_copy_no_overlap_memcpy(
     int64_t srcVMultiplier, int64_t srcVOffset, int64_t dstVMultiplier, int64_t dstVOffset,
     UINT32 flags);
 
+/* SSE4.1 conversion between the common 32, 24 and 16 bpp formats, falls back to
+ * generic_image_copy_no_overlap_convert for all others */
+FREERDP_LOCAL pstatus_t sse_image_copy_no_overlap_convert(
+    BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
+    UINT32 nWidth, UINT32 nHeight, const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+    UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc, const gdiPalette* WINPR_RESTRICT palette,
+    int64_t srcVMultiplier, int64_t srcVOffset, int64_t dstVMultiplier, int64_t dstVOffset);
+
 FREERDP_LOCAL void primitives_init_copy_sse41_int(primitives_t* WINPR_RESTRICT prims);
 static inline void primitives_init_copy_sse41(primitives_t* WINPR_RESTRICT prims)
 {
@@ -0,0 +1,427 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Primitives image scaling
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <string.h>
+#include <winpr/assert.h>
+#include <winpr/synch.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/codec/color.h>
+
+#include "prim_internal.h"
+#include "prim_scale.h"
+
+/* number of scaler geometries kept around for reuse */
+#define SCALE_CACHE_SIZE 4
+
+typedef struct
+{
+	UINT32 taps;
+	UINT32* offsets;
+	INT16* weights;
+} scale_filter;
+
+typedef struct
+{
+	UINT32 srcWidth;
+	UINT32 srcHeight;
+	UINT32 dstWidth;
+	UINT32 dstHeight;
+
+	scale_filter h;
+	scale_filter v;
+
+	/* ring of v.taps horizontally scaled rows, rowIndex is the source row held by a slot */
+	BYTE* rows;
+	UINT32* rowIndex;
+	const BYTE** rowPointers;
+
+	/* a source row converted to 32 bpp and padded to h.taps pixels */
+	BYTE* srcRow;
+	/* a scaled row that still needs conversion to the destination format */
+	BYTE* dstRow;
+} scale_context;
+
+static INIT_ONCE scale_cache_InitOnce = INIT_ONCE_STATIC_INIT;
+static CRITICAL_SECTION scale_cache_lock;
+static scale_context* scale_cache[SCALE_CACHE_SIZE] = { 0 };
+
+static void scale_filter_uninit(scale_filter* filter)
+{
+	free(filter->offsets);
+	free(filter->weights);
+}
+
+/**
+ * Bilinear when enlarging, area (box) when shrinking. Each output pixel reads taps input pixels
+ * starting at its offset, the offsets are clamped so that no pixel past MAX(srcLen, taps) is read.
+ */
+static BOOL scale_filter_init(scale_filter* filter, UINT32 srcLen, UINT32 dstLen)
+{
+	const BOOL area = dstLen < srcLen;
+	UINT32 taps = 2;
+
+	if (area)
+		taps = (srcLen + dstLen - 1) / dstLen + 1;
+
+	filter->taps = (taps + 1) & ~1u;
+	filter->offsets = calloc(dstLen, sizeof(UINT32));
+	filter->weights = calloc(1ULL * dstLen * filter->taps, sizeof(INT16));
+
+	if (!filter->offsets || !filter->weights)
+		return FALSE;
+
+	const UINT32 length = MAX(srcLen, filter->taps);
+
+	for (UINT32 x = 0; x < dstLen; x++)
+	{
+		INT16* weights = &filter->weights[1ULL * x * filter->taps];
+		UINT64 first = 0;
+
+		if (area)
+		{
+			/* in units of 1 / dstLen source pixels */
+			const UINT64 lo = 1ULL * x * srcLen;
+			const UINT64 hi = lo + srcLen;
+			INT32 sum = 0;
+			UINT32 largest = 0;
+
+			first = lo / dstLen;
+
+			for (UINT32 t = 0; (t < filter->taps) && (first + t < srcLen); t++)
+			{
+				const UINT64 start = MAX(lo, (first + t) * dstLen);
+				const UINT64 end = MIN(hi, (first + t + 1) * dstLen);
+
+				if (end <= start)
+					break;
+
+				weights[t] = (INT16)(((end - start) * PRIM_SCALE_ONE + srcLen / 2) / srcLen);
+				sum += weights[t];
+
+				if (weights[t] > weights[largest])
+					largest = t;
+			}
+
+			weights[largest] = (INT16)(weights[largest] + PRIM_SCALE_ONE - sum);
+		}
+		else
+		{
+			/* pixel centers in units of 1 / (2 * dstLen) source pixels */
+			const UINT64 scale = 2ULL * dstLen;
+			const UINT64 pos = (2ULL * x + 1) * srcLen;
+			const UINT64 center = (pos > dstLen) ? pos - dstLen : 0;
+			UINT64 fraction = center % scale;
+
+			first = center / scale;
+
+			if (first >= srcLen - 1)
+			{
+				first = srcLen - 1;
+				fraction = 0;
+			}
+
+			weights[1] = (INT16)((fraction * PRIM_SCALE_ONE + scale / 2) / scale);
+			weights[0] = (INT16)(PRIM_SCALE_ONE - weights[1]);
+		}
+
+		/* move the window left at the right border, the weights follow */
+		const UINT32 offset = (UINT32)MIN(first, length - filter->taps);
+		const UINT32 shift = (UINT32)(first - offset);
+
+		if (shift > 0)
+		{
+			memmove(&weights[shift], weights, sizeof(INT16) * (filter->taps - shift));
+			memset(weights, 0, sizeof(INT16) * shift);
+		}
+
+		filter->offsets[x] = offset;
+	}
+
+	return TRUE;
+}
+
+static void scale_context_free(scale_context* ctx)
+{
+	if (!ctx)
+		return;
+
+	scale_filter_uninit(&ctx->h);
+	scale_filter_uninit(&ctx->v);
+	winpr_aligned_free(ctx->rows);
+	free(ctx->rowIndex);
+	free((void*)ctx->rowPointers);
+	winpr_aligned_free(ctx->srcRow);
+	winpr_aligned_free(ctx->dstRow);
+	free(ctx);
+}
+
+static scale_context* scale_context_new(UINT32 srcWidth, UINT32 srcHeight, UINT32 dstWidth,
+                                        UINT32 dstHeight)
+{
+	scale_context* ctx = calloc(1, sizeof(scale_context));
+
+	if (!ctx)
+		return NULL;
+
+	ctx->srcWidth = srcWidth;
+	ctx->srcHeight = srcHeight;
+	ctx->dstWidth = dstWidth;
+	ctx->dstHeight = dstHeight;
+
+	if (!scale_filter_init(&ctx->h, srcWidth, dstWidth) ||
+	    !scale_filter_init(&ctx->v, srcHeight, dstHeight))
+		goto fail;
+
+	const size_t srcRowSize = 4ULL * MAX(srcWidth, ctx->h.taps);
+	ctx->rows = winpr_aligned_calloc(ctx->v.taps, 4ULL * dstWidth, 32);
+	ctx->rowIndex = calloc(ctx->v.taps, sizeof(UINT32));
+	ctx->rowPointers = (const BYTE**)calloc(ctx->v.taps, sizeof(BYTE*));
+	ctx->srcRow = winpr_aligned_calloc(1, srcRowSize, 32);
+	ctx->dstRow = winpr_aligned_calloc(4, dstWidth, 32);
+
+	if (!ctx->rows || !ctx->rowIndex || !ctx->rowPointers || !ctx->srcRow || !ctx->dstRow)
+		goto fail;
+
+	return ctx;
+
+fail:
+	scale_context_free(ctx);
+	return NULL;
+}
+
+static BOOL CALLBACK scale_cache_init(PINIT_ONCE once, PVOID param, PVOID* context)
+{
+	WINPR_UNUSED(once);
+	WINPR_UNUSED(param);
+	WINPR_UNUSED(context);
+	return InitializeCriticalSectionAndSpinCount(&scale_cache_lock, 4000);
+}
+
+/* takes a context for this geometry out of the cache, concurrent callers get their own */
+static scale_context* scale_context_acquire(UINT32 srcWidth, UINT32 srcHeight, UINT32 dstWidth,
+                                            UINT32 dstHeight)
+{
+	if (!InitOnceExecuteOnce(&scale_cache_InitOnce, scale_cache_init, NULL, NULL))
+		return scale_context_new(srcWidth, srcHeight, dstWidth, dstHeight);
+
+	scale_context* ctx = NULL;
+	EnterCriticalSection(&scale_cache_lock);
+
+	for (size_t x = 0; x < ARRAYSIZE(scale_cache); x++)
+	{
+		scale_context* cur = scale_cache[x];
+
+		if (cur && (cur->srcWidth == srcWidth) && (cur->srcHeight == srcHeight) &&
+		    (cur->dstWidth == dstWidth) && (cur->dstHeight == dstHeight))
+		{
+			ctx = cur;
+			scale_cache[x] = NULL;
+			break;
+		}
+	}
+
+	LeaveCriticalSection(&scale_cache_lock);
+
+	if (!ctx)
+		ctx = scale_context_new(srcWidth, srcHeight, dstWidth, dstHeight);
+
+	return ctx;
+}
+
+/* returns a context to the cache, replacing the oldest entry if it is full */
+static void scale_context_release(scale_context* ctx)
+{
+	if (!InitOnceExecuteOnce(&scale_cache_InitOnce, scale_cache_init, NULL, NULL))
+	{
+		scale_context_free(ctx);
+		return;
+	}
+
+	EnterCriticalSection(&scale_cache_lock);
+	scale_context* evicted = scale_cache[0];
+	size_t x = 0;
+
+	for (; x < ARRAYSIZE(scale_cache); x++)
+	{
+		if (!scale_cache[x])
+		{
+			evicted = NULL;
+			break;
+		}
+	}
+
+	if (evicted)
+	{
+		memmove((void*)&scale_cache[0], (void*)&scale_cache[1],
+		        sizeof(scale_context*) * (ARRAYSIZE(scale_cache) - 1));
+		x = ARRAYSIZE(scale_cache) - 1;
+	}
+
+	scale_cache[x] = ctx;
+	LeaveCriticalSection(&scale_cache_lock);
+	scale_context_free(evicted);
+}
+
+/* ------------------------------------------------------------------------- */
+void generic_scale_row_h(const BYTE* WINPR_RESTRICT pSrc, BYTE* WINPR_RESTRICT pDst, UINT32 width,
+                         const UINT32* WINPR_RESTRICT offsets, const INT16* WINPR_RESTRICT weights,
+                         UINT32 taps)
+{
+	for (UINT32 x = 0; x < width; x++)
+		prim_scale_pixel_h(pSrc, pDst, x, offsets, weights, taps);
+}
+
+void generic_scale_row_v(const BYTE* const* WINPR_RESTRICT rows,
+                         const INT16* WINPR_RESTRICT weights, UINT32 taps,
+                         BYTE* WINPR_RESTRICT pDst, size_t bytes)
+{
+	for (size_t x = 0; x < bytes; x++)
+		prim_scale_byte_v(rows, weights, taps, pDst, x);
+}
+
+/* ------------------------------------------------------------------------- */
+pstatus_t prim_image_scale(const prim_scale_kernels* WINPR_RESTRICT kernels,
+                           BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32 nDstStep,
+                           UINT32 nXDst, UINT32 nYDst, UINT32 nDstWidth, UINT32 nDstHeight,
+                           const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat, UINT32 nSrcStep,
+                           UINT32 nXSrc, UINT32 nYSrc, UINT32 nSrcWidth, UINT32 nSrcHeight)
+{
+	WINPR_ASSERT(kernels);
+
+	if (!pDstData || !pSrcData || (nDstWidth == 0) || (nDstHeight == 0) || (nSrcWidth == 0) ||
+	    (nSrcHeight == 0))
+		return -1;
+
+	if (nDstStep == 0)
+		nDstStep = nDstWidth * FreeRDPGetBytesPerPixel(DstFormat);
+
+	if (nSrcStep == 0)
+		nSrcStep = nSrcWidth * FreeRDPGetBytesPerPixel(SrcFormat);
+
+	if ((nDstWidth == nSrcWidth) && (nDstHeight == nSrcHeight))
+	{
+		if (!freerdp_image_copy_no_overlap(pDstData, DstFormat, nDstStep, nXDst, nYDst, nDstWidth,
+		                                   nDstHeight, pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc,
+		                                   NULL, FREERDP_FLIP_NONE))
+			return -1;
+		return PRIMITIVES_SUCCESS;
+	}
+
+	/* the filters work on the bytes of 32 bpp pixels, other formats are converted by row */
+	DWORD format = PIXEL_FORMAT_BGRA32;
+
+	if (FreeRDPGetBytesPerPixel(SrcFormat) == 4)
+		format = SrcFormat;
+	else if (FreeRDPGetBytesPerPixel(DstFormat) == 4)
+		format = DstFormat;
+
+	scale_context* ctx = scale_context_acquire(nSrcWidth, nSrcHeight, nDstWidth, nDstHeight);
+
+	if (!ctx)
+		return -1;
+
+	pstatus_t status = -1;
+	const BOOL convertSrc = (format != SrcFormat) || (nSrcWidth < ctx->h.taps);
+	const BOOL convertDst = format != DstFormat;
+	const size_t rowSize = 4ULL * nDstWidth;
+	const size_t srcBpp = FreeRDPGetBytesPerPixel(SrcFormat);
+	const size_t dstBpp = FreeRDPGetBytesPerPixel(DstFormat);
+
+	for (UINT32 x = 0; x < ctx->v.taps; x++)
+		ctx->rowIndex[x] = UINT32_MAX;
+
+	for (UINT32 y = 0; y < nDstHeight; y++)
+	{
+		const UINT32 first = ctx->v.offsets[y];
+
+		for (UINT32 t = 0; t < ctx->v.taps; t++)
+		{
+			const UINT32 row = MIN(first + t, nSrcHeight - 1);
+			const UINT32 slot = row % ctx->v.taps;
+			BYTE* scaled = &ctx->rows[slot * rowSize];
+
+			if (ctx->rowIndex[slot] != row)
+			{
+				const BYTE* src = &pSrcData[(1ULL * nYSrc + row) * nSrcStep + nXSrc * srcBpp];
+
+				if (convertSrc)
+				{
+					if (!freerdp_image_copy_no_overlap(ctx->srcRow, format, 0, 0, 0, nSrcWidth, 1,
+					                                   src, SrcFormat, nSrcStep, 0, 0, NULL,
+					                                   FREERDP_FLIP_NONE))
+						goto fail;
+
+					src = ctx->srcRow;
+				}
+
+				kernels->row_h(src, scaled, nDstWidth, ctx->h.offsets, ctx->h.weights,
+				               ctx->h.taps);
+				ctx->rowIndex[slot] = row;
+			}
+
+			ctx->rowPointers[t] = scaled;
+		}
+
+		BYTE* dst = &pDstData[(1ULL * nYDst + y) * nDstStep + nXDst * dstBpp];
+		kernels->row_v(ctx->rowPointers, &ctx->v.weights[1ULL * y * ctx->v.taps], ctx->v.taps,
+		               convertDst ? ctx->dstRow : dst, rowSize);
+
+		if (convertDst && !freerdp_image_copy_no_overlap(dst, DstFormat, 0, 0, 0, nDstWidth, 1,
+		                                                 ctx->dstRow, format, 0, 0, 0, NULL,
+		                                                 FREERDP_FLIP_NONE))
+			goto fail;
+	}
+
+	status = PRIMITIVES_SUCCESS;
+fail:
+	scale_context_release(ctx);
+	return status;
+}
+
+static pstatus_t generic_image_scale(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat,
+                                     UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
+                                     UINT32 nDstWidth, UINT32 nDstHeight,
+                                     const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+                                     UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc,
+                                     UINT32 nSrcWidth, UINT32 nSrcHeight)
+{
+	static const prim_scale_kernels kernels = { generic_scale_row_h, generic_scale_row_v };
+
+	return prim_image_scale(&kernels, pDstData, DstFormat, nDstStep, nXDst, nYDst, nDstWidth,
+	                        nDstHeight, pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc, nSrcWidth,
+	                        nSrcHeight);
+}
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_scale(primitives_t* WINPR_RESTRICT prims)
+{
+	prims->image_scale = generic_image_scale;
+}
+
+void primitives_init_scale_opt(primitives_t* WINPR_RESTRICT prims)
+{
+	primitives_init_scale(prims);
+	primitives_init_scale_sse41(prims);
+#if defined(WITH_AVX2)
+	primitives_init_scale_avx2(prims);
+#endif
+	primitives_init_scale_neon(prims);
+}
@@ -0,0 +1,133 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Primitives image scaling
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_PRIM_SCALE_H
+#define FREERDP_LIB_PRIM_SCALE_H
+
+#include <winpr/wtypes.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/config.h>
+#include <freerdp/primitives.h>
+
+#include "prim_internal.h"
+
+/* filter weights are fixed point with PRIM_SCALE_BITS fraction bits and sum up to
+ * PRIM_SCALE_ONE, the number of taps is always even */
+#define PRIM_SCALE_BITS 14
+#define PRIM_SCALE_ONE (1 << PRIM_SCALE_BITS)
+
+/**
+ * Horizontal pass over a row of 32 bpp pixels, for each channel of pixel x
+ * pDst[x] = sum(weights[x * taps + t] * pSrc[offsets[x] + t]) with t < taps
+ */
+typedef void (*prim_scale_row_h_fn)(const BYTE* WINPR_RESTRICT pSrc, BYTE* WINPR_RESTRICT pDst,
+                                    UINT32 width, const UINT32* WINPR_RESTRICT offsets,
+                                    const INT16* WINPR_RESTRICT weights, UINT32 taps);
+
+/**
+ * Vertical pass, for each byte pDst[x] = sum(weights[t] * rows[t][x]) with t < taps
+ */
+typedef void (*prim_scale_row_v_fn)(const BYTE* const* WINPR_RESTRICT rows,
+                                    const INT16* WINPR_RESTRICT weights, UINT32 taps,
+                                    BYTE* WINPR_RESTRICT pDst, size_t bytes);
+
+/* one pixel of the horizontal pass, shared by the generic kernel and the SIMD tails */
+static inline void prim_scale_pixel_h(const BYTE* WINPR_RESTRICT pSrc, BYTE* WINPR_RESTRICT pDst,
+                                      UINT32 x, const UINT32* WINPR_RESTRICT offsets,
+                                      const INT16* WINPR_RESTRICT weights, UINT32 taps)
+{
+	const BYTE* src = &pSrc[4ULL * offsets[x]];
+	const INT16* w = &weights[1ULL * x * taps];
+	INT32 sum[4] = { PRIM_SCALE_ONE / 2, PRIM_SCALE_ONE / 2, PRIM_SCALE_ONE / 2,
+		             PRIM_SCALE_ONE / 2 };
+
+	for (UINT32 t = 0; t < taps; t++)
+	{
+		for (size_t c = 0; c < 4; c++)
+			sum[c] += w[t] * src[4ULL * t + c];
+	}
+
+	for (size_t c = 0; c < 4; c++)
+		pDst[4ULL * x + c] = (BYTE)(sum[c] >> PRIM_SCALE_BITS);
+}
+
+/* one byte of the vertical pass */
+static inline void prim_scale_byte_v(const BYTE* const* WINPR_RESTRICT rows,
+                                     const INT16* WINPR_RESTRICT weights, UINT32 taps,
+                                     BYTE* WINPR_RESTRICT pDst, size_t x)
+{
+	INT32 sum = PRIM_SCALE_ONE / 2;
+
+	for (UINT32 t = 0; t < taps; t++)
+		sum += weights[t] * rows[t][x];
+
+	pDst[x] = (BYTE)(sum >> PRIM_SCALE_BITS);
+}
+
+typedef struct
+{
+	prim_scale_row_h_fn row_h;
+	prim_scale_row_v_fn row_v;
+} prim_scale_kernels;
+
+FREERDP_LOCAL void generic_scale_row_h(const BYTE* WINPR_RESTRICT pSrc, BYTE* WINPR_RESTRICT pDst,
+                                       UINT32 width, const UINT32* WINPR_RESTRICT offsets,
+                                       const INT16* WINPR_RESTRICT weights, UINT32 taps);
+FREERDP_LOCAL void generic_scale_row_v(const BYTE* const* WINPR_RESTRICT rows,
+                                       const INT16* WINPR_RESTRICT weights, UINT32 taps,
+                                       BYTE* WINPR_RESTRICT pDst, size_t bytes);
+
+/* Scales with the given row kernels, shared by all image_scale implementations */
+FREERDP_LOCAL pstatus_t prim_image_scale(const prim_scale_kernels* WINPR_RESTRICT kernels,
+                                         BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat,
+                                         UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
+                                         UINT32 nDstWidth, UINT32 nDstHeight,
+                                         const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+                                         UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc,
+                                         UINT32 nSrcWidth, UINT32 nSrcHeight);
+
+FREERDP_LOCAL void primitives_init_scale_sse41_int(primitives_t* WINPR_RESTRICT prims);
+static inline void primitives_init_scale_sse41(primitives_t* WINPR_RESTRICT prims)
+{
+	if (!IsProcessorFeaturePresent(PF_SSE4_1_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	primitives_init_scale_sse41_int(prims);
+}
+
+#if defined(WITH_AVX2)
+FREERDP_LOCAL void primitives_init_scale_avx2_int(primitives_t* WINPR_RESTRICT prims);
+static inline void primitives_init_scale_avx2(primitives_t* WINPR_RESTRICT prims)
+{
+	if (!IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	primitives_init_scale_avx2_int(prims);
+}
+#endif
+
+FREERDP_LOCAL void primitives_init_scale_neon_int(primitives_t* WINPR_RESTRICT prims);
+static inline void primitives_init_scale_neon(primitives_t* WINPR_RESTRICT prims)
+{
+	if (!IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	primitives_init_scale_neon_int(prims);
+}
+
+#endif
@@ -0,0 +1,209 @@
+/* FreeRDP: A Remote Desktop Protocol Client
+ * Optimized Color conversion operations.
+ * vi:ts=4 sw=4:
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0.
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_colors.h"
+
+#include "prim_internal.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <immintrin.h>
+
+/* Widths that are not a multiple of 16 are left to the implementation replaced here */
+static fn_yCbCrToRGB_16s8u_P3AC4R_t fallback_yCbCrToRGB_16s8u_P3AC4R = NULL;
+static fn_RGBToYCbCr_16s16s_P3P3_t fallback_RGBToYCbCr_16s16s_P3P3 = NULL;
+
+static inline __m256i mm256_between_epi16(__m256i val, __m256i min, __m256i max)
+{
+	return _mm256_min_epi16(max, _mm256_max_epi16(val, min));
+}
+
+/*
+ * Same fixed point arithmetic as the SSE2 version (see the comments there), 16 pixels per
+ * iteration. The results are identical.
+ */
+static inline void avx2_yCbCrToRGB_16s8u_P3AC4R_line(const INT16* WINPR_RESTRICT y_buf,
+                                                     const INT16* WINPR_RESTRICT cb_buf,
+                                                     const INT16* WINPR_RESTRICT cr_buf,
+                                                     BYTE* WINPR_RESTRICT d_buf, UINT32 width,
+                                                     BOOL bgr)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i max = _mm256_set1_epi16(255);
+	const __m256i r_cr = _mm256_set1_epi16(22987);  /*  1.403 << 14 */
+	const __m256i g_cb = _mm256_set1_epi16(-5636);  /* -0.344 << 14 */
+	const __m256i g_cr = _mm256_set1_epi16(-11698); /* -0.714 << 14 */
+	const __m256i b_cb = _mm256_set1_epi16(29000);  /*  1.770 << 14 */
+	const __m256i c4096 = _mm256_set1_epi16(4096);
+	const __m256i alpha = _mm256_set1_epi16((INT16)0xFF00);
+
+	for (UINT32 x = 0; x < width; x += 16)
+	{
+		/* y = (y_r_buf[i] + 4096) >> 2 */
+		__m256i y = _mm256_loadu_si256((const __m256i*)&y_buf[x]);
+		y = _mm256_srai_epi16(_mm256_add_epi16(y, c4096), 2);
+		const __m256i cb = _mm256_loadu_si256((const __m256i*)&cb_buf[x]);
+		const __m256i cr = _mm256_loadu_si256((const __m256i*)&cr_buf[x]);
+
+		/* (y + HIWORD(cr*22986)) >> 3 */
+		__m256i r = _mm256_add_epi16(y, _mm256_mulhi_epi16(cr, r_cr));
+		r = mm256_between_epi16(_mm256_srai_epi16(r, 3), zero, max);
+
+		/* (y + HIWORD(cb*-5636) + HIWORD(cr*-11698)) >> 3 */
+		__m256i g = _mm256_add_epi16(y, _mm256_mulhi_epi16(cb, g_cb));
+		g = _mm256_add_epi16(g, _mm256_mulhi_epi16(cr, g_cr));
+		g = mm256_between_epi16(_mm256_srai_epi16(g, 3), zero, max);
+
+		/* (y + HIWORD(cb*29000)) >> 3 */
+		__m256i b = _mm256_add_epi16(y, _mm256_mulhi_epi16(cb, b_cb));
+		b = mm256_between_epi16(_mm256_srai_epi16(b, 3), zero, max);
+
+		/* 16 bit B|G<<8 and R|0xFF<<8 (or swapped R/B), interleaved to 32 bit pixels */
+		const __m256i bg = _mm256_or_si256(bgr ? b : r, _mm256_slli_epi16(g, 8));
+		const __m256i ra = _mm256_or_si256(bgr ? r : b, alpha);
+		const __m256i lo = _mm256_unpacklo_epi16(bg, ra); /* pixel 0-3, 8-11 */
+		const __m256i hi = _mm256_unpackhi_epi16(bg, ra); /* pixel 4-7, 12-15 */
+		_mm256_storeu_si256((__m256i*)&d_buf[4ULL * x], _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i*)&d_buf[4ULL * x + 32],
+		                    _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+}
+
+static pstatus_t
+avx2_yCbCrToRGB_16s8u_P3AC4R(const INT16* WINPR_RESTRICT pSrc[3], UINT32 srcStep,
+                             BYTE* WINPR_RESTRICT pDst, UINT32 dstStep, UINT32 DstFormat,
+                             const prim_size_t* WINPR_RESTRICT roi) /* region of interest */
+{
+	BOOL bgr = TRUE;
+
+	switch (DstFormat)
+	{
+		case PIXEL_FORMAT_BGRA32:
+		case PIXEL_FORMAT_BGRX32:
+			bgr = TRUE;
+			break;
+
+		case PIXEL_FORMAT_RGBA32:
+		case PIXEL_FORMAT_RGBX32:
+			bgr = FALSE;
+			break;
+
+		default:
+			return fallback_yCbCrToRGB_16s8u_P3AC4R(pSrc, srcStep, pDst, dstStep, DstFormat,
+			                                        roi);
+	}
+
+	if ((roi->width % 16) != 0)
+		return fallback_yCbCrToRGB_16s8u_P3AC4R(pSrc, srcStep, pDst, dstStep, DstFormat, roi);
+
+	for (UINT32 y = 0; y < roi->height; y++)
+	{
+		const INT16* y_buf = (const INT16*)((const BYTE*)pSrc[0] + 1ULL * y * srcStep);
+		const INT16* cb_buf = (const INT16*)((const BYTE*)pSrc[1] + 1ULL * y * srcStep);
+		const INT16* cr_buf = (const INT16*)((const BYTE*)pSrc[2] + 1ULL * y * srcStep);
+		avx2_yCbCrToRGB_16s8u_P3AC4R_line(y_buf, cb_buf, cr_buf, &pDst[1ULL * y * dstStep],
+		                                  roi->width, bgr);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* The encoded YCbCr coefficients are represented as 11.5 fixed-point numbers, see the SSE2
+ * version for the details of the arithmetic.
+ */
+static pstatus_t
+avx2_RGBToYCbCr_16s16s_P3P3(const INT16* WINPR_RESTRICT pSrc[3], INT32 srcStep,
+                            INT16* WINPR_RESTRICT pDst[3], INT32 dstStep,
+                            const prim_size_t* WINPR_RESTRICT roi) /* region of interest */
+{
+	if (((roi->width % 16) != 0) || (srcStep < 0) || (dstStep < 0))
+		return fallback_RGBToYCbCr_16s16s_P3P3(pSrc, srcStep, pDst, dstStep, roi);
+
+	const __m256i min = _mm256_set1_epi16(-128 * 32);
+	const __m256i max = _mm256_set1_epi16(127 * 32);
+	const __m256i y_r = _mm256_set1_epi16(9798);    /*  0.299000 << 15 */
+	const __m256i y_g = _mm256_set1_epi16(19235);   /*  0.587000 << 15 */
+	const __m256i y_b = _mm256_set1_epi16(3735);    /*  0.114000 << 15 */
+	const __m256i cb_r = _mm256_set1_epi16(-5535);  /* -0.168935 << 15 */
+	const __m256i cb_g = _mm256_set1_epi16(-10868); /* -0.331665 << 15 */
+	const __m256i cb_b = _mm256_set1_epi16(16403);  /*  0.500590 << 15 */
+	const __m256i cr_r = _mm256_set1_epi16(16377);  /*  0.499813 << 15 */
+	const __m256i cr_g = _mm256_set1_epi16(-13714); /* -0.418531 << 15 */
+	const __m256i cr_b = _mm256_set1_epi16(-2663);  /* -0.081282 << 15 */
+
+	for (UINT32 yp = 0; yp < roi->height; yp++)
+	{
+		const size_t srcOffset = 1ULL * yp * (size_t)srcStep;
+		const size_t dstOffset = 1ULL * yp * (size_t)dstStep;
+		const INT16* r_buf = (const INT16*)((const BYTE*)pSrc[0] + srcOffset);
+		const INT16* g_buf = (const INT16*)((const BYTE*)pSrc[1] + srcOffset);
+		const INT16* b_buf = (const INT16*)((const BYTE*)pSrc[2] + srcOffset);
+		INT16* y_buf = (INT16*)((BYTE*)pDst[0] + dstOffset);
+		INT16* cb_buf = (INT16*)((BYTE*)pDst[1] + dstOffset);
+		INT16* cr_buf = (INT16*)((BYTE*)pDst[2] + dstOffset);
+
+		for (UINT32 x = 0; x < roi->width; x += 16)
+		{
+			/* r<<6; g<<6; b<<6 */
+			const __m256i r =
+			    _mm256_slli_epi16(_mm256_loadu_si256((const __m256i*)&r_buf[x]), 6);
+			const __m256i g =
+			    _mm256_slli_epi16(_mm256_loadu_si256((const __m256i*)&g_buf[x]), 6);
+			const __m256i b =
+			    _mm256_slli_epi16(_mm256_loadu_si256((const __m256i*)&b_buf[x]), 6);
+
+			/* y = HIWORD(r*y_r) + HIWORD(g*y_g) + HIWORD(b*y_b) + min */
+			__m256i y = _mm256_mulhi_epi16(r, y_r);
+			y = _mm256_add_epi16(y, _mm256_mulhi_epi16(g, y_g));
+			y = _mm256_add_epi16(y, _mm256_mulhi_epi16(b, y_b));
+			y = _mm256_add_epi16(y, min);
+			_mm256_storeu_si256((__m256i*)&y_buf[x], mm256_between_epi16(y, min, max));
+
+			/* cb = HIWORD(r*cb_r) + HIWORD(g*cb_g) + HIWORD(b*cb_b) */
+			__m256i cb = _mm256_mulhi_epi16(r, cb_r);
+			cb = _mm256_add_epi16(cb, _mm256_mulhi_epi16(g, cb_g));
+			cb = _mm256_add_epi16(cb, _mm256_mulhi_epi16(b, cb_b));
+			_mm256_storeu_si256((__m256i*)&cb_buf[x], mm256_between_epi16(cb, min, max));
+
+			/* cr = HIWORD(r*cr_r) + HIWORD(g*cr_g) + HIWORD(b*cr_b) */
+			__m256i cr = _mm256_mulhi_epi16(r, cr_r);
+			cr = _mm256_add_epi16(cr, _mm256_mulhi_epi16(g, cr_g));
+			cr = _mm256_add_epi16(cr, _mm256_mulhi_epi16(b, cr_b));
+			_mm256_storeu_si256((__m256i*)&cr_buf[x], mm256_between_epi16(cr, min, max));
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_colors_avx2_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	WLog_VRB(PRIM_TAG, "AVX2 optimizations");
+	fallback_yCbCrToRGB_16s8u_P3AC4R = prims->yCbCrToRGB_16s8u_P3AC4R;
+	fallback_RGBToYCbCr_16s16s_P3P3 = prims->RGBToYCbCr_16s16s_P3P3;
+	prims->yCbCrToRGB_16s8u_P3AC4R = avx2_yCbCrToRGB_16s8u_P3AC4R;
+	prims->RGBToYCbCr_16s16s_P3P3 = avx2_RGBToYCbCr_16s16s_P3P3;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or WITH_AVX2 or AVX2 intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
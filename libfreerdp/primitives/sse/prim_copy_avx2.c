@@ -257,11 +257,10 @@ static pstatus_t avx2_image_copy_no_overlap(BYTE* WINPR_RESTRICT pDstData, DWORD
 		                                            nXSrc, nYSrc, palette, srcVMultiplier,
 		                                            srcVOffset, dstVMultiplier, dstVOffset, flags);
 	else
-	{
-		primitives_t* gen = primitives_get_generic();
-		return gen->copy_no_overlap(pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth, nHeight,
-		                            pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc, palette, flags);
-	}
+		return sse_image_copy_no_overlap_convert(pDstData, DstFormat, nDstStep, nXDst, nYDst,
+		                                         nWidth, nHeight, pSrcData, SrcFormat, nSrcStep,
+		                                         nXSrc, nYSrc, palette, srcVMultiplier, srcVOffset,
+		                                         dstVMultiplier, dstVOffset);
 }
 #endif
 
@@ -132,6 +132,220 @@ static INLINE pstatus_t sse_image_copy_bgrx32_bgrx32(BYTE* WINPR_RESTRICT pDstDa
 	return PRIMITIVES_SUCCESS;
 }
 
+/* 4 pixels of a format are converted via B, G, R, A byte order in a register */
+typedef struct
+{
+	UINT32 bpp;
+	BOOL bgr16;
+	__m128i unpack;
+	__m128i alpha;
+	__m128i pack;
+} sse_pixel_layout;
+
+/* byte i of a pixel holds channel order[i] (0 blue, 1 green, 2 red, 3 alpha), 0x80 is zero */
+static const struct
+{
+	DWORD format;
+	BYTE order[4];
+} sse_pixel_orders[] = { { PIXEL_FORMAT_ARGB32, { 3, 2, 1, 0 } },
+	                       { PIXEL_FORMAT_XRGB32, { 0x80, 2, 1, 0 } },
+	                       { PIXEL_FORMAT_ABGR32, { 3, 0, 1, 2 } },
+	                       { PIXEL_FORMAT_XBGR32, { 0x80, 0, 1, 2 } },
+	                       { PIXEL_FORMAT_RGBA32, { 2, 1, 0, 3 } },
+	                       { PIXEL_FORMAT_RGBX32, { 2, 1, 0, 3 } },
+	                       { PIXEL_FORMAT_BGRA32, { 0, 1, 2, 3 } },
+	                       { PIXEL_FORMAT_BGRX32, { 0, 1, 2, 3 } },
+	                       { PIXEL_FORMAT_RGB24, { 2, 1, 0, 0x80 } },
+	                       { PIXEL_FORMAT_BGR24, { 0, 1, 2, 0x80 } },
+	                       { PIXEL_FORMAT_RGB16, { 0x80, 0x80, 0x80, 0x80 } },
+	                       { PIXEL_FORMAT_BGR16, { 0x80, 0x80, 0x80, 0x80 } } };
+
+/* mirrors FreeRDPSplitColor and FreeRDPGetColor: formats without alpha read as 0xFF,
+ * the X byte of RGBX32 and BGRX32 is written with alpha, the one of XRGB32 and XBGR32 with 0 */
+static BOOL sse_pixel_layout_init(sse_pixel_layout* layout, DWORD format)
+{
+	const BYTE* order = NULL;
+	BYTE unpack[16] = { 0 };
+	BYTE alpha[16] = { 0 };
+	BYTE pack[16] = { 0 };
+
+	for (size_t x = 0; x < ARRAYSIZE(sse_pixel_orders); x++)
+	{
+		if (sse_pixel_orders[x].format == format)
+			order = sse_pixel_orders[x].order;
+	}
+
+	if (!order)
+		return FALSE;
+
+	const BOOL hasAlpha = FreeRDPColorHasAlpha(format);
+	layout->bpp = FreeRDPGetBytesPerPixel(format);
+	layout->bgr16 = (format == PIXEL_FORMAT_BGR16);
+
+	memset(unpack, 0x80, sizeof(unpack));
+	memset(pack, 0x80, sizeof(pack));
+
+	for (size_t x = 0; x < 4; x++)
+	{
+		if (!hasAlpha)
+			alpha[x * 4 + 3] = 0xFF;
+
+		for (size_t i = 0; i < layout->bpp; i++)
+		{
+			const BYTE c = order[i];
+
+			if (c == 0x80)
+				continue;
+
+			if ((c < 3) || hasAlpha)
+				unpack[x * 4 + c] = (BYTE)(x * layout->bpp + i);
+			pack[x * layout->bpp + i] = (BYTE)(x * 4 + c);
+		}
+	}
+
+	layout->unpack = _mm_loadu_si128((const __m128i*)unpack);
+	layout->alpha = _mm_loadu_si128((const __m128i*)alpha);
+	layout->pack = _mm_loadu_si128((const __m128i*)pack);
+	return TRUE;
+}
+
+static INLINE __m128i sse_unpack_565(__m128i v, BOOL bgr16)
+{
+	const __m128i mask5 = _mm_set1_epi32(0x1F);
+	const __m128i mask6 = _mm_set1_epi32(0x3F);
+	const __m128i max = _mm_set1_epi32(0xFF);
+	const __m128i hi = _mm_srli_epi32(v, 11);
+	const __m128i mid = _mm_and_si128(_mm_srli_epi32(v, 5), mask6);
+	const __m128i lo = _mm_and_si128(v, mask5);
+
+	/* (c << 3) + c / 4 for 5 bits and (c << 2) + c / 8 for 6 bits, as FreeRDPSplitColor */
+	const __m128i hi8 = _mm_or_si128(_mm_slli_epi32(hi, 3), _mm_srli_epi32(hi, 2));
+	const __m128i lo8 = _mm_or_si128(_mm_slli_epi32(lo, 3), _mm_srli_epi32(lo, 2));
+	const __m128i g8 = _mm_min_epi32(_mm_add_epi32(_mm_slli_epi32(mid, 2), _mm_srli_epi32(mid, 3)),
+	                                 max);
+	const __m128i r8 = bgr16 ? lo8 : hi8;
+	const __m128i b8 = bgr16 ? hi8 : lo8;
+
+	return _mm_or_si128(_mm_or_si128(b8, _mm_slli_epi32(g8, 8)),
+	                    _mm_or_si128(_mm_slli_epi32(r8, 16), mm_set1_epu32(0xFF000000)));
+}
+
+static INLINE __m128i sse_pack_565(__m128i c, BOOL bgr16)
+{
+	const __m128i mask5 = _mm_set1_epi32(0x1F);
+	const __m128i b5 = _mm_and_si128(_mm_srli_epi32(c, 3), mask5);
+	const __m128i g6 = _mm_and_si128(_mm_srli_epi32(c, 10), _mm_set1_epi32(0x3F));
+	const __m128i r5 = _mm_and_si128(_mm_srli_epi32(c, 19), mask5);
+	const __m128i hi = bgr16 ? b5 : r5;
+	const __m128i lo = bgr16 ? r5 : b5;
+	const __m128i v =
+	    _mm_or_si128(_mm_or_si128(_mm_slli_epi32(hi, 11), _mm_slli_epi32(g6, 5)), lo);
+
+	return _mm_packus_epi32(v, v);
+}
+
+static INLINE __m128i sse_load_pixels(const BYTE* WINPR_RESTRICT src, UINT32 bpp,
+                                      const sse_pixel_layout* WINPR_RESTRICT layout)
+{
+	__m128i v = _mm_setzero_si128();
+
+	switch (bpp)
+	{
+		case 4:
+			v = _mm_loadu_si128((const __m128i*)src);
+			break;
+		case 3:
+		{
+			INT32 tail = 0;
+			memcpy(&tail, &src[8], sizeof(tail));
+			v = _mm_insert_epi32(_mm_loadl_epi64((const __m128i*)src), tail, 2);
+		}
+		break;
+		default:
+			v = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)src));
+			return sse_unpack_565(v, layout->bgr16);
+	}
+
+	return _mm_or_si128(_mm_shuffle_epi8(v, layout->unpack), layout->alpha);
+}
+
+static INLINE void sse_store_pixels(BYTE* WINPR_RESTRICT dst, UINT32 bpp,
+                                    const sse_pixel_layout* WINPR_RESTRICT layout, __m128i c)
+{
+	switch (bpp)
+	{
+		case 4:
+			_mm_storeu_si128((__m128i*)dst, _mm_shuffle_epi8(c, layout->pack));
+			break;
+		case 3:
+		{
+			const __m128i v = _mm_shuffle_epi8(c, layout->pack);
+			const INT32 tail = _mm_extract_epi32(v, 2);
+			_mm_storel_epi64((__m128i*)dst, v);
+			memcpy(&dst[8], &tail, sizeof(tail));
+		}
+		break;
+		default:
+			_mm_storel_epi64((__m128i*)dst, sse_pack_565(c, layout->bgr16));
+			break;
+	}
+}
+
+static void sse_convert_rows(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32 nDstStep,
+                             UINT32 nXDst, UINT32 nYDst, UINT32 nWidth, UINT32 nHeight,
+                             const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat, UINT32 nSrcStep,
+                             UINT32 nXSrc, UINT32 nYSrc, const sse_pixel_layout* WINPR_RESTRICT src,
+                             const sse_pixel_layout* WINPR_RESTRICT dst, int64_t srcVMultiplier,
+                             int64_t srcVOffset, int64_t dstVMultiplier, int64_t dstVOffset)
+{
+	const int64_t srcByte = src->bpp;
+	const int64_t dstByte = dst->bpp;
+	const int64_t width = nWidth - nWidth % 4;
+
+	for (int64_t y = 0; y < nHeight; y++)
+	{
+		const BYTE* WINPR_RESTRICT srcLine =
+		    &pSrcData[srcVMultiplier * (y + nYSrc) * nSrcStep + srcVOffset + nXSrc * srcByte];
+		BYTE* WINPR_RESTRICT dstLine =
+		    &pDstData[dstVMultiplier * (y + nYDst) * nDstStep + dstVOffset + nXDst * dstByte];
+
+		int64_t x = 0;
+		for (; x < width; x += 4)
+		{
+			const __m128i c = sse_load_pixels(&srcLine[x * srcByte], srcByte, src);
+			sse_store_pixels(&dstLine[x * dstByte], dstByte, dst, c);
+		}
+
+		for (; x < nWidth; x++)
+		{
+			const UINT32 color = FreeRDPReadColor_int(&srcLine[x * srcByte], SrcFormat);
+			const UINT32 dstColor = FreeRDPConvertColor(color, SrcFormat, DstFormat, NULL);
+			FreeRDPWriteColor_int(&dstLine[x * dstByte], DstFormat, dstColor);
+		}
+	}
+}
+
+pstatus_t sse_image_copy_no_overlap_convert(
+    BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
+    UINT32 nWidth, UINT32 nHeight, const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+    UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc, const gdiPalette* WINPR_RESTRICT palette,
+    int64_t srcVMultiplier, int64_t srcVOffset, int64_t dstVMultiplier, int64_t dstVOffset)
+{
+	sse_pixel_layout src = { 0 };
+	sse_pixel_layout dst = { 0 };
+
+	if (!sse_pixel_layout_init(&src, SrcFormat) || !sse_pixel_layout_init(&dst, DstFormat))
+		return generic_image_copy_no_overlap_convert(
+		    pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth, nHeight, pSrcData, SrcFormat,
+		    nSrcStep, nXSrc, nYSrc, palette, srcVMultiplier, srcVOffset, dstVMultiplier,
+		    dstVOffset);
+
+	sse_convert_rows(pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth, nHeight, pSrcData,
+	                 SrcFormat, nSrcStep, nXSrc, nYSrc, &src, &dst, srcVMultiplier, srcVOffset,
+	                 dstVMultiplier, dstVOffset);
+	return PRIMITIVES_SUCCESS;
+}
+
 static pstatus_t sse_image_copy_no_overlap_dst_alpha(
     BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
     UINT32 nWidth, UINT32 nHeight, const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
@@ -236,11 +450,10 @@ static pstatus_t sse_image_copy_no_overlap(BYTE* WINPR_RESTRICT pDstData, DWORD
 		                                            nXSrc, nYSrc, palette, srcVMultiplier,
 		                                            srcVOffset, dstVMultiplier, dstVOffset, flags);
 	else
-	{
-		primitives_t* gen = primitives_get_generic();
-		return gen->copy_no_overlap(pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth, nHeight,
-		                            pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc, palette, flags);
-	}
+		return sse_image_copy_no_overlap_convert(pDstData, DstFormat, nDstStep, nXDst, nYDst,
+		                                         nWidth, nHeight, pSrcData, SrcFormat, nSrcStep,
+		                                         nXSrc, nYSrc, palette, srcVMultiplier, srcVOffset,
+		                                         dstVMultiplier, dstVOffset);
 }
 #endif
 
@@ -0,0 +1,172 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Optimized image scaling
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <string.h>
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/log.h>
+
+#include "prim_internal.h"
+#include "prim_scale.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <emmintrin.h>
+#include <immintrin.h>
+
+static inline INT32 avx2_weight_pair(const INT16* WINPR_RESTRICT weights)
+{
+	INT32 pair = 0;
+	memcpy(&pair, weights, sizeof(pair));
+	return pair;
+}
+
+/* the weight pair of lo in lane 0, that of hi in lane 1 */
+static inline __m256i avx2_weight_pairs(const INT16* WINPR_RESTRICT lo,
+                                        const INT16* WINPR_RESTRICT hi)
+{
+	return _mm256_set_m128i(_mm_set1_epi32(avx2_weight_pair(hi)),
+	                        _mm_set1_epi32(avx2_weight_pair(lo)));
+}
+
+static inline __m128i avx2_load_pixels(const BYTE* WINPR_RESTRICT p0,
+                                       const BYTE* WINPR_RESTRICT p1)
+{
+	return _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)p0),
+	                          _mm_loadl_epi64((const __m128i*)p1));
+}
+
+/* Four output pixels per iteration, lane 0 holds the taps of pixels x and x + 1, lane 1 those
+ * of x + 2 and x + 3. See sse41_scale_row_h for the layout within a lane. */
+static void avx2_scale_row_h(const BYTE* WINPR_RESTRICT pSrc, BYTE* WINPR_RESTRICT pDst,
+                             UINT32 width, const UINT32* WINPR_RESTRICT offsets,
+                             const INT16* WINPR_RESTRICT weights, UINT32 taps)
+{
+	const __m256i round = _mm256_set1_epi32(PRIM_SCALE_ONE / 2);
+	const __m256i interleave =
+	    _mm256_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15, 0, 4, 1, 5, 2, 6, 3,
+	                     7, 8, 12, 9, 13, 10, 14, 11, 15);
+	const __m256i zero = _mm256_setzero_si256();
+	UINT32 x = 0;
+
+	for (; x + 4 <= width; x += 4)
+	{
+		const BYTE* src[4] = { &pSrc[4ULL * offsets[x]], &pSrc[4ULL * offsets[x + 1]],
+			                   &pSrc[4ULL * offsets[x + 2]], &pSrc[4ULL * offsets[x + 3]] };
+		const INT16* w = &weights[1ULL * x * taps];
+		__m256i sum0 = round;
+		__m256i sum1 = round;
+
+		for (UINT32 t = 0; t < taps; t += 2)
+		{
+			const size_t offset = 4ULL * t;
+			const __m256i pixels = _mm256_shuffle_epi8(
+			    _mm256_set_m128i(avx2_load_pixels(&src[2][offset], &src[3][offset]),
+			                     avx2_load_pixels(&src[0][offset], &src[1][offset])),
+			    interleave);
+			const __m256i w0 = avx2_weight_pairs(&w[t], &w[2ULL * taps + t]);
+			const __m256i w1 = avx2_weight_pairs(&w[taps + t], &w[3ULL * taps + t]);
+
+			sum0 =
+			    _mm256_add_epi32(sum0, _mm256_madd_epi16(_mm256_unpacklo_epi8(pixels, zero), w0));
+			sum1 =
+			    _mm256_add_epi32(sum1, _mm256_madd_epi16(_mm256_unpackhi_epi8(pixels, zero), w1));
+		}
+
+		sum0 = _mm256_srai_epi32(sum0, PRIM_SCALE_BITS);
+		sum1 = _mm256_srai_epi32(sum1, PRIM_SCALE_BITS);
+
+		/* the low 64 bit of each lane hold two pixels, gather them into the low lane */
+		const __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(sum0, sum1), zero);
+		_mm_storeu_si128((__m128i*)&pDst[4ULL * x],
+		                 _mm256_castsi256_si128(_mm256_permute4x64_epi64(packed, 0x08)));
+	}
+
+	for (; x < width; x++)
+		prim_scale_pixel_h(pSrc, pDst, x, offsets, weights, taps);
+}
+
+/* 32 bytes per iteration, two rows are interleaved for _mm256_madd_epi16 */
+static void avx2_scale_row_v(const BYTE* const* WINPR_RESTRICT rows,
+                             const INT16* WINPR_RESTRICT weights, UINT32 taps,
+                             BYTE* WINPR_RESTRICT pDst, size_t bytes)
+{
+	const __m256i round = _mm256_set1_epi32(PRIM_SCALE_ONE / 2);
+	const __m256i zero = _mm256_setzero_si256();
+	size_t x = 0;
+
+	for (; x + 32 <= bytes; x += 32)
+	{
+		__m256i sum[4] = { round, round, round, round };
+
+		for (UINT32 t = 0; t < taps; t += 2)
+		{
+			const __m256i a = _mm256_loadu_si256((const __m256i*)&rows[t][x]);
+			const __m256i b = _mm256_loadu_si256((const __m256i*)&rows[t + 1][x]);
+			const __m256i w = _mm256_set1_epi32(avx2_weight_pair(&weights[t]));
+			const __m256i lo = _mm256_unpacklo_epi8(a, b);
+			const __m256i hi = _mm256_unpackhi_epi8(a, b);
+
+			sum[0] =
+			    _mm256_add_epi32(sum[0], _mm256_madd_epi16(_mm256_unpacklo_epi8(lo, zero), w));
+			sum[1] =
+			    _mm256_add_epi32(sum[1], _mm256_madd_epi16(_mm256_unpackhi_epi8(lo, zero), w));
+			sum[2] =
+			    _mm256_add_epi32(sum[2], _mm256_madd_epi16(_mm256_unpacklo_epi8(hi, zero), w));
+			sum[3] =
+			    _mm256_add_epi32(sum[3], _mm256_madd_epi16(_mm256_unpackhi_epi8(hi, zero), w));
+		}
+
+		for (size_t i = 0; i < ARRAYSIZE(sum); i++)
+			sum[i] = _mm256_srai_epi32(sum[i], PRIM_SCALE_BITS);
+
+		/* all operations work within lanes, so the byte order is restored */
+		const __m256i lo = _mm256_packs_epi32(sum[0], sum[1]);
+		const __m256i hi = _mm256_packs_epi32(sum[2], sum[3]);
+		_mm256_storeu_si256((__m256i*)&pDst[x], _mm256_packus_epi16(lo, hi));
+	}
+
+	for (; x < bytes; x++)
+		prim_scale_byte_v(rows, weights, taps, pDst, x);
+}
+
+static pstatus_t avx2_image_scale(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32 nDstStep,
+                                  UINT32 nXDst, UINT32 nYDst, UINT32 nDstWidth, UINT32 nDstHeight,
+                                  const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+                                  UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc, UINT32 nSrcWidth,
+                                  UINT32 nSrcHeight)
+{
+	static const prim_scale_kernels kernels = { avx2_scale_row_h, avx2_scale_row_v };
+
+	return prim_image_scale(&kernels, pDstData, DstFormat, nDstStep, nXDst, nYDst, nDstWidth,
+	                        nDstHeight, pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc, nSrcWidth,
+	                        nSrcHeight);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_scale_avx2_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	WLog_VRB(PRIM_TAG, "AVX2 optimizations");
+	prims->image_scale = avx2_image_scale;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or WITH_AVX2 or AVX2 intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
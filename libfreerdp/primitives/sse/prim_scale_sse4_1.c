@@ -0,0 +1,145 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Optimized image scaling
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <string.h>
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/log.h>
+
+#include "prim_internal.h"
+#include "prim_scale.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <emmintrin.h>
+#include <smmintrin.h>
+
+static inline __m128i sse_weight_pair(const INT16* WINPR_RESTRICT weights)
+{
+	INT32 pair = 0;
+	memcpy(&pair, weights, sizeof(pair));
+	return _mm_set1_epi32(pair);
+}
+
+/* Two output pixels per iteration. The bytes of each pair of input pixels are interleaved to
+ * (p0c0, p1c0, p0c1, ...) so that _mm_madd_epi16 sums two taps per channel. */
+static void sse41_scale_row_h(const BYTE* WINPR_RESTRICT pSrc, BYTE* WINPR_RESTRICT pDst,
+                              UINT32 width, const UINT32* WINPR_RESTRICT offsets,
+                              const INT16* WINPR_RESTRICT weights, UINT32 taps)
+{
+	const __m128i round = _mm_set1_epi32(PRIM_SCALE_ONE / 2);
+	const __m128i interleave =
+	    _mm_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15);
+	const __m128i zero = _mm_setzero_si128();
+	UINT32 x = 0;
+
+	for (; x + 2 <= width; x += 2)
+	{
+		const BYTE* src0 = &pSrc[4ULL * offsets[x]];
+		const BYTE* src1 = &pSrc[4ULL * offsets[x + 1]];
+		const INT16* w0 = &weights[1ULL * x * taps];
+		const INT16* w1 = &w0[taps];
+		__m128i sum0 = round;
+		__m128i sum1 = round;
+
+		for (UINT32 t = 0; t < taps; t += 2)
+		{
+			const __m128i p0 = _mm_loadl_epi64((const __m128i*)&src0[4ULL * t]);
+			const __m128i p1 = _mm_loadl_epi64((const __m128i*)&src1[4ULL * t]);
+			const __m128i pixels = _mm_shuffle_epi8(_mm_unpacklo_epi64(p0, p1), interleave);
+
+			sum0 = _mm_add_epi32(
+			    sum0, _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), sse_weight_pair(&w0[t])));
+			sum1 = _mm_add_epi32(
+			    sum1, _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), sse_weight_pair(&w1[t])));
+		}
+
+		sum0 = _mm_srai_epi32(sum0, PRIM_SCALE_BITS);
+		sum1 = _mm_srai_epi32(sum1, PRIM_SCALE_BITS);
+		_mm_storel_epi64((__m128i*)&pDst[4ULL * x],
+		                 _mm_packus_epi16(_mm_packs_epi32(sum0, sum1), zero));
+	}
+
+	for (; x < width; x++)
+		prim_scale_pixel_h(pSrc, pDst, x, offsets, weights, taps);
+}
+
+/* 16 bytes per iteration, two rows are interleaved for _mm_madd_epi16 */
+static void sse41_scale_row_v(const BYTE* const* WINPR_RESTRICT rows,
+                              const INT16* WINPR_RESTRICT weights, UINT32 taps,
+                              BYTE* WINPR_RESTRICT pDst, size_t bytes)
+{
+	const __m128i round = _mm_set1_epi32(PRIM_SCALE_ONE / 2);
+	const __m128i zero = _mm_setzero_si128();
+	size_t x = 0;
+
+	for (; x + 16 <= bytes; x += 16)
+	{
+		__m128i sum[4] = { round, round, round, round };
+
+		for (UINT32 t = 0; t < taps; t += 2)
+		{
+			const __m128i a = _mm_loadu_si128((const __m128i*)&rows[t][x]);
+			const __m128i b = _mm_loadu_si128((const __m128i*)&rows[t + 1][x]);
+			const __m128i w = sse_weight_pair(&weights[t]);
+			const __m128i lo = _mm_unpacklo_epi8(a, b);
+			const __m128i hi = _mm_unpackhi_epi8(a, b);
+
+			sum[0] = _mm_add_epi32(sum[0], _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), w));
+			sum[1] = _mm_add_epi32(sum[1], _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), w));
+			sum[2] = _mm_add_epi32(sum[2], _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), w));
+			sum[3] = _mm_add_epi32(sum[3], _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), w));
+		}
+
+		for (size_t i = 0; i < ARRAYSIZE(sum); i++)
+			sum[i] = _mm_srai_epi32(sum[i], PRIM_SCALE_BITS);
+
+		const __m128i lo = _mm_packs_epi32(sum[0], sum[1]);
+		const __m128i hi = _mm_packs_epi32(sum[2], sum[3]);
+		_mm_storeu_si128((__m128i*)&pDst[x], _mm_packus_epi16(lo, hi));
+	}
+
+	for (; x < bytes; x++)
+		prim_scale_byte_v(rows, weights, taps, pDst, x);
+}
+
+static pstatus_t sse41_image_scale(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32 nDstStep,
+                                   UINT32 nXDst, UINT32 nYDst, UINT32 nDstWidth, UINT32 nDstHeight,
+                                   const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+                                   UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc, UINT32 nSrcWidth,
+                                   UINT32 nSrcHeight)
+{
+	static const prim_scale_kernels kernels = { sse41_scale_row_h, sse41_scale_row_v };
+
+	return prim_image_scale(&kernels, pDstData, DstFormat, nDstStep, nXDst, nYDst, nDstWidth,
+	                        nDstHeight, pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc, nSrcWidth,
+	                        nSrcHeight);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_scale_sse41_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	WLog_VRB(PRIM_TAG, "SSE4.1 optimizations");
+	prims->image_scale = sse41_image_scale;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or SSE4.1 intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
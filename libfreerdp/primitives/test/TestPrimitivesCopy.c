@@ -18,6 +18,7 @@
 #include <winpr/crypto.h>
 
 #include <winpr/sysinfo.h>
+#include <freerdp/utils/profiler.h>
 #include "prim_test.h"
 
 #define COPY_TESTSIZE (256 * 2 + 16 * 2 + 15 + 15)
@@ -222,6 +223,87 @@ static BOOL test_copy_no_overlap(BOOL verbose, UINT32 srcFormat, UINT32 dstForma
 	return rc;
 }
 
+/* all formats the SIMD conversion handles, in every combination and with short rows */
+static BOOL test_copy_no_overlap_convert(BOOL verbose)
+{
+	const UINT32 formats[] = { PIXEL_FORMAT_ARGB32, PIXEL_FORMAT_XRGB32, PIXEL_FORMAT_ABGR32,
+		                       PIXEL_FORMAT_XBGR32, PIXEL_FORMAT_RGBA32, PIXEL_FORMAT_RGBX32,
+		                       PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_BGRX32, PIXEL_FORMAT_RGB24,
+		                       PIXEL_FORMAT_BGR24,  PIXEL_FORMAT_RGB16,  PIXEL_FORMAT_BGR16 };
+	const UINT32 widths[] = { 1, 3, 4, 5, 8, 9, 67 };
+	BOOL rc = TRUE;
+
+	for (size_t x = 0; x < ARRAYSIZE(formats); x++)
+	{
+		for (size_t y = 0; y < ARRAYSIZE(formats); y++)
+		{
+			for (size_t z = 0; z < ARRAYSIZE(widths); z++)
+			{
+				const UINT32 w = widths[z];
+
+				if (!test_copy_no_overlap_off(verbose, formats[x], formats[y], FREERDP_FLIP_NONE,
+				                              8, w, 3, w / 2, 1, (w - 1) / 3, 2))
+					rc = FALSE;
+			}
+		}
+	}
+
+	return rc;
+}
+
+static BOOL test_copy_no_overlap_convert_speed(UINT32 srcFormat, UINT32 dstFormat)
+{
+	BOOL rc = FALSE;
+	const UINT32 w = 1920;
+	const UINT32 h = 1080;
+	const UINT32 sstride = w * FreeRDPGetBytesPerPixel(srcFormat);
+	const UINT32 dstride = w * FreeRDPGetBytesPerPixel(dstFormat);
+	primitives_t* gen = primitives_get_generic();
+	primitives_t* prims = primitives_get();
+	BYTE* src = rand_alloc(w, h, 4, 0, NULL);
+	BYTE* dst = rand_alloc(w, h, 4, 0, NULL);
+	char name[64] = { 0 };
+
+	PROFILER_DEFINE(genericProf)
+	PROFILER_DEFINE(optProf)
+	(void)_snprintf(name, sizeof(name), "%s->%s-GENERIC", FreeRDPGetColorFormatName(srcFormat),
+	                FreeRDPGetColorFormatName(dstFormat));
+	PROFILER_CREATE(genericProf, name)
+	(void)_snprintf(name, sizeof(name), "%s->%s-OPTIMIZED", FreeRDPGetColorFormatName(srcFormat),
+	                FreeRDPGetColorFormatName(dstFormat));
+	PROFILER_CREATE(optProf, name)
+
+	if (!src || !dst)
+		goto fail;
+
+	for (size_t x = 0; x < 10; x++)
+	{
+		PROFILER_ENTER(genericProf)
+		const pstatus_t status1 = gen->copy_no_overlap(dst, dstFormat, dstride, 0, 0, w, h, src,
+		                                               srcFormat, sstride, 0, 0, NULL, 0);
+		PROFILER_EXIT(genericProf)
+		PROFILER_ENTER(optProf)
+		const pstatus_t status2 = prims->copy_no_overlap(dst, dstFormat, dstride, 0, 0, w, h, src,
+		                                                 srcFormat, sstride, 0, 0, NULL, 0);
+		PROFILER_EXIT(optProf)
+
+		if ((status1 != PRIMITIVES_SUCCESS) || (status2 != PRIMITIVES_SUCCESS))
+			goto fail;
+	}
+
+	PROFILER_PRINT_HEADER
+	PROFILER_PRINT(genericProf)
+	PROFILER_PRINT(optProf)
+	PROFILER_PRINT_FOOTER
+	rc = TRUE;
+fail:
+	PROFILER_FREE(genericProf)
+	PROFILER_FREE(optProf)
+	free(src);
+	free(dst);
+	return rc;
+}
+
 int TestPrimitivesCopy(int argc, char* argv[])
 {
 	WINPR_UNUSED(argc);
@@ -284,6 +366,18 @@ int TestPrimitivesCopy(int argc, char* argv[])
 		}
 	}
 
+	if (!test_copy_no_overlap_convert(verbose))
+		rc = -1;
+
+	if (g_TestPrimitivesPerformance)
+	{
+		if (!test_copy_no_overlap_convert_speed(PIXEL_FORMAT_BGRX32, PIXEL_FORMAT_RGB16) ||
+		    !test_copy_no_overlap_convert_speed(PIXEL_FORMAT_BGRX32, PIXEL_FORMAT_RGB24) ||
+		    !test_copy_no_overlap_convert_speed(PIXEL_FORMAT_RGB16, PIXEL_FORMAT_BGRX32) ||
+		    !test_copy_no_overlap_convert_speed(PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_RGBA32))
+			rc = -1;
+	}
+
 	if (verbose)
 		(void)fprintf(stderr, "runcount=%" PRIuz "\n", runcount);
 
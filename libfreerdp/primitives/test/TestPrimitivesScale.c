@@ -0,0 +1,297 @@
+/* test_scale.c
+ * vi:ts=4 sw=4
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0.
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <stdio.h>
+#include <math.h>
+
+#include <freerdp/config.h>
+#include <winpr/crypto.h>
+
+#include <winpr/sysinfo.h>
+#include <freerdp/codec/color.h>
+#include <freerdp/utils/profiler.h>
+#include "prim_test.h"
+
+/* weight of source pixel j for destination pixel x, bilinear when enlarging, area otherwise */
+static double ref_weight(UINT32 srcLen, UINT32 dstLen, UINT32 x, UINT32 j)
+{
+	const double scale = (double)srcLen / (double)dstLen;
+
+	if (dstLen < srcLen)
+	{
+		const double lo = fmax(x * scale, j);
+		const double hi = fmin((x + 1) * scale, j + 1.0);
+		return (hi > lo) ? (hi - lo) / scale : 0.0;
+	}
+
+	const double center = fmin(fmax((x + 0.5) * scale - 0.5, 0.0), srcLen - 1.0);
+	const double distance = fabs(center - j);
+	return (distance < 1.0) ? 1.0 - distance : 0.0;
+}
+
+/* the scaler rounds after each pass, allow for that */
+static BOOL check_reference(const BYTE* src, UINT32 srcWidth, UINT32 srcHeight, const BYTE* dst,
+                            UINT32 dstWidth, UINT32 dstHeight)
+{
+	for (UINT32 y = 0; y < dstHeight; y++)
+	{
+		for (UINT32 x = 0; x < dstWidth; x++)
+		{
+			for (size_t c = 0; c < 4; c++)
+			{
+				double value = 0.0;
+
+				for (UINT32 j = 0; j < srcHeight; j++)
+				{
+					const double wy = ref_weight(srcHeight, dstHeight, y, j);
+
+					if (wy == 0.0)
+						continue;
+
+					for (UINT32 i = 0; i < srcWidth; i++)
+						value += wy * ref_weight(srcWidth, dstWidth, x, i) *
+						         src[(1ULL * j * srcWidth + i) * 4 + c];
+				}
+
+				const BYTE actual = dst[(1ULL * y * dstWidth + x) * 4 + c];
+
+				if (fabs(value - actual) > 1.5)
+				{
+					printf("%" PRIu32 "x%" PRIu32 " -> %" PRIu32 "x%" PRIu32 " at %" PRIu32
+					       "x%" PRIu32 " channel %" PRIuz ": %" PRIu8 " instead of %f\n",
+					       srcWidth, srcHeight, dstWidth, dstHeight, x, y, c, actual, value);
+					return FALSE;
+				}
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL test_scale_func(UINT32 srcWidth, UINT32 srcHeight, UINT32 dstWidth, UINT32 dstHeight)
+{
+	BOOL rc = FALSE;
+	const UINT32 pad = 3;
+	const size_t srcStep = 4ULL * (srcWidth + pad);
+	const size_t dstStep = 4ULL * (dstWidth + pad);
+	const size_t dstSize = dstStep * (dstHeight + pad);
+	BYTE* src = calloc(srcHeight + pad, srcStep);
+	BYTE* packed = calloc(srcHeight, 4ULL * srcWidth);
+	BYTE* dstGeneric = calloc(1, dstSize);
+	BYTE* dstOptimized = calloc(1, dstSize);
+	BYTE* scaled = calloc(dstHeight, 4ULL * dstWidth);
+
+	if (!src || !packed || !dstGeneric || !dstOptimized || !scaled)
+		goto fail;
+
+	winpr_RAND(src, (srcHeight + pad) * srcStep);
+	winpr_RAND(dstGeneric, dstSize);
+	memcpy(dstOptimized, dstGeneric, dstSize);
+
+	if (generic->image_scale(dstGeneric, PIXEL_FORMAT_BGRA32, (UINT32)dstStep, pad, pad, dstWidth,
+	                         dstHeight, src, PIXEL_FORMAT_BGRA32, (UINT32)srcStep, pad, pad,
+	                         srcWidth, srcHeight) != PRIMITIVES_SUCCESS)
+		goto fail;
+
+	if (optimized->image_scale(dstOptimized, PIXEL_FORMAT_BGRA32, (UINT32)dstStep, pad, pad,
+	                           dstWidth, dstHeight, src, PIXEL_FORMAT_BGRA32, (UINT32)srcStep, pad,
+	                           pad, srcWidth, srcHeight) != PRIMITIVES_SUCCESS)
+		goto fail;
+
+	/* the optimized kernels use the same fixed point arithmetic, pixels outside are untouched */
+	if (memcmp(dstGeneric, dstOptimized, dstSize) != 0)
+	{
+		printf("%" PRIu32 "x%" PRIu32 " -> %" PRIu32 "x%" PRIu32 " optimized differs\n", srcWidth,
+		       srcHeight, dstWidth, dstHeight);
+		goto fail;
+	}
+
+	for (UINT32 y = 0; y < srcHeight; y++)
+		memcpy(&packed[4ULL * y * srcWidth], &src[(y + pad) * srcStep + 4ULL * pad],
+		       4ULL * srcWidth);
+
+	for (UINT32 y = 0; y < dstHeight; y++)
+		memcpy(&scaled[4ULL * y * dstWidth], &dstGeneric[(y + pad) * dstStep + 4ULL * pad],
+		       4ULL * dstWidth);
+
+	rc = check_reference(packed, srcWidth, srcHeight, scaled, dstWidth, dstHeight);
+fail:
+	free(src);
+	free(packed);
+	free(dstGeneric);
+	free(dstOptimized);
+	free(scaled);
+	return rc;
+}
+
+/* a solid color stays solid in any geometry and format combination */
+static BOOL test_scale_formats(void)
+{
+	const UINT32 formats[] = { PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_RGBX32, PIXEL_FORMAT_ARGB32,
+		                       PIXEL_FORMAT_BGR24,  PIXEL_FORMAT_RGB16 };
+	const UINT32 sizes[][4] = { { 64, 48, 37, 21 }, { 17, 9, 80, 33 }, { 1, 1, 7, 5 } };
+	BOOL rc = FALSE;
+	BYTE* src = calloc(80 * 48, 4);
+	BYTE* dst = calloc(80 * 48, 4);
+
+	if (!src || !dst)
+		goto fail;
+
+	for (size_t i = 0; i < ARRAYSIZE(formats); i++)
+	{
+		for (size_t j = 0; j < ARRAYSIZE(formats); j++)
+		{
+			const UINT32 srcFormat = formats[i];
+			const UINT32 dstFormat = formats[j];
+			const UINT32 color = FreeRDPGetColor(srcFormat, 0xF8, 0x80, 0x08, 0xFF);
+			const UINT32 expected =
+			    FreeRDPConvertColor(color, srcFormat, dstFormat, NULL);
+
+			for (size_t k = 0; k < ARRAYSIZE(sizes); k++)
+			{
+				const UINT32* size = sizes[k];
+
+				if (!freerdp_image_fill(src, srcFormat, 0, 0, 0, size[0], size[1], color))
+					goto fail;
+
+				if (optimized->image_scale(dst, dstFormat, 0, 0, 0, size[2], size[3], src,
+				                           srcFormat, 0, 0, 0, size[0],
+				                           size[1]) != PRIMITIVES_SUCCESS)
+					goto fail;
+
+				for (size_t x = 0; x < 1ULL * size[2] * size[3]; x++)
+				{
+					const UINT32 actual = FreeRDPReadColor(
+					    &dst[x * FreeRDPGetBytesPerPixel(dstFormat)], dstFormat);
+
+					if (actual != expected)
+					{
+						printf("%s -> %s %" PRIu32 "x%" PRIu32 ": 0x%08" PRIx32
+						       " instead of 0x%08" PRIx32 "\n",
+						       FreeRDPGetColorFormatName(srcFormat),
+						       FreeRDPGetColorFormatName(dstFormat), size[2], size[3], actual,
+						       expected);
+						goto fail;
+					}
+				}
+			}
+		}
+	}
+
+	rc = TRUE;
+fail:
+	free(src);
+	free(dst);
+	return rc;
+}
+
+static BOOL test_scale_speed(UINT32 srcWidth, UINT32 srcHeight, UINT32 dstWidth,
+                             UINT32 dstHeight)
+{
+	BOOL rc = FALSE;
+	char name[64] = { 0 };
+	BYTE* src = calloc(srcHeight, 4ULL * srcWidth);
+	BYTE* dst = calloc(dstHeight, 4ULL * dstWidth);
+
+	PROFILER_DEFINE(genericProf)
+	PROFILER_DEFINE(optProf)
+	(void)_snprintf(name, sizeof(name), "scale %" PRIu32 "x%" PRIu32 " generic", dstWidth,
+	                dstHeight);
+	PROFILER_CREATE(genericProf, name)
+	(void)_snprintf(name, sizeof(name), "scale %" PRIu32 "x%" PRIu32 " optimized", dstWidth,
+	                dstHeight);
+	PROFILER_CREATE(optProf, name)
+
+	if (!src || !dst)
+		goto fail;
+
+	winpr_RAND(src, 4ULL * srcWidth * srcHeight);
+
+	for (size_t x = 0; x < 10; x++)
+	{
+		PROFILER_ENTER(genericProf)
+		const pstatus_t status =
+		    generic->image_scale(dst, PIXEL_FORMAT_BGRX32, 0, 0, 0, dstWidth, dstHeight, src,
+		                         PIXEL_FORMAT_BGRX32, 0, 0, 0, srcWidth, srcHeight);
+		PROFILER_EXIT(genericProf)
+
+		if (status != PRIMITIVES_SUCCESS)
+			goto fail;
+
+		PROFILER_ENTER(optProf)
+		const pstatus_t optStatus =
+		    optimized->image_scale(dst, PIXEL_FORMAT_BGRX32, 0, 0, 0, dstWidth, dstHeight, src,
+		                           PIXEL_FORMAT_BGRX32, 0, 0, 0, srcWidth, srcHeight);
+		PROFILER_EXIT(optProf)
+
+		if (optStatus != PRIMITIVES_SUCCESS)
+			goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	PROFILER_PRINT_HEADER
+	PROFILER_PRINT(genericProf)
+	PROFILER_PRINT(optProf)
+	PROFILER_PRINT_FOOTER
+	PROFILER_FREE(genericProf)
+	PROFILER_FREE(optProf)
+	free(src);
+	free(dst);
+	return rc;
+}
+
+int TestPrimitivesScale(int argc, char* argv[])
+{
+	const UINT32 sizes[] = { 1, 2, 3, 5, 8, 13, 31, 64 };
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+	prim_test_setup(FALSE);
+
+	for (size_t x = 0; x < ARRAYSIZE(sizes); x++)
+	{
+		for (size_t y = 0; y < ARRAYSIZE(sizes); y++)
+		{
+			if (!test_scale_func(sizes[x], sizes[y], sizes[y], sizes[x]))
+				return 1;
+
+			if (!test_scale_func(sizes[x], sizes[x], sizes[y], sizes[y] + 1))
+				return 1;
+		}
+	}
+
+	if (!test_scale_func(1920 / 8, 1080 / 8, 1280 / 8, 720 / 8))
+		return 1;
+
+	if (!test_scale_func(1280 / 8, 720 / 8, 1920 / 8, 1080 / 8))
+		return 1;
+
+	if (!test_scale_formats())
+		return 1;
+
+	if (g_TestPrimitivesPerformance)
+	{
+		if (!test_scale_speed(1920, 1080, 1280, 720))
+			return 1;
+
+		if (!test_scale_speed(1280, 720, 1920, 1080))
+			return 1;
+
+		if (!test_scale_speed(3840, 2160, 1024, 576))
+			return 1;
+	}
+
+	return 0;
+}
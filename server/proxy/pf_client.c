@@ -668,6 +668,8 @@ static BOOL pf_client_set_security_settings(pClientContext* pc)
 		return FALSE;
 	if (!freerdp_settings_set_bool(settings, FreeRDP_NlaSecurity, config->ClientNlaSecurity))
 		return FALSE;
+	if (!freerdp_settings_set_bool(settings, FreeRDP_KernelTlsOffload, config->KernelTlsOffload))
+		return FALSE;
 
 	if (pf_client_use_proxy_smartcard_auth(settings))
 	{
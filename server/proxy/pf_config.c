@@ -106,6 +106,7 @@ static const char* key_security_client_nla = "ClientNlaSecurity";
 static const char* key_security_client_tls = "ClientTlsSecurity";
 static const char* key_security_client_rdp = "ClientRdpSecurity";
 static const char* key_security_client_fallback = "ClientAllowFallbackToTls";
+static const char* key_security_ktls = "KernelTlsOffload";
 
 static const char* section_certificates = "Certificates";
 static const char* key_private_key_file = "PrivateKeyFile";
@@ -346,6 +347,7 @@ static BOOL pf_config_load_security(wIniFile* ini, proxyConfig* config)
 	    pf_config_get_bool(ini, section_security, key_security_client_rdp, TRUE);
 	config->ClientAllowFallbackToTls =
 	    pf_config_get_bool(ini, section_security, key_security_client_fallback, TRUE);
+	config->KernelTlsOffload = pf_config_get_bool(ini, section_security, key_security_ktls, FALSE);
 	return TRUE;
 }
 
@@ -672,6 +674,8 @@ BOOL pf_server_config_dump(const char* file)
 	if (IniFile_SetKeyValueString(ini, section_security, key_security_client_fallback,
 	                              bool_str_true) < 0)
 		goto fail;
+	if (IniFile_SetKeyValueString(ini, section_security, key_security_ktls, bool_str_false) < 0)
+		goto fail;
 
 	/* Module configuration */
 	if (IniFile_SetKeyValueString(ini, section_plugins, key_plugins_modules,
@@ -797,6 +801,7 @@ void pf_server_config_print(const proxyConfig* config)
 	CONFIG_PRINT_BOOL(config, ClientTlsSecurity);
 	CONFIG_PRINT_BOOL(config, ClientRdpSecurity);
 	CONFIG_PRINT_BOOL(config, ClientAllowFallbackToTls);
+	CONFIG_PRINT_BOOL(config, KernelTlsOffload);
 
 	CONFIG_PRINT_SECTION(section_channels);
 	CONFIG_PRINT_BOOL(config, GFX);
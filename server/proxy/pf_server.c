@@ -534,6 +534,8 @@ static BOOL pf_server_initialize_peer_connection(freerdp_peer* peer)
 		return FALSE;
 	if (!freerdp_settings_set_bool(settings, FreeRDP_NlaSecurity, config->ServerNlaSecurity))
 		return FALSE;
+	if (!freerdp_settings_set_bool(settings, FreeRDP_KernelTlsOffload, config->KernelTlsOffload))
+		return FALSE;
 
 	if (!freerdp_settings_set_uint32(settings, FreeRDP_EncryptionLevel,
 	                                 ENCRYPTION_LEVEL_CLIENT_COMPATIBLE))
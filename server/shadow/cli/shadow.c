@@ -88,6 +88,8 @@ int main(int argc, char** argv)
 		  "Kerberos host ccache file for NLA authentication" },
 		{ "tls-secrets-file", COMMAND_LINE_VALUE_REQUIRED, "<file>", NULL, NULL, -1, NULL,
 		  "file where tls secrets shall be stored" },
+		{ "ktls", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueFalse, NULL, -1, NULL,
+		  "Offload TLS record encryption to the kernel if supported (Linux only)" },
 		{ "nsc", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueTrue, NULL, -1, NULL, "Allow NSC codec" },
 		{ "rfx", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueTrue, NULL, -1, NULL,
 		  "Allow RFX surface bits" },
@@ -0,0 +1,330 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <string.h>
+
+#include <winpr/assert.h>
+#include <winpr/crt.h>
+
+#include "shadow_bitmapcache.h"
+
+#include <freerdp/log.h>
+#define TAG CLIENT_TAG("shadow")
+
+/* cache index 0x7FFF is the waiting list, the 2 byte encoding allows 15 bits */
+#define SHADOW_BITMAP_CACHE_MAX_ENTRIES 0x7FFF
+#define SHADOW_BITMAP_CACHE_MAX_CELLS 5
+
+typedef struct
+{
+	UINT64 key;
+	UINT32 next; /* slot + 1 of the next entry in the same bucket, 0 ends the chain */
+	BOOL used;
+	BOOL referenced;
+} SHADOW_BITMAP_CACHE_SLOT;
+
+typedef struct
+{
+	UINT32 numEntries;
+	UINT32 maxPixels;
+	UINT32 hand; /* clock hand of the second chance replacement */
+	UINT32 bucketMask;
+	UINT32* buckets; /* slot + 1 of the first entry, 0 for an empty bucket */
+	SHADOW_BITMAP_CACHE_SLOT* slots;
+} SHADOW_BITMAP_CACHE_CELL;
+
+struct rdp_shadow_bitmap_cache
+{
+	UINT32 numCells;
+	SHADOW_BITMAP_CACHE_CELL cells[SHADOW_BITMAP_CACHE_MAX_CELLS];
+};
+
+static BOOL shadow_bitmap_cache_supported(const rdpSettings* settings)
+{
+	const BYTE* orders = freerdp_settings_get_pointer(settings, FreeRDP_OrderSupport);
+
+	/* only set if the client sent a revision 2 bitmap cache capability set */
+	if (!freerdp_settings_get_bool(settings, FreeRDP_BitmapCacheEnabled))
+		return FALSE;
+
+	if (!orders || !orders[NEG_MEMBLT_INDEX])
+		return FALSE;
+
+	return freerdp_settings_get_uint32(settings, FreeRDP_BitmapCacheV2NumCells) > 0;
+}
+
+static BOOL shadow_bitmap_cache_cell_init(SHADOW_BITMAP_CACHE_CELL* cell, UINT32 numEntries,
+                                          UINT32 maxPixels)
+{
+	UINT32 numBuckets = 1;
+
+	WINPR_ASSERT(cell);
+
+	cell->numEntries = MIN(numEntries, SHADOW_BITMAP_CACHE_MAX_ENTRIES);
+	cell->maxPixels = maxPixels;
+
+	if (cell->numEntries == 0)
+		return TRUE;
+
+	while (numBuckets < cell->numEntries)
+		numBuckets <<= 1;
+
+	cell->bucketMask = numBuckets - 1;
+	cell->buckets = (UINT32*)calloc(numBuckets, sizeof(UINT32));
+	cell->slots =
+	    (SHADOW_BITMAP_CACHE_SLOT*)calloc(cell->numEntries, sizeof(SHADOW_BITMAP_CACHE_SLOT));
+	return cell->buckets && cell->slots;
+}
+
+rdpShadowBitmapCache* shadow_bitmap_cache_new(const rdpSettings* settings)
+{
+	WINPR_ASSERT(settings);
+
+	if (!shadow_bitmap_cache_supported(settings))
+		return NULL;
+
+	rdpShadowBitmapCache* cache = (rdpShadowBitmapCache*)calloc(1, sizeof(rdpShadowBitmapCache));
+
+	if (!cache)
+		return NULL;
+
+	cache->numCells = MIN(freerdp_settings_get_uint32(settings, FreeRDP_BitmapCacheV2NumCells),
+	                      SHADOW_BITMAP_CACHE_MAX_CELLS);
+
+	for (UINT32 x = 0; x < cache->numCells; x++)
+	{
+		const BITMAP_CACHE_V2_CELL_INFO* info =
+		    freerdp_settings_get_pointer_array(settings, FreeRDP_BitmapCacheV2CellInfo, x);
+
+		/* cell n holds bitmaps of up to 256 * 4^n pixels */
+		if (!info || !shadow_bitmap_cache_cell_init(&cache->cells[x], info->numEntries,
+		                                            256u << (2u * x)))
+		{
+			shadow_bitmap_cache_free(cache);
+			return NULL;
+		}
+
+		WLog_DBG(TAG, "bitmap cache cell %" PRIu32 ": %" PRIu32 " entries of %" PRIu32 " pixels",
+		         x, cache->cells[x].numEntries, cache->cells[x].maxPixels);
+	}
+
+	return cache;
+}
+
+void shadow_bitmap_cache_free(rdpShadowBitmapCache* cache)
+{
+	if (!cache)
+		return;
+
+	for (UINT32 x = 0; x < SHADOW_BITMAP_CACHE_MAX_CELLS; x++)
+	{
+		free(cache->cells[x].buckets);
+		free(cache->cells[x].slots);
+	}
+
+	free(cache);
+}
+
+static INLINE UINT64 shadow_bitmap_cache_mix(UINT64 h, UINT64 k)
+{
+	k *= 0x87c37b91114253d5ull;
+	k = (k << 31) | (k >> 33);
+	k *= 0x4cf5ad432745937full;
+	h ^= k;
+	h = (h << 27) | (h >> 37);
+	return h * 5 + 0x52dce729;
+}
+
+UINT64 shadow_bitmap_cache_key(const BYTE* data, UINT32 step, UINT32 width, UINT32 height)
+{
+	/* BGRX32, drop the X byte of both pixels of a 64 bit word */
+	const UINT64 mask = 0x00FFFFFF00FFFFFFull;
+	UINT64 h = ((UINT64)width << 32) | height;
+
+	WINPR_ASSERT(data);
+
+	for (UINT32 y = 0; y < height; y++)
+	{
+		const BYTE* line = &data[1ull * y * step];
+		UINT32 x = 0;
+
+		for (; x + 2 <= width; x += 2)
+		{
+			UINT64 k = 0;
+			memcpy(&k, &line[4ull * x], sizeof(k));
+			h = shadow_bitmap_cache_mix(h, k & mask);
+		}
+
+		if (x < width)
+		{
+			UINT32 k = 0;
+			memcpy(&k, &line[4ull * x], sizeof(k));
+			h = shadow_bitmap_cache_mix(h, k & 0x00FFFFFF);
+		}
+	}
+
+	/* final avalanche, the low bits select the bucket */
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return h;
+}
+
+BOOL shadow_bitmap_cache_is_solid(const BYTE* data, UINT32 step, UINT32 width, UINT32 height,
+                                  UINT32* color)
+{
+	UINT32 first = 0;
+
+	WINPR_ASSERT(data);
+	WINPR_ASSERT(color);
+
+	if ((width == 0) || (height == 0))
+		return FALSE;
+
+	memcpy(&first, data, sizeof(first));
+	first &= 0x00FFFFFF;
+
+	for (UINT32 y = 0; y < height; y++)
+	{
+		const BYTE* line = &data[1ull * y * step];
+
+		for (UINT32 x = 0; x < width; x++)
+		{
+			UINT32 pixel = 0;
+			memcpy(&pixel, &line[4ull * x], sizeof(pixel));
+
+			if ((pixel & 0x00FFFFFF) != first)
+				return FALSE;
+		}
+	}
+
+	*color = first | 0xFF000000;
+	return TRUE;
+}
+
+static SHADOW_BITMAP_CACHE_CELL* shadow_bitmap_cache_cell(rdpShadowBitmapCache* cache,
+                                                          UINT32 width, UINT32 height,
+                                                          UINT32* cacheId)
+{
+	const UINT32 pixels = width * height;
+
+	WINPR_ASSERT(cache);
+	WINPR_ASSERT(cacheId);
+
+	for (UINT32 x = 0; x < cache->numCells; x++)
+	{
+		SHADOW_BITMAP_CACHE_CELL* cell = &cache->cells[x];
+
+		if ((pixels <= cell->maxPixels) && (cell->numEntries > 0))
+		{
+			*cacheId = x;
+			return cell;
+		}
+	}
+
+	return NULL;
+}
+
+static void shadow_bitmap_cache_unlink(SHADOW_BITMAP_CACHE_CELL* cell, UINT32 index)
+{
+	SHADOW_BITMAP_CACHE_SLOT* slot = &cell->slots[index];
+	UINT32* link = &cell->buckets[slot->key & cell->bucketMask];
+
+	while (*link != 0)
+	{
+		if (*link == index + 1)
+		{
+			*link = slot->next;
+			break;
+		}
+
+		link = &cell->slots[*link - 1].next;
+	}
+
+	slot->next = 0;
+	slot->used = FALSE;
+}
+
+BOOL shadow_bitmap_cache_find(rdpShadowBitmapCache* cache, UINT64 key, UINT32 width,
+                              UINT32 height, UINT32* cacheId, UINT32* cacheIndex)
+{
+	WINPR_ASSERT(cacheIndex);
+
+	SHADOW_BITMAP_CACHE_CELL* cell = shadow_bitmap_cache_cell(cache, width, height, cacheId);
+
+	if (!cell)
+		return FALSE;
+
+	for (UINT32 next = cell->buckets[key & cell->bucketMask]; next != 0;)
+	{
+		SHADOW_BITMAP_CACHE_SLOT* slot = &cell->slots[next - 1];
+
+		if (slot->key == key)
+		{
+			slot->referenced = TRUE;
+			*cacheIndex = next - 1;
+			return TRUE;
+		}
+
+		next = slot->next;
+	}
+
+	return FALSE;
+}
+
+BOOL shadow_bitmap_cache_put(rdpShadowBitmapCache* cache, UINT64 key, UINT32 width, UINT32 height,
+                             UINT32* cacheId, UINT32* cacheIndex)
+{
+	WINPR_ASSERT(cacheIndex);
+
+	SHADOW_BITMAP_CACHE_CELL* cell = shadow_bitmap_cache_cell(cache, width, height, cacheId);
+
+	if (!cell)
+		return FALSE;
+
+	/* second chance: skip entries hit since the hand passed them last */
+	for (;;)
+	{
+		SHADOW_BITMAP_CACHE_SLOT* slot = &cell->slots[cell->hand];
+
+		if (!slot->used || !slot->referenced)
+			break;
+
+		slot->referenced = FALSE;
+		cell->hand = (cell->hand + 1) % cell->numEntries;
+	}
+
+	const UINT32 index = cell->hand;
+	SHADOW_BITMAP_CACHE_SLOT* slot = &cell->slots[index];
+	UINT32* bucket = &cell->buckets[key & cell->bucketMask];
+
+	if (slot->used)
+		shadow_bitmap_cache_unlink(cell, index);
+
+	slot->key = key;
+	slot->used = TRUE;
+	slot->referenced = FALSE;
+	slot->next = *bucket;
+	*bucket = index + 1;
+
+	cell->hand = (cell->hand + 1) % cell->numEntries;
+	*cacheIndex = index;
+	return TRUE;
+}
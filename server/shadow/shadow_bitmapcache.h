@@ -0,0 +1,80 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_SERVER_SHADOW_BITMAPCACHE_H
+#define FREERDP_SERVER_SHADOW_BITMAPCACHE_H
+
+#include <winpr/wtypes.h>
+
+#include <freerdp/settings.h>
+
+/* Largest cache bitmap order sent, it has to fit into a single fast-path update */
+#define SHADOW_BITMAP_CACHE_MAX_ORDER_SIZE 0x3E00
+
+typedef struct rdp_shadow_bitmap_cache rdpShadowBitmapCache;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	/**
+	 * Server side mirror of the bitmap cache (revision 2) a client announced. It only tracks
+	 * which content is stored in which cache slot, the bitmaps themselves stay on the client.
+	 */
+	void shadow_bitmap_cache_free(rdpShadowBitmapCache* cache);
+
+	/**
+	 * @return a new cache mirror or NULL if the client does not support bitmap cache orders
+	 */
+	WINPR_ATTR_MALLOC(shadow_bitmap_cache_free, 1)
+	rdpShadowBitmapCache* shadow_bitmap_cache_new(const rdpSettings* settings);
+
+	/**
+	 * Hash of the pixel content of a BGRX32 tile, the X channel is ignored.
+	 */
+	UINT64 shadow_bitmap_cache_key(const BYTE* data, UINT32 step, UINT32 width, UINT32 height);
+
+	/**
+	 * Check if the tile is a single color
+	 *
+	 * @return TRUE if all pixels match, color receives the BGRX32 value
+	 */
+	BOOL shadow_bitmap_cache_is_solid(const BYTE* data, UINT32 step, UINT32 width, UINT32 height,
+	                                  UINT32* color);
+
+	/**
+	 * Look up a bitmap the client already has.
+	 *
+	 * @return TRUE if the client holds the bitmap at cacheId/cacheIndex
+	 */
+	BOOL shadow_bitmap_cache_find(rdpShadowBitmapCache* cache, UINT64 key, UINT32 width,
+	                              UINT32 height, UINT32* cacheId, UINT32* cacheIndex);
+
+	/**
+	 * Assign a slot to a bitmap, replacing one that was not used recently. The caller must send
+	 * the bitmap to the client with a cache bitmap order before referencing the slot.
+	 *
+	 * @return FALSE if no cache cell can hold a bitmap of that size
+	 */
+	BOOL shadow_bitmap_cache_put(rdpShadowBitmapCache* cache, UINT64 key, UINT32 width,
+	                             UINT32 height, UINT32* cacheId, UINT32* cacheIndex);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FREERDP_SERVER_SHADOW_BITMAPCACHE_H */
@@ -307,6 +307,12 @@ static BOOL shadow_client_context_new(freerdp_peer* peer, rdpContext* context)
 	if (!freerdp_settings_set_uint32(settings, FreeRDP_CompressionLevel, PACKET_COMPR_TYPE_RDP8))
 		return FALSE;
 
+	/* legacy bitmap updates use the client bitmap cache if it announces one */
+	BYTE* OrderSupport = freerdp_settings_get_pointer_writable(settings, FreeRDP_OrderSupport);
+	if (!OrderSupport)
+		return FALSE;
+	OrderSupport[NEG_MEMBLT_INDEX] = TRUE;
+
 	if (server->ipcSocket && (strncmp(bind_address, server->ipcSocket,
 	                                  strnlen(bind_address, sizeof(bind_address))) != 0))
 	{
@@ -362,10 +368,7 @@ static INLINE void shadow_client_mark_invalid(rdpShadowClient* client, UINT32 nu
 	/* Mark client invalid region. No rectangle means full screen */
 	if (numRects > 0)
 	{
-		for (UINT32 index = 0; index < numRects; index++)
-		{
-			region16_union_rect(&(client->invalidRegion), &(client->invalidRegion), &rects[index]);
-		}
+		region16_union_rects(&(client->invalidRegion), &(client->invalidRegion), rects, numRects);
 	}
 	else
 	{
@@ -1648,6 +1651,170 @@ static BOOL shadow_client_send_surface_bits(rdpShadowClient* client, BYTE* pSrcD
 	return ret;
 }
 
+static BOOL shadow_client_encode_bitmap(rdpShadowClient* client, const BYTE* pSrcData,
+                                        UINT32 nSrcStep, BITMAP_DATA* bitmap, BYTE* buffer)
+{
+	rdpContext* context = (rdpContext*)client;
+	rdpShadowEncoder* encoder = client->encoder;
+	const UINT32 SrcFormat = PIXEL_FORMAT_BGRX32;
+
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(encoder);
+	WINPR_ASSERT(bitmap);
+
+	const UINT32 bitsPerPixel = freerdp_settings_get_uint32(context->settings, FreeRDP_ColorDepth);
+
+	if (bitsPerPixel < 32)
+	{
+		const UINT32 bytesPerPixel = (bitsPerPixel + 7) / 8;
+		UINT32 DstSize = 64 * 64 * 4;
+
+		if (!interleaved_compress(encoder->interleaved, buffer, &DstSize, bitmap->width,
+		                          bitmap->height, pSrcData, SrcFormat, nSrcStep, bitmap->destLeft,
+		                          bitmap->destTop, NULL, bitsPerPixel))
+			return FALSE;
+
+		bitmap->bitmapDataStream = buffer;
+		bitmap->bitmapLength = DstSize;
+		bitmap->bitsPerPixel = bitsPerPixel;
+		bitmap->cbScanWidth = bitmap->width * bytesPerPixel;
+		bitmap->cbUncompressedSize = bitmap->width * bitmap->height * bytesPerPixel;
+	}
+	else
+	{
+		UINT32 dstSize = 0;
+		const BYTE* data = &pSrcData[(bitmap->destTop * nSrcStep) + (bitmap->destLeft * 4)];
+
+		buffer = freerdp_bitmap_compress_planar(encoder->planar, data, SrcFormat, bitmap->width,
+		                                        bitmap->height, nSrcStep, buffer, &dstSize);
+		if (!buffer)
+			return FALSE;
+
+		bitmap->bitmapDataStream = buffer;
+		bitmap->bitmapLength = dstSize;
+		bitmap->bitsPerPixel = 32;
+		bitmap->cbScanWidth = bitmap->width * 4;
+		bitmap->cbUncompressedSize = bitmap->width * bitmap->height * 4;
+	}
+
+	bitmap->cbCompFirstRowSize = 0;
+	bitmap->cbCompMainBodySize = bitmap->bitmapLength;
+	return TRUE;
+}
+
+static UINT32 shadow_client_order_color(UINT32 colorDepth, UINT32 color)
+{
+	/* the encoding clients expect for primary order colors, see gdi_decode_color */
+	switch (colorDepth)
+	{
+		case 15:
+			return FreeRDPConvertColor(color, PIXEL_FORMAT_BGRX32, PIXEL_FORMAT_RGB15, NULL);
+		case 16:
+			return FreeRDPConvertColor(color, PIXEL_FORMAT_BGRX32, PIXEL_FORMAT_RGB16, NULL);
+		default:
+			return FreeRDPConvertColor(color, PIXEL_FORMAT_BGRX32, PIXEL_FORMAT_BGR24, NULL);
+	}
+}
+
+/**
+ * Draw a tile with orders: solid tiles become an OpaqueRect if the client supports it,
+ * everything else is stored in the client bitmap cache (if not already there) and drawn with a
+ * MemBlt.
+ *
+ * @return 1 if the tile was drawn, 0 if it has to be sent as bitmap update, -1 on failure
+ */
+static int shadow_client_send_cached_bitmap(rdpShadowClient* client, const BYTE* pSrcData,
+                                            UINT32 nSrcStep, BITMAP_DATA* bitmap, BYTE* buffer,
+                                            UINT32 maxUpdateSize)
+{
+	rdpContext* context = (rdpContext*)client;
+	rdpShadowEncoder* encoder = client->encoder;
+	UINT32 cacheId = 0;
+	UINT32 cacheIndex = 0;
+	UINT32 color = 0;
+
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(encoder);
+	WINPR_ASSERT(bitmap);
+
+	rdpUpdate* update = context->update;
+	WINPR_ASSERT(update);
+
+	const UINT32 colorDepth = freerdp_settings_get_uint32(context->settings, FreeRDP_ColorDepth);
+	const BYTE* orders = freerdp_settings_get_pointer(context->settings, FreeRDP_OrderSupport);
+	const BYTE* data = &pSrcData[(bitmap->destTop * nSrcStep) + (bitmap->destLeft * 4)];
+
+	/* palette indices are not worth the trouble, without OpaqueRect the tile is cached */
+	if ((colorDepth > 8) && orders && orders[NEG_OPAQUE_RECT_INDEX] &&
+	    shadow_bitmap_cache_is_solid(data, nSrcStep, bitmap->width, bitmap->height, &color))
+	{
+		const OPAQUE_RECT_ORDER opaqueRect = {
+			.nLeftRect = WINPR_ASSERTING_INT_CAST(INT32, bitmap->destLeft),
+			.nTopRect = WINPR_ASSERTING_INT_CAST(INT32, bitmap->destTop),
+			.nWidth = WINPR_ASSERTING_INT_CAST(INT32, bitmap->width),
+			.nHeight = WINPR_ASSERTING_INT_CAST(INT32, bitmap->height),
+			.color = shadow_client_order_color(colorDepth, color)
+		};
+
+		return IFCALLRESULT(FALSE, update->primary->OpaqueRect, context, &opaqueRect) ? 1 : -1;
+	}
+
+	const UINT64 key = shadow_bitmap_cache_key(data, nSrcStep, bitmap->width, bitmap->height);
+
+	if (!shadow_bitmap_cache_find(encoder->bitmapCache, key, bitmap->width, bitmap->height,
+	                              &cacheId, &cacheIndex))
+	{
+		if (!shadow_client_encode_bitmap(client, pSrcData, nSrcStep, bitmap, buffer))
+			return -1;
+
+		/* large tiles do not fit into a single order, send them uncached */
+		const UINT32 limit = MIN(maxUpdateSize, SHADOW_BITMAP_CACHE_MAX_ORDER_SIZE);
+		if (bitmap->bitmapLength + 64 > limit)
+			return 0;
+
+		if (!shadow_bitmap_cache_put(encoder->bitmapCache, key, bitmap->width, bitmap->height,
+		                             &cacheId, &cacheIndex))
+			return 0;
+
+		CACHE_BITMAP_V2_ORDER cacheBitmap = { 0 };
+		cacheBitmap.cacheId = cacheId;
+		cacheBitmap.cacheIndex = cacheIndex;
+		cacheBitmap.bitmapBpp = bitmap->bitsPerPixel;
+		cacheBitmap.bitmapWidth = bitmap->width;
+		cacheBitmap.bitmapHeight = bitmap->height;
+		cacheBitmap.compressed = TRUE;
+		cacheBitmap.bitmapLength = bitmap->bitmapLength;
+		cacheBitmap.cbCompFirstRowSize = bitmap->cbCompFirstRowSize;
+		cacheBitmap.cbCompMainBodySize = bitmap->cbCompMainBodySize;
+		cacheBitmap.cbScanWidth = bitmap->cbScanWidth;
+		cacheBitmap.cbUncompressedSize = bitmap->cbUncompressedSize;
+		cacheBitmap.bitmapDataStream = bitmap->bitmapDataStream;
+
+		/* bitmapLength covers the compression header if there is one */
+		if (!freerdp_settings_get_bool(context->settings, FreeRDP_NoBitmapCompressionHeader))
+			cacheBitmap.bitmapLength += 8;
+
+		if (bitmap->width == bitmap->height)
+			cacheBitmap.flags |= CBR2_HEIGHT_SAME_AS_WIDTH;
+
+		if (!IFCALLRESULT(FALSE, update->secondary->CacheBitmapV2, context, &cacheBitmap))
+			return -1;
+	}
+
+	MEMBLT_ORDER memblt = { .cacheId = cacheId,
+		                    .colorIndex = 0,
+		                    .nLeftRect = WINPR_ASSERTING_INT_CAST(INT32, bitmap->destLeft),
+		                    .nTopRect = WINPR_ASSERTING_INT_CAST(INT32, bitmap->destTop),
+		                    .nWidth = WINPR_ASSERTING_INT_CAST(INT32, bitmap->width),
+		                    .nHeight = WINPR_ASSERTING_INT_CAST(INT32, bitmap->height),
+		                    .bRop = 0xCC, /* SRCCOPY */
+		                    .nXSrc = 0,
+		                    .nYSrc = 0,
+		                    .cacheIndex = cacheIndex };
+
+	return IFCALLRESULT(FALSE, update->primary->MemBlt, context, &memblt) ? 1 : -1;
+}
+
 /**
  * Function description
  *
@@ -1658,15 +1825,11 @@ static BOOL shadow_client_send_bitmap_update(rdpShadowClient* client, BYTE* pSrc
                                              UINT16 nWidth, UINT16 nHeight)
 {
 	BOOL ret = TRUE;
-	BYTE* data = NULL;
-	BYTE* buffer = NULL;
 	UINT32 k = 0;
 	UINT32 yIdx = 0;
 	UINT32 xIdx = 0;
 	UINT32 rows = 0;
 	UINT32 cols = 0;
-	UINT32 DstSize = 0;
-	UINT32 SrcFormat = 0;
 	BITMAP_DATA* bitmap = NULL;
 	rdpContext* context = (rdpContext*)client;
 	UINT32 totalBitmapSize = 0;
@@ -1703,7 +1866,8 @@ static BOOL shadow_client_send_bitmap_update(rdpShadowClient* client, BYTE* pSrc
 		}
 	}
 
-	SrcFormat = PIXEL_FORMAT_BGRX32;
+	if (!encoder->bitmapCache)
+		encoder->bitmapCache = shadow_bitmap_cache_new(settings);
 
 	if ((nXSrc % 4) != 0)
 	{
@@ -1761,39 +1925,29 @@ static BOOL shadow_client_send_bitmap_update(rdpShadowClient* client, BYTE* pSrc
 			if ((bitmap->width < 4) || (bitmap->height < 4))
 				continue;
 
-			if (freerdp_settings_get_uint32(settings, FreeRDP_ColorDepth) < 32)
+			if (encoder->bitmapCache)
 			{
-				UINT32 bitsPerPixel = freerdp_settings_get_uint32(settings, FreeRDP_ColorDepth);
-				UINT32 bytesPerPixel = (bitsPerPixel + 7) / 8;
-				DstSize = 64 * 64 * 4;
-				buffer = encoder->grid[k];
-				interleaved_compress(encoder->interleaved, buffer, &DstSize, bitmap->width,
-				                     bitmap->height, pSrcData, SrcFormat, nSrcStep,
-				                     bitmap->destLeft, bitmap->destTop, NULL, bitsPerPixel);
-				bitmap->bitmapDataStream = buffer;
-				bitmap->bitmapLength = DstSize;
-				bitmap->bitsPerPixel = bitsPerPixel;
-				bitmap->cbScanWidth = bitmap->width * bytesPerPixel;
-				bitmap->cbUncompressedSize = bitmap->width * bitmap->height * bytesPerPixel;
+				const int rc =
+				    shadow_client_send_cached_bitmap(client, pSrcData, nSrcStep, bitmap,
+				                                     encoder->grid[k], maxUpdateSize);
+
+				if (rc < 0)
+				{
+					ret = FALSE;
+					goto out;
+				}
+
+				/* drawn with orders */
+				if (rc > 0)
+					continue;
 			}
-			else
+			else if (!shadow_client_encode_bitmap(client, pSrcData, nSrcStep, bitmap,
+			                                      encoder->grid[k]))
 			{
-				UINT32 dstSize = 0;
-				buffer = encoder->grid[k];
-				data = &pSrcData[(bitmap->destTop * nSrcStep) + (bitmap->destLeft * 4)];
-
-				buffer =
-				    freerdp_bitmap_compress_planar(encoder->planar, data, SrcFormat, bitmap->width,
-				                                   bitmap->height, nSrcStep, buffer, &dstSize);
-				bitmap->bitmapDataStream = buffer;
-				bitmap->bitmapLength = dstSize;
-				bitmap->bitsPerPixel = 32;
-				bitmap->cbScanWidth = bitmap->width * 4;
-				bitmap->cbUncompressedSize = bitmap->width * bitmap->height * 4;
+				ret = FALSE;
+				goto out;
 			}
 
-			bitmap->cbCompFirstRowSize = 0;
-			bitmap->cbCompMainBodySize = bitmap->bitmapLength;
 			totalBitmapSize += bitmap->bitmapLength;
 			k++;
 		}
@@ -1907,8 +2061,7 @@ static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GF
 	EnterCriticalSection(&surface->lock);
 	rects = region16_rects(&(surface->invalidRegion), &numRects);
 
-	for (UINT32 index = 0; index < numRects; index++)
-		region16_union_rect(&invalidRegion, &invalidRegion, &rects[index]);
+	region16_union_rects(&invalidRegion, &invalidRegion, rects, numRects);
 
 	surfaceRect.left = 0;
 	surfaceRect.top = 0;
@@ -2366,8 +2519,16 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 				}
 				else
 				{
-					/* Send frame */
-					if (!shadow_client_send_surface_update(client, &gfxstatus))
+					/* Send frame, bracketed so its PDUs are gathered into full size writes */
+					if (!IFCALLRESULT(TRUE, update->BeginPaint, peer->context))
+					{
+						WLog_ERR(TAG, "Failed to begin frame");
+						break;
+					}
+
+					const BOOL sent = shadow_client_send_surface_update(client, &gfxstatus);
+
+					if (!IFCALLRESULT(TRUE, update->EndPaint, peer->context) || !sent)
 					{
 						WLog_ERR(TAG, "Failed to send surface update");
 						break;
@@ -394,6 +394,10 @@ static int shadow_encoder_uninit(rdpShadowEncoder* encoder)
 
 	shadow_encoder_uninit_progressive(encoder);
 
+	/* rebuilt on activation, bitmaps the client still holds are sent again */
+	shadow_bitmap_cache_free(encoder->bitmapCache);
+	encoder->bitmapCache = NULL;
+
 	return 1;
 }
 
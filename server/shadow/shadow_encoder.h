@@ -27,6 +27,8 @@
 
 #include <freerdp/server/shadow.h>
 
+#include "shadow_bitmapcache.h"
+
 struct rdp_shadow_encoder
 {
 	rdpShadowClient* client;
@@ -51,6 +53,7 @@ struct rdp_shadow_encoder
 	BITMAP_INTERLEAVED_CONTEXT* interleaved;
 	H264_CONTEXT* h264;
 	PROGRESSIVE_CONTEXT* progressive;
+	rdpShadowBitmapCache* bitmapCache; /* mirror of the client bitmap cache, NULL if unused */
 
 	UINT32 fps;
 	UINT32 maxFps;
@@ -558,6 +558,12 @@ int shadow_server_parse_command_line(rdpShadowServer* server, int argc, char** a
 			if (!freerdp_settings_set_string(settings, FreeRDP_TlsSecretsFile, arg->Value))
 				return fail_at(arg, COMMAND_LINE_ERROR);
 		}
+		CommandLineSwitchCase(arg, "ktls")
+		{
+			if (!freerdp_settings_set_bool(settings, FreeRDP_KernelTlsOffload,
+			                               arg->Value ? TRUE : FALSE))
+				return fail_at(arg, COMMAND_LINE_ERROR);
+		}
 		CommandLineSwitchDefault(arg)
 		{
 		}
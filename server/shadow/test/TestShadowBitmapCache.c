@@ -0,0 +1,307 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <winpr/crt.h>
+#include <winpr/crypto.h>
+
+#include <freerdp/settings.h>
+
+#include "shadow_bitmapcache.h"
+
+#define TILE_SIZE 64
+#define TILE_STEP (TILE_SIZE * 4)
+
+static void fill_tile(BYTE* data, UINT32 color)
+{
+	for (size_t x = 0; x < TILE_SIZE * TILE_SIZE; x++)
+		memcpy(&data[4 * x], &color, sizeof(color));
+}
+
+static BOOL test_key(void)
+{
+	BYTE a[TILE_STEP * TILE_SIZE] = { 0 };
+	BYTE b[TILE_STEP * TILE_SIZE] = { 0 };
+
+	winpr_RAND(a, sizeof(a));
+	memcpy(b, a, sizeof(b));
+
+	/* odd widths take the single pixel tail */
+	const UINT32 widths[] = { 1, 7, 16, TILE_SIZE };
+
+	for (size_t x = 0; x < ARRAYSIZE(widths); x++)
+	{
+		const UINT32 w = widths[x];
+
+		/* the X byte does not take part */
+		for (size_t i = 3; i < sizeof(b); i += 4)
+			b[i] = (BYTE)~a[i];
+
+		if (shadow_bitmap_cache_key(a, TILE_STEP, w, 9) !=
+		    shadow_bitmap_cache_key(b, TILE_STEP, w, 9))
+		{
+			printf("key depends on the X byte at width %" PRIu32 "\n", w);
+			return FALSE;
+		}
+
+		/* the last pixel of the last line does */
+		const size_t last = 8ull * TILE_STEP + 4ull * (w - 1);
+		b[last] ^= 0x01;
+
+		if (shadow_bitmap_cache_key(a, TILE_STEP, w, 9) ==
+		    shadow_bitmap_cache_key(b, TILE_STEP, w, 9))
+		{
+			printf("key ignores a color change at width %" PRIu32 "\n", w);
+			return FALSE;
+		}
+
+		b[last] ^= 0x01;
+	}
+
+	/* the same pixels in a different shape are a different bitmap */
+	if (shadow_bitmap_cache_key(a, 32, 8, 8) == shadow_bitmap_cache_key(a, 32, 4, 16))
+	{
+		printf("key ignores the dimensions\n");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL test_is_solid(void)
+{
+	BYTE data[TILE_STEP * TILE_SIZE] = { 0 };
+	UINT32 color = 0;
+
+	fill_tile(data, 0x00123456);
+
+	for (size_t i = 3; i < sizeof(data); i += 4)
+		data[i] = (BYTE)i;
+
+	if (!shadow_bitmap_cache_is_solid(data, TILE_STEP, TILE_SIZE, TILE_SIZE, &color) ||
+	    (color != 0xFF123456))
+	{
+		printf("solid tile with varying X bytes not detected (0x%08" PRIx32 ")\n", color);
+		return FALSE;
+	}
+
+	/* only the pixels inside the tile count */
+	data[TILE_STEP * 2 + 4 * 10] = 0x57;
+
+	if (shadow_bitmap_cache_is_solid(data, TILE_STEP, TILE_SIZE, TILE_SIZE, &color))
+	{
+		printf("tile with a different pixel detected as solid\n");
+		return FALSE;
+	}
+
+	if (!shadow_bitmap_cache_is_solid(data, TILE_STEP, 10, TILE_SIZE, &color) ||
+	    !shadow_bitmap_cache_is_solid(data, TILE_STEP, TILE_SIZE, 2, &color))
+	{
+		printf("solid sub tile not detected\n");
+		return FALSE;
+	}
+
+	if (shadow_bitmap_cache_is_solid(data, TILE_STEP, 0, TILE_SIZE, &color) ||
+	    shadow_bitmap_cache_is_solid(data, TILE_STEP, TILE_SIZE, 0, &color))
+	{
+		printf("empty tile detected as solid\n");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static rdpSettings* create_settings(BOOL memblt)
+{
+	/* cell 1 is announced without entries, cells hold 256, 1024 and 4096 pixels */
+	const BITMAP_CACHE_V2_CELL_INFO cells[] = { { 4, FALSE }, { 0, FALSE }, { 2, FALSE } };
+	rdpSettings* settings = freerdp_settings_new(0);
+
+	if (!settings)
+		return NULL;
+
+	BYTE* orders = freerdp_settings_get_pointer_writable(settings, FreeRDP_OrderSupport);
+
+	if (!orders || !freerdp_settings_set_bool(settings, FreeRDP_BitmapCacheEnabled, TRUE) ||
+	    !freerdp_settings_set_pointer_len(settings, FreeRDP_BitmapCacheV2CellInfo, cells,
+	                                      ARRAYSIZE(cells)))
+	{
+		freerdp_settings_free(settings);
+		return NULL;
+	}
+
+	orders[NEG_MEMBLT_INDEX] = memblt ? 1 : 0;
+	return settings;
+}
+
+static BOOL test_cells(rdpShadowBitmapCache* cache)
+{
+	const struct
+	{
+		UINT32 width;
+		UINT32 height;
+		BOOL fits;
+		UINT32 cacheId;
+	} tests[] = { { 1, 1, TRUE, 0 },     { 16, 16, TRUE, 0 }, { 17, 16, TRUE, 2 },
+		          { 32, 32, TRUE, 2 },   { 64, 64, TRUE, 2 }, { 65, 64, FALSE, 0 },
+		          { 128, 128, FALSE, 0 } };
+
+	for (size_t x = 0; x < ARRAYSIZE(tests); x++)
+	{
+		UINT32 cacheId = UINT32_MAX;
+		UINT32 cacheIndex = UINT32_MAX;
+		const BOOL fits = shadow_bitmap_cache_put(cache, 0x1000 + x, tests[x].width,
+		                                          tests[x].height, &cacheId, &cacheIndex);
+
+		if (fits != tests[x].fits)
+		{
+			printf("%" PRIu32 "x%" PRIu32 " %s a cell\n", tests[x].width, tests[x].height,
+			       fits ? "unexpectedly got" : "did not get");
+			return FALSE;
+		}
+
+		if (fits && (cacheId != tests[x].cacheId))
+		{
+			printf("%" PRIu32 "x%" PRIu32 " went to cell %" PRIu32 " instead of %" PRIu32 "\n",
+			       tests[x].width, tests[x].height, cacheId, tests[x].cacheId);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL expect_find(rdpShadowBitmapCache* cache, UINT64 key, BOOL found, UINT32 index)
+{
+	UINT32 cacheId = UINT32_MAX;
+	UINT32 cacheIndex = UINT32_MAX;
+
+	if (shadow_bitmap_cache_find(cache, key, 16, 16, &cacheId, &cacheIndex) != found)
+	{
+		printf("key %" PRIu64 " %s\n", key, found ? "not found" : "still cached");
+		return FALSE;
+	}
+
+	if (found && ((cacheId != 0) || (cacheIndex != index)))
+	{
+		printf("key %" PRIu64 " at %" PRIu32 "/%" PRIu32 " instead of 0/%" PRIu32 "\n", key,
+		       cacheId, cacheIndex, index);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL test_eviction(rdpShadowBitmapCache* cache)
+{
+	UINT32 cacheId = 0;
+	UINT32 cacheIndex = 0;
+
+	/* keys 0 to 3 fill the four slots of cell 0 in order, key 4 shares bucket 0 */
+	for (UINT64 key = 0; key < 4; key++)
+	{
+		if (!expect_find(cache, key, FALSE, 0))
+			return FALSE;
+
+		if (!shadow_bitmap_cache_put(cache, key, 16, 16, &cacheId, &cacheIndex) ||
+		    (cacheIndex != key))
+		{
+			printf("key %" PRIu64 " stored at %" PRIu32 "\n", key, cacheIndex);
+			return FALSE;
+		}
+	}
+
+	for (UINT64 key = 0; key < 4; key++)
+	{
+		if (!expect_find(cache, key, TRUE, (UINT32)key))
+			return FALSE;
+	}
+
+	/* all were hit, the hand clears them once and replaces slot 0 */
+	if (!shadow_bitmap_cache_put(cache, 4, 16, 16, &cacheId, &cacheIndex) || (cacheIndex != 0))
+	{
+		printf("key 4 stored at %" PRIu32 " instead of 0\n", cacheIndex);
+		return FALSE;
+	}
+
+	if (!expect_find(cache, 0, FALSE, 0) || !expect_find(cache, 4, TRUE, 0))
+		return FALSE;
+
+	/* the hand is at slot 1 now, slot 2 gets a second chance when key 6 is stored */
+	if (!expect_find(cache, 2, TRUE, 2))
+		return FALSE;
+
+	if (!shadow_bitmap_cache_put(cache, 5, 16, 16, &cacheId, &cacheIndex) || (cacheIndex != 1))
+	{
+		printf("key 5 stored at %" PRIu32 " instead of 1\n", cacheIndex);
+		return FALSE;
+	}
+
+	if (!shadow_bitmap_cache_put(cache, 6, 16, 16, &cacheId, &cacheIndex) || (cacheIndex != 3))
+	{
+		printf("key 6 stored at %" PRIu32 " instead of 3\n", cacheIndex);
+		return FALSE;
+	}
+
+	return expect_find(cache, 1, FALSE, 0) && expect_find(cache, 3, FALSE, 0) &&
+	       expect_find(cache, 2, TRUE, 2) && expect_find(cache, 4, TRUE, 0) &&
+	       expect_find(cache, 5, TRUE, 1) && expect_find(cache, 6, TRUE, 3);
+}
+
+static BOOL test_cache(void)
+{
+	BOOL rc = FALSE;
+	rdpShadowBitmapCache* cache = NULL;
+	rdpSettings* settings = create_settings(FALSE);
+
+	if (!settings)
+		goto fail;
+
+	/* MemBlt is required to draw from the cache */
+	cache = shadow_bitmap_cache_new(settings);
+
+	if (cache)
+	{
+		printf("cache created without MemBlt support\n");
+		goto fail;
+	}
+
+	freerdp_settings_free(settings);
+	settings = create_settings(TRUE);
+
+	if (!settings)
+		goto fail;
+
+	cache = shadow_bitmap_cache_new(settings);
+
+	if (!cache || !test_eviction(cache))
+		goto fail;
+
+	shadow_bitmap_cache_free(cache);
+	cache = shadow_bitmap_cache_new(settings);
+
+	if (!cache || !test_cells(cache))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	shadow_bitmap_cache_free(cache);
+	freerdp_settings_free(settings);
+	return rc;
+}
+
+int TestShadowBitmapCache(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!test_key())
+		return -1;
+
+	if (!test_is_solid())
+		return -1;
+
+	if (!test_cache())
+		return -1;
+
+	return 0;
+}
@@ -92,6 +92,21 @@ extern "C"
 	WINPR_API BOOL ClipboardSetData(wClipboard* clipboard, UINT32 formatId, const void* data,
 	                                UINT32 size);
 
+	/**
+	 * @brief Start synthesizing formatId from the current clipboard data in the background.
+	 *
+	 * Large conversions (e.g. image encoding) are run on a worker thread, a later call to
+	 * ClipboardGetData for the same format picks up the result. Small data is left to be
+	 * converted on demand.
+	 *
+	 * @param clipboard The clipboard to use
+	 * @param formatId The format that is expected to be requested
+	 *
+	 * @return TRUE if the format can be provided, FALSE otherwise
+	 * @since version 3.16.0
+	 */
+	WINPR_API BOOL ClipboardPrefetchData(wClipboard* clipboard, UINT32 formatId);
+
 	WINPR_API UINT64 ClipboardGetOwner(wClipboard* clipboard);
 	WINPR_API void ClipboardSetOwner(wClipboard* clipboard, UINT64 ownerId);
 
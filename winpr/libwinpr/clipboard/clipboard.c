@@ -22,6 +22,8 @@
 #include <winpr/crt.h>
 #include <winpr/collections.h>
 #include <winpr/wlog.h>
+#include <winpr/pool.h>
+#include <winpr/interlocked.h>
 
 #include <winpr/clipboard.h>
 
@@ -34,6 +36,29 @@
 
 const char* mime_text_plain = "text/plain";
 
+struct s_wClipboardCacheEntry
+{
+	LONG refCount;
+	BOOL listed;
+	BOOL accounted;
+
+	UINT64 ownerId;
+	UINT32 sequenceNumber;
+	UINT32 srcFormatId;
+	UINT32 dstFormatId;
+
+	BOOL pending;
+	HANDLE done;
+	void* data;
+	UINT32 size;
+
+	/* background synthesis input */
+	wClipboard* clipboard;
+	CLIPBOARD_SYNTHESIZE_FN pfnSynthesize;
+	void* srcData;
+	UINT32 srcSize;
+};
+
 /**
  * Clipboard (Windows):
  * msdn.microsoft.com/en-us/library/windows/desktop/ms648709/
@@ -139,6 +164,230 @@ static wClipboardSynthesizer* ClipboardFindSynthesizer(wClipboardFormat* format,
 	return NULL;
 }
 
+static void ClipboardCacheEntryRelease(void* obj)
+{
+	wClipboardCacheEntry* entry = obj;
+
+	if (!entry)
+		return;
+
+	if (InterlockedDecrement(&entry->refCount) != 0)
+		return;
+
+	if (entry->done)
+		(void)CloseHandle(entry->done);
+	free(entry->srcData);
+	free(entry->data);
+	free(entry);
+}
+
+static wClipboardCacheEntry* ClipboardCacheEntryNew(wClipboard* clipboard, UINT32 formatId)
+{
+	WINPR_ASSERT(clipboard);
+
+	wClipboardCacheEntry* entry = calloc(1, sizeof(wClipboardCacheEntry));
+	if (!entry)
+		return NULL;
+
+	entry->refCount = 1;
+	entry->ownerId = clipboard->ownerId;
+	entry->sequenceNumber = clipboard->sequenceNumber;
+	entry->srcFormatId = clipboard->formatId;
+	entry->dstFormatId = formatId;
+	entry->clipboard = clipboard;
+	return entry;
+}
+
+/* must be called with cacheLock held */
+static wClipboardCacheEntry* ClipboardCacheFind(wClipboard* clipboard, UINT32 formatId)
+{
+	WINPR_ASSERT(clipboard);
+
+	for (size_t x = 0; x < ArrayList_Count(clipboard->cache); x++)
+	{
+		wClipboardCacheEntry* entry = ArrayList_GetItem(clipboard->cache, x);
+
+		if ((entry->dstFormatId == formatId) && (entry->srcFormatId == clipboard->formatId) &&
+		    (entry->sequenceNumber == clipboard->sequenceNumber) &&
+		    (entry->ownerId == clipboard->ownerId))
+			return entry;
+	}
+	return NULL;
+}
+
+/* must be called with cacheLock held, drops the reference of the cache */
+static void ClipboardCacheUnlink(wClipboard* clipboard, wClipboardCacheEntry* entry)
+{
+	WINPR_ASSERT(clipboard);
+	WINPR_ASSERT(entry);
+
+	if (entry->accounted)
+		clipboard->cacheSize -= entry->size;
+	entry->accounted = FALSE;
+	entry->listed = FALSE;
+	ArrayList_Remove(clipboard->cache, entry);
+}
+
+static void ClipboardCacheClear(wClipboard* clipboard)
+{
+	WINPR_ASSERT(clipboard);
+
+	EnterCriticalSection(&clipboard->cacheLock);
+	for (size_t x = 0; x < ArrayList_Count(clipboard->cache); x++)
+	{
+		wClipboardCacheEntry* entry = ArrayList_GetItem(clipboard->cache, x);
+		entry->listed = FALSE;
+		entry->accounted = FALSE;
+	}
+	ArrayList_Clear(clipboard->cache);
+	clipboard->cacheSize = 0;
+	LeaveCriticalSection(&clipboard->cacheLock);
+}
+
+/**
+ * The data was replaced with identical content, carry the conversions of the previous sequence
+ * number over instead of synthesizing them again.
+ */
+static void ClipboardCacheRevalidate(wClipboard* clipboard, UINT32 previousSequenceNumber)
+{
+	WINPR_ASSERT(clipboard);
+
+	EnterCriticalSection(&clipboard->cacheLock);
+	for (size_t x = 0; x < ArrayList_Count(clipboard->cache); x++)
+	{
+		wClipboardCacheEntry* entry = ArrayList_GetItem(clipboard->cache, x);
+		if (entry->sequenceNumber == previousSequenceNumber)
+			entry->sequenceNumber = clipboard->sequenceNumber;
+	}
+	LeaveCriticalSection(&clipboard->cacheLock);
+}
+
+/**
+ * Serve formatId from the cache, waiting for a background synthesis in progress.
+ * On success *ppData is a copy owned by the caller.
+ */
+static BOOL ClipboardCacheLookup(wClipboard* clipboard, UINT32 formatId, void** ppData,
+                                 UINT32* pSize)
+{
+	WINPR_ASSERT(clipboard);
+	WINPR_ASSERT(ppData);
+	WINPR_ASSERT(pSize);
+
+	EnterCriticalSection(&clipboard->cacheLock);
+	wClipboardCacheEntry* entry = ClipboardCacheFind(clipboard, formatId);
+	if (entry)
+		InterlockedIncrement(&entry->refCount);
+	LeaveCriticalSection(&clipboard->cacheLock);
+
+	if (!entry)
+		return FALSE;
+
+	/* data and size are final once done is signaled */
+	if (entry->done)
+		(void)WaitForSingleObject(entry->done, INFINITE);
+
+	BOOL rc = FALSE;
+	if (entry->data)
+	{
+		void* data = malloc(entry->size + 1ull);
+		if (data)
+		{
+			CopyMemory(data, entry->data, entry->size);
+			*ppData = data;
+			*pSize = entry->size;
+			rc = TRUE;
+		}
+	}
+
+	ClipboardCacheEntryRelease(entry);
+	return rc;
+}
+
+static void ClipboardCacheStore(wClipboard* clipboard, UINT32 formatId, const void* data,
+                                UINT32 size)
+{
+	WINPR_ASSERT(clipboard);
+	WINPR_ASSERT(data);
+
+	/* Cheap conversions are not worth the copy */
+	if ((size < WINPR_CLIPBOARD_CACHE_MIN_SIZE) &&
+	    (clipboard->size < WINPR_CLIPBOARD_CACHE_MIN_SIZE))
+		return;
+
+	EnterCriticalSection(&clipboard->cacheLock);
+	if (ClipboardCacheFind(clipboard, formatId) ||
+	    (clipboard->cacheSize + size > WINPR_CLIPBOARD_CACHE_MAX_SIZE))
+		goto out;
+
+	wClipboardCacheEntry* entry = ClipboardCacheEntryNew(clipboard, formatId);
+	if (!entry)
+		goto out;
+
+	entry->data = malloc(size + 1ull);
+	if (!entry->data || !ArrayList_Append(clipboard->cache, entry))
+	{
+		ClipboardCacheEntryRelease(entry);
+		goto out;
+	}
+	CopyMemory(entry->data, data, size);
+	entry->size = size;
+	entry->listed = TRUE;
+	entry->accounted = TRUE;
+	clipboard->cacheSize += size;
+
+out:
+	LeaveCriticalSection(&clipboard->cacheLock);
+}
+
+static VOID CALLBACK ClipboardSynthesizeWork(WINPR_ATTR_UNUSED PTP_CALLBACK_INSTANCE instance,
+                                             PVOID context, PTP_WORK work)
+{
+	wClipboardCacheEntry* entry = context;
+	WINPR_ASSERT(entry);
+
+	wClipboard* clipboard = entry->clipboard;
+	WINPR_ASSERT(clipboard);
+
+	UINT32 size = entry->srcSize;
+	void* data = entry->pfnSynthesize(clipboard, entry->srcFormatId, entry->srcData, &size);
+
+	EnterCriticalSection(&clipboard->cacheLock);
+	free(entry->srcData);
+	entry->srcData = NULL;
+	entry->data = data;
+	entry->size = data ? size : 0;
+	entry->pending = FALSE;
+
+	if (entry->listed)
+	{
+		if (!data || (clipboard->cacheSize + size > WINPR_CLIPBOARD_CACHE_MAX_SIZE))
+			ClipboardCacheUnlink(clipboard, entry);
+		else
+		{
+			clipboard->cacheSize += size;
+			entry->accounted = TRUE;
+		}
+	}
+	(void)SetEvent(entry->done);
+
+	/* ClipboardDestroy acquires cacheLock after the idle event, so clipboard stays valid until
+	 * the lock is released here. */
+	if (--clipboard->pendingSyntheses == 0)
+		(void)SetEvent(clipboard->synthesisIdle);
+	LeaveCriticalSection(&clipboard->cacheLock);
+
+	ClipboardCacheEntryRelease(entry);
+	CloseThreadpoolWork(work);
+}
+
+static void ClipboardWaitSyntheses(wClipboard* clipboard)
+{
+	WINPR_ASSERT(clipboard);
+
+	if (clipboard->synthesisIdle)
+		(void)WaitForSingleObject(clipboard->synthesisIdle, INFINITE);
+}
+
 void ClipboardLock(wClipboard* clipboard)
 {
 	if (!clipboard)
@@ -169,6 +418,7 @@ BOOL ClipboardEmpty(wClipboard* clipboard)
 	clipboard->size = 0;
 	clipboard->formatId = 0;
 	clipboard->sequenceNumber++;
+	ClipboardCacheClear(clipboard);
 	return TRUE;
 }
 
@@ -224,6 +474,9 @@ UINT32 ClipboardRegisterFormat(wClipboard* clipboard, const char* name)
 	if (format)
 		return format->formatId;
 
+	/* Background syntheses read the format table */
+	ClipboardWaitSyntheses(clipboard);
+
 	if ((clipboard->numFormats + 1) >= clipboard->maxFormats)
 	{
 		UINT32 numFormats = clipboard->maxFormats * 2;
@@ -292,6 +545,7 @@ BOOL ClipboardRegisterSynthesizer(wClipboard* clipboard, UINT32 formatId, UINT32
 
 	synthesizer->syntheticId = syntheticId;
 	synthesizer->pfnSynthesize = pfnSynthesize;
+	synthesizer->threadSafe = FALSE;
 	return TRUE;
 }
 
@@ -390,6 +644,13 @@ static BOOL ClipboardInitFormats(wClipboard* clipboard)
 	if (!ClipboardInitSynthesizers(clipboard))
 		goto error;
 
+	for (UINT32 index = 0; index < clipboard->numFormats; index++)
+	{
+		format = &clipboard->formats[index];
+		for (UINT32 x = 0; x < format->numSynthesizers; x++)
+			format->synthesizers[x].threadSafe = TRUE;
+	}
+
 	return TRUE;
 error:
 
@@ -477,10 +738,19 @@ void* ClipboardGetData(wClipboard* clipboard, UINT32 formatId, UINT32* pSize)
 			return NULL;
 		}
 
-		DstSize = SrcSize;
-		pDstData = synthesizer->pfnSynthesize(clipboard, format->formatId, pSrcData, &DstSize);
-		if (pDstData)
+		if (ClipboardCacheLookup(clipboard, formatId, &pDstData, &DstSize))
 			*pSize = DstSize;
+		else
+		{
+			DstSize = SrcSize;
+			pDstData =
+			    synthesizer->pfnSynthesize(clipboard, format->formatId, pSrcData, &DstSize);
+			if (pDstData)
+			{
+				*pSize = DstSize;
+				ClipboardCacheStore(clipboard, formatId, pDstData, DstSize);
+			}
+		}
 	}
 
 	WLog_DBG(TAG, "getting formatId=%s [0x%08" PRIx32 "] data=%p, size=%" PRIu32,
@@ -502,38 +772,123 @@ BOOL ClipboardSetData(wClipboard* clipboard, UINT32 formatId, const void* data,
 	if (!format)
 		return FALSE;
 
-	free(clipboard->data);
+	void* copy = calloc(size + sizeof(WCHAR), sizeof(char));
 
-	clipboard->data = calloc(size + sizeof(WCHAR), sizeof(char));
-
-	if (!clipboard->data)
+	if (!copy)
 		return FALSE;
 
-	memcpy(clipboard->data, data, size);
+	memcpy(copy, data, size);
 
 	/* For string values we don´t know if they are '\0' terminated.
 	 * so set the size to the full length in bytes (e.g. string length + 1)
 	 */
+	UINT32 copySize = size;
 	switch (formatId)
 	{
 		case CF_TEXT:
 		case CF_OEMTEXT:
-			clipboard->size = (UINT32)(strnlen(clipboard->data, size) + 1UL);
+			copySize = (UINT32)(strnlen(copy, size) + 1UL);
 			break;
 		case CF_UNICODETEXT:
-			clipboard->size =
-			    (UINT32)((_wcsnlen(clipboard->data, size / sizeof(WCHAR)) + 1UL) * sizeof(WCHAR));
+			copySize = (UINT32)((_wcsnlen(copy, size / sizeof(WCHAR)) + 1UL) * sizeof(WCHAR));
 			break;
 		default:
-			clipboard->size = size;
 			break;
 	}
 
+	/* Applications tend to set the same data again before each conversion */
+	const BOOL unchanged = clipboard->data && (clipboard->formatId == formatId) &&
+	                       (clipboard->size == copySize) &&
+	                       (memcmp(clipboard->data, copy, copySize) == 0);
+	const UINT32 previousSequenceNumber = clipboard->sequenceNumber;
+
+	free(clipboard->data);
+	clipboard->data = copy;
+	clipboard->size = copySize;
 	clipboard->formatId = formatId;
 	clipboard->sequenceNumber++;
+
+	if (unchanged)
+		ClipboardCacheRevalidate(clipboard, previousSequenceNumber);
+	else
+		ClipboardCacheClear(clipboard);
 	return TRUE;
 }
 
+BOOL ClipboardPrefetchData(wClipboard* clipboard, UINT32 formatId)
+{
+	BOOL rc = FALSE;
+
+	if (!clipboard)
+		return FALSE;
+
+	wClipboardFormat* format = ClipboardFindFormat(clipboard, clipboard->formatId, NULL);
+
+	if (!format)
+		return FALSE;
+
+	if (formatId == format->formatId)
+		return TRUE;
+
+	wClipboardSynthesizer* synthesizer = ClipboardFindSynthesizer(format, formatId);
+
+	if (!synthesizer || !synthesizer->pfnSynthesize)
+		return FALSE;
+
+	/* Small data and synthesizers depending on clipboard state are converted on demand */
+	if ((clipboard->size < WINPR_CLIPBOARD_ASYNC_MIN_SIZE) || !synthesizer->threadSafe)
+		return TRUE;
+
+	EnterCriticalSection(&clipboard->cacheLock);
+	if (ClipboardCacheFind(clipboard, formatId))
+	{
+		rc = TRUE;
+		goto out;
+	}
+
+	wClipboardCacheEntry* entry = ClipboardCacheEntryNew(clipboard, formatId);
+	if (!entry)
+		goto out;
+
+	entry->pending = TRUE;
+	entry->pfnSynthesize = synthesizer->pfnSynthesize;
+	entry->srcSize = clipboard->size;
+	entry->srcData = malloc(clipboard->size + sizeof(WCHAR));
+	entry->done = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (!entry->srcData || !entry->done || !ArrayList_Append(clipboard->cache, entry))
+	{
+		ClipboardCacheEntryRelease(entry);
+		goto out;
+	}
+	CopyMemory(entry->srcData, clipboard->data, clipboard->size + sizeof(WCHAR));
+	entry->listed = TRUE;
+
+	/* reference held by the worker */
+	InterlockedIncrement(&entry->refCount);
+	clipboard->pendingSyntheses++;
+	(void)ResetEvent(clipboard->synthesisIdle);
+
+	PTP_WORK work = CreateThreadpoolWork(ClipboardSynthesizeWork, entry, NULL);
+	if (work)
+		SubmitThreadpoolWork(work);
+	else
+	{
+		WLog_WARN(TAG, "failed to submit synthesis of %s, converting on demand",
+		          ClipboardGetFormatName(clipboard, formatId));
+		if (--clipboard->pendingSyntheses == 0)
+			(void)SetEvent(clipboard->synthesisIdle);
+		entry->pending = FALSE;
+		(void)SetEvent(entry->done);
+		ClipboardCacheUnlink(clipboard, entry);
+		ClipboardCacheEntryRelease(entry);
+	}
+	rc = TRUE;
+
+out:
+	LeaveCriticalSection(&clipboard->cacheLock);
+	return rc;
+}
+
 UINT64 ClipboardGetOwner(wClipboard* clipboard)
 {
 	if (!clipboard)
@@ -547,6 +902,8 @@ void ClipboardSetOwner(wClipboard* clipboard, UINT64 ownerId)
 	if (!clipboard)
 		return;
 
+	if (clipboard->ownerId != ownerId)
+		ClipboardCacheClear(clipboard);
 	clipboard->ownerId = ownerId;
 }
 
@@ -590,6 +947,21 @@ wClipboard* ClipboardCreate(void)
 	if (!InitializeCriticalSectionAndSpinCount(&(clipboard->lock), 4000))
 		goto fail;
 
+	if (!InitializeCriticalSectionAndSpinCount(&(clipboard->cacheLock), 4000))
+		goto fail;
+
+	clipboard->synthesisIdle = CreateEvent(NULL, TRUE, TRUE, NULL);
+	if (!clipboard->synthesisIdle)
+	{
+		DeleteCriticalSection(&(clipboard->cacheLock));
+		goto fail;
+	}
+
+	clipboard->cache = ArrayList_New(FALSE);
+	if (!clipboard->cache)
+		goto fail;
+	ArrayList_Object(clipboard->cache)->fnObjectFree = ClipboardCacheEntryRelease;
+
 	clipboard->numFormats = 0;
 	clipboard->maxFormats = 64;
 	clipboard->formats = (wClipboardFormat*)calloc(clipboard->maxFormats, sizeof(wClipboardFormat));
@@ -613,6 +985,20 @@ void ClipboardDestroy(wClipboard* clipboard)
 	if (!clipboard)
 		return;
 
+	if (clipboard->synthesisIdle)
+	{
+		ClipboardWaitSyntheses(clipboard);
+
+		/* the last worker signals idle with cacheLock held */
+		EnterCriticalSection(&(clipboard->cacheLock));
+		ArrayList_Free(clipboard->cache);
+		clipboard->cache = NULL;
+		LeaveCriticalSection(&(clipboard->cacheLock));
+
+		(void)CloseHandle(clipboard->synthesisIdle);
+		DeleteCriticalSection(&(clipboard->cacheLock));
+	}
+
 	ArrayList_Free(clipboard->localFiles);
 	clipboard->localFiles = NULL;
 
@@ -29,8 +29,19 @@ typedef struct
 {
 	UINT32 syntheticId;
 	CLIPBOARD_SYNTHESIZE_FN pfnSynthesize;
+	/* built-in synthesizers only depend on their input and may run on a worker thread */
+	BOOL threadSafe;
 } wClipboardSynthesizer;
 
+/* Conversions of at least this size are kept in the synthesis cache */
+#define WINPR_CLIPBOARD_CACHE_MIN_SIZE (64u * 1024u)
+/* Upper bound of synthesized data kept per clipboard */
+#define WINPR_CLIPBOARD_CACHE_MAX_SIZE (128u * 1024u * 1024u)
+/* ClipboardPrefetchData only goes asynchronous for source data of at least this size */
+#define WINPR_CLIPBOARD_ASYNC_MIN_SIZE (1024u * 1024u)
+
+typedef struct s_wClipboardCacheEntry wClipboardCacheEntry;
+
 typedef struct
 {
 	UINT32 formatId;
@@ -66,6 +77,14 @@ struct s_wClipboard
 	wClipboardDelegate delegate;
 
 	CRITICAL_SECTION lock;
+
+	/* synthesized formats of the current data, guarded by cacheLock */
+
+	CRITICAL_SECTION cacheLock;
+	wArrayList* cache;
+	size_t cacheSize;
+	UINT32 pendingSyntheses;
+	HANDLE synthesisIdle;
 };
 
 WINPR_LOCAL BOOL ClipboardInitSynthesizers(wClipboard* clipboard);
@@ -43,22 +43,25 @@ static const char mime_tiff[] = "image/tiff";
 static const BYTE enc_base64url[] =
     "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
-static inline char* b64_encode(const BYTE* WINPR_RESTRICT data, size_t length, size_t* plen)
+static inline size_t b64_encoded_size(size_t length)
 {
-	WINPR_ASSERT(plen);
+	return (length + 3) * 4 / 3;
+}
+
+/**
+ * Encodes data to dst, which must hold at least b64_encoded_size(length) bytes.
+ * Returns the number of characters written.
+ */
+static inline size_t b64_encode(const BYTE* WINPR_RESTRICT data, size_t length,
+                                BYTE* WINPR_RESTRICT dst)
+{
+	WINPR_ASSERT(dst);
 	const BYTE* WINPR_RESTRICT alphabet = enc_base64url;
 	int c = 0;
 	size_t blocks = 0;
-	size_t outLen = (length + 3) * 4 / 3;
-	size_t extra = 0;
 
 	const BYTE* q = data;
-	const size_t alen = outLen + extra + 1ull;
-	BYTE* p = malloc(alen);
-	if (!p)
-		return NULL;
-
-	BYTE* ret = p;
+	BYTE* p = dst;
 
 	/* b1, b2, b3 are input bytes
 	 *
@@ -104,10 +107,7 @@ static inline char* b64_encode(const BYTE* WINPR_RESTRICT data, size_t length, s
 			break;
 	}
 
-	*p = 0;
-	*plen = WINPR_ASSERTING_INT_CAST(size_t, p - ret);
-
-	return (char*)ret;
+	return WINPR_ASSERTING_INT_CAST(size_t, p - dst);
 }
 
 /**
@@ -746,18 +746,10 @@ static void* clipboard_wrap_html(const char* mime, const char* idata, size_t ile
 
 	*plen = 0;
 
-	size_t b64len = 0;
-	char* b64 = b64_encode((const BYTE*)idata, ilength, &b64len);
-	if (!b64)
-		return NULL;
-
 	const size_t mimelen = strlen(mime);
-	wStream* s = Stream_New(NULL, b64len + 225 + mimelen);
+	wStream* s = Stream_New(NULL, b64_encoded_size(ilength) + 225 + mimelen);
 	if (!s)
-	{
-		free(b64);
 		return NULL;
-	}
 
 	char* startHTML = html_pre_write(s, "Version:0.9\r\nStartHTML:");
 	char* endHTML = html_pre_write(s, "EndHTML:");
@@ -777,7 +769,11 @@ static void* clipboard_wrap_html(const char* mime, const char* idata, size_t ile
 
 	const char base64[] = ";base64,";
 	Stream_Write(s, base64, strnlen(base64, sizeof(base64)));
-	Stream_Write(s, b64, b64len);
+
+	/* encode straight into the output instead of going through a temporary copy */
+	WINPR_ASSERT(Stream_GetRemainingCapacity(s) >= b64_encoded_size(ilength));
+	const size_t b64len = b64_encode((const BYTE*)idata, ilength, Stream_Pointer(s));
+	Stream_Seek(s, b64len);
 
 	const char end[] = "\"/></body>";
 	Stream_Write(s, end, strnlen(end, sizeof(end)));
@@ -792,7 +788,6 @@ static void* clipboard_wrap_html(const char* mime, const char* idata, size_t ile
 	const size_t pos = Stream_GetPosition(s);
 	*plen = WINPR_ASSERTING_INT_CAST(uint32_t, pos);
 	Stream_Free(s, FALSE);
-	free(b64);
 	return res;
 }
 
@@ -956,6 +951,24 @@ static void* clipboard_synthesize_text_html(wClipboard* clipboard, UINT32 format
 
 BOOL ClipboardInitSynthesizers(wClipboard* clipboard)
 {
+	/**
+	 * Formats looked up while synthesizing, registered upfront so that synthesizing never
+	 * modifies the format table (see ClipboardPrefetchData)
+	 */
+	{
+		const char* mimes[] = { mime_text_plain, mime_html, mime_ms_html, mime_webp,
+			                    mime_png,        mime_jpeg, mime_tiff };
+		for (size_t x = 0; x < ARRAYSIZE(mimes); x++)
+		{
+			if (ClipboardRegisterFormat(clipboard, mimes[x]) == 0)
+				return FALSE;
+		}
+		for (size_t x = 0; x < ARRAYSIZE(mime_bitmap); x++)
+		{
+			if (ClipboardRegisterFormat(clipboard, mime_bitmap[x]) == 0)
+				return FALSE;
+		}
+	}
 	/**
 	 * CF_TEXT
 	 */
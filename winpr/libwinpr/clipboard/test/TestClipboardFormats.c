@@ -234,6 +234,43 @@ int TestClipboardFormats(int argc, char* argv[])
 #endif
 	}
 
+	if (1)
+	{
+		/* large enough for background synthesis and the conversion cache */
+		const size_t length = 2ull * 1024ull * 1024ull;
+		WCHAR* text = calloc(length + 1, sizeof(WCHAR));
+		if (!text)
+			goto fail;
+
+		BOOL bSuccess = TRUE;
+		for (size_t round = 0; bSuccess && (round < 3); round++)
+		{
+			/* the second round sets identical data, the third one changes it */
+			const char first = (round < 2) ? 'a' : 'A';
+			for (size_t x = 0; x < length; x++)
+				text[x] = (WCHAR)(first + (x % 26));
+
+			bSuccess = ClipboardSetData(clipboard, CF_UNICODETEXT, text,
+			                            (UINT32)((length + 1) * sizeof(WCHAR)));
+			if (bSuccess)
+				bSuccess = ClipboardPrefetchData(clipboard, CF_TEXT);
+
+			for (size_t x = 0; bSuccess && (x < 2); x++)
+			{
+				UINT32 DstSize = 0;
+				char* pDstData = ClipboardGetData(clipboard, CF_TEXT, &DstSize);
+				bSuccess = pDstData && (strnlen(pDstData, DstSize) == length) &&
+				           (pDstData[0] == first) &&
+				           (pDstData[length - 1] == first + (char)((length - 1) % 26));
+				free(pDstData);
+			}
+		}
+		free(text);
+		(void)fprintf(stderr, "ClipboardPrefetchData: %" PRId32 "\n", bSuccess);
+		if (!bSuccess)
+			goto fail;
+	}
+
 	rc = 0;
 
 fail:
@@ -45,6 +45,7 @@
 #include <sys/file.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <unistd.h>
 
 #ifdef ANDROID
 #include <sys/vfs.h>
@@ -218,6 +219,63 @@ static BOOL FileSetFilePointerEx(HANDLE hFile, LARGE_INTEGER liDistanceToMove,
 	return TRUE;
 }
 
+/**
+ * Positional I/O for OVERLAPPED requests.
+ *
+ * The offset is taken from the OVERLAPPED structure and the operation completes synchronously.
+ * Unlike Windows the file pointer is not updated, so several threads may issue positional
+ * reads and writes on the same handle without serializing on a seek.
+ */
+static UINT64 FileOverlappedOffset(const OVERLAPPED* lpOverlapped)
+{
+	WINPR_ASSERT(lpOverlapped);
+	return (((UINT64)lpOverlapped->DUMMYUNIONNAME.DUMMYSTRUCTNAME.OffsetHigh) << 32) |
+	       lpOverlapped->DUMMYUNIONNAME.DUMMYSTRUCTNAME.Offset;
+}
+
+static BOOL FilePositionalIo(WINPR_FILE* file, BOOL write, void* buffer, DWORD length,
+                             LPDWORD lpTransferred, LPOVERLAPPED lpOverlapped)
+{
+	WINPR_ASSERT(file);
+	WINPR_ASSERT(lpOverlapped);
+
+	const UINT64 offset = FileOverlappedOffset(lpOverlapped);
+	if (offset > INT64_MAX)
+	{
+		SetLastError(ERROR_INVALID_PARAMETER);
+		return FALSE;
+	}
+
+	/* Commit data still buffered by stdio before bypassing it */
+	if (fflush(file->fp) != 0)
+	{
+		SetLastError(map_posix_err(errno));
+		return FALSE;
+	}
+
+	const int fd = fileno(file->fp);
+	ssize_t rc = 0;
+	do
+	{
+		if (write)
+			rc = pwrite(fd, buffer, length, (off_t)offset);
+		else
+			rc = pread(fd, buffer, length, (off_t)offset);
+	} while ((rc < 0) && (errno == EINTR));
+
+	if (rc < 0)
+	{
+		SetLastError(map_posix_err(errno));
+		return FALSE;
+	}
+
+	lpOverlapped->Internal = 0;
+	lpOverlapped->InternalHigh = (ULONG_PTR)rc;
+	if (lpTransferred)
+		*lpTransferred = (DWORD)rc;
+	return TRUE;
+}
+
 static BOOL FileRead(PVOID Object, LPVOID lpBuffer, DWORD nNumberOfBytesToRead,
                      LPDWORD lpNumberOfBytesRead, LPOVERLAPPED lpOverlapped)
 {
@@ -225,17 +283,15 @@ static BOOL FileRead(PVOID Object, LPVOID lpBuffer, DWORD nNumberOfBytesToRead,
 	WINPR_FILE* file = NULL;
 	BOOL status = TRUE;
 
-	if (lpOverlapped)
-	{
-		WLog_ERR(TAG, "WinPR does not support the lpOverlapped parameter");
-		SetLastError(ERROR_NOT_SUPPORTED);
-		return FALSE;
-	}
-
 	if (!Object)
 		return FALSE;
 
 	file = (WINPR_FILE*)Object;
+
+	if (lpOverlapped)
+		return FilePositionalIo(file, FALSE, lpBuffer, nNumberOfBytesToRead, lpNumberOfBytesRead,
+		                        lpOverlapped);
+
 	clearerr(file->fp);
 	io_status = fread(lpBuffer, 1, nNumberOfBytesToRead, file->fp);
 
@@ -265,18 +321,15 @@ static BOOL FileWrite(PVOID Object, LPCVOID lpBuffer, DWORD nNumberOfBytesToWrit
 	size_t io_status = 0;
 	WINPR_FILE* file = NULL;
 
-	if (lpOverlapped)
-	{
-		WLog_ERR(TAG, "WinPR does not support the lpOverlapped parameter");
-		SetLastError(ERROR_NOT_SUPPORTED);
-		return FALSE;
-	}
-
 	if (!Object)
 		return FALSE;
 
 	file = (WINPR_FILE*)Object;
 
+	if (lpOverlapped)
+		return FilePositionalIo(file, TRUE, WINPR_CAST_CONST_PTR_AWAY(lpBuffer, void*),
+		                        nNumberOfBytesToWrite, lpNumberOfBytesWritten, lpOverlapped);
+
 	clearerr(file->fp);
 	io_status = fwrite(lpBuffer, 1, nNumberOfBytesToWrite, file->fp);
 	if (io_status == 0 && ferror(file->fp))
@@ -80,6 +80,33 @@ int TestFileCreateFile(int argc, char* argv[])
 	if (memcmp(buffer, cmp, sizeof(buffer)) != 0)
 		rc = -1;
 
+	/* Positional I/O through OVERLAPPED offsets */
+	{
+		OVERLAPPED ov = { 0 };
+		char part[4] = { 0 };
+
+		ov.DUMMYUNIONNAME.DUMMYSTRUCTNAME.Offset = 5;
+		if (!ReadFile(handle, part, sizeof(part), &written, &ov))
+			rc = -1;
+
+		if ((written != sizeof(part)) || (memcmp(part, &buffer[5], sizeof(part)) != 0))
+			rc = -1;
+
+		ov.DUMMYUNIONNAME.DUMMYSTRUCTNAME.Offset = 0;
+		if (!WriteFile(handle, "SOME", 4, &written, &ov))
+			rc = -1;
+
+		if (written != 4)
+			rc = -1;
+
+		ov.DUMMYUNIONNAME.DUMMYSTRUCTNAME.Offset = 0;
+		if (!ReadFile(handle, part, sizeof(part), &written, &ov))
+			rc = -1;
+
+		if ((written != sizeof(part)) || (memcmp(part, "SOME", sizeof(part)) != 0))
+			rc = -1;
+	}
+
 	if (!CloseHandle(handle))
 		rc = -1;
 
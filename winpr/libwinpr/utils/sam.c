@@ -30,6 +30,12 @@
 #include <winpr/cast.h>
 #include <winpr/print.h>
 #include <winpr/file.h>
+#include <winpr/synch.h>
+#include <winpr/collections.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
 
 #include "../log.h"
 
@@ -42,12 +48,30 @@
 struct winpr_sam
 {
 	FILE* fp;
+	char* filename;
 	char* line;
 	char* buffer;
 	char* context;
 	BOOL readOnly;
 };
 
+/**
+ * Parsed content of a SAM file, shared by all WINPR_SAM instances opened on the same file.
+ * The index is rebuilt when the size, modification time or identity of the file changes.
+ */
+typedef struct
+{
+	INT64 size;
+	INT64 mtime;
+	UINT64 inode;
+	BOOL fresh;          /* modified in the second it was loaded, a later change might be missed */
+	wHashTable* entries; /* "user:domain" -> WINPR_SAM_ENTRY*, first line in the file wins */
+} WINPR_SAM_INDEX;
+
+static INIT_ONCE SamIndexOnce = INIT_ONCE_STATIC_INIT;
+static CRITICAL_SECTION SamIndexLock;
+static wHashTable* SamIndexes = NULL; /* filename -> WINPR_SAM_INDEX* */
+
 static WINPR_SAM_ENTRY* SamEntryFromDataA(LPCSTR User, DWORD UserLength, LPCSTR Domain,
                                           DWORD DomainLength)
 {
@@ -63,31 +87,57 @@ static WINPR_SAM_ENTRY* SamEntryFromDataA(LPCSTR User, DWORD UserLength, LPCSTR
 	return entry;
 }
 
-static BOOL SamAreEntriesEqual(const WINPR_SAM_ENTRY* a, const WINPR_SAM_ENTRY* b)
+static void SamIndexFree(void* obj)
+{
+	WINPR_SAM_INDEX* index = obj;
+
+	if (!index)
+		return;
+
+	HashTable_Free(index->entries);
+	free(index);
+}
+
+static void SamIndexEntryFree(void* obj)
 {
-	if (!a || !b)
+	SamFreeEntry(NULL, obj);
+}
+
+static BOOL CALLBACK SamIndexInit(WINPR_ATTR_UNUSED PINIT_ONCE once,
+                                  WINPR_ATTR_UNUSED PVOID param,
+                                  WINPR_ATTR_UNUSED PVOID* context)
+{
+	if (!InitializeCriticalSectionAndSpinCount(&SamIndexLock, 4000))
 		return FALSE;
-	if (a->UserLength != b->UserLength)
+
+	SamIndexes = HashTable_New(FALSE);
+	if (!SamIndexes)
 		return FALSE;
-	if (a->DomainLength != b->DomainLength)
+
+	if (!HashTable_SetupForStringData(SamIndexes, FALSE))
 		return FALSE;
-	if (a->UserLength > 0)
-	{
-		if (!a->User || !b->User)
-			return FALSE;
-		if (strncmp(a->User, b->User, a->UserLength) != 0)
-			return FALSE;
-	}
-	if (a->DomainLength > 0)
-	{
-		if (!a->Domain || !b->Domain)
-			return FALSE;
-		if (strncmp(a->Domain, b->Domain, a->DomainLength) != 0)
-			return FALSE;
-	}
+
+	wObject* obj = HashTable_ValueObject(SamIndexes);
+	WINPR_ASSERT(obj);
+	obj->fnObjectFree = SamIndexFree;
 	return TRUE;
 }
 
+static char* SamIndexKey(LPCSTR User, UINT32 UserLength, LPCSTR Domain, UINT32 DomainLength)
+{
+	char* key = calloc(1ull + UserLength + DomainLength + 1ull, sizeof(char));
+
+	if (!key)
+		return NULL;
+
+	if (User && (UserLength > 0))
+		memcpy(key, User, UserLength);
+	key[UserLength] = ':';
+	if (Domain && (DomainLength > 0))
+		memcpy(&key[UserLength + 1], Domain, DomainLength);
+	return key;
+}
+
 WINPR_SAM* SamOpen(const char* filename, BOOL readOnly)
 {
 	FILE* fp = NULL;
@@ -109,7 +159,6 @@ WINPR_SAM* SamOpen(const char* filename, BOOL readOnly)
 		if (!fp)
 			fp = winpr_fopen(filename, "w+");
 	}
-	free(allocatedFileName);
 
 	if (fp)
 	{
@@ -118,18 +167,26 @@ WINPR_SAM* SamOpen(const char* filename, BOOL readOnly)
 		if (!sam)
 		{
 			(void)fclose(fp);
+			free(allocatedFileName);
 			return NULL;
 		}
 
 		sam->readOnly = readOnly;
 		sam->fp = fp;
+		sam->filename = _strdup(filename);
+
+		if (!sam->filename)
+		{
+			SamClose(sam);
+			sam = NULL;
+		}
 	}
 	else
 	{
 		WLog_DBG(TAG, "Could not open SAM file!");
-		return NULL;
 	}
 
+	free(allocatedFileName);
 	return sam;
 }
 
@@ -288,56 +345,182 @@ void SamResetEntry(WINPR_SAM_ENTRY* entry)
 	ZeroMemory(entry->NtHash, sizeof(entry->NtHash));
 }
 
-WINPR_SAM_ENTRY* SamLookupUserA(WINPR_SAM* sam, LPCSTR User, UINT32 UserLength, LPCSTR Domain,
-                                UINT32 DomainLength)
+static BOOL SamIndexStat(WINPR_SAM* sam, INT64* size, INT64* mtime, UINT64* inode)
 {
-	size_t length = 0;
-	BOOL found = FALSE;
-	WINPR_SAM_ENTRY* search = SamEntryFromDataA(User, UserLength, Domain, DomainLength);
-	WINPR_SAM_ENTRY* entry = (WINPR_SAM_ENTRY*)calloc(1, sizeof(WINPR_SAM_ENTRY));
+	WINPR_ASSERT(sam);
+	WINPR_ASSERT(sam->fp);
 
-	if (!entry || !search)
-		goto fail;
+#if defined(_WIN32)
+	struct _stat64 st = { 0 };
+	if (_fstat64(_fileno(sam->fp), &st) != 0)
+		return FALSE;
+	*inode = 0;
+#else
+	struct stat st = { 0 };
+	if (fstat(fileno(sam->fp), &st) != 0)
+		return FALSE;
+	*inode = ((UINT64)st.st_dev << 32) ^ (UINT64)st.st_ino;
+#endif
+	*size = (INT64)st.st_size;
+	*mtime = (INT64)st.st_mtime;
+	return TRUE;
+}
 
+static BOOL SamIndexLoad(WINPR_SAM* sam, WINPR_SAM_INDEX* index)
+{
+	WINPR_ASSERT(sam);
+	WINPR_ASSERT(index);
+
+	HashTable_Clear(index->entries);
+
+	/* an empty or unreadable file is an empty database */
 	if (!SamLookupStart(sam))
-		goto fail;
+		return TRUE;
 
+	BOOL rc = TRUE;
 	while (sam->line != NULL)
 	{
-		length = strlen(sam->line);
-
-		if (length > 1)
+		if ((strlen(sam->line) > 1) && (sam->line[0] != '#'))
 		{
-			if (sam->line[0] != '#')
+			WINPR_SAM_ENTRY* entry = (WINPR_SAM_ENTRY*)calloc(1, sizeof(WINPR_SAM_ENTRY));
+
+			if (!entry)
 			{
-				if (!SamReadEntry(sam, entry))
-				{
-					goto out_fail;
-				}
-
-				if (SamAreEntriesEqual(entry, search))
-				{
-					found = 1;
-					break;
-				}
+				rc = FALSE;
+				break;
 			}
+
+			/* entries following a malformed line were never reachable, keep it that way */
+			if (!SamReadEntry(sam, entry))
+			{
+				SamFreeEntry(sam, entry);
+				break;
+			}
+
+			char* key =
+			    SamIndexKey(entry->User, entry->UserLength, entry->Domain, entry->DomainLength);
+			if (!key)
+			{
+				SamFreeEntry(sam, entry);
+				rc = FALSE;
+				break;
+			}
+
+			if (HashTable_Contains(index->entries, key))
+				SamFreeEntry(sam, entry);
+			else if (!HashTable_Insert(index->entries, key, entry))
+			{
+				SamFreeEntry(sam, entry);
+				free(key);
+				rc = FALSE;
+				break;
+			}
+			free(key);
 		}
 
-		SamResetEntry(entry);
 		sam->line = strtok_s(NULL, "\n", &sam->context);
 	}
 
-out_fail:
 	SamLookupFinish(sam);
-fail:
-	SamFreeEntry(sam, search);
 
-	if (!found)
+	if (!rc)
+		HashTable_Clear(index->entries);
+	return rc;
+}
+
+/* must be called with SamIndexLock held */
+static WINPR_SAM_INDEX* SamIndexGet(WINPR_SAM* sam)
+{
+	INT64 size = 0;
+	INT64 mtime = 0;
+	UINT64 inode = 0;
+
+	WINPR_ASSERT(sam);
+
+	if (!SamIndexStat(sam, &size, &mtime, &inode))
+		return NULL;
+
+	WINPR_SAM_INDEX* index = HashTable_GetItemValue(SamIndexes, sam->filename);
+
+	if (index && !index->fresh && (index->size == size) && (index->mtime == mtime) &&
+	    (index->inode == inode))
+		return index;
+
+	if (!index)
+	{
+		index = (WINPR_SAM_INDEX*)calloc(1, sizeof(WINPR_SAM_INDEX));
+		if (!index)
+			return NULL;
+
+		index->entries = HashTable_New(FALSE);
+		if (!index->entries || !HashTable_SetupForStringData(index->entries, FALSE))
+		{
+			SamIndexFree(index);
+			return NULL;
+		}
+
+		wObject* obj = HashTable_ValueObject(index->entries);
+		WINPR_ASSERT(obj);
+		obj->fnObjectFree = SamIndexEntryFree;
+
+		if (!HashTable_Insert(SamIndexes, sam->filename, index))
+		{
+			SamIndexFree(index);
+			return NULL;
+		}
+	}
+
+	if (!SamIndexLoad(sam, index))
 	{
-		SamFreeEntry(sam, entry);
+		HashTable_Remove(SamIndexes, sam->filename);
 		return NULL;
 	}
 
+	index->size = size;
+	index->mtime = mtime;
+	index->inode = inode;
+	index->fresh = (mtime >= (INT64)time(NULL));
+	WLog_DBG(TAG, "Indexed %" PRIuz " SAM entries of %s", HashTable_Count(index->entries),
+	         sam->filename);
+	return index;
+}
+
+WINPR_SAM_ENTRY* SamLookupUserA(WINPR_SAM* sam, LPCSTR User, UINT32 UserLength, LPCSTR Domain,
+                                UINT32 DomainLength)
+{
+	WINPR_SAM_ENTRY* entry = NULL;
+
+	if (!sam || !sam->fp || !sam->filename)
+		return NULL;
+
+	if (!InitOnceExecuteOnce(&SamIndexOnce, SamIndexInit, NULL, NULL))
+		return NULL;
+
+	char* key = SamIndexKey(User, UserLength, Domain, DomainLength);
+	if (!key)
+		return NULL;
+
+	EnterCriticalSection(&SamIndexLock);
+	WINPR_SAM_INDEX* index = SamIndexGet(sam);
+
+	if (index)
+	{
+		const WINPR_SAM_ENTRY* found = HashTable_GetItemValue(index->entries, key);
+
+		if (found)
+		{
+			entry = SamEntryFromDataA(found->User, found->UserLength, found->Domain,
+			                          found->DomainLength);
+			if (entry)
+			{
+				memcpy(entry->LmHash, found->LmHash, sizeof(entry->LmHash));
+				memcpy(entry->NtHash, found->NtHash, sizeof(entry->NtHash));
+			}
+		}
+	}
+
+	LeaveCriticalSection(&SamIndexLock);
+	free(key);
 	return entry;
 }
 
@@ -372,6 +555,7 @@ void SamClose(WINPR_SAM* sam)
 	{
 		if (sam->fp)
 			(void)fclose(sam->fp);
+		free(sam->filename);
 		free(sam);
 	}
 }
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <winpr/crt.h>
+#include <winpr/path.h>
+#include <winpr/file.h>
+#include <winpr/sam.h>
+
+#define SAM_HASH_A "0123456789abcdef0123456789abcdef"
+#define SAM_HASH_B "fedcba9876543210fedcba9876543210"
+
+static BOOL write_sam(const char* filename, const char* content)
+{
+	FILE* fp = winpr_fopen(filename, "w");
+
+	if (!fp)
+		return FALSE;
+
+	const size_t len = strlen(content);
+	const BOOL rc = fwrite(content, 1, len, fp) == len;
+	(void)fclose(fp);
+	return rc;
+}
+
+static BOOL check_user(const char* filename, const char* user, const char* domain, BYTE first)
+{
+	BOOL rc = FALSE;
+	WINPR_SAM* sam = SamOpen(filename, TRUE);
+
+	if (!sam)
+		return FALSE;
+
+	const UINT32 domainLength = domain ? (UINT32)strlen(domain) : 0;
+	WINPR_SAM_ENTRY* entry = SamLookupUserA(sam, user, (UINT32)strlen(user), domain, domainLength);
+
+	if (first == 0)
+		rc = (entry == NULL);
+	else if (entry)
+	{
+		rc = (entry->UserLength == strlen(user)) && (entry->DomainLength == domainLength) &&
+		     (strncmp(entry->User, user, entry->UserLength) == 0) && (entry->NtHash[0] == first);
+	}
+
+	SamFreeEntry(sam, entry);
+	SamClose(sam);
+
+	if (!rc)
+		printf("lookup of %s\\%s failed\n", domain ? domain : "", user);
+	return rc;
+}
+
+int TestSam(int argc, char* argv[])
+{
+	int rc = -1;
+	char* filename = GetCombinedPath(TEST_BINARY_PATH, "TestSam.sam");
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!filename)
+		return -1;
+
+	if (!write_sam(filename, "# comment\n"
+	                         "User1:Domain1:" SAM_HASH_A ":" SAM_HASH_A ":::\n"
+	                         "User1::" SAM_HASH_A ":" SAM_HASH_B ":::\n"
+	                         "User1:Domain1:" SAM_HASH_B ":" SAM_HASH_B ":::\n"))
+		goto fail;
+
+	if (!check_user(filename, "User1", "Domain1", 0x01))
+		goto fail;
+	if (!check_user(filename, "User1", NULL, 0xfe))
+		goto fail;
+	if (!check_user(filename, "User2", NULL, 0))
+		goto fail;
+	if (!check_user(filename, "User", "1:Domain1", 0))
+		goto fail;
+
+	/* a different size invalidates the index */
+	if (!write_sam(filename, "User2::" SAM_HASH_A ":" SAM_HASH_A ":::\n"))
+		goto fail;
+
+	if (!check_user(filename, "User1", NULL, 0))
+		goto fail;
+	if (!check_user(filename, "User2", NULL, 0x01))
+		goto fail;
+
+	/* same size and, most likely, the same modification time */
+	if (!write_sam(filename, "User2::" SAM_HASH_B ":" SAM_HASH_B ":::\n"))
+		goto fail;
+
+	if (!check_user(filename, "User2", NULL, 0xfe))
+		goto fail;
+
+	rc = 0;
+fail:
+	(void)winpr_DeleteFile(filename);
+	free(filename);
+	return rc;
+}